@@ -0,0 +1,136 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+// 3rd-parties
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+
+// Src
+#include "lfjson/lfjson.h"
+using namespace  lfjson;
+
+// Utils
+#include "bench_utils.h"
+
+// Std
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cassert>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+
+#define AGGREGATE_MAIN_LOOPS    5
+static_assert(AGGREGATE_MAIN_LOOPS  > 0, "AGGREGATE_MAIN_LOOPS <= 0");
+#define AGGREGATE_INNER_LOOPS   1000  // ensure min time Vs clock resolution
+static_assert(AGGREGATE_INNER_LOOPS > 0, "AGGREGATE_INNER_LOOPS <= 0");
+
+// Median time (ms) of 'func' over main loops
+template <class Func>
+double bench_aggregate_time(Func func)
+{
+  std::vector<double> times;
+  times.reserve(AGGREGATE_MAIN_LOOPS);
+  for (int i = 0; i < AGGREGATE_MAIN_LOOPS; ++i)
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    for (int j = 0; j < AGGREGATE_INNER_LOOPS; ++j)
+      func();
+    
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> diff = end - start;
+    times.push_back(diff.count() * 1000.);
+  }
+  std::sort(times.begin(), times.end());
+  return times[(times.size() - 1) / 2];
+}
+
+void bench_aggregate(const std::vector<std::string>& filePaths)
+{
+  for (const auto& filePath : filePaths)
+  {
+    // Read file to memory
+    std::ifstream ifs(filePath, std::ifstream::in);
+    assert(ifs.good());
+    std::string json(std::istreambuf_iterator<char>{ifs}, {});
+    
+    DynamicDocument doc;
+    {
+      auto handler = doc.makeHandler();
+      RapidHandler<> rapidHandler(handler);
+      
+      rapidjson::Reader reader;
+      rapidjson::StringStream ss(json.c_str());
+      
+      reader.Parse(ss, rapidHandler);
+      handler.finalize();
+    }
+    
+    // Specialized root arrays only
+    const ConstValue& rt = doc.croot();
+    if (!rt.isDArray() && !rt.isBArray())
+      continue;
+    
+    std::cout << "\n------------------------------\n" << std::endl;
+    std::cout << "FilePath: " << filePath << "\n" << std::endl;
+    
+    volatile double sink = 0.;
+    double loopTime, scalarTime, simdTime;
+    if (rt.isDArray())
+    {
+      const double*  data = rt.darrayValues();
+      const uint32_t size = rt.darraySize();
+      
+      // Hand-written loop
+      loopTime = bench_aggregate_time([&]() {
+        double sum = 0., mn = data[0], mx = data[0];
+        for (uint32_t i = 0; i < size; ++i)
+        {
+          sum += data[i];
+          mn = std::min(mn, data[i]);
+          mx = std::max(mx, data[i]);
+        }
+        sink = sink + sum + mn + mx;
+      });
+      
+      // Kernels
+      helper::simdEnabled() = false;
+      scalarTime = bench_aggregate_time([&]() { sink = sink + darraySum(rt) + darrayMin(rt) + darrayMax(rt); });
+      helper::simdEnabled() = true;
+      simdTime   = bench_aggregate_time([&]() { sink = sink + darraySum(rt) + darrayMin(rt) + darrayMax(rt); });
+      
+      std::cout << "DArray sum+min+max (" << size << ")" << std::endl;
+    }
+    else
+    {
+      const bool*    data = rt.barrayValues();
+      const uint32_t size = rt.barraySize();
+      
+      loopTime = bench_aggregate_time([&]() {
+        uint32_t count = 0u;
+        for (uint32_t i = 0; i < size; ++i)
+          count += data[i] ? 1u : 0u;
+        sink = sink + count;
+      });
+      
+      helper::simdEnabled() = false;
+      scalarTime = bench_aggregate_time([&]() { sink = sink + barraySum(rt); });
+      helper::simdEnabled() = true;
+      simdTime   = bench_aggregate_time([&]() { sink = sink + barraySum(rt); });
+      
+      std::cout << "BArray count (" << size << ")" << std::endl;
+    }
+    
+    std::cout << "-> Loop median:   " << loopTime   << " ms" << std::endl;
+    std::cout << "-> Scalar median: " << scalarTime << " ms" << std::endl;
+    std::cout << "-> SIMD median:   " << simdTime   << " ms" << std::endl;
+    std::cout << "-> Speedup:       " << loopTime / simdTime << " x" << std::endl;
+  }
+}
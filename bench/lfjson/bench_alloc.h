@@ -0,0 +1,93 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+// 3rd-parties
+#include "rapidjson/reader.h"
+
+// Src
+#include "lfjson/lfjson.h"
+#include "lfjson/ProfilingAllocator.h"
+using namespace  lfjson;
+
+// Utils
+#include "bench_utils.h"
+#include "bench_registry.h"
+
+// Std
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+
+#define ALLOC_SAMPLES   5
+
+using ProfiledDocument = Document<LFJ_DOCUMENT_DFLT_CHUNKSIZE, ProfilingAllocator>;
+
+bool bench_alloc_parse(ProfiledDocument& doc, const std::string& json, bool shrink)
+{
+  auto handler = doc.makeHandler();
+  RapidHandler<LFJ_DOCUMENT_DFLT_CHUNKSIZE, ProfilingAllocator> rapidHandler(handler);
+  rapidjson::Reader reader;
+  rapidjson::StringStream ss(json.c_str());
+  if (!reader.Parse(ss, rapidHandler))
+    return false;
+  handler.finalize(shrink);
+  return true;
+}
+
+// Base allocator requests by origin (see AllocOrigin) for each input
+// Row: parse time with profiling, metrics '<origin>_kb' in use at the overall peak, 'peak_kb' and 'final_kb'
+// Free text: per origin requests, cumulated and peak bytes, size histogram (log2 classes)
+void bench_alloc(BenchContext& ctx)
+{
+  for (const auto& filePath : ctx.files())
+  {
+    const std::string json = BenchContext::readFile(filePath);
+    const std::string input = BenchContext::inputName(filePath);
+    
+    ctx.measure(input, "profiled", json.size(), ALLOC_SAMPLES, [&]() {
+      ProfiledDocument doc;
+      if (!bench_alloc_parse(doc, json, true))
+        exit(1);
+    });
+    
+    ProfiledDocument doc;
+    if (!bench_alloc_parse(doc, json, true))
+      exit(1);
+    const ProfilingAllocator& alc = doc.baseAllocator();
+    for (int i = 0; i < ProfilingAllocator::OriginCount; ++i)
+    {
+      const AllocOrigin origin = (AllocOrigin)i;
+      ctx.annotate(std::string(ProfilingAllocator::name(origin)) + "_kb", alc.stats(origin).atPeak / 1024.);
+    }
+    ctx.annotate("peak_kb", alc.peak() / 1024.);
+    ctx.annotate("final_kb", alc.allocated() / 1024.);
+    
+    std::cout << "\n------------------------------\n" << std::endl;
+    std::cout << "FilePath: " << filePath << "\n" << std::endl;
+    std::cout << std::left << std::setw(18) << "origin" << std::right << std::setw(10) << "requests"
+              << std::setw(14) << "total B" << std::setw(14) << "peak B" << std::setw(14) << "at peak B"
+              << std::setw(14) << "final B" << "   sizes (2^class: requests)" << std::endl;
+    for (int i = 0; i < ProfilingAllocator::OriginCount; ++i)
+    {
+      const AllocOrigin origin = (AllocOrigin)i;
+      const auto& stats = alc.stats(origin);
+      std::cout << std::left << std::setw(18) << ProfilingAllocator::name(origin) << std::right
+                << std::setw(10) << stats.count << std::setw(14) << stats.total << std::setw(14) << stats.peak
+                << std::setw(14) << stats.atPeak << std::setw(14) << stats.allocated << "  ";
+      for (uint32_t c = 0u; c < ProfilingAllocator::SizeClasses; ++c)
+      {
+        if (stats.sizes[c] > 0u)
+          std::cout << " " << c << ":" << stats.sizes[c];
+      }
+      std::cout << std::endl;
+    }
+    std::cout << "-> Peak:  " << alc.peak() << " B" << std::endl;
+    std::cout << "-> Final: " << alc.allocated() << " B" << std::endl;
+  }
+}
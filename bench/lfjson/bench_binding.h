@@ -0,0 +1,203 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+// 3rd-parties
+#include "rapidjson/reader.h"
+
+// Src
+#include "lfjson/lfjson.h"
+using namespace  lfjson;
+
+// Utils
+#include "bench_utils.h"
+
+// Std
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+
+#define BINDING_MAIN_LOOPS    5
+static_assert(BINDING_MAIN_LOOPS  > 0, "BINDING_MAIN_LOOPS <= 0");
+#define BINDING_INNER_LOOPS   20   // ensure min time Vs clock resolution
+static_assert(BINDING_INNER_LOOPS > 0, "BINDING_INNER_LOOPS <= 0");
+
+// Consumer structs (twitter.json subset)
+struct BenchTwitterUser {
+  int64_t     id = 0;
+  std::string name;
+  std::string screen_name;
+  int64_t     followers_count = 0;
+  bool        verified = false;
+};
+
+struct BenchTwitterStatus {
+  int64_t           id = 0;
+  std::string       text;
+  std::string       lang;
+  int64_t           retweet_count = 0;
+  int64_t           favorite_count = 0;
+  BenchTwitterUser  user;
+};
+
+struct BenchTwitter {
+  std::vector<BenchTwitterStatus> statuses;
+};
+
+LFJ_BINDING(BenchTwitterUser, LFJ_FIELD(id), LFJ_FIELD(name), LFJ_FIELD(screen_name), LFJ_FIELD(followers_count),
+                              LFJ_FIELD(verified))
+LFJ_BINDING(BenchTwitterStatus, LFJ_FIELD(id), LFJ_FIELD(text), LFJ_FIELD(lang), LFJ_FIELD(retweet_count),
+                                LFJ_FIELD(favorite_count), LFJ_FIELD(user))
+LFJ_BINDING(BenchTwitter, LFJ_FIELD(statuses))
+
+// Median time (ms) of 'func' over main loops
+template <class Func>
+double bench_binding_time(Func func)
+{
+  std::vector<double> times;
+  times.reserve(BINDING_MAIN_LOOPS);
+  for (int i = 0; i < BINDING_MAIN_LOOPS; ++i)
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    for (int j = 0; j < BINDING_INNER_LOOPS; ++j)
+      func();
+      
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> diff = end - start;
+    times.push_back(diff.count() * 1000.);
+  }
+  std::sort(times.begin(), times.end());
+  return times[(times.size() - 1) / 2];
+}
+
+// Member by text (no pool lookup)
+const ConstValue& bench_binding_member(const ConstValue& object, const char* key)
+{
+  const ConstValue* value = PoolKeys<>::findMember(object, key, (uint32_t)std::strlen(key));
+  if (value == nullptr)
+    exit(1);
+  return *value;
+}
+
+// Copy fields by hand from a Document (consumer baseline)
+void bench_binding_copy(const ConstValue& root, BenchTwitter& twitter)
+{
+  twitter.statuses.clear();
+  const ConstValue& statuses = bench_binding_member(root, "statuses");
+  twitter.statuses.resize(statuses.arraySize());
+  for (uint32_t i = 0u; i < statuses.arraySize(); ++i)
+  {
+    const ConstValue& src = statuses.arrayValues()[i];
+    BenchTwitterStatus& dst = twitter.statuses[i];
+    dst.id              = bench_binding_member(src, "id").getInt64();
+    dst.text            = bench_binding_member(src, "text").asString();
+    dst.lang            = bench_binding_member(src, "lang").asString();
+    dst.retweet_count   = bench_binding_member(src, "retweet_count").getInt64();
+    dst.favorite_count  = bench_binding_member(src, "favorite_count").getInt64();
+    const ConstValue& user = bench_binding_member(src, "user");
+    dst.user.id               = bench_binding_member(user, "id").getInt64();
+    dst.user.name             = bench_binding_member(user, "name").asString();
+    dst.user.screen_name      = bench_binding_member(user, "screen_name").asString();
+    dst.user.followers_count  = bench_binding_member(user, "followers_count").getInt64();
+    dst.user.verified         = bench_binding_member(user, "verified").getBool();
+  }
+}
+
+// Build a Document by hand from structs (producer baseline, keys hashed per member)
+void bench_binding_build(DynamicDocument::RefValue root, const BenchTwitter& twitter)
+{
+  auto statuses = root.toObject()["statuses"];
+  statuses.toArray();
+  statuses.arrayReserve((uint32_t)twitter.statuses.size());
+  for (uint32_t i = 0u; i < (uint32_t)twitter.statuses.size(); ++i)
+  {
+    const BenchTwitterStatus& src = twitter.statuses[i];
+    auto dst = statuses[(int)i];
+    dst["id"]             = src.id;
+    dst["text"].assign(BuildValue(src.text));
+    dst["lang"].assign(BuildValue(src.lang));
+    dst["retweet_count"]  = src.retweet_count;
+    dst["favorite_count"] = src.favorite_count;
+    auto user = dst["user"];
+    user["id"]              = src.user.id;
+    user["name"].assign(BuildValue(src.user.name));
+    user["screen_name"].assign(BuildValue(src.user.screen_name));
+    user["followers_count"] = src.user.followers_count;
+    user["verified"]        = src.user.verified;
+  }
+}
+
+void bench_binding(const std::string& filePath)
+{
+  std::cout << "\n------------------------------\n" << std::endl;
+  std::cout << "FilePath: " << filePath << "\n" << std::endl;
+  
+  // Read file to memory
+  std::ifstream ifs(filePath, std::ifstream::in);
+  assert(ifs.good());
+  std::string json(std::istreambuf_iterator<char>{ifs}, {});
+  
+  // Parse to Document then copy fields
+  BenchTwitter copied;
+  double copyTime = bench_binding_time([&]() {
+    DynamicDocument doc;
+    auto handler = doc.makeHandler();
+    RapidHandler<> rapidHandler(handler);
+    rapidjson::Reader reader;
+    rapidjson::StringStream ss(json.c_str());
+    if (!reader.Parse(ss, rapidHandler))
+      exit(1);
+    handler.finalize();
+    bench_binding_copy(doc.croot(), copied);
+  });
+  
+  // Parse events straight into structs
+  BenchTwitter bound;
+  double bindTime = bench_binding_time([&]() {
+    BindHandler<BenchTwitter> handler(bound);
+    RapidEventHandler<BindHandler<BenchTwitter>> rapidHandler(handler);
+    rapidjson::Reader reader;
+    rapidjson::StringStream ss(json.c_str());
+    if (!reader.Parse(ss, rapidHandler))
+      exit(1);
+  });
+  
+  if (bound.statuses.size() != copied.statuses.size() || bound.statuses.back().user.name != copied.statuses.back().user.name)
+    exit(1);
+    
+  std::cout << "Statuses: " << bound.statuses.size() << std::endl;
+  std::cout << "-> Document + copy median: " << copyTime << " ms" << std::endl;
+  std::cout << "-> Binding median:         " << bindTime << " ms" << std::endl;
+  std::cout << "-> Speedup:                " << copyTime / bindTime << " x" << std::endl;
+  
+  // Structs back into a Document (objects cleared, string pool kept)
+  DynamicDocument built;
+  double buildTime = bench_binding_time([&]() {
+    built.clearObjects();
+    bench_binding_build(built.root(), bound);
+  });
+  
+  DynamicDocument written;
+  StructWriter<> writer;
+  double writeTime = bench_binding_time([&]() {
+    written.clearObjects();
+    writer.write(written, bound);
+  });
+  
+  if (built.root()["statuses"].arraySize() != written.root()["statuses"].arraySize())
+    exit(1);
+  
+  std::cout << "-> Build by hand median:   " << buildTime << " ms" << std::endl;
+  std::cout << "-> StructWriter median:    " << writeTime << " ms" << std::endl;
+  std::cout << "-> Speedup:                " << buildTime / writeTime << " x" << std::endl;
+}
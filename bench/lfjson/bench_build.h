@@ -0,0 +1,126 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+// 3rd-parties
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+
+// Src
+#include "lfjson/lfjson.h"
+using namespace  lfjson;
+
+// Utils
+#include "bench_utils.h"
+
+// Std
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+
+#define BUILD_MAIN_LOOPS    5
+static_assert(BUILD_MAIN_LOOPS  > 0, "BUILD_MAIN_LOOPS <= 0");
+#define BUILD_INNER_LOOPS   10   // ensure min time Vs clock resolution
+static_assert(BUILD_INNER_LOOPS > 0, "BUILD_INNER_LOOPS <= 0");
+#define BUILD_RECORDS       10000
+
+// Median time (ms) of 'func' over main loops
+template <class Func>
+double bench_build_time(Func func)
+{
+  std::vector<double> times;
+  times.reserve(BUILD_MAIN_LOOPS);
+  for (int i = 0; i < BUILD_MAIN_LOOPS; ++i)
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    for (int j = 0; j < BUILD_INNER_LOOPS; ++j)
+      func();
+      
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> diff = end - start;
+    times.push_back(diff.count() * 1000.);
+  }
+  std::sort(times.begin(), times.end());
+  return times[(times.size() - 1) / 2];
+}
+
+// Synthetic records (Serialize/Create-like): objects with scalars, strings and a small array
+void bench_build()
+{
+  std::cout << "\n------------------------------\n" << std::endl;
+  std::cout << "Records: " << BUILD_RECORDS << "\n" << std::endl;
+  
+  const char* names[] = {"this is a long name for record 0", "this is a long name for record 1", "short"};
+  
+  // Push based (growth by GrowthFactor, checks on each push)
+  double pushTime = bench_build_time([&]() {
+    DynamicDocument doc;
+    auto rt = doc.root();
+    for (uint32_t i = 0u; i < BUILD_RECORDS; ++i)
+    {
+      auto rec = rt[(int)i];
+      rec.toObject();
+      rec.objectPushBack("id", (uint64_t)i);
+      rec.objectPushBack("name", names[i % 3]);
+      rec.objectPushBack("score", i * 0.5);
+      rec.objectPushBack("active", (i & 1u) == 0u);
+      rec.objectPushBack("parent", nullptr);
+      rec.objectPushBack("tags", nullptr);
+      auto tags = rec["tags"];
+      tags.toArray();
+      for (int j = 0; j < 4; ++j)
+        tags.arrayPushBack(j);
+    }
+  });
+  
+  // Bulk builders (one allocation per container, keys interned in one batch)
+  double bulkTime = bench_build_time([&]() {
+    DynamicDocument doc;
+    auto rt = doc.root();
+    rt.toArray();
+    rt.arrayReserve(BUILD_RECORDS);
+    for (uint32_t i = 0u; i < BUILD_RECORDS; ++i)
+    {
+      auto rec = rt[(int)i];
+      rec.objectAssign({
+        {"id",     (uint64_t)i},
+        {"name",   names[i % 3]},
+        {"score",  i * 0.5},
+        {"active", (i & 1u) == 0u},
+        {"parent", nullptr},
+        {"tags",   nullptr}
+      });
+      rec["tags"].arrayAssign({0, 1, 2, 3});
+    }
+  });
+  
+  // Check same JSON
+  DynamicDocument pushed, built;
+  for (uint32_t i = 0u; i < 3u; ++i)
+  {
+    auto rec = pushed.root()[(int)i];
+    rec.toObject();
+    rec.objectPushBack("id", (uint64_t)i);
+    rec.objectPushBack("tags", nullptr);
+    rec["tags"].toArray().arrayPushBack(1);
+    built.root()[(int)i].objectAssign({{"id", (uint64_t)i}, {"tags", nullptr}});
+    built.root()[(int)i]["tags"].arrayAssign({1});
+  }
+  if (!deepEquals(pushed, built, MemberOrder::SENSITIVE))
+    exit(1);
+  
+  std::cout << "Build" << std::endl;
+  std::cout << "-> Push median: " << pushTime << " ms" << std::endl;
+  std::cout << "-> Bulk median: " << bulkTime << " ms" << std::endl;
+  std::cout << "-> Speedup:     " << pushTime / bulkTime << " x" << std::endl;
+}
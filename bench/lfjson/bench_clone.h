@@ -0,0 +1,131 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+// 3rd-parties
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+
+// Src
+#include "lfjson/lfjson.h"
+using namespace  lfjson;
+
+// Utils
+#include "bench_utils.h"
+
+// Std
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cassert>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+
+#define CLONE_MAIN_LOOPS    5
+static_assert(CLONE_MAIN_LOOPS  > 0, "CLONE_MAIN_LOOPS <= 0");
+#define CLONE_INNER_LOOPS   1000  // ensure min time Vs clock resolution
+static_assert(CLONE_INNER_LOOPS > 0, "CLONE_INNER_LOOPS <= 0");
+
+// Median time (ms) of 'func' over main loops
+template <class Func>
+double bench_clone_time(Func func)
+{
+  std::vector<double> times;
+  times.reserve(CLONE_MAIN_LOOPS);
+  for (int i = 0; i < CLONE_MAIN_LOOPS; ++i)
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    for (int j = 0; j < CLONE_INNER_LOOPS; ++j)
+      func();
+    
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> diff = end - start;
+    times.push_back(diff.count() * 1000.);
+  }
+  std::sort(times.begin(), times.end());
+  return times[(times.size() - 1) / 2];
+}
+
+void bench_clone(const std::vector<std::string>& filePaths)
+{
+  for (const auto& filePath : filePaths)
+  {
+    std::cout << "\n------------------------------\n" << std::endl;
+    std::cout << "FilePath: " << filePath << "\n" << std::endl;
+    
+    // Read file to memory
+    std::ifstream ifs(filePath, std::ifstream::in);
+    assert(ifs.good());
+    std::string json(std::istreambuf_iterator<char>{ifs}, {});
+    
+    auto parse = [&json](DynamicDocument& doc) {
+      auto handler = doc.makeHandler();
+      RapidHandler<> rapidHandler(handler);
+      
+      rapidjson::Reader reader;
+      rapidjson::StringStream ss(json.c_str());
+      
+      reader.Parse(ss, rapidHandler);
+      handler.finalize();
+    };
+    
+    // Template document
+    DynamicDocument tmpl;
+    parse(tmpl);
+    
+    // Re-parse per request
+    double parseTime = bench_clone_time([&]() {
+      DynamicDocument doc(tmpl.stringPool());
+      parse(doc);
+    });
+    
+    // Clone, shared pool (verbatim strings)
+    double sharedTime = bench_clone_time([&]() {
+      DynamicDocument doc(tmpl.stringPool());
+      doc.cloneFrom(tmpl);
+    });
+    
+    // Clone, other pool (re-interned strings)
+    double otherTime = bench_clone_time([&]() {
+      DynamicDocument doc;
+      doc.cloneFrom(tmpl);
+    });
+    
+    // Replay events into a Handler, other pool
+    double acceptTime = bench_clone_time([&]() {
+      DynamicDocument doc;
+      auto handler = doc.makeHandler();
+      tmpl.accept(handler);
+      handler.finalize();
+    });
+    
+    // Staging to live document (staging clone included): copy Vs move
+    double copyTime = bench_clone_time([&]() {
+      DynamicDocument staging(tmpl.stringPool());
+      staging.cloneFrom(tmpl);
+      DynamicDocument live(tmpl.stringPool());
+      live.root().copyFrom(staging.root());
+    });
+    double moveTime = bench_clone_time([&]() {
+      DynamicDocument staging(tmpl.stringPool());
+      staging.cloneFrom(tmpl);
+      DynamicDocument live(tmpl.stringPool());
+      live.root().moveFrom(staging.root());
+    });
+    
+    std::cout << "Clone" << std::endl;
+    std::cout << "-> Re-parse median:     " << parseTime  << " ms" << std::endl;
+    std::cout << "-> Shared pool median:  " << sharedTime << " ms" << std::endl;
+    std::cout << "-> Other pool median:   " << otherTime  << " ms" << std::endl;
+    std::cout << "-> Accept median:       " << acceptTime << " ms" << std::endl;
+    std::cout << "-> Speedup (shared):    " << parseTime / sharedTime << " x" << std::endl;
+    std::cout << "-> Staging copy median: " << copyTime << " ms" << std::endl;
+    std::cout << "-> Staging move median: " << moveTime << " ms" << std::endl;
+  }
+}
@@ -0,0 +1,240 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+#ifndef LFJSON_BENCH_CORPUS_H
+#define LFJSON_BENCH_CORPUS_H
+
+// Std
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+// Synthetic corpus parameters (sizes in bytes, ratios in [0, 1])
+// Records are objects; every record reaches 'maxDepth' (first member/element nests), 'nestRatio' adds
+// branches: containers per level grow as (1 + nestRatio * width)^depth, keep it low for deep specs
+struct CorpusSpec
+{
+  uint64_t seed              = 0x9E3779B97F4A7C15ull;
+  uint64_t bytes             = 1u << 20;  // approximate output size
+  uint32_t keyCardinality    = 256u;      // distinct member keys
+  double   keySkew           = 1.;        // 1: uniform key choice, > 1: hot keys (power law)
+  uint32_t keyLength         = 8u;        // min key length
+  uint32_t membersPerObject  = 8u;
+  uint32_t minStringLength   = 4u;
+  uint32_t maxStringLength   = 24u;
+  uint32_t stringCardinality = 0u;        // 0: random strings, N: drawn from N distinct values
+  uint32_t maxDepth          = 2u;        // nesting below records
+  double   nestRatio         = 0.1;       // other members/elements holding containers (below max depth)
+  double   arrayRatio        = 0.5;       // containers being arrays (others objects)
+  uint32_t arrayLength       = 8u;
+  double   homogeneity       = 1.;        // array elements of the array's element type
+};
+
+//
+// Deterministic JSON generator: same spec, same bytes (own PRNG, no std distributions)
+// Documents are arrays of records, NDJSON streams one record per line (generated on the fly, any size)
+class CorpusGenerator
+{
+private:
+  enum class Kind : uint8_t {
+    STRING, INT, DOUBLE, BOOL, NUL, OBJECT, ARRAY
+  };
+  
+  CorpusSpec mSpec;
+  uint64_t mState;
+  std::vector<std::string> mKeys;
+  std::vector<std::string> mStrings;  // if bounded string cardinality
+  
+  // splitmix64
+  uint64_t next()
+  {
+    uint64_t z = (mState += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+  }
+  
+  double uniform() { return (double)(next() >> 11) * (1. / 9007199254740992.); }
+  uint32_t below(uint32_t n) { return n > 0u ? (uint32_t)(next() % n) : 0u; }
+  bool chance(double ratio) { return uniform() < ratio; }
+  
+  void randomText(std::string& out, uint32_t len)
+  {
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 ";
+    for (uint32_t i = 0u; i < len; ++i)
+      out += alphabet[below(sizeof(alphabet) - 1u)];
+  }
+  
+  uint32_t stringLength()
+  {
+    const uint32_t lo = std::min(mSpec.minStringLength, mSpec.maxStringLength);
+    return lo + below(mSpec.maxStringLength - lo + 1u);
+  }
+  
+  Kind scalarKind()
+  {
+    const uint32_t r = below(100u);
+    if (r < 40u) return Kind::STRING;
+    if (r < 70u) return Kind::INT;
+    if (r < 90u) return Kind::DOUBLE;
+    if (r < 97u) return Kind::BOOL;
+    return Kind::NUL;
+  }
+  
+  Kind containerKind() { return chance(mSpec.arrayRatio) ? Kind::ARRAY : Kind::OBJECT; }
+  
+  // Container for the first member/element (spine to max depth), or by 'nestRatio'
+  Kind valueKind(uint32_t depth, bool first)
+  {
+    if (depth < mSpec.maxDepth && (first || chance(mSpec.nestRatio)))
+      return containerKind();
+    return scalarKind();
+  }
+  
+  void writeString(std::string& out)
+  {
+    out += '"';
+    if (!mStrings.empty())
+      out += mStrings[below((uint32_t)mStrings.size())];
+    else
+      randomText(out, stringLength());
+    out += '"';
+  }
+  
+  void writeValue(std::string& out, Kind kind, uint32_t depth)
+  {
+    char buf[32];
+    switch (kind)
+    {
+      case Kind::STRING:  writeString(out); break;
+      case Kind::INT:     out += std::to_string((int64_t)(next() % 2000001u) - 1000000); break;
+      case Kind::DOUBLE:
+        std::snprintf(buf, sizeof(buf), "%.3f", uniform() * 2000. - 1000.);
+        out += buf;
+        break;
+      case Kind::BOOL:    out += chance(0.5) ? "true" : "false"; break;
+      case Kind::NUL:     out += "null"; break;
+      case Kind::OBJECT:  writeObject(out, depth + 1u); break;
+      case Kind::ARRAY:   writeArray(out, depth + 1u); break;
+    }
+  }
+  
+  void writeObject(std::string& out, uint32_t depth)
+  {
+    // Consecutive keys from a skewed start: distinct within the object
+    const uint32_t card = (uint32_t)mKeys.size();
+    const uint32_t count = std::min(mSpec.membersPerObject, card);
+    const uint32_t start = (uint32_t)((double)card * std::pow(uniform(), mSpec.keySkew)) % card;
+    out += '{';
+    for (uint32_t i = 0u; i < count; ++i)
+    {
+      if (i > 0u)
+        out += ',';
+      out += '"';
+      out += mKeys[(start + i) % card];
+      out += "\":";
+      writeValue(out, valueKind(depth, i == 0u), depth);
+    }
+    out += '}';
+  }
+  
+  void writeArray(std::string& out, uint32_t depth)
+  {
+    // Element type: objects by 'nestRatio' (below max depth), scalars otherwise
+    const Kind type = depth < mSpec.maxDepth && chance(mSpec.nestRatio) ? Kind::OBJECT : scalarKind();
+    out += '[';
+    for (uint32_t i = 0u; i < mSpec.arrayLength; ++i)
+    {
+      if (i > 0u)
+        out += ',';
+      Kind kind = type;
+      if (i == 0u && depth < mSpec.maxDepth)  // spine
+        kind = containerKind();
+      else if (!chance(mSpec.homogeneity))
+      {
+        kind = scalarKind();
+        if (kind == type)
+          kind = type == Kind::STRING ? Kind::INT : Kind::STRING;
+      }
+      writeValue(out, kind, depth);
+    }
+    out += ']';
+  }
+  
+public:
+  explicit CorpusGenerator(const CorpusSpec& spec)
+    : mSpec(spec)
+    , mState(spec.seed)
+  {
+    const uint32_t keyCount = std::max(mSpec.keyCardinality, 1u);
+    mKeys.reserve(keyCount);
+    for (uint32_t i = 0u; i < keyCount; ++i)
+    {
+      std::string key = "k" + std::to_string(i) + "_";
+      randomText(key, key.size() < mSpec.keyLength ? mSpec.keyLength - (uint32_t)key.size() : 1u);
+      mKeys.push_back(key);
+    }
+    mStrings.reserve(mSpec.stringCardinality);
+    for (uint32_t i = 0u; i < mSpec.stringCardinality; ++i)
+    {
+      std::string str;
+      randomText(str, stringLength());
+      mStrings.push_back(str);
+    }
+  }
+  
+  // Accessors
+  const CorpusSpec& spec() const { return mSpec; }
+  const std::string& key(uint32_t i) const { return mKeys[i % mKeys.size()]; }
+  
+  // Append one record
+  void record(std::string& out) { writeObject(out, 0u); }
+  
+  // Array of records, about 'spec.bytes'
+  std::string document()
+  {
+    std::string out;
+    out.reserve(mSpec.bytes + mSpec.bytes / 8u);
+    out += '[';
+    do {
+      if (out.size() > 1u)
+        out += ',';
+      record(out);
+    } while (out.size() < mSpec.bytes);
+    out += ']';
+    return out;
+  }
+  
+  // One record per line, about 'spec.bytes' in total, 'onLine(line)' without the newline
+  template <class Func>
+  uint64_t ndjson(Func onLine)
+  {
+    uint64_t total = 0u;
+    std::string line;
+    do {
+      line.clear();
+      record(line);
+      onLine(line);
+      total += line.size() + 1u;
+    } while (total < mSpec.bytes);
+    return total;
+  }
+  
+  std::string ndjson()
+  {
+    std::string out;
+    out.reserve(mSpec.bytes + mSpec.bytes / 8u);
+    ndjson([&out](const std::string& line) {
+      out += line;
+      out += '\n';
+    });
+    return out;
+  }
+};
+
+#endif // LFJSON_BENCH_CORPUS_H
@@ -0,0 +1,158 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+#ifndef LFJSON_BENCH_COUNTERS_H
+#define LFJSON_BENCH_COUNTERS_H
+
+// Std
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define LFJ_BENCH_PERF_EVENTS
+#endif
+
+//
+// Hardware counters around timed samples (Linux perf_event_open), user space only
+// Each counter is opened on its own: unsupported ones are skipped, multiplexed ones scaled by their running time
+// Counting inherits to threads created while enabled (e.g. threads benchmark)
+class BenchCounters
+{
+public:
+  struct Counter {
+    const char* name    = nullptr;
+    int         fd      = -1;
+    double      total   = 0.;  // scaled, accumulated between reset() calls
+    uint64_t    enabled = 0u;  // last read times (ns), cumulated since open
+    uint64_t    running = 0u;
+  };
+  
+private:
+  std::vector<Counter> mCounters;
+  std::string mError;  // why some or all counters are unavailable
+  
+#if defined(LFJ_BENCH_PERF_EVENTS)
+  static uint64_t cacheConfig(uint64_t cache, uint64_t op, uint64_t result)
+  {
+    return cache | (op << 8u) | (result << 16u);
+  }
+  
+  void open(const char* name, uint32_t type, uint64_t config)
+  {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size           = sizeof(attr);
+    attr.type           = type;
+    attr.config         = config;
+    attr.disabled       = 1;
+    attr.inherit        = 1;
+    attr.exclude_kernel = 1;  // allowed up to perf_event_paranoid 2
+    attr.exclude_hv     = 1;
+    attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    
+    const int fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fd < 0)
+    {
+      mError += std::string(mError.empty() ? "" : ", ") + name + " (" + std::strerror(errno) + ")";
+      return;
+    }
+    Counter counter;
+    counter.name = name;
+    counter.fd   = fd;
+    mCounters.push_back(counter);
+  }
+#endif
+
+public:
+  BenchCounters()
+  {
+#if defined(LFJ_BENCH_PERF_EVENTS)
+    open("cycles",        PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    open("instructions",  PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    open("branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    open("l1d_misses",    PERF_TYPE_HW_CACHE,
+         cacheConfig(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS));
+    open("llc_misses",    PERF_TYPE_HW_CACHE,
+         cacheConfig(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS));
+    open("dtlb_misses",   PERF_TYPE_HW_CACHE,
+         cacheConfig(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS));
+#else
+    mError = "perf_event_open requires Linux";
+#endif
+  }
+  
+  ~BenchCounters()
+  {
+#if defined(LFJ_BENCH_PERF_EVENTS)
+    for (const Counter& counter : mCounters)
+      close(counter.fd);
+#endif
+  }
+  
+  BenchCounters(const BenchCounters&) = delete;
+  BenchCounters& operator=(const BenchCounters&) = delete;
+  
+  // Accessors
+  bool available() const { return !mCounters.empty(); }
+  const std::vector<Counter>& counters() const { return mCounters; }
+  const std::string& error() const { return mError; }
+  
+  void reset()
+  {
+    for (Counter& counter : mCounters)
+      counter.total = 0.;
+  }
+  
+  // Around one sample: counts from start() to stop() added to totals
+  void start()
+  {
+#if defined(LFJ_BENCH_PERF_EVENTS)
+    for (const Counter& counter : mCounters)
+      ioctl(counter.fd, PERF_EVENT_IOC_RESET, 0);
+    for (const Counter& counter : mCounters)
+      ioctl(counter.fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+  }
+  
+  void stop()
+  {
+#if defined(LFJ_BENCH_PERF_EVENTS)
+    for (const Counter& counter : mCounters)
+      ioctl(counter.fd, PERF_EVENT_IOC_DISABLE, 0);
+    for (Counter& counter : mCounters)
+    {
+      uint64_t values[3] = {};  // value, time enabled, time running
+      if (read(counter.fd, values, sizeof(values)) != (ssize_t)sizeof(values))
+        continue;
+      const uint64_t enabled = values[1] - counter.enabled;
+      const uint64_t running = values[2] - counter.running;
+      counter.enabled = values[1];
+      counter.running = values[2];
+      if (running > 0u)
+        counter.total += (double)values[0] * ((double)enabled / (double)running);
+    }
+#endif
+  }
+  
+  // Total of a counter (0 if unavailable)
+  double total(const char* name) const
+  {
+    for (const Counter& counter : mCounters)
+    {
+      if (std::strcmp(counter.name, name) == 0)
+        return counter.total;
+    }
+    return 0.;
+  }
+};
+
+#endif // LFJSON_BENCH_COUNTERS_H
@@ -0,0 +1,111 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+// 3rd-parties
+#include "rapidjson/reader.h"
+
+// Src
+#include "lfjson/lfjson.h"
+using namespace  lfjson;
+
+// Utils
+#include "bench_utils.h"
+
+// Std
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+
+#define DIRECT_MAIN_LOOPS     5
+static_assert(DIRECT_MAIN_LOOPS  > 0, "DIRECT_MAIN_LOOPS <= 0");
+#define DIRECT_INNER_LOOPS    10
+
+// Median time (ms) of 'func' over main loops
+template <class Func>
+double bench_direct_time(Func func)
+{
+  std::vector<double> times;
+  times.reserve(DIRECT_MAIN_LOOPS);
+  for (int i = 0; i < DIRECT_MAIN_LOOPS; ++i)
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    for (int j = 0; j < DIRECT_INNER_LOOPS; ++j)
+      func();
+      
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> diff = end - start;
+    times.push_back(diff.count() * 1000.);
+  }
+  std::sort(times.begin(), times.end());
+  return times[(times.size() - 1) / 2];
+}
+
+template <class HandlerT>
+void bench_direct_parse(const std::string& json, HandlerT& handler)
+{
+  RapidEventHandler<HandlerT> rapidHandler(handler);
+  rapidjson::Reader reader;
+  rapidjson::StringStream ss(json.c_str());
+  if (!reader.Parse(ss, rapidHandler))
+    exit(1);
+}
+
+void bench_direct(const std::vector<std::string>& filePaths)
+{
+  for (const auto& filePath : filePaths)
+  {
+    std::cout << "\n------------------------------\n" << std::endl;
+    std::cout << "FilePath: " << filePath << "\n" << std::endl;
+    
+    // Read file to memory
+    std::ifstream ifs(filePath, std::ifstream::in);
+    assert(ifs.good());
+    std::string json(std::istreambuf_iterator<char>{ifs}, {});
+    
+    // Staged: values built on the LFStack, copied at endObject/endArray
+    DynamicDocument staged;
+    double stagedTime = bench_direct_time([&]() {
+      staged.clear();
+      auto handler = staged.makeHandler();
+      bench_direct_parse(json, handler);
+      handler.finalize(false);
+    });
+    
+    // Structural pre-pass only
+    StructureTape tape;
+    double tapeTime = bench_direct_time([&]() {
+      TapeRecorder recorder(tape);
+      bench_direct_parse(json, recorder);
+    });
+    
+    // Direct: values built in place from the tape (e.g. shape known from a previous parse)
+    DynamicDocument direct;
+    double directTime = bench_direct_time([&]() {
+      direct.clear();
+      auto handler = direct.makeDirectHandler(tape);
+      bench_direct_parse(json, handler);
+      handler.finalize(false);
+    });
+    
+    if (!deepEquals(staged, direct, MemberOrder::SENSITIVE))
+      exit(1);
+      
+    std::cout << "Containers: " << tape.size() << std::endl;
+    std::cout << "-> Staged Handler median:        " << stagedTime << " ms" << std::endl;
+    std::cout << "-> Tape pre-pass median:         " << tapeTime << " ms" << std::endl;
+    std::cout << "-> DirectHandler median:         " << directTime << " ms" << std::endl;
+    std::cout << "-> Speedup (tape given):         " << stagedTime / directTime << " x" << std::endl;
+    std::cout << "-> Speedup (tape + direct):      " << stagedTime / (tapeTime + directTime) << " x" << std::endl;
+  }
+}
@@ -0,0 +1,120 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+// 3rd-parties
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+
+// Src
+#include "lfjson/lfjson.h"
+using namespace  lfjson;
+
+// Utils
+#include "bench_utils.h"
+
+// Std
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+
+#define HASH_MAIN_LOOPS    5
+static_assert(HASH_MAIN_LOOPS  > 0, "HASH_MAIN_LOOPS <= 0");
+#define HASH_INNER_LOOPS   100  // ensure min time Vs clock resolution
+static_assert(HASH_INNER_LOOPS > 0, "HASH_INNER_LOOPS <= 0");
+
+// Median time (ms) of 'func' over main loops
+template <class Func>
+double bench_hash_time(Func func)
+{
+  std::vector<double> times;
+  times.reserve(HASH_MAIN_LOOPS);
+  for (int i = 0; i < HASH_MAIN_LOOPS; ++i)
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    for (int j = 0; j < HASH_INNER_LOOPS; ++j)
+      func();
+      
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> diff = end - start;
+    times.push_back(diff.count() * 1000.);
+  }
+  std::sort(times.begin(), times.end());
+  return times[(times.size() - 1) / 2];
+}
+
+void bench_hash(const std::vector<std::string>& filePaths)
+{
+  for (const auto& filePath : filePaths)
+  {
+    std::cout << "\n------------------------------\n" << std::endl;
+    std::cout << "FilePath: " << filePath << "\n" << std::endl;
+    
+    // Read file to memory
+    std::ifstream ifs(filePath, std::ifstream::in);
+    assert(ifs.good());
+    std::string json(std::istreambuf_iterator<char>{ifs}, {});
+    
+    DynamicDocument doc;
+    {
+      auto handler = doc.makeHandler();
+      RapidHandler<> rapidHandler(handler);
+      
+      rapidjson::Reader reader;
+      rapidjson::StringStream ss(json.c_str());
+      
+      reader.Parse(ss, rapidHandler);
+      handler.finalize();
+    }
+    DynamicDocument shared(doc.stringPool());
+    shared.cloneFrom(doc);
+    DynamicDocument other;
+    other.cloneFrom(doc);
+    
+    // Re-serialize then hash text
+    uint64_t hash = 0u;
+    double textTime = bench_hash_time([&]() {
+      rapidjson::StringBuffer buffer;
+      RapidWriter::write(buffer, doc.croot());
+      hash += helper::hashBytes(buffer.GetString(), buffer.GetSize(), 0u);
+    });
+    
+    // Structural hash (scratch reused)
+    StructuralHasher hasher;
+    double structTime = bench_hash_time([&]() {
+      hash += hasher(doc.croot());
+    });
+    StructuralHasher orderedHasher(MemberOrder::SENSITIVE);
+    double orderedTime = bench_hash_time([&]() {
+      hash += orderedHasher(doc.croot());
+    });
+    
+    // Deep equality, shared pool (pointer compares) Vs other pool (text compares)
+    double sharedTime = bench_hash_time([&]() {
+      if (!deepEquals(doc, shared))
+        exit(1);
+    });
+    double otherTime = bench_hash_time([&]() {
+      if (!deepEquals(doc, other))
+        exit(1);
+    });
+    
+    std::cout << "Hash (" << std::hex << hash << std::dec << ")" << std::endl;
+    std::cout << "-> Re-serialize + hash median: " << textTime    << " ms" << std::endl;
+    std::cout << "-> Structural median:          " << structTime  << " ms" << std::endl;
+    std::cout << "-> Structural ordered median:  " << orderedTime << " ms" << std::endl;
+    std::cout << "-> Equals shared pool median:  " << sharedTime  << " ms" << std::endl;
+    std::cout << "-> Equals other pool median:   " << otherTime   << " ms" << std::endl;
+    std::cout << "-> Speedup (structural):       " << textTime / structTime << " x" << std::endl;
+  }
+}
@@ -0,0 +1,142 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+// 3rd-parties
+#include "rapidjson/reader.h"
+
+// Src
+#include "lfjson/lfjson.h"
+using namespace  lfjson;
+
+// Utils
+#include "bench_utils.h"
+
+// Std
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+
+#define NDJSON_MAIN_LOOPS     5
+static_assert(NDJSON_MAIN_LOOPS  > 0, "NDJSON_MAIN_LOOPS <= 0");
+#define NDJSON_RECORDS        50000
+
+// Median time (ms) of 'func' over main loops
+template <class Func>
+double bench_ndjson_time(Func func)
+{
+  std::vector<double> times;
+  times.reserve(NDJSON_MAIN_LOOPS);
+  for (int i = 0; i < NDJSON_MAIN_LOOPS; ++i)
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    func();
+    
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> diff = end - start;
+    times.push_back(diff.count() * 1000.);
+  }
+  std::sort(times.begin(), times.end());
+  return times[(times.size() - 1) / 2];
+}
+
+// Synthetic log stream, 'errorRate' of records with level "error" (deterministic)
+std::string bench_ndjson_stream(double errorRate)
+{
+  static const char* const levels[] = { "debug", "info", "warn" };
+  std::string data;
+  uint64_t seed = 88172645463325252ull;
+  for (int i = 0; i < NDJSON_RECORDS; ++i)
+  {
+    seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;  // xorshift
+    const bool error = (double)(seed % 10000u) < errorRate * 10000.;
+    const int status = error ? 500 + (int)(seed % 4u) : 200 + (int)(seed % 5u);
+    data += "{\"ts\":" + std::to_string(1650000000 + i);
+    data += ",\"service\":\"api-" + std::to_string(seed % 16u) + "\"";
+    data += ",\"msg\":\"request handled in " + std::to_string(seed % 1000u) + " ms for user " + std::to_string(seed % 100000u) + "\"";
+    data += ",\"http\":{\"method\":\"GET\",\"path\":\"/v1/items/" + std::to_string(seed % 5000u) + "\",\"bytes\":" + std::to_string(seed % 65536u) + "}";
+    data += ",\"tags\":[\"edge\",\"eu-west\",\"canary\"]";
+    data += ",\"level\":\"" + std::string(error ? "error" : levels[seed % 3u]) + "\"";
+    data += ",\"status\":" + std::to_string(status) + "}\n";
+  }
+  return data;
+}
+
+// Parse one record into the session document
+bool bench_ndjson_parse(DynamicParseSession& session, const char* line, size_t len)
+{
+  RapidHandler<> rapidHandler(session.begin());
+  rapidjson::Reader reader;
+  rapidjson::MemoryStream ms(line, len);
+  rapidjson::EncodedInputStream<rapidjson::UTF8<>, rapidjson::MemoryStream> is(ms);
+  if (!reader.Parse(is, rapidHandler))
+    return false;
+  session.end();
+  return true;
+}
+
+void bench_ndjson()
+{
+  RecordFilter filter;
+  filter.where("/level", FilterOp::EQ, "error").where("/status", FilterOp::GE, 500);
+  DynamicPointer level("/level");
+  
+  for (double errorRate : { 0.001, 0.01, 0.1, 0.5, 1. })
+  {
+    std::cout << "\n------------------------------\n" << std::endl;
+    std::cout << "Records: " << NDJSON_RECORDS << ", error rate: " << errorRate << "\n" << std::endl;
+    
+    const std::string data = bench_ndjson_stream(errorRate);
+    const double mb = (double)data.size() / (1024. * 1024.);
+    
+    // Parse every record, filter on the Document
+    DynamicDocument doc;
+    DynamicParseSession session(doc);
+    uint64_t parsedMatches = 0u;
+    double parseAllTime = bench_ndjson_time([&]() {
+      parsedMatches = 0u;
+      scanNdjson(data.data(), data.size(), RecordFilter(), [&](const char* line, size_t len) {
+        if (!bench_ndjson_parse(session, line, len))
+          exit(1);
+        const ConstValue* value = level.find(doc);
+        if (value != nullptr && value->isMetaString() && std::strcmp(value->asString(), "error") == 0
+         && doc.croot().objectSize() > 0u)
+          ++parsedMatches;
+        return true;
+      });
+    });
+    
+    // Predicates on raw text, matches only parsed
+    DynamicDocument pushdownDoc;
+    DynamicParseSession pushdownSession(pushdownDoc);
+    NdjsonStats stats;
+    double pushdownTime = bench_ndjson_time([&]() {
+      stats = scanNdjson(data.data(), data.size(), filter, [&](const char* line, size_t len) {
+        return bench_ndjson_parse(pushdownSession, line, len);
+      });
+    });
+    
+    // Filter alone
+    double scanTime = bench_ndjson_time([&]() {
+      stats = scanNdjson(data, filter);
+    });
+    
+    if (stats.matched != parsedMatches)
+      exit(1);
+      
+    std::cout << "Stream size: " << mb << " MB, matched: " << stats.matched << std::endl;
+    std::cout << "-> Parse all median:     " << parseAllTime << " ms (" << mb / (parseAllTime / 1000.) << " MB/s)" << std::endl;
+    std::cout << "-> Pushdown median:      " << pushdownTime << " ms (" << mb / (pushdownTime / 1000.) << " MB/s)" << std::endl;
+    std::cout << "-> Filter only median:   " << scanTime << " ms (" << mb / (scanTime / 1000.) << " MB/s)" << std::endl;
+    std::cout << "-> Speedup:              " << parseAllTime / pushdownTime << " x" << std::endl;
+  }
+}
@@ -0,0 +1,134 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+// 3rd-parties
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+
+// Src
+#include "lfjson/lfjson.h"
+using namespace  lfjson;
+
+// Utils
+#include "bench_utils.h"
+
+// Std
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+
+#define PATCH_MAIN_LOOPS    5
+static_assert(PATCH_MAIN_LOOPS  > 0, "PATCH_MAIN_LOOPS <= 0");
+#define PATCH_INNER_LOOPS   100  // ensure min time Vs clock resolution
+static_assert(PATCH_INNER_LOOPS > 0, "PATCH_INNER_LOOPS <= 0");
+
+// Median time (ms) of 'func' over main loops
+template <class Func>
+double bench_patch_time(Func func)
+{
+  std::vector<double> times;
+  times.reserve(PATCH_MAIN_LOOPS);
+  for (int i = 0; i < PATCH_MAIN_LOOPS; ++i)
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    for (int j = 0; j < PATCH_INNER_LOOPS; ++j)
+      func();
+      
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> diff = end - start;
+    times.push_back(diff.count() * 1000.);
+  }
+  std::sort(times.begin(), times.end());
+  return times[(times.size() - 1) / 2];
+}
+
+void bench_patch(const std::vector<std::string>& filePaths)
+{
+  for (const auto& filePath : filePaths)
+  {
+    std::cout << "\n------------------------------\n" << std::endl;
+    std::cout << "FilePath: " << filePath << "\n" << std::endl;
+    
+    // Read file to memory
+    std::ifstream ifs(filePath, std::ifstream::in);
+    assert(ifs.good());
+    std::string json(std::istreambuf_iterator<char>{ifs}, {});
+    
+    DynamicDocument from;
+    {
+      auto handler = from.makeHandler();
+      RapidHandler<> rapidHandler(handler);
+      
+      rapidjson::Reader reader;
+      rapidjson::StringStream ss(json.c_str());
+      
+      reader.Parse(ss, rapidHandler);
+      handler.finalize();
+    }
+    if (!from.croot().isObject())
+    {
+      std::cout << "Skipped: root is not an object" << std::endl;
+      continue;
+    }
+    
+    // Replica: one member added
+    DynamicDocument to(from.stringPool());
+    to.cloneFrom(from);
+    to.root()["version"] = 1;
+    DynamicDocument other;
+    other.cloneFrom(to);
+    
+    // Re-serialize both and compare text
+    double textTime = bench_patch_time([&]() {
+      rapidjson::StringBuffer lhs, rhs;
+      RapidWriter::write(lhs, from.croot());
+      RapidWriter::write(rhs, to.croot());
+      if (lhs.GetSize() == rhs.GetSize() && std::memcmp(lhs.GetString(), rhs.GetString(), lhs.GetSize()) == 0)
+        exit(1);
+    });
+    
+    // Diff, shared pool (pointer compares)
+    uint32_t ops = 0u;
+    double sharedTime = bench_patch_time([&]() {
+      DynamicDocument patch;
+      ops = diff(from, to, patch);
+    });
+    
+    // Diff, other pool (text compares)
+    double otherTime = bench_patch_time([&]() {
+      DynamicDocument patch;
+      ops = diff(from, other, patch);
+    });
+    
+    // Diff, snapshots of a versioned document (shared blocks skipped)
+    DynamicVersionedDocument vdoc;
+    vdoc.assign(DynamicPointer(""), from);
+    vdoc.commit();
+    auto before = vdoc.snapshot();
+    vdoc.set(DynamicPointer("/version"), 1);
+    vdoc.commit();
+    auto after = vdoc.snapshot();
+    double versionedTime = bench_patch_time([&]() {
+      DynamicDocument patch;
+      ops = diff(before.root(), after.root(), vdoc.stringPool(), patch, true);
+    });
+    
+    std::cout << "Patch (" << ops << " operation)" << std::endl;
+    std::cout << "-> Re-serialize median: " << textTime   << " ms" << std::endl;
+    std::cout << "-> Shared pool median:  " << sharedTime << " ms" << std::endl;
+    std::cout << "-> Other pool median:   " << otherTime  << " ms" << std::endl;
+    std::cout << "-> Versioned median:    " << versionedTime << " ms" << std::endl;
+    std::cout << "-> Speedup (shared):    " << textTime / sharedTime << " x" << std::endl;
+  }
+}
@@ -0,0 +1,114 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+// 3rd-parties
+#include "rapidjson/reader.h"
+#include "rapidjson/stringbuffer.h"
+
+// Src
+#include "lfjson/lfjson.h"
+using namespace  lfjson;
+
+// Utils
+#include "bench_utils.h"
+#include "bench_registry.h"
+
+// Std
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cassert>
+#include <memory>
+#include <string>
+#include <vector>
+#include <iostream>
+
+#define PHASES_SAMPLES    20
+
+// Deserialization split in phases (rows per input):
+// - tokenize:  rapidjson Reader, null handler
+// - build:     Handler fed from recorded events (no tokenizing), strings interned, no finalize
+// - intern:    StringPool only, keys and long strings of the input
+// - finalize:  Handler finalize with document shrink
+// - serialize: RapidWriter of the finalized document
+// - total:     tokenize + build + finalize, as in deserialize
+void bench_phases(BenchContext& ctx)
+{
+  using StringPoolT = DynamicDocument::SharedStringPool::element_type;
+  
+  for (const auto& filePath : ctx.files())
+  {
+    const std::string json = BenchContext::readFile(filePath);
+    const std::string input = BenchContext::inputName(filePath);
+    
+    BenchEventTape tape;
+    {
+      rapidjson::Reader reader;
+      rapidjson::StringStream ss(json.c_str());
+      if (!reader.Parse(ss, tape))
+        exit(1);
+    }
+    
+    ctx.measure(input, "tokenize", json.size(), PHASES_SAMPLES, [&]() {
+      rapidjson::BaseReaderHandler<> nullHandler;
+      rapidjson::Reader reader;
+      rapidjson::StringStream ss(json.c_str());
+      if (!reader.Parse(ss, nullHandler))
+        exit(1);
+    });
+    
+    std::unique_ptr<DynamicDocument> doc;
+    std::unique_ptr<DynamicDocument::Handler> handler;
+    auto freshDocument = [&]() {
+      handler.reset();
+      doc.reset(new DynamicDocument());
+      handler.reset(new DynamicDocument::Handler(doc->makeHandler()));
+    };
+    
+    ctx.measureEach(input, "build", json.size(), PHASES_SAMPLES, freshDocument, [&]() {
+      if (!tape.replay(*handler))
+        exit(1);
+    });
+    
+    std::unique_ptr<StringPoolT> pool;
+    ctx.measureEach(input, "intern", json.size(), PHASES_SAMPLES, [&]() {
+      pool.reset(new StringPoolT());
+    }, [&]() {
+      tape.forEachInterned([&](const char* str, uint32_t len, bool key) {
+        bool found = false;
+        pool->provideInterned(str, key, found, (int32_t)len);
+      });
+    });
+    pool.reset();
+    
+    ctx.measureEach(input, "finalize", json.size(), PHASES_SAMPLES, [&]() {
+      freshDocument();
+      if (!tape.replay(*handler))
+        exit(1);
+    }, [&]() {
+      handler->finalize(true);
+    });
+    
+    ctx.measure(input, "serialize", json.size(), PHASES_SAMPLES, [&]() {
+      rapidjson::StringBuffer buffer;
+      RapidWriter::write(buffer, doc->croot());
+      if (buffer.GetSize() == 0u)
+        exit(1);
+    });
+    handler.reset();
+    doc.reset();
+    
+    ctx.measure(input, "total", json.size(), PHASES_SAMPLES, [&]() {
+      DynamicDocument totalDoc;
+      auto totalHandler = totalDoc.makeHandler();
+      RapidHandler<> rapidHandler(totalHandler);
+      rapidjson::Reader reader;
+      rapidjson::StringStream ss(json.c_str());
+      if (!reader.Parse(ss, rapidHandler))
+        exit(1);
+      totalHandler.finalize();
+    });
+  }
+}
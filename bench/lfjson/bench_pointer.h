@@ -0,0 +1,117 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+// 3rd-parties
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+
+// Src
+#include "lfjson/lfjson.h"
+using namespace  lfjson;
+
+// Utils
+#include "bench_utils.h"
+
+// Std
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cassert>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+
+#define POINTER_MAIN_LOOPS    5
+static_assert(POINTER_MAIN_LOOPS  > 0, "POINTER_MAIN_LOOPS <= 0");
+#define POINTER_INNER_LOOPS   1000000 // ensure min time Vs clock resolution
+static_assert(POINTER_INNER_LOOPS > 0, "POINTER_INNER_LOOPS <= 0");
+
+
+void bench_pointer(const std::vector<std::string>& filePaths)
+{
+  // Paths evaluated on each file (missing ones are still timed)
+  const std::vector<std::string> pointers = {
+    "/statuses/0/user/screen_name",
+    "/search_metadata/count",
+    "/0/actor/login",
+    "/0/payload/commits/0/author/name"
+  };
+  
+  for (const auto& filePath : filePaths)
+  {
+    std::cout << "\n------------------------------\n" << std::endl;
+    std::cout << "FilePath: " << filePath << "\n" << std::endl;
+    
+    // Read file to memory
+    std::ifstream ifs(filePath, std::ifstream::in);
+    assert(ifs.good());
+    std::string json(std::istreambuf_iterator<char>{ifs}, {});
+    
+    DynamicDocument doc;
+    {
+      auto handler = doc.makeHandler();
+      RapidHandler<> rapidHandler(handler);
+      
+      rapidjson::Reader reader;
+      rapidjson::StringStream ss(json.c_str());
+      
+      reader.Parse(ss, rapidHandler);
+      handler.finalize();
+    }
+    
+    for (const auto& pointer : pointers)
+    {
+      uint64_t found = 0u;
+      
+      // Naive: parse and resolve keys on each lookup
+      std::vector<double> naiveTimes;
+      naiveTimes.reserve(POINTER_MAIN_LOOPS);
+      for (int i = 0; i < POINTER_MAIN_LOOPS; ++i)
+      {
+        auto start = std::chrono::high_resolution_clock::now();
+        
+        for (int j = 0; j < POINTER_INNER_LOOPS; ++j)
+        {
+          DynamicPointer ptr(pointer);
+          found += ptr.find(doc) != nullptr;
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> diff = end - start;
+        naiveTimes.push_back(diff.count() * 1000.);
+      }
+      
+      // Compiled: parsed once, handles cached
+      std::vector<double> compiledTimes;
+      compiledTimes.reserve(POINTER_MAIN_LOOPS);
+      DynamicPointer ptr(pointer);
+      for (int i = 0; i < POINTER_MAIN_LOOPS; ++i)
+      {
+        auto start = std::chrono::high_resolution_clock::now();
+        
+        for (int j = 0; j < POINTER_INNER_LOOPS; ++j)
+          found += ptr.find(doc) != nullptr;
+        
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> diff = end - start;
+        compiledTimes.push_back(diff.count() * 1000.);
+      }
+      
+      // Results
+      std::sort(naiveTimes.begin(),    naiveTimes.end());
+      std::sort(compiledTimes.begin(), compiledTimes.end());
+      
+      double naiveMedian    = naiveTimes[(naiveTimes.size() - 1) / 2];
+      double compiledMedian = compiledTimes[(compiledTimes.size() - 1) / 2];
+      
+      std::cout << "Pointer: " << pointer << (found ? "" : " (not found)") << std::endl;
+      std::cout << "-> Naive median:    " << naiveMedian    << " ms" << std::endl;
+      std::cout << "-> Compiled median: " << compiledMedian << " ms" << std::endl;
+      std::cout << "-> Speedup:         " << naiveMedian / compiledMedian << " x" << std::endl;
+    }
+  }
+}
@@ -0,0 +1,115 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+// 3rd-parties
+#include "rapidjson/reader.h"
+
+// Src
+#include "lfjson/lfjson.h"
+using namespace  lfjson;
+
+// Utils
+#include "bench_utils.h"
+
+// Std
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+
+#define PROFILE_MAIN_LOOPS    5
+static_assert(PROFILE_MAIN_LOOPS  > 0, "PROFILE_MAIN_LOOPS <= 0");
+#define PROFILE_INNER_LOOPS   20
+
+// Median time (ms) of 'func' over main loops
+template <class Func>
+double bench_profile_time(Func func)
+{
+  std::vector<double> times;
+  times.reserve(PROFILE_MAIN_LOOPS);
+  for (int i = 0; i < PROFILE_MAIN_LOOPS; ++i)
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    for (int j = 0; j < PROFILE_INNER_LOOPS; ++j)
+      func();
+      
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> diff = end - start;
+    times.push_back(diff.count() * 1000.);
+  }
+  std::sort(times.begin(), times.end());
+  return times[(times.size() - 1) / 2];
+}
+
+// Long arrays whose first elements are misleading: ints then a double, numbers then a string
+std::string bench_profile_json(int length)
+{
+  std::string json = "{\"series\":[";
+  for (int i = 0; i < length; ++i)
+    json += std::to_string(i * 7) + ",";
+  json += "0.5],\"labels\":[";
+  for (int i = 0; i < length; ++i)
+    json += std::to_string(i) + ",";
+  json += "\"end\"],\"flags\":[";
+  for (int i = 0; i < length; ++i)
+    json += (i % 3 == 0) ? "true," : "false,";
+  json += "null]}";
+  return json;
+}
+
+bool bench_profile_parse(DynamicDocument& doc, const std::string& json, DynamicTypeProfile* profile)
+{
+  doc.clear();
+  auto handler = doc.makeHandler();
+  handler.setTypeProfile(profile);
+  RapidHandler<> rapidHandler(handler);
+  rapidjson::Reader reader;
+  rapidjson::StringStream ss(json.c_str());
+  if (!reader.Parse(ss, rapidHandler))
+    return false;
+  handler.finalize(false);
+  return true;
+}
+
+void bench_profile()
+{
+  for (int length : { 100, 10000, 100000 })
+  {
+    std::cout << "\n------------------------------\n" << std::endl;
+    std::cout << "Array length: " << length << "\n" << std::endl;
+    
+    const std::string json = bench_profile_json(length);
+    
+    // Conversions at the last element
+    DynamicDocument plain;
+    double plainTime = bench_profile_time([&]() {
+      if (!bench_profile_parse(plain, json, nullptr))
+        exit(1);
+    });
+    
+    // Learned from a previous document
+    DynamicTypeProfile profile;
+    profile.learn(plain.croot());
+    DynamicDocument hinted;
+    double hintedTime = bench_profile_time([&]() {
+      if (!bench_profile_parse(hinted, json, &profile))
+        exit(1);
+    });
+    
+    if (!deepEquals(plain, hinted, MemberOrder::SENSITIVE))
+      exit(1);
+      
+    std::cout << "-> Without profile median:  " << plainTime << " ms" << std::endl;
+    std::cout << "-> With profile median:     " << hintedTime << " ms" << std::endl;
+    std::cout << "-> Speedup:                 " << plainTime / hintedTime << " x" << std::endl;
+  }
+}
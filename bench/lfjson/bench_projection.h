@@ -0,0 +1,105 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+// 3rd-parties
+#include "rapidjson/reader.h"
+
+// Src
+#include "lfjson/lfjson.h"
+using namespace  lfjson;
+
+// Utils
+#include "bench_utils.h"
+
+// Std
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+
+#define PROJECTION_MAIN_LOOPS   5
+static_assert(PROJECTION_MAIN_LOOPS  > 0, "PROJECTION_MAIN_LOOPS <= 0");
+#define PROJECTION_INNER_LOOPS  10
+
+// Median time (ms) of 'func' over main loops
+template <class Func>
+double bench_projection_time(Func func)
+{
+  std::vector<double> times;
+  times.reserve(PROJECTION_MAIN_LOOPS);
+  for (int i = 0; i < PROJECTION_MAIN_LOOPS; ++i)
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    for (int j = 0; j < PROJECTION_INNER_LOOPS; ++j)
+      func();
+      
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> diff = end - start;
+    times.push_back(diff.count() * 1000.);
+  }
+  std::sort(times.begin(), times.end());
+  return times[(times.size() - 1) / 2];
+}
+
+template <class HandlerT>
+void bench_projection_parse(const std::string& json, HandlerT& handler)
+{
+  RapidEventHandler<HandlerT> rapidHandler(handler);
+  rapidjson::Reader reader;
+  rapidjson::StringStream ss(json.c_str());
+  if (!reader.Parse(ss, rapidHandler))
+    exit(1);
+}
+
+void bench_projection(const std::string& filePath)
+{
+  std::cout << "\n------------------------------\n" << std::endl;
+  std::cout << "FilePath: " << filePath << "\n" << std::endl;
+  
+  // Read file to memory
+  std::ifstream ifs(filePath, std::ifstream::in);
+  assert(ifs.good());
+  std::string json(std::istreambuf_iterator<char>{ifs}, {});
+  
+  // Whole document
+  DynamicDocument full;
+  double fullTime = bench_projection_time([&]() {
+    full.clear();
+    auto handler = full.makeHandler();
+    bench_projection_parse(json, handler);
+    handler.finalize(false);
+  });
+  
+  // A few fields per status
+  const Projection projection = { "/statuses/*/id", "/statuses/*/lang", "/statuses/*/user/screen_name" };
+  DynamicDocument projected;
+  double projectedTime = bench_projection_time([&]() {
+    projected.clear();
+    auto handler = projected.makeHandler();
+    auto projectionHandler = makeProjectionHandler(handler, projection);
+    bench_projection_parse(json, projectionHandler);
+    handler.finalize(false);
+  });
+  
+  // Full parse then lookup, as reference
+  DynamicPointer pointer("/statuses/0/user/screen_name");
+  const ConstValue* expected = pointer.find(full);
+  const ConstValue* value = pointer.find(projected);
+  if (expected == nullptr || value == nullptr || !deepEquals(*expected, *value))
+    exit(1);
+    
+  std::cout << "Strings full: " << full.stringPool()->size() << ", projected: " << projected.stringPool()->size() << std::endl;
+  std::cout << "-> Full parse median:       " << fullTime << " ms" << std::endl;
+  std::cout << "-> Projected parse median:  " << projectedTime << " ms" << std::endl;
+  std::cout << "-> Speedup:                 " << fullTime / projectedTime << " x" << std::endl;
+}
@@ -0,0 +1,575 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+#ifndef LFJSON_BENCH_REGISTRY_H
+#define LFJSON_BENCH_REGISTRY_H
+
+// Std
+#include <cstdint>
+#include <cassert>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <utility>
+
+// Utils
+#include "bench_counters.h"
+
+// Summary of timed samples (ms)
+struct BenchStats
+{
+  size_t samples = 0u;
+  double min     = 0.;
+  double median  = 0.;
+  double p99     = 0.;
+  double mean    = 0.;
+  
+  static BenchStats of(std::vector<double> times)
+  {
+    BenchStats stats;
+    if (times.empty())
+      return stats;
+    std::sort(times.begin(), times.end());
+    const size_t n = times.size();
+    stats.samples = n;
+    stats.min     = times[0];
+    stats.median  = times[(n - 1) / 2];
+    stats.p99     = times[(size_t)std::ceil(0.99 * (double)n) - 1u];
+    double sum = 0.;
+    for (double t : times)
+      sum += t;
+    stats.mean = sum / (double)n;
+    return stats;
+  }
+  
+  // Throughput of 'bytes' per sample at median time
+  double mbps(uint64_t bytes) const
+  {
+    if (bytes == 0u || median <= 0.)
+      return 0.;
+    return ((double)bytes / (1024. * 1024.)) / (median / 1000.);
+  }
+};
+
+// One measured phase of a benchmark on one input
+struct BenchRow
+{
+  std::string bench;
+  std::string input;
+  std::string phase;
+  uint64_t    bytes = 0u;  // processed per sample (0: no throughput)
+  BenchStats  stats;
+  std::vector<std::pair<std::string, double>> metrics;  // benchmark specific (e.g. peak RSS)
+  
+  double mbps() const { return stats.mbps(bytes); }
+};
+
+enum class BenchFormat : uint8_t {
+  TEXT  = 0,
+  JSON  = 1,
+  CSV   = 2
+};
+
+//
+// Command line: lfjson_benchmark [--list] [--filter a,b] [--files x.json,y.json] [--samples N]
+//                                [--format text|json|csv] [--output path] [--set name=value ...] [--counters]
+struct BenchOptions
+{
+  std::vector<std::string> filters;  // benchmark names or 'prefix*', none: default ones
+  std::vector<std::string> files;
+  BenchFormat format = BenchFormat::TEXT;
+  std::string output;                // empty: stdout
+  int  samples = 0;                  // per phase, 0: benchmark default
+  std::map<std::string, std::string> params;  // benchmark specific (--set)
+  bool counters = false;             // hardware counters per row (see BenchCounters)
+  bool list = false;
+  bool help = false;
+  std::string error;
+  
+  static std::vector<std::string> split(const std::string& str)
+  {
+    std::vector<std::string> parts;
+    std::stringstream ss(str);
+    std::string part;
+    while (std::getline(ss, part, ','))
+    {
+      if (!part.empty())
+        parts.push_back(part);
+    }
+    return parts;
+  }
+  
+  static BenchOptions parse(int argc, char** argv, const std::vector<std::string>& defaultFiles)
+  {
+    BenchOptions options;
+    options.files = defaultFiles;
+    for (int i = 1; i < argc; ++i)
+    {
+      const std::string arg = argv[i];
+      const bool hasValue = i + 1 < argc;
+      if (arg == "--list")
+        options.list = true;
+      else if (arg == "--counters")
+        options.counters = true;
+      else if (arg == "--help" || arg == "-h")
+        options.help = true;
+      else if (arg == "--filter" && hasValue)
+        options.filters = split(argv[++i]);
+      else if (arg == "--files" && hasValue)
+        options.files = split(argv[++i]);
+      else if (arg == "--samples" && hasValue)
+        options.samples = std::atoi(argv[++i]);
+      else if (arg == "--output" && hasValue)
+        options.output = argv[++i];
+      else if (arg == "--set" && hasValue)
+      {
+        const std::string param = argv[++i];
+        const size_t pos = param.find('=');
+        if (pos == std::string::npos || pos == 0u)
+          options.error = "invalid parameter '" + param + "' (name=value)";
+        else
+          options.params[param.substr(0u, pos)] = param.substr(pos + 1u);
+      }
+      else if (arg == "--format" && hasValue)
+      {
+        const std::string format = argv[++i];
+        if (format == "text")
+          options.format = BenchFormat::TEXT;
+        else if (format == "json")
+          options.format = BenchFormat::JSON;
+        else if (format == "csv")
+          options.format = BenchFormat::CSV;
+        else
+          options.error = "unknown format '" + format + "'";
+      }
+      else
+        options.error = "unknown or incomplete argument '" + arg + "'";
+    }
+    return options;
+  }
+  
+  static void usage(std::ostream& os)
+  {
+    os << "Usage: lfjson_benchmark [--list] [--filter a,b] [--files x.json,y.json] [--samples N]\n"
+       << "                        [--format text|json|csv] [--output path] [--set name=value ...]\n"
+       << "                        [--counters]\n"
+       << "  --filter   benchmark names, 'prefix*' patterns or 'all' (default: memory)\n"
+       << "  --files    input files of file based benchmarks (default: bench/examples)\n"
+       << "  --samples  timed samples per phase (default: per benchmark)\n"
+       << "  --format   report format, free text of legacy benchmarks goes to stderr for json/csv on stdout\n"
+       << "  --set      benchmark parameter, sizes accept K/M/G suffixes (e.g. --set bytes=64M)\n"
+       << "  --counters hardware counters of timed samples per MB (Linux perf_event_open, skipped if unavailable)\n";
+  }
+};
+
+//
+// Handed to each benchmark: inputs and timers recording report rows
+class BenchContext
+{
+private:
+  const BenchOptions& mOptions;
+  std::vector<BenchRow>& mRows;
+  std::string mBench;
+  BenchCounters* mCounters;  // null: not counting
+  size_t mLast = 0u;  // last row recorded here (1-based, 0: none)
+  
+  // Row metrics '<counter>_per_mb' ('_per_call' without throughput) and 'ipc' from counted 'calls'
+  void annotateCounters(uint64_t bytes, double calls)
+  {
+    if (mCounters == nullptr || calls <= 0.)
+      return;
+    const double units = bytes > 0u ? calls * (double)bytes / (1024. * 1024.) : calls;
+    for (const auto& counter : mCounters->counters())
+      annotate(std::string(counter.name) + (bytes > 0u ? "_per_mb" : "_per_call"), counter.total / units);
+    const double cycles = mCounters->total("cycles");
+    if (cycles > 0.)
+      annotate("ipc", mCounters->total("instructions") / cycles);
+  }
+  
+  // Sample with counters enabled around it (outside the timed region)
+  template <class Func>
+  double sampleMs(Func func)
+  {
+    if (mCounters == nullptr)
+      return elapsedMs(func);
+    mCounters->start();
+    const double ms = elapsedMs(func);
+    mCounters->stop();
+    return ms;
+  }
+  
+  BenchStats record(const std::string& input, const std::string& phase, uint64_t bytes, std::vector<double>& times)
+  {
+    BenchRow row;
+    row.bench = mBench;
+    row.input = input;
+    row.phase = phase;
+    row.bytes = bytes;
+    row.stats = BenchStats::of(times);
+    mRows.push_back(row);
+    mLast = mRows.size();
+    return row.stats;
+  }
+  
+  template <class Func>
+  static double elapsedMs(Func func)
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+    func();
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> diff = end - start;
+    return diff.count() * 1000.;
+  }
+  
+public:
+  BenchContext(const BenchOptions& options, std::vector<BenchRow>& rows, const std::string& bench,
+               BenchCounters* counters = nullptr)
+    : mOptions(options)
+    , mRows(rows)
+    , mBench(bench)
+    , mCounters(counters != nullptr && counters->available() ? counters : nullptr)
+  {}
+  
+  const std::vector<std::string>& files() const { return mOptions.files; }
+  int samples(int defaultSamples) const { return mOptions.samples > 0 ? mOptions.samples : defaultSamples; }
+  
+  const BenchRow& lastRow() const
+  {
+    assert(mLast > 0u && "[bench] BenchContext: no measured row");
+    return mRows[mLast - 1u];
+  }
+  
+  // Extra value reported with the last measured row
+  void annotate(const std::string& name, double value)
+  {
+    assert(mLast > 0u && "[bench] BenchContext: no measured row");
+    mRows[mLast - 1u].metrics.emplace_back(name, value);
+  }
+  
+  // Parameters (--set name=value)
+  std::string param(const std::string& name, const std::string& defaultValue) const
+  {
+    auto it = mOptions.params.find(name);
+    return it != mOptions.params.end() ? it->second : defaultValue;
+  }
+  
+  double number(const std::string& name, double defaultValue) const
+  {
+    auto it = mOptions.params.find(name);
+    return it != mOptions.params.end() ? std::atof(it->second.c_str()) : defaultValue;
+  }
+  
+  // Size with optional K/M/G suffix (powers of 1024)
+  uint64_t bytes(const std::string& name, uint64_t defaultValue) const
+  {
+    auto it = mOptions.params.find(name);
+    if (it == mOptions.params.end() || it->second.empty())
+      return defaultValue;
+    char* end = nullptr;
+    const double value = std::strtod(it->second.c_str(), &end);
+    switch (*end)
+    {
+      case 'k': case 'K': return (uint64_t)(value * 1024.);
+      case 'm': case 'M': return (uint64_t)(value * 1024. * 1024.);
+      case 'g': case 'G': return (uint64_t)(value * 1024. * 1024. * 1024.);
+      default:            return (uint64_t)value;
+    }
+  }
+  
+  // Input name in reports (file name without folders)
+  static std::string inputName(const std::string& path)
+  {
+    const size_t pos = path.find_last_of("/\\");
+    return pos == std::string::npos ? path : path.substr(pos + 1);
+  }
+  
+  static std::string readFile(const std::string& path)
+  {
+    std::ifstream ifs(path, std::ifstream::in | std::ifstream::binary);
+    if (!ifs.good())
+    {
+      std::cerr << "[bench] cannot read " << path << std::endl;
+      exit(1);
+    }
+    return std::string(std::istreambuf_iterator<char>{ifs}, {});
+  }
+  
+  // Repeatable 'run': calls per sample calibrated to ~1 ms (clock resolution), time per call recorded
+  template <class Run>
+  BenchStats measure(const std::string& input, const std::string& phase, uint64_t bytes, int defaultSamples, Run run)
+  {
+    const double once = elapsedMs(run);  // warm-up
+    const int calls = once >= 1. ? 1 : (int)std::min(100000., std::ceil(1. / std::max(once, 1e-6)));
+    
+    const int count = samples(defaultSamples);
+    std::vector<double> times;
+    times.reserve((size_t)count);
+    if (mCounters != nullptr)
+      mCounters->reset();
+    for (int i = 0; i < count; ++i)
+    {
+      times.push_back(sampleMs([&]() {
+        for (int j = 0; j < calls; ++j)
+          run();
+      }) / calls);
+    }
+    const BenchStats stats = record(input, phase, bytes, times);
+    annotateCounters(bytes, (double)count * calls);
+    return stats;
+  }
+  
+  // Consuming 'run' (e.g. finalize): untimed 'setup' before each call, one call per sample
+  template <class Setup, class Run>
+  BenchStats measureEach(const std::string& input, const std::string& phase, uint64_t bytes, int defaultSamples,
+                         Setup setup, Run run)
+  {
+    const int count = samples(defaultSamples);
+    std::vector<double> times;
+    times.reserve((size_t)count);
+    if (mCounters != nullptr)
+      mCounters->reset();
+    for (int i = 0; i < count; ++i)
+    {
+      setup();
+      times.push_back(sampleMs(run));
+    }
+    const BenchStats stats = record(input, phase, bytes, times);
+    annotateCounters(bytes, (double)count);
+    return stats;
+  }
+  
+  // Timed like measureEach (without setup) but no row recorded, e.g. baseline of a relative metric
+  template <class Run>
+  BenchStats timeEach(int defaultSamples, Run run)
+  {
+    const int count = samples(defaultSamples);
+    std::vector<double> times;
+    times.reserve((size_t)count);
+    for (int i = 0; i < count; ++i)
+      times.push_back(elapsedMs(run));
+    return BenchStats::of(times);
+  }
+};
+
+//
+// Named benchmarks selected from the command line, rows reported as text, JSON or CSV
+class BenchRegistry
+{
+private:
+  struct Entry {
+    std::string name;
+    std::string description;
+    bool        byDefault;
+    std::function<void(BenchContext&)> run;
+  };
+  
+  std::vector<Entry> mEntries;
+  
+  static bool selected(const Entry& entry, const std::vector<std::string>& filters)
+  {
+    if (filters.empty())
+      return entry.byDefault;
+    for (const auto& filter : filters)
+    {
+      if (filter == "all" || filter == entry.name)
+        return true;
+      if (!filter.empty() && filter.back() == '*' && entry.name.compare(0u, filter.size() - 1u, filter, 0u, filter.size() - 1u) == 0)
+        return true;
+    }
+    return false;
+  }
+  
+  static std::string jsonString(const std::string& str)
+  {
+    std::string out = "\"";
+    for (char c : str)
+    {
+      if (c == '"' || c == '\\')
+      {
+        out += '\\';
+        out += c;
+      }
+      else if ((unsigned char)c < 0x20u)
+      {
+        char buf[8];
+        std::snprintf(buf, sizeof(buf), "\\u%04x", (unsigned)c);
+        out += buf;
+      }
+      else
+        out += c;
+    }
+    return out + "\"";
+  }
+  
+  static std::string csvField(const std::string& str)
+  {
+    if (str.find_first_of(",\"\n") == std::string::npos)
+      return str;
+    std::string out = "\"";
+    for (char c : str)
+    {
+      if (c == '"')
+        out += '"';
+      out += c;
+    }
+    return out + "\"";
+  }
+  
+public:
+  void add(const std::string& name, const std::string& description, bool byDefault, std::function<void(BenchContext&)> run)
+  {
+    mEntries.push_back(Entry{ name, description, byDefault, run });
+  }
+  
+  void list(std::ostream& os) const
+  {
+    for (const auto& entry : mEntries)
+      os << std::left << std::setw(14) << entry.name << (entry.byDefault ? " * " : "   ") << entry.description << "\n";
+    os << "(* run without --filter)" << std::endl;
+  }
+  
+  static void writeText(std::ostream& os, const std::vector<BenchRow>& rows)
+  {
+    os << "\n" << std::left << std::setw(14) << "bench" << std::setw(22) << "input" << std::setw(14) << "phase"
+       << std::right << std::setw(8) << "samples" << std::setw(12) << "min ms" << std::setw(12) << "median ms"
+       << std::setw(12) << "p99 ms" << std::setw(10) << "MB/s" << "\n";
+    os << std::fixed;
+    for (const auto& row : rows)
+    {
+      os << std::left << std::setw(14) << row.bench << std::setw(22) << row.input << std::setw(14) << row.phase
+         << std::right << std::setw(8) << row.stats.samples << std::setprecision(4)
+         << std::setw(12) << row.stats.min << std::setw(12) << row.stats.median << std::setw(12) << row.stats.p99
+         << std::setprecision(1) << std::setw(10) << row.mbps();
+      for (const auto& metric : row.metrics)
+        os << "  " << metric.first << "=" << std::setprecision(2) << metric.second;
+      os << "\n";
+    }
+    os.unsetf(std::ios_base::floatfield);
+    os << std::setprecision(6) << std::flush;
+  }
+  
+  static void writeJson(std::ostream& os, const std::vector<BenchRow>& rows)
+  {
+    os << "{\"benchmarks\":[";
+    os << std::setprecision(9);
+    for (size_t i = 0; i < rows.size(); ++i)
+    {
+      const BenchRow& row = rows[i];
+      os << (i > 0 ? "," : "") << "\n  {\"bench\":" << jsonString(row.bench) << ",\"input\":" << jsonString(row.input)
+         << ",\"phase\":" << jsonString(row.phase) << ",\"bytes\":" << row.bytes << ",\"samples\":" << row.stats.samples
+         << ",\"min_ms\":" << row.stats.min << ",\"median_ms\":" << row.stats.median << ",\"p99_ms\":" << row.stats.p99
+         << ",\"mean_ms\":" << row.stats.mean << ",\"mbps\":" << row.mbps();
+      if (!row.metrics.empty())
+      {
+        os << ",\"metrics\":{";
+        for (size_t j = 0; j < row.metrics.size(); ++j)
+          os << (j > 0 ? "," : "") << jsonString(row.metrics[j].first) << ":" << row.metrics[j].second;
+        os << "}";
+      }
+      os << "}";
+    }
+    os << "\n]}" << std::endl;
+  }
+  
+  static void writeCsv(std::ostream& os, const std::vector<BenchRow>& rows)
+  {
+    os << "bench,input,phase,bytes,samples,min_ms,median_ms,p99_ms,mean_ms,mbps,metrics\n";
+    os << std::setprecision(9);
+    for (const auto& row : rows)
+    {
+      os << csvField(row.bench) << "," << csvField(row.input) << "," << csvField(row.phase) << "," << row.bytes
+         << "," << row.stats.samples << "," << row.stats.min << "," << row.stats.median << "," << row.stats.p99
+         << "," << row.stats.mean << "," << row.mbps() << ",";
+      for (size_t j = 0; j < row.metrics.size(); ++j)  // name=value;...
+        os << (j > 0 ? ";" : "") << csvField(row.metrics[j].first) << "=" << row.metrics[j].second;
+      os << "\n";
+    }
+    os << std::flush;
+  }
+  
+  // Returns the process exit code
+  int run(const BenchOptions& options) const
+  {
+    if (!options.error.empty())
+    {
+      std::cerr << "[bench] " << options.error << "\n";
+      BenchOptions::usage(std::cerr);
+      return 2;
+    }
+    if (options.help)
+    {
+      BenchOptions::usage(std::cout);
+      return 0;
+    }
+    if (options.list)
+    {
+      list(std::cout);
+      return 0;
+    }
+    
+    // Machine readable report on stdout: free text of benchmarks goes to stderr
+    std::ofstream file;
+    if (!options.output.empty())
+    {
+      file.open(options.output, std::ofstream::out | std::ofstream::trunc);
+      if (!file.good())
+      {
+        std::cerr << "[bench] cannot write " << options.output << std::endl;
+        return 1;
+      }
+    }
+    std::streambuf* stdoutBuf = std::cout.rdbuf();
+    const bool redirect = options.output.empty() && options.format != BenchFormat::TEXT;
+    if (redirect)
+      std::cout.rdbuf(std::cerr.rdbuf());
+      
+    // Optional hardware counters: missing ones reported once, benchmarks run regardless
+    std::unique_ptr<BenchCounters> counters;
+    if (options.counters)
+    {
+      counters.reset(new BenchCounters());
+      if (!counters->error().empty())
+        std::cerr << "[bench] counters " << (counters->available() ? "skipped: " : "unavailable: ") << counters->error()
+                  << " (see /proc/sys/kernel/perf_event_paranoid)" << std::endl;
+    }
+    
+    std::vector<BenchRow> rows;
+    for (const auto& entry : mEntries)
+    {
+      if (!selected(entry, options.filters))
+        continue;
+      std::cerr << "[bench] " << entry.name << std::endl;
+      BenchContext context(options, rows, entry.name, counters.get());
+      entry.run(context);
+    }
+    
+    if (redirect)
+      std::cout.rdbuf(stdoutBuf);
+    std::ostream& os = options.output.empty() ? std::cout : file;
+    if (rows.empty())
+      return 0;
+    switch (options.format)
+    {
+      case BenchFormat::JSON: writeJson(os, rows); break;
+      case BenchFormat::CSV:  writeCsv(os, rows);  break;
+      default:                writeText(os, rows); break;
+    }
+    return 0;
+  }
+};
+
+#endif // LFJSON_BENCH_REGISTRY_H
@@ -0,0 +1,186 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+// 3rd-parties
+#include "rapidjson/reader.h"
+
+// Src
+#include "lfjson/lfjson.h"
+using namespace  lfjson;
+
+// Utils
+#include "bench_utils.h"
+#include "bench_registry.h"
+#include "bench_corpus.h"
+
+// Std
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include <iostream>
+
+#define SCALING_SAMPLES   5
+
+// Rows of one sweep point (input "param=value"):
+// - total:  tokenize + build + finalize
+// - build:  Handler fed from recorded events (StringPool and PoolAllocator growth, no tokenizing)
+// - intern: StringPool only, keys and long strings
+void bench_scaling_point(BenchContext& ctx, const std::string& input, const CorpusSpec& spec)
+{
+  using StringPoolT = DynamicDocument::SharedStringPool::element_type;
+  
+  const std::string json = CorpusGenerator(spec).document();
+  
+  BenchEventTape tape;
+  {
+    rapidjson::Reader reader;
+    rapidjson::StringStream ss(json.c_str());
+    if (!reader.Parse(ss, tape))
+    {
+      std::cerr << "[bench] scaling: invalid corpus for " << input << std::endl;
+      exit(1);
+    }
+  }
+  
+  ctx.measure(input, "total", json.size(), SCALING_SAMPLES, [&]() {
+    DynamicDocument doc;
+    auto handler = doc.makeHandler();
+    RapidHandler<> rapidHandler(handler);
+    rapidjson::Reader reader;
+    rapidjson::StringStream ss(json.c_str());
+    if (!reader.Parse(ss, rapidHandler))
+      exit(1);
+    handler.finalize();
+  });
+  
+  std::unique_ptr<DynamicDocument> doc;
+  std::unique_ptr<DynamicDocument::Handler> handler;
+  ctx.measureEach(input, "build", json.size(), SCALING_SAMPLES, [&]() {
+    handler.reset();
+    doc.reset(new DynamicDocument());
+    handler.reset(new DynamicDocument::Handler(doc->makeHandler()));
+  }, [&]() {
+    if (!tape.replay(*handler))
+      exit(1);
+  });
+  handler.reset();
+  doc.reset();
+  
+  std::unique_ptr<StringPoolT> pool;
+  ctx.measureEach(input, "intern", json.size(), SCALING_SAMPLES, [&]() {
+    pool.reset(new StringPoolT());
+  }, [&]() {
+    tape.forEachInterned([&](const char* str, uint32_t len, bool key) {
+      bool found = false;
+      pool->provideInterned(str, key, found, (int32_t)len);
+    });
+  });
+}
+
+// Parameter sweeps over synthetic corpora (see CorpusSpec), one varied at a time from a base spec
+// --set bytes=N      size of each sweep point (default 1M)
+// --set max_bytes=N  largest point of the size sweep (default 16M, x4 steps from 64K)
+// --set seed=N       corpus seed
+// --set sweep=a,b    subset of keys, strlen, depth, homogeneity, size, ndjson
+void bench_scaling(BenchContext& ctx)
+{
+  CorpusSpec base;
+  base.bytes = ctx.bytes("bytes", 1u << 20);
+  base.seed  = (uint64_t)ctx.number("seed", (double)base.seed);
+  const uint64_t maxBytes = ctx.bytes("max_bytes", 16u << 20);
+  
+  const std::vector<std::string> sweeps = BenchOptions::split(ctx.param("sweep", "keys,strlen,depth,homogeneity,size,ndjson"));
+  auto enabled = [&sweeps](const char* sweep) {
+    return std::find(sweeps.begin(), sweeps.end(), sweep) != sweeps.end();
+  };
+  
+  // Key cardinality: StringPool buckets and rehashes
+  if (enabled("keys"))
+  {
+    for (uint32_t card : { 16u, 256u, 4096u, 65536u, 1048576u })
+    {
+      CorpusSpec spec = base;
+      spec.keyCardinality = card;
+      bench_scaling_point(ctx, "keys=" + std::to_string(card), spec);
+    }
+  }
+  
+  // String length: short (inline) Vs long (interned) strings, chunk use
+  if (enabled("strlen"))
+  {
+    const uint32_t shortMax = (uint32_t)JValue::ShortString_MaxSize;
+    for (uint32_t len : { 4u, shortMax - 1u, shortMax, 64u, 512u, 4096u })
+    {
+      CorpusSpec spec = base;
+      spec.minStringLength = len;
+      spec.maxStringLength = len;
+      bench_scaling_point(ctx, "strlen=" + std::to_string(len), spec);
+    }
+  }
+  
+  // Nesting depth: LFStack growth, object/array chunks per level
+  if (enabled("depth"))
+  {
+    for (uint32_t depth : { 1u, 4u, 16u, 64u, 256u })
+    {
+      CorpusSpec spec = base;
+      spec.maxDepth  = depth;
+      spec.nestRatio = 0.;
+      bench_scaling_point(ctx, "depth=" + std::to_string(depth), spec);
+    }
+  }
+  
+  // Array homogeneity: specialized arrays Vs mid-parse conversions
+  if (enabled("homogeneity"))
+  {
+    for (double ratio : { 0., 0.5, 0.9, 0.99, 1. })
+    {
+      CorpusSpec spec = base;
+      spec.maxDepth    = 1u;
+      spec.nestRatio   = 0.5;
+      spec.arrayRatio  = 1.;
+      spec.arrayLength = 64u;
+      spec.homogeneity = ratio;
+      char name[32];
+      std::snprintf(name, sizeof(name), "homogeneity=%g", ratio);
+      bench_scaling_point(ctx, name, spec);
+    }
+  }
+  
+  // Document size: allocator chunk chains, pool growth
+  if (enabled("size"))
+  {
+    for (uint64_t bytes = 64u << 10; bytes <= maxBytes; bytes *= 4u)
+    {
+      CorpusSpec spec = base;
+      spec.bytes = bytes;
+      bench_scaling_point(ctx, "size=" + std::to_string(bytes), spec);
+    }
+  }
+  
+  // NDJSON stream size: filter pushdown on raw records (hot key, skewed keys)
+  if (enabled("ndjson"))
+  {
+    for (uint64_t bytes = 64u << 10; bytes <= maxBytes; bytes *= 4u)
+    {
+      CorpusSpec spec = base;
+      spec.bytes   = bytes;
+      spec.keySkew = 4.;
+      CorpusGenerator generator(spec);
+      const std::string pointer = "/" + generator.key(0u);
+      const std::string data = generator.ndjson();
+      
+      RecordFilter filter;
+      filter.exists(pointer.c_str());
+      ctx.measure("ndjson=" + std::to_string(bytes), "filter", data.size(), SCALING_SAMPLES, [&]() {
+        if (scanNdjson(data, filter).records == 0u)
+          exit(1);
+      });
+    }
+  }
+}
@@ -0,0 +1,227 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+// 3rd-parties
+#include "rapidjson/document.h"
+#if defined(__GNUC__)
+  #pragma GCC diagnostic push
+  #pragma GCC diagnostic ignored "-Wimplicit-fallthrough"  // rapidjson/internal/regex.h
+#endif
+#include "rapidjson/schema.h"
+#if defined(__GNUC__)
+  #pragma GCC diagnostic pop
+#endif
+#include "rapidjson/stringbuffer.h"
+
+// Src
+#include "lfjson/lfjson.h"
+using namespace  lfjson;
+
+// Utils
+#include "bench_utils.h"
+
+// Std
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <chrono>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+
+#define SCHEMA_MAIN_LOOPS    5
+static_assert(SCHEMA_MAIN_LOOPS  > 0, "SCHEMA_MAIN_LOOPS <= 0");
+#define SCHEMA_INNER_LOOPS   50   // ensure min time Vs clock resolution
+static_assert(SCHEMA_INNER_LOOPS > 0, "SCHEMA_INNER_LOOPS <= 0");
+
+// Median time (ms) of 'func' over main loops
+template <class Func>
+double bench_schema_time(Func func)
+{
+  std::vector<double> times;
+  times.reserve(SCHEMA_MAIN_LOOPS);
+  for (int i = 0; i < SCHEMA_MAIN_LOOPS; ++i)
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    for (int j = 0; j < SCHEMA_INNER_LOOPS; ++j)
+      func();
+      
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> diff = end - start;
+    times.push_back(diff.count() * 1000.);
+  }
+  std::sort(times.begin(), times.end());
+  return times[(times.size() - 1) / 2];
+}
+
+// Schema inferred from a document: merged types, properties, required (present in all), items and numeric bounds
+struct BenchShape
+{
+  std::vector<std::string> types;
+  std::map<std::string, BenchShape> props;
+  std::vector<std::string> required;
+  std::unique_ptr<BenchShape> items;
+  bool objectSeen = false;
+  bool hasBounds = false;
+  double low = 0.;
+  double high = 0.;
+  
+  void addType(const char* type)
+  {
+    if (std::find(types.begin(), types.end(), type) == types.end())
+      types.push_back(type);
+  }
+  
+  void addNumber(double d, bool integral)
+  {
+    addType(integral ? "integer" : "number");
+    low  = hasBounds ? std::min(low, d)  : d;
+    high = hasBounds ? std::max(high, d) : d;
+    hasBounds = true;
+  }
+  
+  void merge(const ConstValue& value)
+  {
+    switch (value.type())
+    {
+      case JType::OBJECT:
+      {
+        addType("object");
+        std::vector<std::string> keys;
+        for (uint32_t i = 0u; i < value.objectSize(); ++i)
+        {
+          const ConstMember& member = value.objectMembers()[i];
+          keys.emplace_back(member.key(), member.keyLen());
+          props[keys.back()].merge(member.value());
+        }
+        if (!objectSeen)
+          required = keys;
+        else
+          required.erase(std::remove_if(required.begin(), required.end(), [&](const std::string& key) {
+            return std::find(keys.begin(), keys.end(), key) == keys.end();
+          }), required.end());
+        objectSeen = true;
+        break;
+      }
+      case JType::ARRAY:
+      case JType::BARRAY:
+      case JType::IARRAY:
+      case JType::DARRAY:
+      {
+        addType("array");
+        if (!items)
+          items.reset(new BenchShape());
+        for (uint32_t i = 0u; i < helper::metaArraySize(value); ++i)
+          items->merge(helper::metaArrayElement(value, i));
+        break;
+      }
+      case JType::SSTRING:
+      case JType::LSTRING:  addType("string");  break;
+      case JType::TRUE:
+      case JType::FALSE:    addType("boolean"); break;
+      case JType::INT64:    addNumber((double)value.getInt64(),  true); break;
+      case JType::UINT64:   addNumber((double)value.getUInt64(), true); break;
+      case JType::DOUBLE:   addNumber(value.getDouble(), false); break;
+      default:              addType("null");    break;
+    }
+  }
+  
+  template <class RefValueT>
+  void write(RefValueT schema) const
+  {
+    const bool number = std::find(types.begin(), types.end(), "number") != types.end();
+    uint32_t t = 0u;
+    for (const auto& type : types)
+    {
+      if (!number || type != "integer")  // 'number' includes integers
+        schema["type"][t++] = type.c_str();  // extern, shape outlives schema
+    }
+    if (hasBounds)
+    {
+      schema["minimum"] = low;
+      schema["maximum"] = high;
+    }
+    if (!props.empty())
+    {
+      schema["properties"].toObject();
+      for (const auto& prop : props)
+        prop.second.write(schema["properties"][prop.first.c_str()]);
+    }
+    for (uint32_t i = 0u; i < (uint32_t)required.size(); ++i)
+      schema["required"][i] = required[i].c_str();
+    if (items && !items->types.empty())
+      items->write(schema["items"]);
+  }
+};
+
+void bench_schema(const std::vector<std::string>& filePaths)
+{
+  for (const auto& filePath : filePaths)
+  {
+    std::cout << "\n------------------------------\n" << std::endl;
+    std::cout << "FilePath: " << filePath << "\n" << std::endl;
+    
+    // Read file to memory
+    std::ifstream ifs(filePath, std::ifstream::in);
+    assert(ifs.good());
+    std::string json(std::istreambuf_iterator<char>{ifs}, {});
+    
+    DynamicDocument doc;
+    {
+      auto handler = doc.makeHandler();
+      RapidHandler<> rapidHandler(handler);
+      
+      rapidjson::Reader reader;
+      rapidjson::StringStream ss(json.c_str());
+      
+      reader.Parse(ss, rapidHandler);
+      handler.finalize();
+    }
+    
+    // Inferred schema, compiled by both
+    BenchShape shape;
+    shape.merge(doc.croot());
+    DynamicDocument schemaDoc;
+    shape.write(schemaDoc.root());
+    rapidjson::StringBuffer buffer;
+    RapidWriter::write(buffer, schemaDoc.croot());
+    
+    std::unique_ptr<rapidjson::SchemaDocument> rapidSchema;
+    {
+      // Only one instrumented rapidjson document alive at a time (each one resets DbgAllocator)
+      rapidjson::Document rapidSchemaDoc;
+      rapidSchemaDoc.Parse(buffer.GetString());
+      rapidSchema.reset(new rapidjson::SchemaDocument(rapidSchemaDoc));
+    }
+    rapidjson::SchemaValidator rapidValidator(*rapidSchema);
+    DynamicSchema schema(schemaDoc);
+    
+    rapidjson::Document rapidDoc;
+    rapidDoc.Parse(json.c_str());
+    
+    std::cout << "Schema size: " << buffer.GetSize() << " bytes" << std::endl;
+    
+    double rapidTime = bench_schema_time([&]() {
+      rapidValidator.Reset();
+      if (!rapidDoc.Accept(rapidValidator))
+        exit(1);
+    });
+    double lfjTime = bench_schema_time([&]() {
+      if (!schema.validate(doc))
+        exit(1);
+    });
+    
+    std::cout << "-> Rapidjson validate median: " << rapidTime << " ms" << std::endl;
+    std::cout << "-> Lfjson validate median:    " << lfjTime   << " ms" << std::endl;
+    std::cout << "-> Speedup:                   " << rapidTime / lfjTime << " x" << std::endl;
+  }
+}
@@ -14,6 +14,7 @@ using namespace  lfjson;
 
 // Utils
 #include "bench_utils.h"
+#include "bench_registry.h"
 
 // Std
 #include <cstdint>
@@ -27,67 +28,44 @@ using namespace  lfjson;
 #include <fstream>
 #include <algorithm>
 
-#define SERIALIZE_MAIN_LOOPS    5
-static_assert(SERIALIZE_MAIN_LOOPS  > 0, "SERIALIZE_MAIN_LOOPS <= 0");
-#define SERIALIZE_INNER_LOOPS   1000  // ensure min time Vs clock resolution
-static_assert(SERIALIZE_INNER_LOOPS > 0, "SERIALIZE_INNER_LOOPS <= 0");
+#define SERIALIZE_SAMPLES     10
 
 
-void bench_serialize(const std::vector<std::string>& filePaths)
+void bench_serialize(BenchContext& ctx)
 {
   // Use pretty writer
   const bool prettyOutput = false;
   
-  for (const auto& filePath : filePaths)
+  for (const auto& filePath : ctx.files())
   {
-    std::cout << "\n------------------------------\n" << std::endl;
-    std::cout << "FilePath: " << filePath << "\n" << std::endl;
-    
-    // Read file to memory
-    std::ifstream ifs(filePath, std::ifstream::in);
-    assert(ifs.good());
-    std::string json(std::istreambuf_iterator<char>{ifs}, {});
+    const std::string json = BenchContext::readFile(filePath);
+    const std::string input = BenchContext::inputName(filePath);
     
     // RapidJSON
-    std::vector<double> rapidTimes;
-    rapidTimes.reserve(SERIALIZE_MAIN_LOOPS);
-    
     {
       rapidjson::Document doc;
       doc.Parse(json.c_str());
       
-      for (int i = 0; i < SERIALIZE_MAIN_LOOPS; ++i)
-      {
-        auto start = std::chrono::high_resolution_clock::now();
-        
-        for (int j = 0; j < SERIALIZE_INNER_LOOPS; ++j)
+      ctx.measure(input, "rapidjson", json.size(), SERIALIZE_SAMPLES, [&]() {
+        rapidjson::StringBuffer buffer;
+        if (prettyOutput)
+        {
+          rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+          writer.SetIndent(' ', 2);
+          doc.Accept(writer);
+        }
+        else
         {
-          rapidjson::StringBuffer buffer;
-          if (prettyOutput)
-          {
-            rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
-            writer.SetIndent(' ', 2);
-            doc.Accept(writer);
-          }
-          else
-          {
-            rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-            doc.Accept(writer);
-          }
-          
-          if (buffer.GetSize() == 0u)
-            exit(1);
+          rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+          doc.Accept(writer);
         }
-        auto end = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<double> diff = end - start;
-        rapidTimes.push_back(diff.count() * 1000.);
-      }
+        
+        if (buffer.GetSize() == 0u)
+          exit(1);
+      });
     }
     
     // LFJSON
-    std::vector<double> lfTimes;
-    lfTimes.reserve(SERIALIZE_MAIN_LOOPS);
-    
     {
       DynamicDocument doc;
       auto handler = doc.makeHandler();
@@ -99,47 +77,20 @@ void bench_serialize(const std::vector<std::string>& filePaths)
       reader.Parse(ss, rapidHandler);
       handler.finalize();
       
-      for (int i = 0; i < SERIALIZE_MAIN_LOOPS; ++i)
-      {
-        auto start = std::chrono::high_resolution_clock::now();
-        
-        for (int j = 0; j < SERIALIZE_INNER_LOOPS; ++j)
+      ctx.measure(input, "lfjson", json.size(), SERIALIZE_SAMPLES, [&]() {
+        rapidjson::StringBuffer buffer;
+        if (prettyOutput)
         {
-          rapidjson::StringBuffer buffer;
-          if (prettyOutput)
-          {
-            RapidWriter::prettyWrite(buffer, doc.croot(), ' ', 2);
-          }
-          else
-          {
-            RapidWriter::write(buffer, doc.croot());
-          }
-          
-          if (buffer.GetSize() == 0u)
-            exit(1);
+          RapidWriter::prettyWrite(buffer, doc.croot(), ' ', 2);
         }
-        auto end = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<double> diff = end - start;
-        lfTimes.push_back(diff.count() * 1000.);
-      }
+        else
+        {
+          RapidWriter::write(buffer, doc.croot());
+        }
+        
+        if (buffer.GetSize() == 0u)
+          exit(1);
+      });
     }
-    
-    // Results
-    std::sort(rapidTimes.begin(), rapidTimes.end());
-    std::sort(lfTimes.begin(),    lfTimes.end());
-    
-    double rapidMedian = rapidTimes[(rapidTimes.size() - 1) / 2];
-    double lfMedian    = lfTimes[(lfTimes.size() - 1) / 2];
-    
-    double fastRatio   = 100. - (lfTimes[0] * 100. / (double)rapidTimes[0]);
-    double medianRatio = 100. - (lfMedian   * 100. / (double)rapidMedian);
-    
-    std::cout << "Serialize" << std::endl;
-    std::cout << "-> RapidJSON fastest: " << rapidTimes[0] << " ms" << std::endl;
-    std::cout << "-> LFJSON fastest:    " << lfTimes[0]    << " ms" << std::endl;
-    std::cout << "-> Fastest diff:      " << fastRatio     << " %"  << std::endl;
-    std::cout << "-> RapidJSON median: " << rapidMedian << " ms" << std::endl;
-    std::cout << "-> LFJSON median:    " << lfMedian    << " ms" << std::endl;
-    std::cout << "-> Median diff:      " << medianRatio << " %"  << std::endl;
   }
 }
@@ -0,0 +1,113 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+// 3rd-parties
+#include "rapidjson/reader.h"
+
+// Src
+#include "lfjson/lfjson.h"
+using namespace  lfjson;
+
+// Utils
+#include "bench_utils.h"
+
+// Std
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+
+#define SESSION_MAIN_LOOPS    5
+static_assert(SESSION_MAIN_LOOPS  > 0, "SESSION_MAIN_LOOPS <= 0");
+#define SESSION_REQUESTS      20000
+
+// Median time (ms) of 'func' over main loops
+template <class Func>
+double bench_session_time(Func func)
+{
+  std::vector<double> times;
+  times.reserve(SESSION_MAIN_LOOPS);
+  for (int i = 0; i < SESSION_MAIN_LOOPS; ++i)
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    func();
+      
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> diff = end - start;
+    times.push_back(diff.count() * 1000.);
+  }
+  std::sort(times.begin(), times.end());
+  return times[(times.size() - 1) / 2];
+}
+
+// Synthetic request: nested objects and a few hundred array elements (stack peak ~4 KB)
+std::string bench_session_request()
+{
+  std::string json = "{\"id\":42,\"user\":{\"name\":\"this is a long user name\",\"roles\":[\"a\",\"b\"]},\"items\":[";
+  for (int i = 0; i < 100; ++i)
+  {
+    json += (i > 0) ? "," : "";
+    json += "{\"sku\":" + std::to_string(i) + ",\"qty\":" + std::to_string(i % 7) + ",\"tags\":[1,2,3]}";
+  }
+  json += "],\"values\":[";
+  for (int i = 0; i < 500; ++i)
+    json += ((i > 0) ? "," : "") + std::to_string(i * 3);
+  json += "]}";
+  return json;
+}
+
+void bench_session()
+{
+  std::cout << "\n------------------------------\n" << std::endl;
+  std::cout << "Requests: " << SESSION_REQUESTS << "\n" << std::endl;
+  
+  const std::string json = bench_session_request();
+  
+  // New Handler per request (stack grows from 1 KB, released by finalize)
+  DynamicDocument doc;
+  double handlerTime = bench_session_time([&]() {
+    for (int i = 0; i < SESSION_REQUESTS; ++i)
+    {
+      doc.clear();
+      auto handler = doc.makeHandler();
+      RapidHandler<> rapidHandler(handler);
+      rapidjson::Reader reader;
+      rapidjson::StringStream ss(json.c_str());
+      if (!reader.Parse(ss, rapidHandler))
+        exit(1);
+      handler.finalize(false);
+    }
+  });
+  
+  // Persistent session (stack kept at peak capacity)
+  DynamicDocument sessionDoc;
+  DynamicParseSession session(sessionDoc);
+  double sessionTime = bench_session_time([&]() {
+    for (int i = 0; i < SESSION_REQUESTS; ++i)
+    {
+      RapidHandler<> rapidHandler(session.begin());
+      rapidjson::Reader reader;
+      rapidjson::StringStream ss(json.c_str());
+      if (!reader.Parse(ss, rapidHandler))
+        exit(1);
+      session.end();
+    }
+  });
+  
+  if (!deepEquals(doc, sessionDoc, MemberOrder::SENSITIVE))
+    exit(1);
+  
+  std::cout << "Request size: " << json.size() << " B, stack peak: " << session.stackCapacity() << " B" << std::endl;
+  std::cout << "-> Handler per request median: " << handlerTime << " ms" << std::endl;
+  std::cout << "-> ParseSession median:        " << sessionTime << " ms" << std::endl;
+  std::cout << "-> Speedup:                    " << handlerTime / sessionTime << " x" << std::endl;
+}
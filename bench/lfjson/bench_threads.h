@@ -0,0 +1,187 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+// 3rd-parties
+#include "rapidjson/reader.h"
+
+// Src
+#include "lfjson/lfjson.h"
+using namespace  lfjson;
+
+// Utils
+#include "bench_utils.h"
+#include "bench_registry.h"
+#include "bench_corpus.h"
+
+// Std
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+#define THREADS_SAMPLES   5
+
+// Resident set size (MB) from /proc (0 if unavailable), peak reset by clear_refs (Linux >= 4.0)
+double bench_threads_rss(const char* field)
+{
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  const size_t len = std::strlen(field);
+  while (std::getline(status, line))
+  {
+    if (line.compare(0u, len, field) == 0 && line.size() > len && line[len] == ':')
+      return std::atof(line.c_str() + len + 1u) / 1024.;  // kB
+  }
+  return 0.;
+}
+
+void bench_threads_reset_peak()
+{
+  std::ofstream clearRefs("/proc/self/clear_refs");
+  if (clearRefs.good())
+    clearRefs << "5";
+}
+
+bool bench_threads_parse(DynamicDocument& doc, const std::string& line)
+{
+  auto handler = doc.makeHandler();
+  RapidHandler<> rapidHandler(handler);
+  rapidjson::Reader reader;
+  rapidjson::StringStream ss(line.c_str());
+  if (!reader.Parse(ss, rapidHandler))
+    return false;
+  handler.finalize();
+  return true;
+}
+
+// Each thread parses every record of the corpus (one Document per record), setups:
+// - independent:  Documents with their own StringPool
+// - thread-pool:  Documents sharing one StringPool per thread
+// - locked-pool:  Documents sharing one StringPool, tokenized concurrently then built under a mutex
+//                 (the pool allocator also serves Document objects: no finer grained locking)
+// Rows per thread count: aggregate MB/s, metrics efficiency (MB/s per thread vs a 1-thread run) and peak RSS
+// --set threads=1,2,4  thread counts (default 1,2,4 and hardware concurrency)
+// --set bytes=N        corpus size (default 1M)
+void bench_threads(BenchContext& ctx)
+{
+  using SharedStringPool = DynamicDocument::SharedStringPool;
+  using StringPoolT = SharedStringPool::element_type;
+  
+  CorpusSpec spec;
+  spec.bytes = ctx.bytes("bytes", 1u << 20);
+  std::vector<std::string> lines;
+  uint64_t corpusBytes = 0u;
+  CorpusGenerator(spec).ndjson([&](const std::string& line) {
+    lines.push_back(line);
+    corpusBytes += line.size();
+  });
+  
+  std::vector<uint32_t> threadCounts;
+  const std::string threadsParam = ctx.param("threads", "");
+  if (threadsParam.empty())
+  {
+    threadCounts = { 1u, 2u, 4u };
+    const uint32_t hardware = std::thread::hardware_concurrency();
+    if (hardware > 4u)
+      threadCounts.push_back(hardware);
+  }
+  else
+  {
+    for (const auto& count : BenchOptions::split(threadsParam))
+      threadCounts.push_back((uint32_t)std::max(1, std::atoi(count.c_str())));
+  }
+  
+  auto independent = [&](uint32_t) {
+    for (const auto& line : lines)
+    {
+      DynamicDocument doc;
+      if (!bench_threads_parse(doc, line))
+        exit(1);
+    }
+  };
+  
+  auto threadPool = [&](uint32_t) {
+    SharedStringPool pool = std::make_shared<StringPoolT>();
+    for (const auto& line : lines)
+    {
+      DynamicDocument doc(pool);
+      if (!bench_threads_parse(doc, line))
+        exit(1);
+    }
+  };
+  
+  std::mutex mutex;
+  SharedStringPool sharedPool;
+  auto lockedPool = [&](uint32_t) {
+    BenchEventTape tape;
+    for (const auto& line : lines)
+    {
+      tape.clear();
+      rapidjson::Reader reader;
+      rapidjson::StringStream ss(line.c_str());
+      if (!reader.Parse(ss, tape))
+        exit(1);
+        
+      std::lock_guard<std::mutex> lock(mutex);
+      DynamicDocument doc(sharedPool);
+      auto handler = doc.makeHandler();
+      if (!tape.replay(handler))
+        exit(1);
+      handler.finalize();
+    }
+  };
+  
+  struct Setup {
+    const char* name;
+    std::function<void(uint32_t)> run;
+  };
+  const Setup setups[] = {
+    { "independent", independent },
+    { "thread-pool", threadPool },
+    { "locked-pool", lockedPool }
+  };
+  
+  auto spawn = [](const Setup& setup, uint32_t count) {
+    std::vector<std::thread> threads;
+    threads.reserve(count);
+    for (uint32_t t = 0u; t < count; ++t)
+      threads.emplace_back(setup.run, t);
+    for (auto& thread : threads)
+      thread.join();
+  };
+  
+  for (const Setup& setup : setups)
+  {
+    // Single thread baseline, whatever the listed counts (not reported as a row)
+    sharedPool = std::make_shared<StringPoolT>();
+    const double baseline = ctx.timeEach(THREADS_SAMPLES, [&]() { spawn(setup, 1u); }).mbps(corpusBytes);
+    
+    for (uint32_t count : threadCounts)
+    {
+      sharedPool = std::make_shared<StringPoolT>();
+      const double rssBefore = bench_threads_rss("VmRSS");
+      bench_threads_reset_peak();
+      
+      ctx.measureEach("threads=" + std::to_string(count), setup.name, corpusBytes * count, THREADS_SAMPLES, []() {}, [&]() {
+        spawn(setup, count);
+      });
+      
+      const double perThread = ctx.lastRow().mbps() / count;
+      ctx.annotate("efficiency", baseline > 0. ? perThread / baseline : 0.);
+      const double peak = bench_threads_rss("VmHWM");
+      ctx.annotate("peak_rss_mb", peak);
+      ctx.annotate("rss_delta_mb", std::max(0., peak - rssBefore));
+    }
+    sharedPool.reset();
+  }
+}
@@ -19,6 +19,8 @@ using namespace  lfjson;
 // Std
 #include <cstdint>
 #include <cassert>
+#include <string>
+#include <vector>
 #include <iostream>
 
 
@@ -55,6 +57,141 @@ struct RapidHandler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, Rap
 };
 
 
+// Forward rapidjson events to any lfjson event handler
+template <class HandlerT>
+struct RapidEventHandler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, RapidEventHandler<HandlerT>>
+{
+  HandlerT& handler;
+  
+  RapidEventHandler(HandlerT& handler_) : handler(handler_) {}
+  
+  bool Null()               { return handler.pushNull(); }
+  bool Bool(bool b)         { return handler.pushBool(b); }
+  bool Int(int i)           { return handler.pushInt(i); }
+  bool Uint(unsigned u)     { return handler.pushUInt(u); }
+  bool Int64(int64_t i64)   { return handler.pushInt64(i64); }
+  bool Uint64(uint64_t u64) { return handler.pushUInt64(u64); }
+  bool Double(double d)     { return handler.pushDouble(d); }
+  bool String(const char* str, rapidjson::SizeType length, bool copy) { return handler.pushString(str, copy, (int32_t)length); }
+  bool Key(const char* str, rapidjson::SizeType length, bool copy)    { return handler.pushKey(str, copy, (int32_t)length); }
+  bool StartObject()                              { return handler.startObject(); }
+  bool EndObject(rapidjson::SizeType memberCount) { return handler.endObject((uint32_t)memberCount); }
+  bool StartArray()                               { return handler.startArray(); }
+  bool EndArray(rapidjson::SizeType elementCount) { return handler.endArray((uint32_t)elementCount); }
+};
+
+
+// Reader events recorded once, replayed without tokenizing (isolates the Handler build)
+class BenchEventTape : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, BenchEventTape>
+{
+private:
+  enum class Op : uint8_t {
+    NUL, BOOL, INT, UINT, INT64, UINT64, DOUBLE, STRING, KEY, START_OBJECT, END_OBJECT, START_ARRAY, END_ARRAY
+  };
+  
+  struct Event {
+    Op       op;
+    uint32_t count;  // string length or container size
+    union {
+      int64_t  i;
+      uint64_t u;    // string offset in arena
+      double   d;
+    } value;
+  };
+  
+  std::vector<Event> mEvents;
+  std::string mArena;  // zero-terminated strings
+  
+  bool add(Op op, uint32_t count = 0u, uint64_t u = 0u)
+  {
+    Event event;
+    event.op      = op;
+    event.count   = count;
+    event.value.u = u;
+    mEvents.push_back(event);
+    return true;
+  }
+  
+  bool addString(Op op, const char* str, rapidjson::SizeType length)
+  {
+    const uint64_t offset = mArena.size();
+    mArena.append(str, length);
+    mArena.push_back('\0');
+    return add(op, (uint32_t)length, offset);
+  }
+  
+public:
+  // Accessors
+  size_t size() const { return mEvents.size(); }
+  
+  // Modifiers (capacity kept)
+  void clear()
+  {
+    mEvents.clear();
+    mArena.clear();
+  }
+  
+  // Strings the Handler interns (keys and long strings), in event order
+  template <class Func>
+  void forEachInterned(Func func) const
+  {
+    for (const Event& event : mEvents)
+    {
+      if (event.op == Op::KEY || (event.op == Op::STRING && event.count >= JValue::ShortString_MaxSize))
+        func(mArena.data() + event.value.u, event.count, event.op == Op::KEY);
+    }
+  }
+  
+  template <class HandlerT>
+  bool replay(HandlerT& handler) const
+  {
+    for (const Event& event : mEvents)
+    {
+      bool ok = true;
+      switch (event.op)
+      {
+        case Op::NUL:           ok = handler.pushNull(); break;
+        case Op::BOOL:          ok = handler.pushBool(event.value.u != 0u); break;
+        case Op::INT:           ok = handler.pushInt((int)event.value.i); break;
+        case Op::UINT:          ok = handler.pushUInt((unsigned)event.value.u); break;
+        case Op::INT64:         ok = handler.pushInt64(event.value.i); break;
+        case Op::UINT64:        ok = handler.pushUInt64(event.value.u); break;
+        case Op::DOUBLE:        ok = handler.pushDouble(event.value.d); break;
+        case Op::STRING:        ok = handler.pushString(mArena.data() + event.value.u, true, (int32_t)event.count); break;
+        case Op::KEY:           ok = handler.pushKey(mArena.data() + event.value.u, true, (int32_t)event.count); break;
+        case Op::START_OBJECT:  ok = handler.startObject(); break;
+        case Op::END_OBJECT:    ok = handler.endObject(event.count); break;
+        case Op::START_ARRAY:   ok = handler.startArray(); break;
+        case Op::END_ARRAY:     ok = handler.endArray(event.count); break;
+      }
+      if (!ok)
+        return false;
+    }
+    return true;
+  }
+  
+  // rapidjson handler
+  bool Null()               { return add(Op::NUL); }
+  bool Bool(bool b)         { return add(Op::BOOL, 0u, b ? 1u : 0u); }
+  bool Int(int i)           { return add(Op::INT, 0u, (uint64_t)(int64_t)i); }
+  bool Uint(unsigned u)     { return add(Op::UINT, 0u, u); }
+  bool Int64(int64_t i64)   { return add(Op::INT64, 0u, (uint64_t)i64); }
+  bool Uint64(uint64_t u64) { return add(Op::UINT64, 0u, u64); }
+  bool Double(double d)
+  {
+    add(Op::DOUBLE);
+    mEvents.back().value.d = d;
+    return true;
+  }
+  bool String(const char* str, rapidjson::SizeType length, bool) { return addString(Op::STRING, str, length); }
+  bool Key(const char* str, rapidjson::SizeType length, bool)    { return addString(Op::KEY, str, length); }
+  bool StartObject()                              { return add(Op::START_OBJECT); }
+  bool EndObject(rapidjson::SizeType memberCount) { return add(Op::END_OBJECT, (uint32_t)memberCount); }
+  bool StartArray()                               { return add(Op::START_ARRAY); }
+  bool EndArray(rapidjson::SizeType elementCount) { return add(Op::END_ARRAY, (uint32_t)elementCount); }
+};
+
+
 class RapidWriter
 {
 private:
@@ -80,7 +217,7 @@ private:
     const uint32_t size = val.arraySize();
     for (uint32_t i = 0; i < size; ++i)
       printVal(writer, array[i]);
-    
+      
     writer.EndArray();
   }
   
@@ -93,7 +230,7 @@ private:
     const uint32_t size = val.barraySize();
     for (uint32_t i = 0; i < size; ++i)
       writer.Bool(barray[i]);
-    
+      
     writer.EndArray();
   }
   
@@ -106,7 +243,7 @@ private:
     const uint32_t size = val.iarraySize();
     for (uint32_t i = 0; i < size; ++i)
       writer.Int64(iarray[i]);
-    
+      
     writer.EndArray();
   }
   
@@ -119,7 +256,7 @@ private:
     const uint32_t size = val.darraySize();
     for (uint32_t i = 0; i < size; ++i)
       writer.Double(darray[i]);
-    
+      
     writer.EndArray();
   }
   
@@ -167,7 +304,7 @@ private:
     const uint32_t size = val.arraySize();
     for (uint32_t i = 0; i < size; ++i)
       printVal(writer, array[i]);
-    
+      
     writer.EndArray();
   }
   
@@ -180,7 +317,7 @@ private:
     const uint32_t size = val.barraySize();
     for (uint32_t i = 0; i < size; ++i)
       writer.Bool(barray[i]);
-    
+      
     writer.EndArray();
   }
   
@@ -193,7 +330,7 @@ private:
     const uint32_t size = val.iarraySize();
     for (uint32_t i = 0; i < size; ++i)
       writer.Int64(iarray[i]);
-    
+      
     writer.EndArray();
   }
   
@@ -206,7 +343,7 @@ private:
     const uint32_t size = val.darraySize();
     for (uint32_t i = 0; i < size; ++i)
       writer.Double(darray[i]);
-    
+      
     writer.EndArray();
   }
   
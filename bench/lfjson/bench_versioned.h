@@ -0,0 +1,110 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+// 3rd-parties
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+
+// Src
+#include "lfjson/lfjson.h"
+using namespace  lfjson;
+
+// Utils
+#include "bench_utils.h"
+
+// Std
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cassert>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+
+#define VERSIONED_MAIN_LOOPS    5
+static_assert(VERSIONED_MAIN_LOOPS  > 0, "VERSIONED_MAIN_LOOPS <= 0");
+#define VERSIONED_INNER_LOOPS   1000  // ensure min time Vs clock resolution
+static_assert(VERSIONED_INNER_LOOPS > 0, "VERSIONED_INNER_LOOPS <= 0");
+
+// Median time (ms) of 'func' over main loops
+template <class Func>
+double bench_versioned_time(Func func)
+{
+  std::vector<double> times;
+  times.reserve(VERSIONED_MAIN_LOOPS);
+  for (int i = 0; i < VERSIONED_MAIN_LOOPS; ++i)
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    for (int j = 0; j < VERSIONED_INNER_LOOPS; ++j)
+      func(j);
+      
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> diff = end - start;
+    times.push_back(diff.count() * 1000.);
+  }
+  std::sort(times.begin(), times.end());
+  return times[(times.size() - 1) / 2];
+}
+
+void bench_versioned(const std::vector<std::string>& filePaths)
+{
+  for (const auto& filePath : filePaths)
+  {
+    std::cout << "\n------------------------------\n" << std::endl;
+    std::cout << "FilePath: " << filePath << "\n" << std::endl;
+    
+    // Read file to memory
+    std::ifstream ifs(filePath, std::ifstream::in);
+    assert(ifs.good());
+    std::string json(std::istreambuf_iterator<char>{ifs}, {});
+    
+    DynamicDocument tmpl;
+    {
+      auto handler = tmpl.makeHandler();
+      RapidHandler<> rapidHandler(handler);
+      
+      rapidjson::Reader reader;
+      rapidjson::StringStream ss(json.c_str());
+      
+      reader.Parse(ss, rapidHandler);
+      handler.finalize();
+    }
+    if (!tmpl.croot().isObject())
+    {
+      std::cout << "Skipped: root is not an object" << std::endl;
+      continue;
+    }
+    
+    // Updated member: '/version' (added to root)
+    const DynamicPointer path("/version");
+    
+    // Copy whole document per update
+    double copyTime = bench_versioned_time([&](int i) {
+      DynamicDocument doc(tmpl.stringPool());
+      doc.cloneFrom(tmpl);
+      doc.root()["version"] = i;
+    });
+    
+    // Path copy per update, one reader snapshot kept alive
+    DynamicVersionedDocument vdoc;
+    vdoc.assign(DynamicPointer(""), tmpl);
+    vdoc.commit();
+    DynamicVersionedDocument::Snapshot snap;
+    double pathTime = bench_versioned_time([&](int i) {
+      vdoc.set(path, i);
+      vdoc.commit();
+      snap = vdoc.snapshot();
+    });
+    
+    std::cout << "Versioned update" << std::endl;
+    std::cout << "-> Full copy median:    " << copyTime << " ms" << std::endl;
+    std::cout << "-> Path copy median:    " << pathTime << " ms" << std::endl;
+    std::cout << "-> Speedup:             " << copyTime / pathTime << " x" << std::endl;
+  }
+}
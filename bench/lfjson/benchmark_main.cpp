@@ -7,21 +7,36 @@
 #define LFJ_STRINGPOOL_INSTRUMENTED // LFJSON instrumented string pool
 
 #include "bench_utils.h"
+#include "bench_registry.h"
 #include "bench_memory.h"
 #include "bench_deserialize.h"
 #include "bench_serialize.h"
+#include "bench_phases.h"
+#include "bench_scaling.h"
+#include "bench_threads.h"
+#include "bench_alloc.h"
+#include "bench_pointer.h"
+#include "bench_aggregate.h"
+#include "bench_clone.h"
+#include "bench_versioned.h"
+#include "bench_patch.h"
+#include "bench_hash.h"
+#include "bench_build.h"
+#include "bench_schema.h"
+#include "bench_binding.h"
+#include "bench_session.h"
+#include "bench_direct.h"
+#include "bench_projection.h"
+#include "bench_ndjson.h"
+#include "bench_profile.h"
 
 #include <string>
 #include <vector>
 
 
-int main()
+int main(int argc, char** argv)
 {
-  const bool benchMemory      = true;
-  const bool benchDeserialize = false;
-  const bool benchSerialize   = false;
-  
-  // Input files to parse
+  // Input files to parse (--files)
   const std::string folderPath = BENCH_EXAMPLES_DIR;
   
   const std::vector<std::string> filePaths = {
@@ -31,15 +46,47 @@ int main()
     folderPath + "github_events.json"
   };
   
-  // Run
-  if (benchMemory)
-    bench_memory_lfjson(filePaths);
-  
-  if (benchDeserialize)
-    bench_deserialize(filePaths);
+  // Benchmarks by name (--filter), run by default when flagged
+  // Report rows (min/median/p99 ms, MB/s) from deserialize, serialize, phases, scaling, threads and alloc, free text from others
+  BenchRegistry registry;
+  registry.add("memory",      "memory footprint per input",                          true,
+               [](BenchContext& ctx) { bench_memory_lfjson(ctx.files()); });
+  registry.add("deserialize", "rapidjson Vs lfjson parse (rows)",                    false, bench_deserialize);
+  registry.add("serialize",   "rapidjson Vs lfjson write (rows)",                    false, bench_serialize);
+  registry.add("phases",      "tokenize/build/intern/finalize/serialize (rows)",     false, bench_phases);
+  registry.add("scaling",     "synthetic corpus sweeps (rows, --set bytes/max_bytes/seed/sweep)", false, bench_scaling);
+  registry.add("threads",     "multi-threaded parse, pool setups (rows, --set threads/bytes)", false, bench_threads);
+  registry.add("alloc",       "base allocator requests by origin (rows + histograms)",    false, bench_alloc);
+  registry.add("pointer",     "JSON pointer lookups",                                false,
+               [](BenchContext& ctx) { bench_pointer(ctx.files()); });
+  registry.add("aggregate",   "aggregations over documents",                         false,
+               [](BenchContext& ctx) { bench_aggregate(ctx.files()); });
+  registry.add("clone",       "document clones",                                     false,
+               [](BenchContext& ctx) { bench_clone(ctx.files()); });
+  registry.add("versioned",   "versioned documents",                                 false,
+               [](BenchContext& ctx) { bench_versioned(ctx.files()); });
+  registry.add("patch",       "JSON patch",                                          false,
+               [](BenchContext& ctx) { bench_patch(ctx.files()); });
+  registry.add("hash",        "document hashing",                                    false,
+               [](BenchContext& ctx) { bench_hash(ctx.files()); });
+  registry.add("build",       "programmatic builds",                                 false,
+               [](BenchContext&) { bench_build(); });
+  registry.add("schema",      "schema validation",                                   false,
+               [](BenchContext& ctx) { bench_schema(ctx.files()); });
+  registry.add("binding",     "struct bindings (twitter.json)",                      false,
+               [folderPath](BenchContext&) { bench_binding(folderPath + "twitter.json"); });
+  registry.add("session",     "parse sessions",                                      false,
+               [](BenchContext&) { bench_session(); });
+  registry.add("direct",      "staged Vs tape-driven Handler",                       false,
+               [](BenchContext& ctx) { bench_direct(ctx.files()); });
+  registry.add("projection",  "projected parse (twitter.json)",                      false,
+               [folderPath](BenchContext&) { bench_projection(folderPath + "twitter.json"); });
+  registry.add("ndjson",      "NDJSON filter pushdown",                              false,
+               [](BenchContext&) { bench_ndjson(); });
+  registry.add("profile",     "type profile hinted arrays",                          false,
+               [](BenchContext&) { bench_profile(); });
   
-  if (benchSerialize)
-    bench_serialize(filePaths);
-  
-  return 0;
+  // Run
+  const BenchOptions options = BenchOptions::parse(argc, argv, filePaths);
+  return registry.run(options);
 }
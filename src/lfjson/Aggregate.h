@@ -0,0 +1,826 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+#ifndef LFJSON_AGGREGATE_H
+#define LFJSON_AGGREGATE_H
+
+#include "BaseData.h"
+
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+#include <cassert>
+#include <limits>
+
+// AVX2 kernels, selected at runtime (define LFJ_NO_SIMD for scalar only)
+#if !defined(LFJ_NO_SIMD) && (defined(__GNUC__) || defined(__clang__)) \
+  && (defined(__x86_64__) || defined(__i386__))
+  #define LFJ_SIMD_AVX2
+  #include <immintrin.h>
+  #define LFJ_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#ifdef _MSC_VER
+  #include <intrin.h>
+#endif
+
+namespace lfjson
+{
+// Comparison operators (filters and count-if)
+enum class QueryOp : uint8_t {
+  EXISTS  = 0,  // always true
+  EQ      = 1,
+  NE      = 2,
+  LT      = 3,
+  LE      = 4,
+  GT      = 5,
+  GE      = 6
+};
+
+// Element index returned when no element qualifies (e.g. arg-max of an all-NaN array)
+constexpr uint32_t NoElement = std::numeric_limits<uint32_t>::max();
+
+namespace helper
+{
+inline uint32_t countTrailingZeros(uint64_t mask)
+{
+  assert(mask != 0u);
+#ifdef _MSC_VER
+  unsigned long pos;
+  _BitScanForward64(&pos, mask);
+  return (uint32_t)pos;
+#else
+  return (uint32_t)__builtin_ctzll(mask);
+#endif
+}
+
+inline uint32_t popCount(uint64_t mask)
+{
+#ifdef _MSC_VER
+  return (uint32_t)__popcnt64(mask);
+#else
+  return (uint32_t)__builtin_popcountll(mask);
+#endif
+}
+
+template <class T, class L>
+bool compare(T lhs, QueryOp op, L rhs)
+{
+  switch (op)
+  {
+    case QueryOp::EQ: return lhs == rhs;
+    case QueryOp::NE: return lhs != rhs;
+    case QueryOp::LT: return lhs <  rhs;
+    case QueryOp::LE: return lhs <= rhs;
+    case QueryOp::GT: return lhs >  rhs;
+    case QueryOp::GE: return lhs >= rhs;
+    default:
+      return true;
+  }
+}
+
+// Runtime switch (e.g. for benchmarks), AVX2 still requires CPU support
+inline bool& simdEnabled()
+{
+  static bool enabled = true;
+  return enabled;
+}
+
+inline bool useAVX2()
+{
+#ifdef LFJ_SIMD_AVX2
+  static const bool supported = __builtin_cpu_supports("avx2");
+  return supported && simdEnabled();
+#else
+  return false;
+#endif
+}
+
+//
+// Scalar kernels
+// Floating-point sums use 8 lanes reduced pairwise, same order as AVX2 (identical results)
+namespace scalar
+{
+inline double reduce8(const double* acc)
+{
+  return ((acc[0] + acc[4]) + (acc[1] + acc[5])) + ((acc[2] + acc[6]) + (acc[3] + acc[7]));
+}
+
+inline int64_t sum(const int64_t* data, uint32_t size)
+{
+  uint64_t acc = 0u;  // wraps
+  for (uint32_t i = 0u; i < size; ++i)
+    acc += (uint64_t)data[i];
+  return (int64_t)acc;
+}
+
+inline double sum(const double* data, uint32_t size, double* acc, uint32_t start = 0u)
+{
+  uint32_t i = start;
+  for (; i + 8u <= size; i += 8u)
+  {
+    for (uint32_t j = 0u; j < 8u; ++j)
+      acc[j] += data[i + j];
+  }
+  for (uint32_t j = 0u; i + j < size; ++j)
+    acc[j] += data[i + j];
+  return reduce8(acc);
+}
+
+inline double sumSquaredDiff(const double* data, uint32_t size, double mean, double* acc, uint32_t start = 0u)
+{
+  uint32_t i = start;
+  for (; i + 8u <= size; i += 8u)
+  {
+    for (uint32_t j = 0u; j < 8u; ++j)
+    {
+      const double d = data[i + j] - mean;
+      acc[j] += d * d;
+    }
+  }
+  for (uint32_t j = 0u; i + j < size; ++j)
+  {
+    const double d = data[i + j] - mean;
+    acc[j] += d * d;
+  }
+  return reduce8(acc);
+}
+
+template <class T>
+inline bool isNaN(T)         { return false; }
+inline bool isNaN(double v)  { return std::isnan(v); }
+
+// NaNs are skipped (all-NaN range gives NaN)
+template <class T>
+T min(const T* data, uint32_t size, uint32_t start, T init)
+{
+  T m = init;
+  for (uint32_t i = start; i < size; ++i)
+    m = (data[i] < m || isNaN(m)) ? data[i] : m;
+  return m;
+}
+
+template <class T>
+T max(const T* data, uint32_t size, uint32_t start, T init)
+{
+  T m = init;
+  for (uint32_t i = start; i < size; ++i)
+    m = (data[i] > m || isNaN(m)) ? data[i] : m;
+  return m;
+}
+
+// Non-empty range, seeded from first element
+template <class T>
+T min(const T* data, uint32_t size)
+{
+  assert(size > 0u);
+  return min(data, size, 1u, data[0]);
+}
+
+template <class T>
+T max(const T* data, uint32_t size)
+{
+  assert(size > 0u);
+  return max(data, size, 1u, data[0]);
+}
+
+inline uint32_t countTrue(const bool* data, uint32_t size, uint32_t start = 0u)
+{
+  uint32_t count = 0u;
+  for (uint32_t i = start; i < size; ++i)
+    count += (uint32_t)data[i];
+  return count;
+}
+
+// Bitmask of 'data[i] op literal' for up to 64 elements
+template <class T, class L>
+uint64_t compareMask(const T* data, uint32_t count, QueryOp op, L literal)
+{
+  assert(count <= 64u);
+  uint64_t mask = 0u;
+  switch (op)
+  {
+    case QueryOp::EQ: for (uint32_t j = 0u; j < count; ++j) mask |= (uint64_t)(data[j] == literal) << j; break;
+    case QueryOp::NE: for (uint32_t j = 0u; j < count; ++j) mask |= (uint64_t)(data[j] != literal) << j; break;
+    case QueryOp::LT: for (uint32_t j = 0u; j < count; ++j) mask |= (uint64_t)(data[j] <  literal) << j; break;
+    case QueryOp::LE: for (uint32_t j = 0u; j < count; ++j) mask |= (uint64_t)(data[j] <= literal) << j; break;
+    case QueryOp::GT: for (uint32_t j = 0u; j < count; ++j) mask |= (uint64_t)(data[j] >  literal) << j; break;
+    case QueryOp::GE: for (uint32_t j = 0u; j < count; ++j) mask |= (uint64_t)(data[j] >= literal) << j; break;
+    default:
+      mask = (count == 64u) ? ~(uint64_t)0u : (((uint64_t)1u << count) - 1u);
+  }
+  return mask;
+}
+} // namespace scalar
+
+#ifdef LFJ_SIMD_AVX2
+//
+// AVX2 kernels (unaligned loads, scalar tails)
+namespace avx2
+{
+LFJ_TARGET_AVX2 inline int64_t sum(const int64_t* data, uint32_t size)
+{
+  __m256i acc0 = _mm256_setzero_si256();
+  __m256i acc1 = _mm256_setzero_si256();
+  uint32_t i = 0u;
+  for (; i + 8u <= size; i += 8u)
+  {
+    acc0 = _mm256_add_epi64(acc0, _mm256_loadu_si256((const __m256i*)(data + i)));
+    acc1 = _mm256_add_epi64(acc1, _mm256_loadu_si256((const __m256i*)(data + i + 4u)));
+  }
+  alignas(32) int64_t lanes[4];
+  _mm256_store_si256((__m256i*)lanes, _mm256_add_epi64(acc0, acc1));
+  uint64_t acc = (uint64_t)lanes[0] + (uint64_t)lanes[1] + (uint64_t)lanes[2] + (uint64_t)lanes[3];
+  for (; i < size; ++i)
+    acc += (uint64_t)data[i];
+  return (int64_t)acc;
+}
+
+LFJ_TARGET_AVX2 inline double sum(const double* data, uint32_t size)
+{
+  __m256d acc0 = _mm256_setzero_pd();
+  __m256d acc1 = _mm256_setzero_pd();
+  uint32_t i = 0u;
+  for (; i + 8u <= size; i += 8u)
+  {
+    acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(data + i));
+    acc1 = _mm256_add_pd(acc1, _mm256_loadu_pd(data + i + 4u));
+  }
+  alignas(32) double acc[8];
+  _mm256_store_pd(acc,      acc0);
+  _mm256_store_pd(acc + 4u, acc1);
+  return scalar::sum(data, size, acc, i);
+}
+
+LFJ_TARGET_AVX2 inline double sumSquaredDiff(const double* data, uint32_t size, double mean)
+{
+  const __m256d m = _mm256_set1_pd(mean);
+  __m256d acc0 = _mm256_setzero_pd();
+  __m256d acc1 = _mm256_setzero_pd();
+  uint32_t i = 0u;
+  for (; i + 8u <= size; i += 8u)
+  {
+    const __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(data + i),      m);
+    const __m256d d1 = _mm256_sub_pd(_mm256_loadu_pd(data + i + 4u), m);
+    acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(d0, d0));
+    acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(d1, d1));
+  }
+  alignas(32) double acc[8];
+  _mm256_store_pd(acc,      acc0);
+  _mm256_store_pd(acc + 4u, acc1);
+  return scalar::sumSquaredDiff(data, size, mean, acc, i);
+}
+
+LFJ_TARGET_AVX2 inline int64_t min(const int64_t* data, uint32_t size)
+{
+  __m256i m = _mm256_set1_epi64x(data[0]);
+  uint32_t i = 0u;
+  for (; i + 4u <= size; i += 4u)
+  {
+    const __m256i v = _mm256_loadu_si256((const __m256i*)(data + i));
+    m = _mm256_blendv_epi8(m, v, _mm256_cmpgt_epi64(m, v));
+  }
+  alignas(32) int64_t lanes[4];
+  _mm256_store_si256((__m256i*)lanes, m);
+  return scalar::min(data, size, i, scalar::min(lanes, 4u));
+}
+
+LFJ_TARGET_AVX2 inline int64_t max(const int64_t* data, uint32_t size)
+{
+  __m256i m = _mm256_set1_epi64x(data[0]);
+  uint32_t i = 0u;
+  for (; i + 4u <= size; i += 4u)
+  {
+    const __m256i v = _mm256_loadu_si256((const __m256i*)(data + i));
+    m = _mm256_blendv_epi8(m, v, _mm256_cmpgt_epi64(v, m));
+  }
+  alignas(32) int64_t lanes[4];
+  _mm256_store_si256((__m256i*)lanes, m);
+  return scalar::max(data, size, i, scalar::max(lanes, 4u));
+}
+
+LFJ_TARGET_AVX2 inline double min(const double* data, uint32_t size)
+{
+  __m256d m = _mm256_set1_pd(data[0]);
+  uint32_t i = 0u;
+  for (; i + 4u <= size; i += 4u)
+  {
+    // same NaN policy as scalar: take v if better, or if lane is still NaN
+    const __m256d v = _mm256_loadu_pd(data + i);
+    const __m256d take = _mm256_or_pd(_mm256_cmp_pd(v, m, _CMP_LT_OQ), _mm256_cmp_pd(m, m, _CMP_UNORD_Q));
+    m = _mm256_blendv_pd(m, v, take);
+  }
+  alignas(32) double lanes[4];
+  _mm256_store_pd(lanes, m);
+  return scalar::min(data, size, i, scalar::min(lanes, 4u));
+}
+
+LFJ_TARGET_AVX2 inline double max(const double* data, uint32_t size)
+{
+  __m256d m = _mm256_set1_pd(data[0]);
+  uint32_t i = 0u;
+  for (; i + 4u <= size; i += 4u)
+  {
+    const __m256d v = _mm256_loadu_pd(data + i);
+    const __m256d take = _mm256_or_pd(_mm256_cmp_pd(v, m, _CMP_GT_OQ), _mm256_cmp_pd(m, m, _CMP_UNORD_Q));
+    m = _mm256_blendv_pd(m, v, take);
+  }
+  alignas(32) double lanes[4];
+  _mm256_store_pd(lanes, m);
+  return scalar::max(data, size, i, scalar::max(lanes, 4u));
+}
+
+LFJ_TARGET_AVX2 inline uint32_t countTrue(const bool* data, uint32_t size)
+{
+  // bools are 0/1 bytes: sum them 32 at a time
+  __m256i acc = _mm256_setzero_si256();
+  const __m256i zero = _mm256_setzero_si256();
+  uint32_t i = 0u;
+  for (; i + 32u <= size; i += 32u)
+    acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_loadu_si256((const __m256i*)(data + i)), zero));
+  alignas(32) uint64_t lanes[4];
+  _mm256_store_si256((__m256i*)lanes, acc);
+  return (uint32_t)(lanes[0] + lanes[1] + lanes[2] + lanes[3]) + scalar::countTrue(data, size, i);
+}
+
+// Bitmask of 'data[i] op literal' for 64 elements
+template <QueryOp Op>
+LFJ_TARGET_AVX2 inline uint64_t compareMask64(const int64_t* data, __m256i literal)
+{
+  uint64_t mask = 0u;
+  for (uint32_t j = 0u; j < 64u; j += 4u)
+  {
+    const __m256i v = _mm256_loadu_si256((const __m256i*)(data + j));
+    __m256i cmp;
+    switch (Op)
+    {
+      case QueryOp::EQ: cmp = _mm256_cmpeq_epi64(v, literal); break;
+      case QueryOp::NE: cmp = _mm256_xor_si256(_mm256_cmpeq_epi64(v, literal), _mm256_set1_epi64x(-1)); break;
+      case QueryOp::LT: cmp = _mm256_cmpgt_epi64(literal, v); break;
+      case QueryOp::LE: cmp = _mm256_xor_si256(_mm256_cmpgt_epi64(v, literal), _mm256_set1_epi64x(-1)); break;
+      case QueryOp::GT: cmp = _mm256_cmpgt_epi64(v, literal); break;
+      default:          cmp = _mm256_xor_si256(_mm256_cmpgt_epi64(literal, v), _mm256_set1_epi64x(-1)); break;
+    }
+    mask |= (uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(cmp)) << j;
+  }
+  return mask;
+}
+
+template <int Pred>
+LFJ_TARGET_AVX2 inline uint64_t compareMask64(const double* data, __m256d literal)
+{
+  uint64_t mask = 0u;
+  for (uint32_t j = 0u; j < 64u; j += 4u)
+    mask |= (uint64_t)_mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(data + j), literal, Pred)) << j;
+  return mask;
+}
+
+// Full 64-element blocks, returns count of processed elements
+template <QueryOp Op, class Sink>
+LFJ_TARGET_AVX2 uint32_t compareBlocks(const int64_t* data, uint32_t size, int64_t literal, Sink& sink)
+{
+  const __m256i lit = _mm256_set1_epi64x(literal);
+  uint32_t base = 0u;
+  for (; base + 64u <= size; base += 64u)
+  {
+    if (!sink(compareMask64<Op>(data + base, lit), base))
+      return size;
+  }
+  return base;
+}
+
+template <int Pred, class Sink>
+LFJ_TARGET_AVX2 uint32_t compareBlocks(const double* data, uint32_t size, double literal, Sink& sink)
+{
+  const __m256d lit = _mm256_set1_pd(literal);
+  uint32_t base = 0u;
+  for (; base + 64u <= size; base += 64u)
+  {
+    if (!sink(compareMask64<Pred>(data + base, lit), base))
+      return size;
+  }
+  return base;
+}
+
+template <class Sink>
+uint32_t compareBlocks(const int64_t* data, uint32_t size, QueryOp op, int64_t literal, Sink& sink)
+{
+  switch (op)
+  {
+    case QueryOp::EQ: return compareBlocks<QueryOp::EQ>(data, size, literal, sink);
+    case QueryOp::NE: return compareBlocks<QueryOp::NE>(data, size, literal, sink);
+    case QueryOp::LT: return compareBlocks<QueryOp::LT>(data, size, literal, sink);
+    case QueryOp::LE: return compareBlocks<QueryOp::LE>(data, size, literal, sink);
+    case QueryOp::GT: return compareBlocks<QueryOp::GT>(data, size, literal, sink);
+    case QueryOp::GE: return compareBlocks<QueryOp::GE>(data, size, literal, sink);
+    default:
+      return 0u;
+  }
+}
+
+template <class Sink>
+uint32_t compareBlocks(const double* data, uint32_t size, QueryOp op, double literal, Sink& sink)
+{
+  switch (op)
+  {
+    case QueryOp::EQ: return compareBlocks<_CMP_EQ_OQ >(data, size, literal, sink);
+    case QueryOp::NE: return compareBlocks<_CMP_NEQ_UQ>(data, size, literal, sink);
+    case QueryOp::LT: return compareBlocks<_CMP_LT_OQ >(data, size, literal, sink);
+    case QueryOp::LE: return compareBlocks<_CMP_LE_OQ >(data, size, literal, sink);
+    case QueryOp::GT: return compareBlocks<_CMP_GT_OQ >(data, size, literal, sink);
+    case QueryOp::GE: return compareBlocks<_CMP_GE_OQ >(data, size, literal, sink);
+    default:
+      return 0u;
+  }
+}
+} // namespace avx2
+#endif  // LFJ_SIMD_AVX2
+
+//
+// Dispatched kernels
+inline int64_t sum(const int64_t* data, uint32_t size)
+{
+#ifdef LFJ_SIMD_AVX2
+  if (useAVX2())
+    return avx2::sum(data, size);
+#endif
+  return scalar::sum(data, size);
+}
+
+inline double sum(const double* data, uint32_t size)
+{
+#ifdef LFJ_SIMD_AVX2
+  if (useAVX2())
+    return avx2::sum(data, size);
+#endif
+  double acc[8] = {};
+  return scalar::sum(data, size, acc);
+}
+
+inline double sumSquaredDiff(const double* data, uint32_t size, double mean)
+{
+#ifdef LFJ_SIMD_AVX2
+  if (useAVX2())
+    return avx2::sumSquaredDiff(data, size, mean);
+#endif
+  double acc[8] = {};
+  return scalar::sumSquaredDiff(data, size, mean, acc);
+}
+
+template <class T>
+T min(const T* data, uint32_t size)
+{
+#ifdef LFJ_SIMD_AVX2
+  if (useAVX2())
+    return avx2::min(data, size);
+#endif
+  return scalar::min(data, size);
+}
+
+template <class T>
+T max(const T* data, uint32_t size)
+{
+#ifdef LFJ_SIMD_AVX2
+  if (useAVX2())
+    return avx2::max(data, size);
+#endif
+  return scalar::max(data, size);
+}
+
+inline uint32_t countTrue(const bool* data, uint32_t size)
+{
+#ifdef LFJ_SIMD_AVX2
+  if (useAVX2())
+    return avx2::countTrue(data, size);
+#endif
+  return scalar::countTrue(data, size);
+}
+
+// Calls 'sink(mask, base)' with bitmasks of 'data[i] op literal' by blocks of 64 elements,
+// until it returns 'false'
+template <class T, class Sink>
+void compareScan(const T* data, uint32_t size, QueryOp op, T literal, Sink& sink)
+{
+  uint32_t base = 0u;
+#ifdef LFJ_SIMD_AVX2
+  if (useAVX2() && op != QueryOp::EXISTS)
+    base = avx2::compareBlocks(data, size, op, literal, sink);
+#endif
+  for (; base < size; base += 64u)
+  {
+    const uint32_t count = (size - base < 64u) ? size - base : 64u;
+    if (!sink(scalar::compareMask(data + base, count, op, literal), base))
+      return;
+  }
+}
+
+// Integer elements against a real literal, turned into an integer comparison
+// (returns 'false' if no element or every element matches, see 'all')
+inline bool integerLiteral(QueryOp& op, double literal, int64_t& intLiteral, bool& all)
+{
+  const double lo = (double)std::numeric_limits<int64_t>::lowest();
+  const double hi = (double)std::numeric_limits<int64_t>::max();
+  const double fl = std::floor(literal);
+  const double ce = std::ceil(literal);
+  all = false;
+  
+  if (fl == literal && literal >= lo && literal < hi)  // integral
+  {
+    intLiteral = (int64_t)literal;
+    return true;
+  }
+  switch (op)
+  {
+    case QueryOp::EQ:  return false;
+    case QueryOp::NE:  all = true; return false;
+    case QueryOp::LT:
+    case QueryOp::GE:  // compare with ceil
+    {
+      if (std::isnan(literal))  return false;  // unordered: no element
+      if (ce <= lo)      { all = (op == QueryOp::GE); return false; }
+      if (ce >= hi)      { all = (op == QueryOp::LT); return false; }
+      intLiteral = (int64_t)ce;
+      return true;
+    }
+    case QueryOp::LE:
+    case QueryOp::GT:  // compare with floor
+    {
+      if (std::isnan(literal))  return false;
+      if (fl < lo)       { all = (op == QueryOp::GT); return false; }
+      if (fl >= hi)      { all = (op == QueryOp::LE); return false; }
+      intLiteral = (int64_t)fl;
+      return true;
+    }
+    default:
+      all = true;
+      return false;
+  }
+}
+
+// Sinks
+struct CountSink {
+  uint32_t count = 0u;
+  bool operator()(uint64_t mask, uint32_t) { count += popCount(mask); return true; }
+};
+
+struct FirstSink {
+  uint32_t first = NoElement;
+  bool operator()(uint64_t mask, uint32_t base)
+  {
+    if (mask == 0u)
+      return true;
+    first = base + countTrailingZeros(mask);
+    return false;
+  }
+};
+
+struct IndexSink {  // 'out' must hold all indices
+  uint32_t* out;
+  uint32_t  count = 0u;
+  
+  IndexSink(uint32_t* out_) : out(out_) {}
+  bool operator()(uint64_t mask, uint32_t base)
+  {
+    while (mask != 0u)
+    {
+      out[count++] = base + countTrailingZeros(mask);
+      mask &= mask - 1u;
+    }
+    return true;
+  }
+};
+
+// Positions of elements satisfying 'element op literal' ('out' must hold 'size' indices)
+template <class T>
+uint32_t selectIndices(const T* data, uint32_t size, QueryOp op, T literal, uint32_t* out)
+{
+  IndexSink sink(out);
+  compareScan(data, size, op, literal, sink);
+  return sink.count;
+}
+
+inline uint32_t selectIndices(const int64_t* data, uint32_t size, QueryOp op, double literal, uint32_t* out)
+{
+  int64_t intLiteral;
+  bool all;
+  if (integerLiteral(op, literal, intLiteral, all))
+    return selectIndices(data, size, op, intLiteral, out);
+  return all ? selectIndices(data, size, QueryOp::EXISTS, (int64_t)0, out) : 0u;
+}
+
+inline uint32_t selectIndices(const bool* data, uint32_t size, QueryOp op, bool literal, uint32_t* out)
+{
+  IndexSink sink(out);
+  for (uint32_t base = 0u; base < size; base += 64u)
+  {
+    const uint32_t count = (size - base < 64u) ? size - base : 64u;
+    sink(scalar::compareMask(data + base, count, op, literal), base);
+  }
+  return sink.count;
+}
+
+template <class T>
+uint32_t countIf(const T* data, uint32_t size, QueryOp op, T literal)
+{
+  if (op == QueryOp::EXISTS)
+    return size;
+  CountSink sink;
+  compareScan(data, size, op, literal, sink);
+  return sink.count;
+}
+
+template <class T>
+uint32_t argMax(const T* data, uint32_t size)
+{
+  assert(size > 0u);
+  FirstSink sink;
+  compareScan(data, size, QueryOp::EQ, max(data, size), sink);
+  return sink.first;
+}
+
+// Values in [low, high] spread over 'bins' equal bins (high in last one), returns count of binned values
+template <class T>
+uint32_t histogram(const T* data, uint32_t size, double low, double high, uint32_t bins, uint32_t* counts)
+{
+  assert(bins > 0u && high > low);
+  std::memset(counts, 0, bins * sizeof(uint32_t));
+  
+  const double scale = (double)bins / (high - low);
+  uint32_t binned = 0u;
+  for (uint32_t i = 0u; i < size; ++i)
+  {
+    const double v = (double)data[i];
+    if (!(v >= low && v <= high))  // also skips NaN
+      continue;
+    uint32_t bin = (uint32_t)((v - low) * scale);
+    bin = bin < bins ? bin : bins - 1u;
+    ++counts[bin];
+    ++binned;
+  }
+  return binned;
+}
+} // namespace helper
+
+//
+// Aggregates over specialized arrays (contiguous storage, including big arrays)
+// Min, max and arg-max require a non-empty array, mean and variance (population) of empty ones are 0
+// Double min and max skip NaNs (NaN only if all elements are), arg-max is NoElement if all elements are NaN
+
+// IArray
+inline int64_t iarraySum(const ConstValue& value)  // wraps on overflow
+{
+  return helper::sum(value.iarrayValues(), value.iarraySize());
+}
+
+inline int64_t iarrayMin(const ConstValue& value)
+{
+  assert(!value.iarrayEmpty());
+  return helper::min(value.iarrayValues(), value.iarraySize());
+}
+
+inline int64_t iarrayMax(const ConstValue& value)
+{
+  assert(!value.iarrayEmpty());
+  return helper::max(value.iarrayValues(), value.iarraySize());
+}
+
+inline double iarrayMean(const ConstValue& value)
+{
+  // Accumulated as double (no overflow)
+  const int64_t* data = value.iarrayValues();
+  const uint32_t size = value.iarraySize();
+  double acc[8] = {};
+  for (uint32_t i = 0u; i < size; ++i)
+    acc[i % 8u] += (double)data[i];
+  return size > 0u ? helper::scalar::reduce8(acc) / (double)size : 0.;
+}
+
+inline double iarrayVariance(const ConstValue& value)
+{
+  const int64_t* data = value.iarrayValues();
+  const uint32_t size = value.iarraySize();
+  const double mean = iarrayMean(value);
+  double acc[8] = {};
+  for (uint32_t i = 0u; i < size; ++i)
+  {
+    const double d = (double)data[i] - mean;
+    acc[i % 8u] += d * d;
+  }
+  return size > 0u ? helper::scalar::reduce8(acc) / (double)size : 0.;
+}
+
+inline uint32_t iarrayCountIf(const ConstValue& value, QueryOp op, int64_t literal)
+{
+  return helper::countIf(value.iarrayValues(), value.iarraySize(), op, literal);
+}
+
+inline uint32_t iarrayHistogram(const ConstValue& value, double low, double high, uint32_t bins, uint32_t* counts)
+{
+  return helper::histogram(value.iarrayValues(), value.iarraySize(), low, high, bins, counts);
+}
+
+inline uint32_t iarrayArgMax(const ConstValue& value)
+{
+  assert(!value.iarrayEmpty());
+  return helper::argMax(value.iarrayValues(), value.iarraySize());
+}
+
+// DArray
+inline double darraySum(const ConstValue& value)
+{
+  return helper::sum(value.darrayValues(), value.darraySize());
+}
+
+inline double darrayMin(const ConstValue& value)
+{
+  assert(!value.darrayEmpty());
+  return helper::min(value.darrayValues(), value.darraySize());
+}
+
+inline double darrayMax(const ConstValue& value)
+{
+  assert(!value.darrayEmpty());
+  return helper::max(value.darrayValues(), value.darraySize());
+}
+
+inline double darrayMean(const ConstValue& value)
+{
+  const uint32_t size = value.darraySize();
+  return size > 0u ? darraySum(value) / (double)size : 0.;
+}
+
+inline double darrayVariance(const ConstValue& value)
+{
+  const uint32_t size = value.darraySize();
+  if (size == 0u)
+    return 0.;
+  return helper::sumSquaredDiff(value.darrayValues(), size, darrayMean(value)) / (double)size;
+}
+
+inline uint32_t darrayCountIf(const ConstValue& value, QueryOp op, double literal)
+{
+  return helper::countIf(value.darrayValues(), value.darraySize(), op, literal);
+}
+
+inline uint32_t darrayHistogram(const ConstValue& value, double low, double high, uint32_t bins, uint32_t* counts)
+{
+  return helper::histogram(value.darrayValues(), value.darraySize(), low, high, bins, counts);
+}
+
+inline uint32_t darrayArgMax(const ConstValue& value)
+{
+  assert(!value.darrayEmpty());
+  return helper::argMax(value.darrayValues(), value.darraySize());
+}
+
+// BArray (false < true)
+inline uint32_t barraySum(const ConstValue& value)  // count of 'true'
+{
+  return helper::countTrue(value.barrayValues(), value.barraySize());
+}
+
+inline bool barrayMin(const ConstValue& value)  // all
+{
+  assert(!value.barrayEmpty());
+  return barraySum(value) == value.barraySize();
+}
+
+inline bool barrayMax(const ConstValue& value)  // any
+{
+  assert(!value.barrayEmpty());
+  return barraySum(value) > 0u;
+}
+
+inline double barrayMean(const ConstValue& value)
+{
+  const uint32_t size = value.barraySize();
+  return size > 0u ? (double)barraySum(value) / (double)size : 0.;
+}
+
+inline double barrayVariance(const ConstValue& value)
+{
+  const double p = barrayMean(value);
+  return p * (1. - p);
+}
+
+inline uint32_t barrayCountIf(const ConstValue& value, QueryOp op, bool literal)
+{
+  const uint32_t trues  = barraySum(value);
+  const uint32_t falses = value.barraySize() - trues;
+  return (helper::compare(true,  op, literal) ? trues  : 0u)
+       + (helper::compare(false, op, literal) ? falses : 0u);
+}
+
+inline uint32_t barrayArgMax(const ConstValue& value)  // first 'true', or 0
+{
+  assert(!value.barrayEmpty());
+  const bool* data = value.barrayValues();
+  const bool* found = (const bool*)std::memchr(data, 1, value.barraySize());
+  return found != nullptr ? (uint32_t)(found - data) : 0u;
+}
+
+} // namespace lfjson
+
+#endif // LFJSON_AGGREGATE_H
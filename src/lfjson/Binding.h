@@ -0,0 +1,926 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+#ifndef LFJSON_BINDING_H
+#define LFJSON_BINDING_H
+
+#include "BaseData.h"
+#include "DataHelper.h"
+#include "Document.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+#include <cassert>
+#include <limits>
+#include <map>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+//
+// Struct descriptor, to use at global namespace scope (types fully qualified)
+//   struct Point { int x; int y; std::string name; };
+//   LFJ_BINDING(Point, LFJ_FIELD(x), LFJ_FIELD(y), LFJ_FIELD(name))
+#define LFJ_BINDING(Type, ...)                                        \
+  namespace lfjson {                                                  \
+  template <> struct Binding<Type> {                                  \
+    using BoundType = Type;                                           \
+    using Fields = decltype(std::make_tuple(__VA_ARGS__));            \
+    static const Fields& fields()                                     \
+    {                                                                 \
+      static const Fields fieldsTuple = std::make_tuple(__VA_ARGS__); \
+      return fieldsTuple;                                             \
+    }                                                                 \
+  };                                                                  \
+  }
+  
+#define LFJ_FIELD(name) ::lfjson::bindField(#name, &BoundType::name)
+#define LFJ_FIELD_AS(key, name) ::lfjson::bindField(key, &BoundType::name)  // JSON key differs from member
+
+namespace lfjson
+{
+//
+// Descriptor (see LFJ_BINDING): 'fields()' returns a tuple of BindField
+template <class T>
+struct Binding;
+
+template <class C, class M>
+struct BindField {
+  const char* name;
+  uint32_t    len;
+  M C::*      member;
+};
+
+template <class C, class M>
+BindField<C, M> bindField(const char* name, M C::* member)
+{
+  return BindField<C, M>{ name, (uint32_t)std::strlen(name), member };
+}
+
+template <class T, class = void>
+struct IsBound : std::false_type {};
+
+template <class T>
+struct IsBound<T, decltype((void)Binding<T>::fields())> : std::true_type {};
+
+namespace helper
+{
+//
+// Type-erased binding operations, one static table per bound C++ type
+enum class BindKind : uint8_t {
+  SCALAR  = 0,
+  OBJECT  = 1,  // bound struct
+  ARRAY   = 2,  // std::vector
+  MAP     = 3   // std::map / std::unordered_map with std::string keys
+};
+
+struct BindOps;
+
+// Struct field (key dispatch by length then text)
+struct BindSlot {
+  const char*     name;
+  uint32_t        len;
+  const BindOps*  ops;
+  void* (*access)(const void* field, void* obj);
+  const void*     field;  // BindField, in Binding<T>::fields()
+};
+
+struct BindOps {
+  BindKind kind;
+  
+  // Scalars (nullptr: type mismatch), null leaves target unchanged
+  bool (*setBool)(void*, bool);
+  bool (*setInt64)(void*, int64_t);
+  bool (*setUInt64)(void*, uint64_t);
+  bool (*setDouble)(void*, double);
+  bool (*setString)(void*, const char*, uint32_t);
+  
+  // Containers
+  void (*reset)(void*);
+  const BindSlot* slots;  // OBJECT
+  uint32_t slotsCount;
+  const BindOps* (*child)();  // ARRAY elements, MAP values
+  void* (*append)(void*);     // ARRAY, element to fill
+  void* (*emplace)(void*, const char*, uint32_t);  // MAP, value to fill
+  
+  // Batch (ARRAY of arithmetic, nullptr otherwise)
+  bool (*appendBools)(void*, const bool*, uint32_t);
+  bool (*appendInt64s)(void*, const int64_t*, uint32_t);
+  bool (*appendDoubles)(void*, const double*, uint32_t);
+};
+
+// Numeric conversions (exact only)
+template <class T>
+bool fitsInt64(int64_t i64, std::true_type /*signed*/)
+{
+  return i64 >= (int64_t)std::numeric_limits<T>::min() && i64 <= (int64_t)std::numeric_limits<T>::max();
+}
+
+template <class T>
+bool fitsInt64(int64_t i64, std::false_type /*signed*/)
+{
+  return i64 >= 0 && (uint64_t)i64 <= (uint64_t)std::numeric_limits<T>::max();
+}
+
+template <class T>
+bool setIntegralInt64(void* target, int64_t i64)
+{
+  if (!fitsInt64<T>(i64, std::is_signed<T>()))
+    return false;
+  *(T*)target = (T)i64;
+  return true;
+}
+
+template <class T>
+bool setIntegralUInt64(void* target, uint64_t u64)
+{
+  if (u64 > (uint64_t)std::numeric_limits<T>::max())
+    return false;
+  *(T*)target = (T)u64;
+  return true;
+}
+
+template <class T>
+bool setIntegralDouble(void* target, double d)
+{
+  if (d != std::floor(d))
+    return false;
+  if (std::is_signed<T>::value)
+    return d >= -9223372036854775808.0 && d < 9223372036854775808.0 && setIntegralInt64<T>(target, (int64_t)d);
+  return d >= 0. && d < 18446744073709551616.0 && setIntegralUInt64<T>(target, (uint64_t)d);
+}
+
+template <class T>
+bool setFloating(void* target, double d)
+{
+  *(T*)target = (T)d;
+  return true;
+}
+
+template <class T, class = void>
+struct BindTraits;  // undefined: type not bindable
+
+template <>
+struct BindTraits<bool> {
+  static const BindOps* ops()
+  {
+    static const BindOps boolOps = [] {
+      BindOps o = BindOps();
+      o.kind    = BindKind::SCALAR;
+      o.setBool = [](void* target, bool b) { *(bool*)target = b; return true; };
+      return o;
+    }();
+    return &boolOps;
+  }
+};
+
+template <class T>
+struct BindTraits<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type> {
+  static const BindOps* ops()
+  {
+    static const BindOps integralOps = [] {
+      BindOps o = BindOps();
+      o.kind      = BindKind::SCALAR;
+      o.setInt64  = &setIntegralInt64<T>;
+      o.setUInt64 = &setIntegralUInt64<T>;
+      o.setDouble = &setIntegralDouble<T>;
+      return o;
+    }();
+    return &integralOps;
+  }
+};
+
+template <class T>
+struct BindTraits<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+  static const BindOps* ops()
+  {
+    static const BindOps floatingOps = [] {
+      BindOps o = BindOps();
+      o.kind      = BindKind::SCALAR;
+      o.setInt64  = [](void* target, int64_t i64) { *(T*)target = (T)i64; return true; };
+      o.setUInt64 = [](void* target, uint64_t u64) { *(T*)target = (T)u64; return true; };
+      o.setDouble = &setFloating<T>;
+      return o;
+    }();
+    return &floatingOps;
+  }
+};
+
+template <>
+struct BindTraits<std::string> {
+  static const BindOps* ops()
+  {
+    static const BindOps stringOps = [] {
+      BindOps o = BindOps();
+      o.kind      = BindKind::SCALAR;
+      o.setString = [](void* target, const char* str, uint32_t len) { ((std::string*)target)->assign(str, len); return true; };
+      return o;
+    }();
+    return &stringOps;
+  }
+};
+
+// Batch appenders (only for arithmetic elements)
+template <class VectorT, class = void>
+struct BindBatch {
+  static void set(BindOps&) {}
+};
+
+template <class VectorT>
+struct BindBatch<VectorT, typename std::enable_if<std::is_arithmetic<typename VectorT::value_type>::value>::type> {
+  using T = typename VectorT::value_type;
+  
+  static void set(BindOps& o)
+  {
+    o.appendInt64s  = [](void* target, const int64_t* values, uint32_t count) {
+      auto& vec = *(VectorT*)target;
+      const auto setInt64 = BindTraits<T>::ops()->setInt64;
+      const size_t first = vec.size();
+      vec.resize(first + count);
+      for (uint32_t i = 0u; i < count; ++i)
+      {
+        if (!setInt64(&vec[first + i], values[i]))
+          return false;
+      }
+      return true;
+    };
+    o.appendDoubles = [](void* target, const double* values, uint32_t count) {
+      auto& vec = *(VectorT*)target;
+      const auto setDouble = BindTraits<T>::ops()->setDouble;
+      const size_t first = vec.size();
+      vec.resize(first + count);
+      for (uint32_t i = 0u; i < count; ++i)
+      {
+        if (!setDouble(&vec[first + i], values[i]))
+          return false;
+      }
+      return true;
+    };
+  }
+};
+
+template <class T, class A>
+struct BindTraits<std::vector<T, A>> {
+  static const BindOps* ops()
+  {
+    static const BindOps vectorOps = [] {
+      BindOps o = BindOps();
+      o.kind   = BindKind::ARRAY;
+      o.reset  = [](void* target) { ((std::vector<T, A>*)target)->clear(); };
+      o.child  = &BindTraits<T>::ops;
+      o.append = [](void* target) -> void* {
+        auto& vec = *(std::vector<T, A>*)target;
+        vec.emplace_back();
+        return &vec.back();
+      };
+      BindBatch<std::vector<T, A>>::set(o);
+      return o;
+    }();
+    return &vectorOps;
+  }
+};
+
+// std::vector<bool> (no element address): elements are pushed by a dedicated child
+template <class A>
+struct BindTraits<std::vector<bool, A>> {
+  static const BindOps* elementOps()
+  {
+    static const BindOps pushOps = [] {
+      BindOps o = BindOps();
+      o.kind    = BindKind::SCALAR;
+      o.setBool = [](void* target, bool b) { ((std::vector<bool, A>*)target)->push_back(b); return true; };
+      return o;
+    }();
+    return &pushOps;
+  }
+  
+  static const BindOps* ops()
+  {
+    static const BindOps vectorOps = [] {
+      BindOps o = BindOps();
+      o.kind        = BindKind::ARRAY;
+      o.reset       = [](void* target) { ((std::vector<bool, A>*)target)->clear(); };
+      o.child       = &elementOps;
+      o.append      = [](void* target) { return target; };
+      o.appendBools = [](void* target, const bool* values, uint32_t count) {
+        ((std::vector<bool, A>*)target)->insert(((std::vector<bool, A>*)target)->end(), values, values + count);
+        return true;
+      };
+      return o;
+    }();
+    return &vectorOps;
+  }
+};
+
+template <class MapT>
+struct BindTraitsMap {
+  static const BindOps* ops()
+  {
+    static const BindOps mapOps = [] {
+      BindOps o = BindOps();
+      o.kind    = BindKind::MAP;
+      o.reset   = [](void* target) { ((MapT*)target)->clear(); };
+      o.child   = &BindTraits<typename MapT::mapped_type>::ops;
+      o.emplace = [](void* target, const char* key, uint32_t len) -> void* {
+        return &(*(MapT*)target)[std::string(key, len)];  // last duplicate wins
+      };
+      return o;
+    }();
+    return &mapOps;
+  }
+};
+
+template <class T, class C, class A>
+struct BindTraits<std::map<std::string, T, C, A>> : BindTraitsMap<std::map<std::string, T, C, A>> {};
+
+template <class T, class H, class E, class A>
+struct BindTraits<std::unordered_map<std::string, T, H, E, A>> : BindTraitsMap<std::unordered_map<std::string, T, H, E, A>> {};
+
+// Bound struct
+template <class C, class M>
+void* accessField(const void* field, void* obj)
+{
+  return &(((C*)obj)->*(((const BindField<C, M>*)field)->member));
+}
+
+template <class C, class M>
+BindSlot makeSlot(const BindField<C, M>& field)
+{
+  return BindSlot{ field.name, field.len, BindTraits<M>::ops(), &accessField<C, M>, &field };
+}
+
+template <class Tuple, size_t I = 0u, bool Last = (I == std::tuple_size<Tuple>::value)>
+struct BindSlots {
+  static void add(const Tuple& fields, std::vector<BindSlot>& slots)
+  {
+    slots.push_back(makeSlot(std::get<I>(fields)));
+    BindSlots<Tuple, I + 1u>::add(fields, slots);
+  }
+};
+
+template <class Tuple, size_t I>
+struct BindSlots<Tuple, I, true> {
+  static void add(const Tuple&, std::vector<BindSlot>&) {}
+};
+
+template <class Tuple>
+std::vector<BindSlot> makeSlots(const Tuple& fields)
+{
+  std::vector<BindSlot> slots;
+  slots.reserve(std::tuple_size<Tuple>::value);
+  BindSlots<Tuple>::add(fields, slots);
+  return slots;
+}
+
+template <class T>
+struct BindTraits<T, typename std::enable_if<IsBound<T>::value>::type> {
+  static const BindOps* ops()
+  {
+    static const std::vector<BindSlot> slots = makeSlots(Binding<T>::fields());
+    static const BindOps structOps = [] {
+      BindOps o = BindOps();
+      o.kind       = BindKind::OBJECT;
+      o.slots      = slots.data();
+      o.slotsCount = (uint32_t)slots.size();
+      return o;
+    }();
+    return &structOps;
+  }
+};
+} // namespace helper
+
+//
+// Event handler writing into 'T' (same events as Document::Handler, no tree, no string interning)
+// Struct keys are dispatched by length then text, trying the declaration order first
+// Unknown keys are skipped with their whole value, null leaves targets unchanged
+// A type mismatch (or out of range integer) aborts with 'false'
+template <class T>
+class BindHandler
+{
+private:
+  struct Frame {
+    void*                   target;
+    const helper::BindOps*  ops;
+    uint32_t                hint;  // next expected slot (OBJECT)
+  };
+  
+  std::vector<Frame> mStack;
+  void* mTarget = nullptr;  // value to fill by next event (after key, or root)
+  const helper::BindOps* mOps = nullptr;
+  uint32_t mSkipDepth = 0u;
+  bool mSkipping = false;
+  bool mDone = false;
+  
+  // Target of next value (nullptr if none)
+  bool next(void*& target, const helper::BindOps*& ops)
+  {
+    if (!mStack.empty() && mStack.back().ops->kind == helper::BindKind::ARRAY)
+    {
+      const Frame& frame = mStack.back();
+      target = frame.ops->append(frame.target);
+      ops = frame.ops->child();
+      return true;
+    }
+    if (mTarget == nullptr)
+      return false;
+    target = mTarget;
+    ops = mOps;
+    mTarget = nullptr;
+    return true;
+  }
+  
+  // Scalar event, 'set' may be null (type mismatch)
+  template <class Func>
+  bool scalar(Func set)
+  {
+    if (mSkipping)
+    {
+      mSkipping = mSkipDepth != 0u;
+      return true;
+    }
+    void* target = nullptr;
+    const helper::BindOps* ops = nullptr;
+    if (!next(target, ops))
+      return false;
+    mDone = mStack.empty();
+    return set(target, ops);
+  }
+  
+  bool start(helper::BindKind kind)
+  {
+    if (mSkipping)
+    {
+      ++mSkipDepth;
+      return true;
+    }
+    void* target = nullptr;
+    const helper::BindOps* ops = nullptr;
+    if (!next(target, ops))
+      return false;
+    const bool isObject = ops->kind == helper::BindKind::OBJECT || ops->kind == helper::BindKind::MAP;
+    if ((kind == helper::BindKind::ARRAY) == isObject || ops->kind == helper::BindKind::SCALAR)
+      return false;
+    if (ops->reset != nullptr)
+      ops->reset(target);
+    mStack.push_back(Frame{ target, ops, 0u });
+    return true;
+  }
+  
+  bool end()
+  {
+    if (mSkipping)
+    {
+      --mSkipDepth;
+      mSkipping = mSkipDepth != 0u;
+      return true;
+    }
+    assert(!mStack.empty());
+    mStack.pop_back();
+    mTarget = nullptr;
+    mDone = mStack.empty();
+    return true;
+  }
+  
+  template <class V>
+  bool batch(const V* values, uint32_t count, bool (*helper::BindOps::*append)(void*, const V*, uint32_t),
+             bool (BindHandler::*push)(V))
+  {
+    if (!mSkipping && !mStack.empty())
+    {
+      const Frame& frame = mStack.back();
+      if (frame.ops->kind == helper::BindKind::ARRAY && frame.ops->*append != nullptr)
+        return (frame.ops->*append)(frame.target, values, count);
+    }
+    for (uint32_t i = 0u; i < count; ++i)
+    {
+      if (!(this->*push)(values[i]))
+        return false;
+    }
+    return true;
+  }
+  
+public:
+  BindHandler(T& target)
+    : mTarget(&target)
+    , mOps(helper::BindTraits<T>::ops())
+  {
+    mStack.reserve(16u);
+  }
+  
+  // 'true' once the root value is complete
+  bool done() const { return mDone; }
+  
+  // Events
+  bool startObject() { return start(helper::BindKind::OBJECT); }
+  bool endObject(uint32_t) { return end(); }
+  bool startArray() { return start(helper::BindKind::ARRAY); }
+  bool endArray(uint32_t) { return end(); }
+  
+  bool pushKey(const char* str, bool copy, int32_t length = -1)
+  {
+    (void)copy;
+    if (mSkipping)
+      return true;
+    assert(!mStack.empty());
+    const uint32_t len = length < 0 ? (uint32_t)std::strlen(str) : (uint32_t)length;
+    Frame& frame = mStack.back();
+    if (frame.ops->kind == helper::BindKind::MAP)
+    {
+      mTarget = frame.ops->emplace(frame.target, str, len);
+      mOps = frame.ops->child();
+      return true;
+    }
+    
+    // Struct: expected slot first, then scan
+    const helper::BindSlot* slots = frame.ops->slots;
+    const uint32_t count = frame.ops->slotsCount;
+    for (uint32_t n = 0u; n < count; ++n)
+    {
+      uint32_t i = frame.hint + n;
+      i = i < count ? i : i - count;
+      if (slots[i].len == len && std::memcmp(slots[i].name, str, len) == 0)
+      {
+        mTarget = slots[i].access(slots[i].field, frame.target);
+        mOps = slots[i].ops;
+        frame.hint = i + 1u < count ? i + 1u : 0u;
+        return true;
+      }
+    }
+    mSkipping = true;  // unknown key, skip value
+    mSkipDepth = 0u;
+    return true;
+  }
+  
+  bool pushNull()
+  {
+    return scalar([](void*, const helper::BindOps*) { return true; });
+  }
+  
+  bool pushBool(bool b)
+  {
+    return scalar([b](void* target, const helper::BindOps* ops) { return ops->setBool != nullptr && ops->setBool(target, b); });
+  }
+  
+  bool pushInt(int i) { return pushInt64((int64_t)i); }
+  
+  bool pushUInt(unsigned u) { return pushInt64((int64_t)u); }
+  
+  bool pushInt64(int64_t i64)
+  {
+    return scalar([i64](void* target, const helper::BindOps* ops) { return ops->setInt64 != nullptr && ops->setInt64(target, i64); });
+  }
+  
+  bool pushUInt64(uint64_t u64)
+  {
+    return scalar([u64](void* target, const helper::BindOps* ops) { return ops->setUInt64 != nullptr && ops->setUInt64(target, u64); });
+  }
+  
+  bool pushDouble(double d)
+  {
+    return scalar([d](void* target, const helper::BindOps* ops) { return ops->setDouble != nullptr && ops->setDouble(target, d); });
+  }
+  
+  bool pushString(const char* str, bool copy, int32_t length = -1)
+  {
+    (void)copy;
+    const uint32_t len = length < 0 ? (uint32_t)std::strlen(str) : (uint32_t)length;
+    return scalar([str, len](void* target, const helper::BindOps* ops) {
+      return ops->setString != nullptr && ops->setString(target, str, len);
+    });
+  }
+  
+  // Batch events (specialized arrays, see Document::accept)
+  bool pushBoolArray(const bool* values, uint32_t count)
+  {
+    return batch(values, count, &helper::BindOps::appendBools, &BindHandler::pushBool);
+  }
+  
+  bool pushInt64Array(const int64_t* values, uint32_t count)
+  {
+    return batch(values, count, &helper::BindOps::appendInt64s, &BindHandler::pushInt64);
+  }
+  
+  bool pushDoubleArray(const double* values, uint32_t count)
+  {
+    return batch(values, count, &helper::BindOps::appendDoubles, &BindHandler::pushDouble);
+  }
+};
+
+template <class T>
+BindHandler<T> makeBindHandler(T& target)
+{
+  return BindHandler<T>(target);
+}
+
+// Bind a Document value into 'target' (replayed as events, no intermediate tree)
+template <class T>
+bool bindValue(const ConstValue& value, T& target)
+{
+  BindHandler<T> handler(target);
+  return helper::acceptValue(value, handler, false) && handler.done();
+}
+
+namespace helper
+{
+//
+// Writing (StructWriter)
+inline uint32_t nextWriteTypeIndex()
+{
+  static std::atomic<uint32_t> counter(0u);
+  return counter++;
+}
+
+// Slot of bound type 'T' in StructWriter key caches
+template <class T>
+uint32_t writeTypeIndex()
+{
+  static const uint32_t index = nextWriteTypeIndex();
+  return index;
+}
+
+template <class T, class = void>
+struct WriteTraits;  // undefined: type not writable
+
+template <class W, class T>
+void writeTyped(W& writer, typename W::RefValue target, const T& value)
+{
+  WriteTraits<T>::write(writer, target, value);
+}
+
+template <>
+struct WriteTraits<bool> {
+  template <class W>
+  static void write(W&, typename W::RefValue target, bool b) { target = b; }
+};
+
+template <class T>
+struct WriteTraits<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type> {
+  template <class W>
+  static void write(W&, typename W::RefValue target, T value) { set(target, value, std::is_signed<T>()); }
+  
+  template <class R>
+  static void set(R& target, T value, std::true_type /*signed*/) { target = (int64_t)value; }
+  
+  // INT64 when it fits (as parsed)
+  template <class R>
+  static void set(R& target, T value, std::false_type /*signed*/)
+  {
+    if ((uint64_t)value <= (uint64_t)std::numeric_limits<int64_t>::max())
+      target = (int64_t)value;
+    else
+      target = (uint64_t)value;
+  }
+};
+
+template <class T>
+struct WriteTraits<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+  template <class W>
+  static void write(W&, typename W::RefValue target, T value) { target = (double)value; }
+};
+
+template <>
+struct WriteTraits<std::string> {
+  template <class W>
+  static void write(W&, typename W::RefValue target, const std::string& str) { target.assign(BuildValue(str)); }
+};
+
+// Numeric vectors into IARRAY / DARRAY storage ('false': not batchable)
+template <class T, class = void>
+struct WriteBatch {
+  template <class R>
+  static bool write(R&, const T*, uint32_t) { return false; }
+};
+
+template <>
+struct WriteBatch<int64_t> {
+  template <class R>
+  static bool write(R& target, const int64_t* values, uint32_t size)
+  {
+    target.iarrayAssign(values, size);
+    return true;
+  }
+};
+
+template <>
+struct WriteBatch<double> {
+  template <class R>
+  static bool write(R& target, const double* values, uint32_t size)
+  {
+    target.darrayAssign(values, size);
+    return true;
+  }
+};
+
+template <class T>
+struct WriteBatch<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value &&
+                                             !std::is_same<T, int64_t>::value>::type> {
+  template <class R>
+  static bool write(R& target, const T* values, uint32_t size)
+  {
+    // Unsigned 64-bit beyond INT64 range: generic array
+    if (!std::is_signed<T>::value && sizeof(T) >= sizeof(int64_t))
+    {
+      for (uint32_t i = 0u; i < size; ++i)
+      {
+        if ((uint64_t)values[i] > (uint64_t)std::numeric_limits<int64_t>::max())
+          return false;
+      }
+    }
+    target.toIArray();
+    target.iarrayReserve(size);
+    for (uint32_t i = 0u; i < size; ++i)
+      target.iarrayPushBack((int64_t)values[i]);
+    return true;
+  }
+};
+
+template <class T>
+struct WriteBatch<T, typename std::enable_if<std::is_floating_point<T>::value && !std::is_same<T, double>::value>::type> {
+  template <class R>
+  static bool write(R& target, const T* values, uint32_t size)
+  {
+    target.toDArray();
+    target.darrayReserve(size);
+    for (uint32_t i = 0u; i < size; ++i)
+      target.darrayPushBack((double)values[i]);
+    return true;
+  }
+};
+
+template <class T, class A>
+struct WriteTraits<std::vector<T, A>> {
+  template <class W>
+  static void write(W& writer, typename W::RefValue target, const std::vector<T, A>& values)
+  {
+    const uint32_t size = (uint32_t)values.size();
+    if (WriteBatch<T>::write(target, values.data(), size))
+      return;
+      
+    target.toArray();
+    target.arrayReserve(size);
+    for (uint32_t i = 0u; i < size; ++i)
+      writeTyped(writer, target[(int)i], values[i]);
+  }
+};
+
+template <class A>
+struct WriteTraits<std::vector<bool, A>> {
+  template <class W>
+  static void write(W&, typename W::RefValue target, const std::vector<bool, A>& values)
+  {
+    const uint32_t size = (uint32_t)values.size();
+    target.toBArray();
+    target.barrayReserve(size);
+    for (uint32_t i = 0u; i < size; ++i)
+      target.barrayPushBack(values[i]);
+  }
+};
+
+// Map keys are dynamic: interned per write
+template <class MapT>
+struct WriteTraitsMap {
+  template <class W>
+  static void write(W& writer, typename W::RefValue target, const MapT& values)
+  {
+    target.toObject();
+    target.objectReserve((uint32_t)values.size());
+    for (const auto& kv : values)
+      writeTyped(writer, target.objectEmplaceBack(writer.key(kv.first)), kv.second);
+  }
+};
+
+template <class T, class C, class A>
+struct WriteTraits<std::map<std::string, T, C, A>> : WriteTraitsMap<std::map<std::string, T, C, A>> {};
+
+template <class T, class H, class E, class A>
+struct WriteTraits<std::unordered_map<std::string, T, H, E, A>> : WriteTraitsMap<std::unordered_map<std::string, T, H, E, A>> {};
+
+// Bound struct, one member per field in declaration order
+template <class Tuple, size_t I = 0u, bool Last = (I == std::tuple_size<Tuple>::value)>
+struct WriteFields {
+  template <class W, class C>
+  static void write(W& writer, typename W::RefValue& target, const JString* const* keys, const Tuple& fields, const C& obj)
+  {
+    writeTyped(writer, target.objectEmplaceBack(keys[I]), obj.*(std::get<I>(fields).member));
+    WriteFields<Tuple, I + 1u>::write(writer, target, keys, fields, obj);
+  }
+};
+
+template <class Tuple, size_t I>
+struct WriteFields<Tuple, I, true> {
+  template <class W, class C>
+  static void write(W&, typename W::RefValue&, const JString* const*, const Tuple&, const C&) {}
+};
+
+template <class T>
+struct WriteTraits<T, typename std::enable_if<IsBound<T>::value>::type> {
+  template <class W>
+  static void write(W& writer, typename W::RefValue target, const T& value)
+  {
+    using Fields = typename Binding<T>::Fields;
+    const JString* const* keys = writer.template keys<T>();
+    target.toObject();
+    target.objectReserve((uint32_t)std::tuple_size<Fields>::value);
+    WriteFields<Fields>::write(writer, target, keys, Binding<T>::fields(), value);
+  }
+};
+} // namespace helper
+
+//
+// Writes bound C++ values into a Document (inverse of BindHandler)
+// Field names are interned once per string pool (and generation), then members are appended
+// by key handle at the exact field count: no hashing nor lookup per field
+// Numeric vectors go straight into IARRAY / DARRAY storage, std::vector<bool> into BARRAY
+template <class DocumentT = DynamicDocument>
+class StructWriter
+{
+public:
+  using RefValue = typename DocumentT::RefValue;
+  using SharedStringPool = typename DocumentT::SharedStringPool;
+  using StringPoolT = typename SharedStringPool::element_type;
+  
+private:
+  SharedStringPool mPool;
+  uint32_t mGeneration = 0u;
+  std::vector<std::vector<const JString*>> mKeys;  // per bound type (writeTypeIndex)
+  
+  void bindPool(const SharedStringPool& pool)
+  {
+    if (pool != mPool || pool->generation() != mGeneration)
+    {
+      mKeys.clear();
+      mPool = pool;
+      mGeneration = pool->generation();
+    }
+  }
+  
+  template <class Tuple, size_t I = 0u, bool Last = (I == std::tuple_size<Tuple>::value)>
+  struct InternFields {
+    static void add(const Tuple& fields, StringPoolT& pool, std::vector<const JString*>& keys)
+    {
+      bool found = false;
+      keys.push_back(pool.provideInterned(std::get<I>(fields).name, true, found, (int32_t)std::get<I>(fields).len));
+      InternFields<Tuple, I + 1u>::add(fields, pool, keys);
+    }
+  };
+  
+  template <class Tuple, size_t I>
+  struct InternFields<Tuple, I, true> {
+    static void add(const Tuple&, StringPoolT&, std::vector<const JString*>&) {}
+  };
+  
+public:
+  // Overwrites root
+  template <class T>
+  void write(DocumentT& doc, const T& value)
+  {
+    write(doc, doc.root(), value);
+  }
+  
+  // 'target' must belong to 'doc'
+  template <class T>
+  void write(DocumentT& doc, RefValue target, const T& value)
+  {
+    bindPool(doc.stringPool());
+    helper::writeTyped(*this, target, value);
+  }
+  
+  // Interned field names of bound type 'T' (current pool)
+  template <class T>
+  const JString* const* keys()
+  {
+    using Fields = typename Binding<T>::Fields;
+    const uint32_t index = helper::writeTypeIndex<T>();
+    if (index >= mKeys.size())
+      mKeys.resize(index + 1u);
+      
+    std::vector<const JString*>& keys = mKeys[index];
+    if (keys.size() != std::tuple_size<Fields>::value)
+    {
+      keys.clear();
+      keys.reserve(std::tuple_size<Fields>::value);
+      mPool->reserve((uint32_t)std::tuple_size<Fields>::value);
+      InternFields<Fields>::add(Binding<T>::fields(), *mPool, keys);
+    }
+    return keys.data();
+  }
+  
+  // Dynamic key (map), interned
+  const JString* key(const std::string& str)
+  {
+    bool found = false;
+    return mPool->provideInterned(str.c_str(), true, found, (int32_t)str.size());
+  }
+};
+
+} // namespace lfjson
+
+#endif // LFJSON_BINDING_H
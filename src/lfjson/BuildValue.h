@@ -0,0 +1,67 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+#ifndef LFJSON_BUILDVALUE_H
+#define LFJSON_BUILDVALUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace lfjson
+{
+//
+// Scalar or string for bulk builders (RefValue::arrayAssign/objectAssign)
+// As with RefValue, 'const char*' strings are extern (i.e. not copied), 'char*' and std::string are interned (i.e. copied)
+struct BuildValue
+{
+  enum class Kind : uint8_t {
+    NUL,
+    BOOL,
+    INT64,
+    UINT64,
+    DOUBLE,
+    STRING
+  };
+  
+  union {
+    bool        b;
+    int64_t     i64;
+    uint64_t    u64;
+    double      d;
+    const char* s;
+  };
+  int32_t len = -1;  // string length, computed on build if -1
+  Kind kind;
+  bool own = false;  // string is copied
+  
+  BuildValue(std::nullptr_t = nullptr) : u64(0u), kind(Kind::NUL) {}
+  BuildValue(bool b_)          : b(b_),           kind(Kind::BOOL)   {}
+  BuildValue(int i)            : i64((int64_t)i), kind(Kind::INT64)  {}
+  BuildValue(int64_t i)        : i64(i),          kind(Kind::INT64)  {}
+  BuildValue(unsigned int u)   : u64((uint64_t)u), kind(Kind::UINT64) {}
+  BuildValue(uint64_t u)       : u64(u),          kind(Kind::UINT64) {}
+  BuildValue(double d_)        : d(d_),           kind(Kind::DOUBLE) {}
+  BuildValue(const char* s_, int32_t length = -1) : s(s_), len(length), kind(Kind::STRING) {}
+  BuildValue(char* s_, int32_t length = -1) : s(s_), len(length), kind(Kind::STRING), own(true) {}
+  BuildValue(const std::string& str) : s(str.c_str()), len((int32_t)str.size()), kind(Kind::STRING), own(true) {}
+};
+
+// Object member for bulk builders, keys must be unique
+struct BuildMember
+{
+  const char* key;
+  int32_t keyLen = -1;
+  bool own = false;  // key is copied
+  BuildValue value;
+  
+  BuildMember(const char* key_, BuildValue value_) : key(key_), value(value_) {}
+  BuildMember(char* key_, BuildValue value_) : key(key_), own(true), value(value_) {}
+  BuildMember(const std::string& key_, BuildValue value_) : key(key_.c_str()), keyLen((int32_t)key_.size()), own(true), value(value_) {}
+};
+
+} // namespace lfjson
+
+#endif // LFJSON_BUILDVALUE_H
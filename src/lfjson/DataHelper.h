@@ -13,6 +13,9 @@
 #include <cmath>
 #include <cstring>
 #include <cassert>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace lfjson {
 namespace helper
@@ -228,12 +231,14 @@ void objectReserve(JValue& value, uint32_t newCapacity, ObjectPoolAllocator<Chun
     JBigObject* newBigObject = (JBigObject*)opa.allocate(sizeof(JBigObject) + (newCapacity - 1) * sizeof(JMember));
     newBigObject->capa = newCapacity;
     
-    std::memcpy((void*)newBigObject->data, (void*)oldMembers, size * sizeof(JMember));
-    if (capacity < LFJ_MAX_UINT16)
-      opa.deallocate(oldMembers, capacity * sizeof(JMember));
-    else
-      opa.deallocate(value.oBO(), sizeof(JBigObject) + (capacity - 1) * sizeof(JMember));
-    
+    if (capacity > 0u)
+    {
+      std::memcpy((void*)newBigObject->data, (void*)oldMembers, size * sizeof(JMember));
+      if (capacity < LFJ_MAX_UINT16)
+        opa.deallocate(oldMembers, capacity * sizeof(JMember));
+      else
+        opa.deallocate(value.oBO(), sizeof(JBigObject) + (capacity - 1) * sizeof(JMember));
+    }
     value.setOBO(newBigObject);
     value.setOCapa(LFJ_MAX_UINT16);
   }
@@ -634,6 +639,36 @@ void objectOverwrite(JValue& value, JMember* it)
   value.decOSize();
 }
 
+// Range overwrite, erase [first, last) (returns new size)
+template <class T>
+uint32_t rangeOverwrite(T* data, uint32_t size, T* first, T* last)
+{
+  assert(data <= first && first <= last && last <= data + size);
+  if (first == last)
+    return size;
+  std::memmove((void*)first, (const void*)last, (data + size - last) * sizeof(T));
+  return size - (uint32_t)(last - first);
+}
+
+// Single pass compaction, 'erased' called on each removed element before being overwritten (returns new size)
+template <class T, class Pred, class Erased>
+uint32_t compactIf(T* data, uint32_t size, Pred& pred, Erased erased)
+{
+  uint32_t kept = 0u;
+  for (uint32_t i = 0u; i < size; ++i)
+  {
+    if (pred(static_cast<const T&>(data[i])))
+    {
+      erased(data[i]);
+      continue;
+    }
+    if (kept != i)
+      std::memcpy((void*)&data[kept], (const void*)&data[i], sizeof(T));
+    ++kept;
+  }
+  return kept;
+}
+
 // Converters
 template <uint16_t ChunkSize, class Allocator>
 void convertBArrayToArray(JValue& value, uint32_t reserveForExtra, ObjectPoolAllocator<ChunkSize, Allocator>& opa)
@@ -875,6 +910,359 @@ void convertIArrayToDArray(JValue& value, uint32_t reserveForExtra, ObjectPoolAl
   }
 }
 
+// Clone
+// Shallow copy of container 'src' into 'dst' (overwritten, not deallocated), block is copied with exact capacity
+// Children are copied verbatim (nested blocks and string references are shared)
+template <uint16_t ChunkSize, class Allocator>
+void copyBlock(JValue& dst, const ConstValue& src, ObjectPoolAllocator<ChunkSize, Allocator>& opa)
+{
+  switch (src.type())
+  {
+    case JType::OBJECT:
+    {
+      const uint32_t size = src.objectSize();
+      new (&dst) JValue(JType::OBJECT);
+      if (size == 0u)
+        return;
+      
+      void* srcMembers = (void*)src.objectMembers();
+      dst.setRawObject((size < LFJ_MAX_UINT16) ? opa.memPush(srcMembers, size * sizeof(JMember))
+                                               : opa.memPushBigObject(srcMembers, size), size);
+      return;
+    }
+    case JType::ARRAY:
+    {
+      const uint32_t size = src.arraySize();
+      new (&dst) JValue(JType::ARRAY);
+      if (size == 0u)
+        return;
+      
+      void* srcValues = (void*)src.arrayValues();
+      dst.setRawArray((size < LFJ_MAX_UINT16) ? opa.memPush(srcValues, size * sizeof(JValue))
+                                              : opa.memPushBigArray(srcValues, size), size);
+      return;
+    }
+    case JType::BARRAY:
+    {
+      const uint32_t size = src.barraySize();
+      new (&dst) JValue(JType::ARRAY);
+      if (size == 0u)
+      {
+        dst.force(JType::BARRAY);
+        return;
+      }
+      void* srcValues = (void*)src.barrayValues();
+      dst.setRawBArray((size < LFJ_MAX_UINT16) ? opa.memPush(srcValues, size * sizeof(bool))
+                                               : opa.memPushBigBArray(srcValues, size), size);
+      return;
+    }
+    case JType::IARRAY:
+    {
+      const uint32_t size = src.iarraySize();
+      new (&dst) JValue(JType::ARRAY);
+      if (size == 0u)
+      {
+        dst.force(JType::IARRAY);
+        return;
+      }
+      void* srcValues = (void*)src.iarrayValues();
+      dst.setRawIArray((size < LFJ_MAX_UINT16) ? opa.memPush(srcValues, size * sizeof(int64_t))
+                                               : opa.memPushBigIArray(srcValues, size), size);
+      return;
+    }
+    case JType::DARRAY:
+    {
+      const uint32_t size = src.darraySize();
+      new (&dst) JValue(JType::ARRAY);
+      if (size == 0u)
+      {
+        dst.force(JType::DARRAY);
+        return;
+      }
+      void* srcValues = (void*)src.darrayValues();
+      dst.setRawDArray((size < LFJ_MAX_UINT16) ? opa.memPush(srcValues, size * sizeof(double))
+                                               : opa.memPushBigDArray(srcValues, size), size);
+      return;
+    }
+    default:  // not a container
+      assert(false);
+      std::memcpy((void*)&dst, (const void*)&src, sizeof(JValue));
+      return;
+  }
+}
+
+// Deep copy of 'src' into 'dst' (overwritten, not deallocated), blocks are copied with exact capacity
+// String references are copied verbatim if 'pool' is null (same string pool), re-interned in 'pool' otherwise
+template <uint16_t ChunkSize, class Allocator, class Pool>
+void cloneValue(JValue& dst, const ConstValue& src, ObjectPoolAllocator<ChunkSize, Allocator>& opa, Pool* pool)
+{
+  switch (src.type())
+  {
+    case JType::OBJECT:
+    {
+      copyBlock(dst, src, opa);
+      
+      const uint32_t size = dst.objectSize();
+      for (uint32_t i = 0u; i < size; ++i)
+      {
+        JMember& member = dst.member(i);
+        if (pool != nullptr)
+        {
+          bool found = false;
+          member.setKey(pool->provideInterned(member.key(), true, found, (int32_t)member.keyLen()));
+        }
+        const ConstValue& child = src.objectMembers()[i].value();
+        if (child.isObject() || child.isMetaArray() || (pool != nullptr && child.isLongString()))
+          cloneValue(member.jvalue(), child, opa, pool);
+      }
+      return;
+    }
+    case JType::ARRAY:
+    {
+      copyBlock(dst, src, opa);
+      
+      const uint32_t size = dst.arraySize();
+      for (uint32_t i = 0u; i < size; ++i)
+      {
+        const ConstValue& child = src.arrayValues()[i];
+        if (child.isObject() || child.isMetaArray() || (pool != nullptr && child.isLongString()))
+          cloneValue(dst[i], child, opa, pool);
+      }
+      return;
+    }
+    case JType::BARRAY:
+    case JType::IARRAY:
+    case JType::DARRAY:
+    {
+      copyBlock(dst, src, opa);
+      return;
+    }
+    case JType::LSTRING:
+    {
+      if (pool != nullptr)
+      {
+        bool found = false;
+        const uint32_t len = src.longStringSize();
+        new (&dst) JValue(pool->provideInterned(src.getLongString(), false, found, (int32_t)len), len);
+        return;
+      }
+      std::memcpy((void*)&dst, (const void*)&src, sizeof(JValue));
+      return;
+    }
+    default:  // verbatim
+      std::memcpy((void*)&dst, (const void*)&src, sizeof(JValue));
+      return;
+  }
+}
+
+// Storage block of a container (as deallocated), returns false if none
+inline bool containerBlock(const JValue& value, void*& block, uint32_t& size)
+{
+  switch (value.type())
+  {
+    case JType::OBJECT:
+    {
+      const uint32_t capacity = value.objectCapacity();
+      block = (capacity < LFJ_MAX_UINT16) ? (void*)value.oO() : (void*)value.oBO();
+      size  = (capacity < LFJ_MAX_UINT16) ? capacity * (uint32_t)sizeof(JMember) : (uint32_t)sizeof(JBigObject) + (capacity - 1) * (uint32_t)sizeof(JMember);
+      return capacity > 0u;
+    }
+    case JType::ARRAY:
+    {
+      const uint32_t capacity = value.arrayCapacity();
+      block = (capacity < LFJ_MAX_UINT16) ? (void*)value.aA() : (void*)value.aBA();
+      size  = (capacity < LFJ_MAX_UINT16) ? capacity * (uint32_t)sizeof(JValue) : (uint32_t)sizeof(JBigArray) + (capacity - 1) * (uint32_t)sizeof(JValue);
+      return capacity > 0u;
+    }
+    case JType::BARRAY:
+    {
+      const uint32_t capacity = value.barrayCapacity();
+      block = (capacity < LFJ_MAX_UINT16) ? (void*)value.baA() : (void*)value.baBA();
+      size  = (capacity < LFJ_MAX_UINT16) ? capacity * (uint32_t)sizeof(bool) : (uint32_t)sizeof(JBigBArray) + (capacity - 1) * (uint32_t)sizeof(bool);
+      return capacity > 0u;
+    }
+    case JType::IARRAY:
+    {
+      const uint32_t capacity = value.iarrayCapacity();
+      block = (capacity < LFJ_MAX_UINT16) ? (void*)value.iaA() : (void*)value.iaBA();
+      size  = (capacity < LFJ_MAX_UINT16) ? capacity * (uint32_t)sizeof(int64_t) : (uint32_t)sizeof(JBigIArray) + (capacity - 1) * (uint32_t)sizeof(int64_t);
+      return capacity > 0u;
+    }
+    case JType::DARRAY:
+    {
+      const uint32_t capacity = value.darrayCapacity();
+      block = (capacity < LFJ_MAX_UINT16) ? (void*)value.daA() : (void*)value.daBA();
+      size  = (capacity < LFJ_MAX_UINT16) ? capacity * (uint32_t)sizeof(double) : (uint32_t)sizeof(JBigDArray) + (capacity - 1) * (uint32_t)sizeof(double);
+      return capacity > 0u;
+    }
+    default:
+      return false;
+  }
+}
+
+// Move ownership of 'value' blocks from 'from' to 'to' (both sharing the same base allocator and string pool)
+// Fallback blocks are relinked as is, chunk blocks are copied (exact capacity) then deallocated
+template <uint16_t ChunkSize, class Allocator>
+void relocateValue(JValue& value, ObjectPoolAllocator<ChunkSize, Allocator>& to, ObjectPoolAllocator<ChunkSize, Allocator>& from)
+{
+  void* block = nullptr;
+  uint32_t size = 0u;
+  if (containerBlock(value, block, size) && !from.transferFallback(block, size, to))
+  {
+    JValue temp;
+    copyBlock(temp, value, to);
+    from.deallocate(block, size);
+    std::memcpy((void*)&value, (const void*)&temp, sizeof(JValue));
+  }
+
+  if (value.isObject())
+  {
+    const uint32_t count = value.objectSize();
+    for (uint32_t i = 0u; i < count; ++i)
+    {
+      JValue& child = value.member(i).jvalue();
+      if (child.isObject() || child.isMetaArray())
+        relocateValue(child, to, from);
+    }
+  }
+  else if (value.isArray())
+  {
+    const uint32_t count = value.arraySize();
+    for (uint32_t i = 0u; i < count; ++i)
+    {
+      JValue& child = value[i];
+      if (child.isObject() || child.isMetaArray())
+        relocateValue(child, to, from);
+    }
+  }
+}
+
+
+// Handler with batch events (pushBoolArray, pushInt64Array, pushDoubleArray)
+template <class HandlerT, class = void>
+struct HasBatchEvents : std::false_type {};
+
+template <class HandlerT>
+struct HasBatchEvents<HandlerT, decltype((void)std::declval<HandlerT&>().pushInt64Array((const int64_t*)nullptr, 0u))> : std::true_type {};
+
+template <class HandlerT>
+bool acceptBatch(HandlerT& handler, const ConstValue& value, std::true_type)
+{
+  switch (value.type())
+  {
+    case JType::BARRAY: return handler.pushBoolArray(value.barrayValues(), value.barraySize());
+    case JType::IARRAY: return handler.pushInt64Array(value.iarrayValues(), value.iarraySize());
+    default:            return handler.pushDoubleArray(value.darrayValues(), value.darraySize());
+  }
+}
+
+template <class HandlerT>
+bool acceptBatch(HandlerT& handler, const ConstValue& value, std::false_type)
+{
+  switch (value.type())
+  {
+    case JType::BARRAY:
+    {
+      for (uint32_t i = 0u; i < value.barraySize(); ++i)
+        if (!handler.pushBool(value.barrayValues()[i]))
+          return false;
+      return true;
+    }
+    case JType::IARRAY:
+    {
+      for (uint32_t i = 0u; i < value.iarraySize(); ++i)
+        if (!handler.pushInt64(value.iarrayValues()[i]))
+          return false;
+      return true;
+    }
+    default:
+    {
+      for (uint32_t i = 0u; i < value.darraySize(); ++i)
+        if (!handler.pushDouble(value.darrayValues()[i]))
+          return false;
+      return true;
+    }
+  }
+}
+
+// Emits a value to 'handler' as Handler events (non-recursive), specialized arrays as batch events if handled
+// Returns false if handler aborted
+template <class HandlerT>
+bool acceptValue(const ConstValue& root, HandlerT& handler, bool copyStrings = true)
+{
+  struct Frame {
+    const ConstValue* container;
+    uint32_t index;
+    uint32_t size;
+  };
+  std::vector<Frame> stack;
+
+  const ConstValue* value = &root;
+  while (true)
+  {
+    bool ok = true;
+    switch (value->type())
+    {
+      case JType::OBJECT:
+      {
+        ok = handler.startObject();
+        stack.push_back({value, 0u, value->objectSize()});
+        break;
+      }
+      case JType::ARRAY:
+      {
+        ok = handler.startArray();
+        stack.push_back({value, 0u, value->arraySize()});
+        break;
+      }
+      case JType::BARRAY:
+      case JType::IARRAY:
+      case JType::DARRAY:
+      {
+        const uint32_t size = (value->type() == JType::BARRAY) ? value->barraySize()
+                            : (value->type() == JType::IARRAY) ? value->iarraySize() : value->darraySize();
+        ok = handler.startArray() && acceptBatch(handler, *value, HasBatchEvents<HandlerT>()) && handler.endArray(size);
+        break;
+      }
+      case JType::SSTRING: { ok = handler.pushString(value->getShortString(), true, (int32_t)value->shortStringSize()); break; }
+      case JType::LSTRING: { ok = handler.pushString(value->getLongString(), copyStrings, (int32_t)value->longStringSize()); break; }
+      case JType::INT64:   { ok = handler.pushInt64(value->getInt64());   break; }
+      case JType::UINT64:  { ok = handler.pushUInt64(value->getUInt64()); break; }
+      case JType::DOUBLE:  { ok = handler.pushDouble(value->getDouble()); break; }
+      case JType::TRUE:    { ok = handler.pushBool(true);  break; }
+      case JType::FALSE:   { ok = handler.pushBool(false); break; }
+      default:             { ok = handler.pushNull(); break; }
+    }
+    if (!ok)
+      return false;
+
+    // Next value, closing finished containers
+    value = nullptr;
+    while (value == nullptr && !stack.empty())
+    {
+      Frame& frame = stack.back();
+      if (frame.index == frame.size)
+      {
+        ok = frame.container->isObject() ? handler.endObject(frame.size) : handler.endArray(frame.size);
+        if (!ok)
+          return false;
+        stack.pop_back();
+      }
+      else if (frame.container->isObject())
+      {
+        const ConstMember& member = frame.container->objectMembers()[frame.index++];
+        if (!handler.pushKey(member.key(), copyStrings, (int32_t)member.keyLen()))
+          return false;
+        value = &member.value();
+      }
+      else
+        value = &frame.container->arrayValues()[frame.index++];
+    }
+    if (value == nullptr)
+      return true;
+  }
+}
+
 } // namespace helper
 } // namespace lfjson
 
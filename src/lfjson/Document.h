@@ -7,18 +7,24 @@
 #define LFJSON_DOCUMENT_H
 
 #include "BaseData.h"
+#include "BuildValue.h"
 #include "DataHelper.h"
 #include "PoolAllocator.h"
 #include "StringPool.h"
+#include "Tape.h"
+#include "TypeProfile.h"
 
 #include <cstddef>
 #include <cstdint>
 #include <cmath>
 #include <cstring>
 #include <cassert>
+#include <initializer_list>
+#include <iterator>
 #include <limits>
 #include <memory>
 #include <stdexcept>
+#include <vector>
 
 #define LFJ_DOCUMENT_DFLT_CHUNKSIZE   32768u
 #define LFJ_MAX_INT64 ((uint64_t)std::numeric_limits<int64_t>::max())
@@ -37,6 +43,7 @@ class Document
 {
 public:
   using SharedStringPool = std::shared_ptr<StringPool<StringChunkSize, Allocator>>;
+  using Profile = TypeProfile<StringChunkSize, Allocator>;
   
   // Reference to a Document JMember
   class RefMember
@@ -144,6 +151,36 @@ public:
       return mValue.incOSize(js);
     }
     
+    void buildValue(JValue& dest, const BuildValue& value)
+    {
+      dest.forceNull();
+      switch (value.kind)
+      {
+        case BuildValue::Kind::BOOL:   { dest.set(value.b);   break; }
+        case BuildValue::Kind::INT64:  { dest.set(value.i64); break; }
+        case BuildValue::Kind::UINT64: { dest.set(value.u64); break; }
+        case BuildValue::Kind::DOUBLE: { dest.set(value.d);   break; }
+        case BuildValue::Kind::STRING:
+        {
+          // Check if short-string
+          uint32_t minLen = value.len >= 0 ? (uint32_t)value.len : JValue::minStringLength(value.s);
+          if (minLen < JValue::ShortString_MaxSize)  // Short
+          {
+            dest.set(value.s, minLen);
+          }
+          else  // Long
+          {
+            bool found = false;
+            const JString* js = value.own ? mDoc.mSPA->provideInterned(value.s, false, found, value.len)
+                                          : mDoc.mSPA->provide(value.s, false, found, value.len);
+            dest.set(js, js->len());
+          }
+          break;
+        }
+        default: break;
+      }
+    }
+    
     void deallocate()
     {
       switch (mValue.type())
@@ -1071,6 +1108,94 @@ public:
       helper::objectOverwrite(mValue, itMember);
     }
     
+    // Range Erase [first, last)
+    void arrayErase(ConstValueIter first, ConstValueIter last)
+    {
+      for (JValue* it = (JValue*)first; it != (JValue*)last; ++it)
+        deallocateValue(mDoc, *it);
+      mValue.setASize(helper::rangeOverwrite(mValue.aValues(), mValue.arraySize(), (JValue*)first, (JValue*)last));
+    }
+    
+    void barrayErase(ConstBoolIter first, ConstBoolIter last)
+    {
+      mValue.setBASize(helper::rangeOverwrite(mValue.baValues(), mValue.barraySize(), (bool*)first, (bool*)last));
+    }
+    
+    void iarrayErase(ConstInt64Iter first, ConstInt64Iter last)
+    {
+      mValue.setIASize(helper::rangeOverwrite(mValue.iaValues(), mValue.iarraySize(), (int64_t*)first, (int64_t*)last));
+    }
+    
+    void darrayErase(ConstDoubleIter first, ConstDoubleIter last)
+    {
+      mValue.setDASize(helper::rangeOverwrite(mValue.daValues(), mValue.darraySize(), (double*)first, (double*)last));
+    }
+    
+    void objectErase(ConstMemberIter first, ConstMemberIter last)
+    {
+      for (JMember* it = (JMember*)first; it != (JMember*)last; ++it)
+        deallocateValue(mDoc, it->jvalue());
+      mValue.setOSize(helper::rangeOverwrite(mValue.oMembers(), mValue.objectSize(), (JMember*)first, (JMember*)last));
+    }
+    
+    // Remove If, single pass (O(n) whatever the count removed), returns count removed
+    // 'pred' takes 'const ConstValue&' (arrays), 'bool', 'int64_t', 'double' or 'const ConstMember&' (objects)
+    template <class Pred>
+    uint32_t arrayRemoveIf(Pred pred, bool shrink = false)
+    {
+      const uint32_t size = mValue.arraySize();
+      Document& doc = mDoc;
+      mValue.setASize(helper::compactIf(mValue.aValues(), size, pred, [&doc](JValue& value) {
+        deallocateValue(doc, value);
+      }));
+      if (shrink)
+        arrayShrink();
+      return size - mValue.arraySize();
+    }
+    
+    template <class Pred>
+    uint32_t barrayRemoveIf(Pred pred, bool shrink = false)
+    {
+      const uint32_t size = mValue.barraySize();
+      mValue.setBASize(helper::compactIf(mValue.baValues(), size, pred, [](bool&) {}));
+      if (shrink)
+        barrayShrink();
+      return size - mValue.barraySize();
+    }
+    
+    template <class Pred>
+    uint32_t iarrayRemoveIf(Pred pred, bool shrink = false)
+    {
+      const uint32_t size = mValue.iarraySize();
+      mValue.setIASize(helper::compactIf(mValue.iaValues(), size, pred, [](int64_t&) {}));
+      if (shrink)
+        iarrayShrink();
+      return size - mValue.iarraySize();
+    }
+    
+    template <class Pred>
+    uint32_t darrayRemoveIf(Pred pred, bool shrink = false)
+    {
+      const uint32_t size = mValue.darraySize();
+      mValue.setDASize(helper::compactIf(mValue.daValues(), size, pred, [](double&) {}));
+      if (shrink)
+        darrayShrink();
+      return size - mValue.darraySize();
+    }
+    
+    template <class Pred>
+    uint32_t objectRemoveIf(Pred pred, bool shrink = false)
+    {
+      const uint32_t size = mValue.objectSize();
+      Document& doc = mDoc;
+      mValue.setOSize(helper::compactIf(mValue.oMembers(), size, pred, [&doc](JMember& member) {
+        deallocateValue(doc, member.jvalue());
+      }));
+      if (shrink)
+        objectShrink();
+      return size - mValue.objectSize();
+    }
+    
     // Swap (/!\ Can break tree structure if swapping parent/child)
     void swap(RefValue& other)
     {
@@ -1080,6 +1205,232 @@ public:
       mValue = temp;
     }
     
+    // Copy (deep), 'value' must use this document string pool (can be part of this document)
+    void copyFrom(const ConstValue& value)
+    {
+      JValue temp;
+      helper::cloneValue(temp, value, mDoc.mOPA, (StringPool<StringChunkSize, Allocator>*)nullptr);
+      deallocate();
+      mValue = temp;
+    }
+    
+    // Copy (deep) from a value using 'valuePool', strings are re-interned only if pools differ
+    template <class Pool>
+    void copyFrom(const ConstValue& value, const std::shared_ptr<Pool>& valuePool)
+    {
+      JValue temp;
+      helper::cloneValue(temp, value, mDoc.mOPA, mDoc.internPoolFor(valuePool));
+      deallocate();
+      mValue = temp;
+    }
+    
+    void copyFrom(const RefValue& other)
+    {
+      copyFrom(other.mValue, other.mDoc.mSPA);
+    }
+
+    // Move, 'other' becomes null (/!\ 'other' must not contain this value)
+    // Zero-copy in same document, big blocks are relinked between documents sharing the string pool (others copied)
+    void moveFrom(RefValue other)
+    {
+      if (&mValue == &other.mValue)
+        return;
+      if (&mDoc != &other.mDoc && mDoc.mSPA != other.mDoc.mSPA)
+      {
+        copyFrom(other);
+        other = nullptr;
+        return;
+      }
+
+      JValue temp;
+      std::memcpy((void*)&temp, (const void*)&other.mValue, sizeof(JValue));
+      other.mValue.forceNull();
+      if (&mDoc != &other.mDoc)
+        helper::relocateValue(temp, mDoc.mOPA, other.mDoc.mOPA);
+      deallocate();
+      mValue = temp;
+    }
+
+    // Move 'other' array elements at 'index' (elements are not copied), 'other' becomes empty
+    // /!\ 'other' must not be part of this array (block may move)
+    void arraySplice(uint32_t index, RefValue other)
+    {
+      assert(mValue.isArray() && other.mValue.isArray());
+      assert(index <= mValue.arraySize());
+      assert(&mValue != &other.mValue);
+      const uint32_t count = other.mValue.arraySize();
+      if (count == 0u)
+        return;
+
+      const uint32_t size = mValue.arraySize();
+      helper::arrayReserve(mValue, size + count, mDoc.mOPA);
+      JValue* values = mValue.aValues();
+      std::memmove((void*)&values[index + count], (void*)&values[index], (size - index) * sizeof(JValue));
+
+      JValue* others = other.mValue.aValues();
+      const bool samePool = mDoc.mSPA == other.mDoc.mSPA;
+      if (samePool)
+        std::memcpy((void*)&values[index], (void*)others, count * sizeof(JValue));
+      for (uint32_t i = 0u; i < count; ++i)
+      {
+        if (!samePool)
+          helper::cloneValue(values[index + i], others[i], mDoc.mOPA, mDoc.mSPA.get());
+        else if (&mDoc != &other.mDoc)
+          helper::relocateValue(values[index + i], mDoc.mOPA, other.mDoc.mOPA);
+      }
+      mValue.setASize(size + count);
+
+      if (!samePool)
+        other.arrayClear();
+      else
+        other.mValue.setASize(0u);
+    }
+
+    // Append 'other' object members (keys must not exist in this object), 'other' becomes empty
+    // /!\ 'other' must not be part of this object (block may move)
+    void objectSplice(RefValue other)
+    {
+      assert(mValue.isObject() && other.mValue.isObject());
+      assert(&mValue != &other.mValue);
+      const uint32_t count = other.mValue.objectSize();
+      if (count == 0u)
+        return;
+
+      const uint32_t size = mValue.objectSize();
+      helper::objectReserve(mValue, size + count, mDoc.mOPA);
+
+      const bool samePool = mDoc.mSPA == other.mDoc.mSPA;
+      for (uint32_t i = 0u; i < count; ++i)
+      {
+        JMember& member = other.mValue.member(i);
+        bool found = false;
+        const JString* jKey = samePool ? member.jkey()
+                                       : mDoc.mSPA->provideInterned(member.key(), true, found, (int32_t)member.keyLen());
+        assert(mDoc.getValue(mValue, jKey) == nullptr && "[lfjson] RefValue: duplicate key in objectSplice");
+        JValue& dest = mValue.incOSize(jKey);
+        if (!samePool)
+          helper::cloneValue(dest, member.jvalue(), mDoc.mOPA, mDoc.mSPA.get());
+        else
+        {
+          std::memcpy((void*)&dest, (const void*)&member.jvalue(), sizeof(JValue));
+          if (&mDoc != &other.mDoc)
+            helper::relocateValue(dest, mDoc.mOPA, other.mDoc.mOPA);
+        }
+      }
+
+      if (!samePool)
+        other.objectClear();
+      else
+        other.mValue.setOSize(0u);
+    }
+
+    // Bulk builders: replace by a container allocated once with exact size (no growth, no lookup)
+    RefValue& arrayAssign(std::initializer_list<BuildValue> values)
+    {
+      return arrayAssign(values.begin(), values.end());
+    }
+    
+    template <class ForwardIt>
+    RefValue& arrayAssign(ForwardIt first, ForwardIt last)
+    {
+      const uint32_t size = (uint32_t)std::distance(first, last);
+      toArray();
+      helper::arrayReserve(mValue, size, mDoc.mOPA);
+      
+      JValue* values = size > 0u ? mValue.aValues() : nullptr;
+      for (uint32_t i = 0u; i < size; ++i, ++first)
+        buildValue(values[i], *first);
+      if (size > 0u)
+        mValue.setASize(size);
+      return *this;
+    }
+    
+    RefValue& barrayAssign(const bool* values, uint32_t size)
+    {
+      toBArray();
+      helper::barrayReserve(mValue, size, mDoc.mOPA);
+      if (size > 0u)
+      {
+        std::memcpy((void*)mValue.baValues(), (const void*)values, size * sizeof(bool));
+        mValue.setBASize(size);
+      }
+      return *this;
+    }
+    
+    RefValue& iarrayAssign(const int64_t* values, uint32_t size)
+    {
+      toIArray();
+      helper::iarrayReserve(mValue, size, mDoc.mOPA);
+      if (size > 0u)
+      {
+        std::memcpy((void*)mValue.iaValues(), (const void*)values, size * sizeof(int64_t));
+        mValue.setIASize(size);
+      }
+      return *this;
+    }
+    
+    RefValue& darrayAssign(const double* values, uint32_t size)
+    {
+      toDArray();
+      helper::darrayReserve(mValue, size, mDoc.mOPA);
+      if (size > 0u)
+      {
+        std::memcpy((void*)mValue.daValues(), (const void*)values, size * sizeof(double));
+        mValue.setDASize(size);
+      }
+      return *this;
+    }
+    
+    // Keys must be unique (not checked in release), interned with a single string pool growth
+    RefValue& objectAssign(std::initializer_list<BuildMember> members)
+    {
+      return objectAssign(members.begin(), members.end());
+    }
+    
+    template <class ForwardIt>
+    RefValue& objectAssign(ForwardIt first, ForwardIt last)
+    {
+      const uint32_t size = (uint32_t)std::distance(first, last);
+      toObject();
+      helper::objectReserve(mValue, size, mDoc.mOPA);
+      mDoc.mSPA->reserve(size);
+      
+      for (; first != last; ++first)
+      {
+        const BuildMember& member = *first;
+        bool found = false;
+        const JString* jKey = member.own ? mDoc.mSPA->provideInterned(member.key, true, found, member.keyLen)
+                                         : mDoc.mSPA->provide(member.key, true, found, member.keyLen);
+        assert((!found || mDoc.getValue(mValue, jKey) == nullptr) && "[lfjson] RefValue: duplicate key in objectAssign");
+        buildValue(mValue.incOSize(jKey), member.value);
+      }
+      return *this;
+    }
+    
+    // Any scalar (long strings copied if 'own')
+    RefValue& assign(const BuildValue& value)
+    {
+      deallocate();
+      buildValue(mValue, value);
+      return *this;
+    }
+    
+    // 'jKey' already interned as a key in this document's string pool: no lookup, no hashing
+    // Keys must be unique (not checked in release), returns the new null value
+    RefValue objectEmplaceBack(const JString* jKey)
+    {
+      assert(jKey != nullptr);
+      if (mValue.isNul())
+        mValue.set(JType::OBJECT);
+      else
+        assert(mValue.isObject());
+      assert(mDoc.getValue(mValue, jKey) == nullptr && "[lfjson] RefValue: duplicate key in objectEmplaceBack");
+    
+      if (mValue.oFull())
+        helper::objectGrow(mValue, mDoc.mOPA);
+      return RefValue(mDoc, mValue.incOSize(jKey));
+    }
+    
     // Array Converters (new_capacity = max(capacity, size + reserveForExtra))
     void convertBArrayToArray(uint32_t reserveForExtra = 0u)
     {
@@ -1117,8 +1468,22 @@ public:
       LFStack(Allocator& allocator_, size_t initialCapacity = 1024u)
         : allocator(allocator_)
         , capa(initialCapacity)
-        , data(initialCapacity > 0u ? allocator.allocate(initialCapacity) : nullptr)
+        , data(initialCapacity > 0u ? helper::allocateFrom(allocator, initialCapacity, AllocOrigin::STACK) : nullptr)
+      {
+      }
+      
+      LFStack(const LFStack&) = delete;
+      LFStack& operator=(const LFStack&) = delete;
+      
+      LFStack(LFStack&& other)
+        : allocator(other.allocator)
+        , size(other.size)
+        , capa(other.capa)
+        , data(other.data)
       {
+        other.size = 0u;
+        other.capa = 0u;
+        other.data = nullptr;
       }
       
       ~LFStack()
@@ -1147,15 +1512,20 @@ public:
         size -= dec;
       }
       
+      size_t grownCapacity(size_t newCapacity) const
+      {
+        size_t grownCapa = (capa > 0u) ? (size_t)std::ceil(capa * Stack_GrowthFactor) : 1u;
+        return (newCapacity < grownCapa) ? grownCapa : newCapacity;
+      }
+      
       void reserve(size_t newCapacity)
       {
         if (capa >= newCapacity)
           return;
         
-        size_t grownCapa = (capa > 0u) ? (size_t)std::ceil(capa * Stack_GrowthFactor) : 1u;
-        newCapacity = (newCapacity < grownCapa) ? grownCapa : newCapacity;
+        newCapacity = grownCapacity(newCapacity);
         
-        char* temp = allocator.allocate(newCapacity);
+        char* temp = helper::allocateFrom(allocator, newCapacity, AllocOrigin::STACK);
         assert(temp);
         std::memcpy(temp, data, size * sizeof(char));
         allocator.deallocate(data, capa);
@@ -1174,7 +1544,7 @@ public:
     };
     
     // Members
-    Document& mDoc;
+    Document* mDoc;
     LFStack mStack;
     bool mMemberVal = false;
     bool mRootInit  = false;
@@ -1182,6 +1552,8 @@ public:
     const bool mIntToDouble = true;
     uint32_t mArraySize = 0u;
     JType mArrayType = JType::NUL;
+    JType mArrayHint = JType::NUL;  // of current array, before its first element
+    Profile* mProfile = nullptr;    // array type hints
     
   #ifdef LFJ_HANDLER_DEBUG
   public:
@@ -1208,7 +1580,7 @@ public:
       else  // Long
       {
         bool found = false;
-        const JString* js = mDoc.stringPool()->provide(str, false, found, len);
+        const JString* js = mDoc->stringPool()->provide(str, false, found, len);
         new (dst) JValue(js, js->len());
       }
     }
@@ -1219,36 +1591,45 @@ public:
       uint32_t minLen = len >= 0 ? (uint32_t)len : JValue::minStringLength(str);
       if (minLen < JValue::ShortString_MaxSize) // Short
       {
-        new (dst) JValue(str, len);
+        new (dst) JValue(str, minLen);
       }
       else  // Long
       {
         bool found = false;
-        const JString* js = mDoc.stringPool()->provide(str, false, found, len);
+        const JString* js = mDoc->stringPool()->provide(str, false, found, len);
         new (dst) JValue(js, js->len());
       }
     }
     void inPlaceMember(void* dst, const char* key, int32_t len)
     {
       bool found = false;
-      const JString* js = mDoc.stringPool()->provide(key, true, found, len);
+      const JString* js = mDoc->stringPool()->provide(key, true, found, len);
       new (dst) JMember(js);
     }
     void inPlaceMember(void* dst, char* key, int32_t len)
     {
       bool found = false;
-      const JString* js = mDoc.stringPool()->provide(key, true, found, len);
+      const JString* js = mDoc->stringPool()->provide(key, true, found, len);
       new (dst) JMember(js);
     }
     
+    // Array type once holding an element of 'type'
+    // Hint only kept if storing the first element as such is lossless (generic array or same type)
+    JType arrayTypeFor(const JType type) const
+    {
+      if (mArrayType != JType::NUL)
+        return mArrayType;
+      return mArrayHint == JType::ARRAY ? JType::ARRAY : type;
+    }
+    
     // Returns 'true' if array is specialized
     bool convertedFor(const JType type)
     {
       assert(type == JType::ARRAY || type == JType::BARRAY || type == JType::IARRAY || type == JType::DARRAY);
-      if (mArrayType == type || mArrayType == JType::NUL)
+      mArrayType = arrayTypeFor(type);
+      if (mArrayType == type)
       {
         ++mArraySize;
-        mArrayType = type;
         return true;
       }
       
@@ -1289,6 +1670,7 @@ public:
           
           for (int64_t i = (int64_t)mArraySize - 1; i >= 0; --i)
             aValues[i].force(bValues[i]);
+          mStack.increment(addSize - sizeof(ConstValue));  // next value pushed by caller
           break;
         }
         case JType::IARRAY:
@@ -1301,6 +1683,7 @@ public:
           
           for (int64_t i = (int64_t)mArraySize - 1; i >= 0; --i)
             aValues[i].force(iValues[i]);
+          mStack.increment(addSize - sizeof(ConstValue));  // next value pushed by caller
           break;
         }
         case JType::DARRAY:
@@ -1313,6 +1696,7 @@ public:
           
           for (int64_t i = (int64_t)mArraySize - 1; i >= 0; --i)
             aValues[i].force(dValues[i]);
+          mStack.increment(addSize - sizeof(ConstValue));  // next value pushed by caller
           break;
         }
         default:
@@ -1323,15 +1707,55 @@ public:
       return false;
     }
     
+    // Worst case stack growth of next value (in place member value, specialized element or conversion)
+    size_t stackNeed(const JType type) const
+    {
+      if (mMemberVal)
+        return 0u;
+      const bool specialized = mArrayType == JType::BARRAY || mArrayType == JType::IARRAY || mArrayType == JType::DARRAY;
+      const bool numeric = (type == JType::IARRAY || type == JType::DARRAY)
+                        && (mArrayType == JType::IARRAY || mArrayType == JType::DARRAY);
+      if (specialized && type != mArrayType && !(numeric && mIntToDouble))
+        return ((size_t)mArraySize + 1u) * sizeof(ConstValue);
+      return sizeof(ConstValue);
+    }
+    
+    // Memory budget: refuses stack growth beyond it (stack counted on top of the pools while parsing)
+    // and aborts once pools exceeded it, the Document stays clearable
+    bool admit(size_t stackExtra)
+    {
+      const MemoryBudget& budget = mDoc->mBudget;
+      if (!budget.limited())
+        return true;
+      if (budget.exceeded())
+        return false;
+      
+      const size_t needed = mStack.size + stackExtra;
+      if (needed <= mStack.capa)
+        return true;
+      if (!budget.allows(mStack.grownCapacity(needed)))
+        return false;
+      mStack.reserve(needed);
+      return true;
+    }
+    
   public:
     Handler(Document& doc, bool allowIntToDouble = true)
-      : mDoc(doc)
+      : mDoc(&doc)
       , mStack(doc.baseAllocator())
       , mIntToDouble(allowIntToDouble)
     {}
     
+    // Stack from 'stackAllocator' (must outlive the handler, see ParseSession)
+    Handler(Document& doc, Allocator& stackAllocator, size_t stackCapacity, bool allowIntToDouble = true)
+      : mDoc(&doc)
+      , mStack(stackAllocator, stackCapacity)
+      , mIntToDouble(allowIntToDouble)
+    {}
+    
     // Accessors
     uint64_t stackCapacity() const { return mStack.capa; }
+    Document& document() const { return *mDoc; }
   #ifdef LFJ_HANDLER_DEBUG
     uint64_t parsedValuesCount()  const { return valCount; }
   #endif
@@ -1344,6 +1768,30 @@ public:
       mRootInit  = false;
       mArraySize = 0u;
       mArrayType = JType::NUL;
+      mArrayHint = JType::NUL;
+    }
+    
+    // Next events go to 'doc' (stack kept, previous parse dropped if unfinished)
+    void rebind(Document& doc)
+    {
+      clear();
+      mDoc = &doc;
+      if (mProfile != nullptr)
+        mProfile->bind(mDoc->stringPool());
+    }
+    
+    // Member arrays start with the type hinted for their key, if their first element fits it (nullptr to disable)
+    // Bound to the document pool here and on rebind: set again after clearing the pool otherwise
+    void setTypeProfile(Profile* profile)
+    {
+      mProfile = profile;
+      if (mProfile != nullptr)
+        mProfile->bind(mDoc->stringPool());
+    }
+    
+    void reserveStack(size_t capacity)
+    {
+      mStack.reserve(capacity);
     }
     
     void finalize(bool shrinkDocument = true, bool rehashStringPool = false)
@@ -1355,17 +1803,20 @@ public:
       mRootInit  = false;
       mArraySize = 0u;
       mArrayType = JType::NUL;
+      mArrayHint = JType::NUL;
       
       if (shrinkDocument)
-        mDoc.shrink(rehashStringPool);
+        mDoc->shrink(rehashStringPool);
     }
     
     // Group
     bool startObject()
     {
+      if (!admit(stackNeed(JType::ARRAY)))
+        return false;
       if (!mRootInit) // root
       {
-        mDoc.root().toObject();
+        mDoc->root().toObject();
         mRootInit = true;
       }
       else
@@ -1400,7 +1851,7 @@ public:
       if (memberCount > 0u)
       {
         void* ptr = nullptr;
-        auto& opa = mDoc.objectAllocator();
+        auto& opa = mDoc->objectAllocator();
         const uint32_t memSize = memberCount * sizeof(ConstMember);
         if (memberCount < LFJ_MAX_UINT16)
           ptr = opa.memPush(mStack.end() - memSize, memSize);
@@ -1409,7 +1860,7 @@ public:
         
         mStack.decrement(memSize);
         assert(mStack.size == 0u || mStack.size >= sizeof(ConstValue));
-        auto& val = mStack.size == 0u ? mDoc.root().mValue : *(JValue*)mStack.lastValue();
+        auto& val = mStack.size == 0u ? mDoc->root().mValue : *(JValue*)mStack.lastValue();
         assert(val.isObject());
         val.setRawObject(ptr, (uint32_t)memberCount);
       }
@@ -1418,14 +1869,17 @@ public:
     #ifdef LFJ_HANDLER_DEBUG
       if (print) std::cout << "EndObject(" << memberCount << ")" << std::endl;
     #endif
-      return true;
+      return !mDoc->mBudget.exceeded();
     }
     
     bool startArray()
     {
+      if (!admit(stackNeed(JType::ARRAY)))
+        return false;
+      JType hint = JType::NUL;
       if (!mRootInit) // root
       {
-        mDoc.root().toArray();
+        mDoc->root().toArray();
         mRootInit = true;
       }
       else
@@ -1436,6 +1890,8 @@ public:
           assert(((JValue*)mStack.lastValue())->isNul());
           inPlaceValue(mStack.lastValue(), JType::ARRAY);
           mMemberVal = false;
+          if (mProfile != nullptr)
+            hint = mProfile->hint(((JMember*)(mStack.end() - sizeof(ConstMember)))->jkey());
         }
         else
         {
@@ -1448,6 +1904,7 @@ public:
       }
       mArraySize = 0u;
       mArrayType = JType::NUL;
+      mArrayHint = hint;
       
     #ifdef LFJ_HANDLER_DEBUG
       ++valCount;
@@ -1465,7 +1922,7 @@ public:
         assert(mArrayType != JType::NUL);
         void* ptr = nullptr;
         uint32_t memSize = 0u;
-        auto& opa = mDoc.objectAllocator();
+        auto& opa = mDoc->objectAllocator();
         switch (mArrayType)
         {
           case JType::ARRAY:
@@ -1478,7 +1935,7 @@ public:
             
             mStack.decrement(memSize);
             assert(mStack.size == 0u || mStack.size >= sizeof(ConstValue));
-            auto& val = mStack.size == 0u ? mDoc.root().mValue : *(JValue*)mStack.lastValue();
+            auto& val = mStack.size == 0u ? mDoc->root().mValue : *(JValue*)mStack.lastValue();
             val.setRawArray(ptr, (uint32_t)elementCount);
             break;
           }
@@ -1492,7 +1949,7 @@ public:
             
             mStack.decrement(memSize);
             assert(mStack.size == 0u || mStack.size >= sizeof(ConstValue));
-            auto& val = mStack.size == 0u ? mDoc.root().mValue : *(JValue*)mStack.lastValue();
+            auto& val = mStack.size == 0u ? mDoc->root().mValue : *(JValue*)mStack.lastValue();
             val.setRawBArray(ptr, (uint32_t)elementCount);
             break;
           }
@@ -1506,7 +1963,7 @@ public:
             
             mStack.decrement(memSize);
             assert(mStack.size == 0u || mStack.size >= sizeof(ConstValue));
-            auto& val = mStack.size == 0u ? mDoc.root().mValue : *(JValue*)mStack.lastValue();
+            auto& val = mStack.size == 0u ? mDoc->root().mValue : *(JValue*)mStack.lastValue();
             val.setRawIArray(ptr, (uint32_t)elementCount);
             break;
           }
@@ -1520,7 +1977,7 @@ public:
             
             mStack.decrement(memSize);
             assert(mStack.size == 0u || mStack.size >= sizeof(ConstValue));
-            auto& val = mStack.size == 0u ? mDoc.root().mValue : *(JValue*)mStack.lastValue();
+            auto& val = mStack.size == 0u ? mDoc->root().mValue : *(JValue*)mStack.lastValue();
             val.setRawDArray(ptr, (uint32_t)elementCount);
             break;
           }
@@ -1533,12 +1990,14 @@ public:
     #ifdef LFJ_HANDLER_DEBUG
       if (print) std::cout << "EndArray(" << elementCount << ")" << std::endl;
     #endif
-      return true;
+      return !mDoc->mBudget.exceeded();
     }
     
     // Scalar
     bool pushKey(const char* str, bool copy, int32_t length = -1)
     {
+      if (!admit(sizeof(ConstMember)))
+        return false;
       assert(!mMemberVal);
       // push on stack
       const uint64_t memSize = sizeof(ConstMember);
@@ -1560,6 +2019,8 @@ public:
     
     bool pushNull()
     {
+      if (!admit(stackNeed(JType::ARRAY)))
+        return false;
       // push on stack
       if (mMemberVal)
       {
@@ -1583,6 +2044,8 @@ public:
     
     bool pushBool(bool b)
     {
+      if (!admit(stackNeed(JType::BARRAY)))
+        return false;
       // push on stack
       if (mMemberVal)
       {
@@ -1622,6 +2085,8 @@ public:
     
     bool pushInt64(int64_t i64)
     {
+      if (!admit(stackNeed(JType::IARRAY)))
+        return false;
       // push on stack
       if (mMemberVal)
       {
@@ -1671,6 +2136,8 @@ public:
     {
       if (u64 <= LFJ_MAX_INT64)
         return pushInt64((int64_t)u64); // preferred because of IARRAY
+      if (!admit(stackNeed(JType::ARRAY)))
+        return false;
       
       // push on stack
       if (mMemberVal)
@@ -1696,6 +2163,8 @@ public:
     
     bool pushDouble(double d)
     {
+      if (!admit(stackNeed(JType::DARRAY)))
+        return false;
       // push on stack
       if (mMemberVal)
       {
@@ -1731,6 +2200,8 @@ public:
     
     bool pushString(const char* str, bool copy, int32_t length = -1)
     {
+      if (!admit(stackNeed(JType::ARRAY)))
+        return false;
       // push on stack
       if (mMemberVal)
       {
@@ -1758,9 +2229,366 @@ public:
     #endif
       return true;
     }
+
+    // Batch (array elements only), same as pushing each element
+    // Copied at once if the array is (or would start) of this specialized type
+    bool pushBoolArray(const bool* values, uint32_t count)
+    {
+      assert(!mMemberVal);
+      if (arrayTypeFor(JType::BARRAY) != JType::BARRAY)
+      {
+        for (uint32_t i = 0u; i < count; ++i)
+        {
+          if (!pushBool(values[i]))
+            return false;
+        }
+        return true;
+      }
+      if (!admit((size_t)count * sizeof(bool)))
+        return false;
+      pushBatch(values, count, JType::BARRAY);
+      return true;
+    }
+
+    bool pushInt64Array(const int64_t* values, uint32_t count)
+    {
+      assert(!mMemberVal);
+      if (arrayTypeFor(JType::IARRAY) != JType::IARRAY)
+      {
+        for (uint32_t i = 0u; i < count; ++i)
+        {
+          if (!pushInt64(values[i]))
+            return false;
+        }
+        return true;
+      }
+      if (!admit((size_t)count * sizeof(int64_t)))
+        return false;
+      pushBatch(values, count, JType::IARRAY);
+      return true;
+    }
+
+    bool pushDoubleArray(const double* values, uint32_t count)
+    {
+      assert(!mMemberVal);
+      if (arrayTypeFor(JType::DARRAY) != JType::DARRAY)
+      {
+        for (uint32_t i = 0u; i < count; ++i)
+        {
+          if (!pushDouble(values[i]))
+            return false;
+        }
+        return true;
+      }
+      if (!admit((size_t)count * sizeof(double)))
+        return false;
+      pushBatch(values, count, JType::DARRAY);
+      return true;
+    }
+
+  private:
+    template <class T>
+    void pushBatch(const T* values, uint32_t count, JType type)
+    {
+      if (count == 0u)
+        return;
+
+      const uint64_t memSize = (uint64_t)count * sizeof(T);
+      mStack.reserve(mStack.size + memSize);
+      std::memcpy((void*)mStack.end(), (const void*)values, memSize);
+      mStack.increment(memSize);
+      mArraySize += count;
+      mArrayType = type;
+    #ifdef LFJ_HANDLER_DEBUG
+      valCount += count;
+      if (print) std::cout << "Batch(" << count << ")" << std::endl;
+    #endif
+    }
+  };
+  
+  // Builds in place from container counts known up front (StructureTape, from a pre-pass or the parser)
+  // Final storage is reserved at startObject/startArray: values are written once, no stack copy
+  // Events must match the tape ('false' otherwise, the Document stays clearable)
+  class DirectHandler
+  {
+  private:
+    Document& mDoc;
+    const StructureTape& mTape;
+    size_t mNext = 0u;             // next tape entry
+    std::vector<JValue*> mFrames;  // open containers
+    JValue* mMember = nullptr;     // value of last key
+    bool mRootInit = false;
+    
+    // Next generic value (member value, ARRAY element or root), nullptr on mismatch
+    JValue* slot()
+    {
+      if (mMember != nullptr)
+      {
+        JValue* val = mMember;
+        mMember = nullptr;
+        return val;
+      }
+      if (mFrames.empty())
+      {
+        if (mRootInit)
+          return nullptr;
+        mRootInit = true;
+        mDoc.root().toNull();
+        return &mDoc.mRoot;
+      }
+      JValue& array = *mFrames.back();
+      if (!array.isArray() || array.aFull())
+        return nullptr;
+      array.incASize();
+      return &array[array.arraySize() - 1u];
+    }
+    
+    // Open specialized array of 'type' (nullptr if none, or full)
+    JValue* specialized(JType type)
+    {
+      if (mMember != nullptr || mFrames.empty() || mFrames.back()->type() != type)
+        return nullptr;
+      return mFrames.back();
+    }
+    
+    bool start(bool object)
+    {
+      JValue* val = slot();
+      if (val == nullptr || mNext >= mTape.size() || mDoc.mBudget.exceeded())
+        return false;
+      
+      const StructureTape::Entry& entry = mTape[mNext++];
+      if ((entry.type == JType::OBJECT) != object)
+        return false;
+      
+      val->set(entry.type);
+      if (entry.count > 0u)
+      {
+        switch (entry.type)
+        {
+          case JType::OBJECT: { helper::objectReserve(*val, entry.count, mDoc.mOPA); break; }
+          case JType::ARRAY:  { helper::arrayReserve(*val, entry.count, mDoc.mOPA);  break; }
+          case JType::BARRAY: { helper::barrayReserve(*val, entry.count, mDoc.mOPA); break; }
+          case JType::IARRAY: { helper::iarrayReserve(*val, entry.count, mDoc.mOPA); break; }
+          case JType::DARRAY: { helper::darrayReserve(*val, entry.count, mDoc.mOPA); break; }
+          default: return false;
+        }
+      }
+      mFrames.push_back(val);
+      return true;
+    }
+    
+    bool end(bool object, uint32_t count)
+    {
+      if (mFrames.empty() || mMember != nullptr)
+        return false;
+      JValue& val = *mFrames.back();
+      mFrames.pop_back();
+      if (val.isObject() != object)
+        return false;
+      
+      switch (val.type())
+      {
+        case JType::OBJECT: return val.objectSize() == count;
+        case JType::ARRAY:  return val.arraySize()  == count;
+        case JType::BARRAY: return val.barraySize() == count;
+        case JType::IARRAY: return val.iarraySize() == count;
+        case JType::DARRAY: return val.darraySize() == count;
+        default: return false;
+      }
+    }
+    
+    void setString(JValue& dst, const char* str, bool copy, int32_t len)
+    {
+      // Check if short-string
+      uint32_t minLen = len >= 0 ? (uint32_t)len : JValue::minStringLength(str);
+      if (minLen < JValue::ShortString_MaxSize)  // Short
+      {
+        dst.set(str, minLen);
+      }
+      else  // Long
+      {
+        bool found = false;
+        const JString* js = copy ? mDoc.mSPA->provideInterned(str, false, found, len)
+                                 : mDoc.mSPA->provide(str, false, found, len);
+        dst.set(js, js->len());
+      }
+    }
+    
+  public:
+    DirectHandler(Document& doc, const StructureTape& tape)
+      : mDoc(doc)
+      , mTape(tape)
+    {}
+    
+    // Accessors
+    bool done() const { return mRootInit && mFrames.empty() && mNext == mTape.size(); }
+    
+    void finalize(bool shrinkDocument = true, bool rehashStringPool = false)
+    {
+      assert(mFrames.empty());
+      if (shrinkDocument)
+        mDoc.shrink(rehashStringPool);
+    }
+    
+    // Group
+    bool startObject() { return start(true); }
+    bool endObject(uint32_t memberCount) { return end(true, memberCount); }
+    bool startArray() { return start(false); }
+    bool endArray(uint32_t elementCount) { return end(false, elementCount); }
+    
+    // Scalar
+    bool pushKey(const char* str, bool copy, int32_t length = -1)
+    {
+      if (mMember != nullptr || mFrames.empty())
+        return false;
+      JValue& object = *mFrames.back();
+      if (!object.isObject() || object.oFull())
+        return false;
+      
+      bool found = false;
+      const JString* jKey = copy ? mDoc.mSPA->provideInterned(str, true, found, length)
+                                 : mDoc.mSPA->provide(str, true, found, length);
+      mMember = &object.incOSize(jKey);
+      return true;
+    }
+    
+    bool pushNull()
+    {
+      JValue* val = slot();
+      if (val == nullptr)
+        return false;
+      val->forceNull();
+      return true;
+    }
+    
+    bool pushBool(bool b)
+    {
+      if (JValue* array = specialized(JType::BARRAY))
+      {
+        if (array->baFull())
+          return false;
+        array->incBASizeUninit();
+        array->arrayBool(array->barraySize() - 1u) = b;
+        return true;
+      }
+      JValue* val = slot();
+      if (val == nullptr)
+        return false;
+      val->set(b);
+      return true;
+    }
+    
+    bool pushInt(int i) { return pushInt64((int64_t)i); }
+    
+    bool pushUInt(unsigned u) { return pushInt64((int64_t)u); }
+    
+    bool pushInt64(int64_t i64)
+    {
+      if (JValue* array = specialized(JType::IARRAY))
+      {
+        if (array->iaFull())
+          return false;
+        array->incIASizeUninit();
+        array->arrayInt64(array->iarraySize() - 1u) = i64;
+        return true;
+      }
+      if (specialized(JType::DARRAY) != nullptr)
+        return pushDouble((double)i64);
+      JValue* val = slot();
+      if (val == nullptr)
+        return false;
+      val->set(i64);
+      return true;
+    }
+    
+    bool pushUInt64(uint64_t u64)
+    {
+      if (u64 <= LFJ_MAX_INT64)
+        return pushInt64((int64_t)u64);
+      JValue* val = slot();
+      if (val == nullptr)
+        return false;
+      val->set(u64);
+      return true;
+    }
+    
+    bool pushDouble(double d)
+    {
+      if (JValue* array = specialized(JType::DARRAY))
+      {
+        if (array->daFull())
+          return false;
+        array->incDASizeUninit();
+        array->arrayDouble(array->darraySize() - 1u) = d;
+        return true;
+      }
+      JValue* val = slot();
+      if (val == nullptr)
+        return false;
+      val->set(d);
+      return true;
+    }
+    
+    bool pushString(const char* str, bool copy, int32_t length = -1)
+    {
+      assert(str != nullptr);
+      JValue* val = slot();
+      if (val == nullptr)
+        return false;
+      setString(*val, str, copy, length);
+      return true;
+    }
+    
+    // Batch (array elements only)
+    bool pushBoolArray(const bool* values, uint32_t count)
+    {
+      if (count == 0u)
+        return true;
+      JValue* array = specialized(JType::BARRAY);
+      if (array == nullptr || count > array->barrayCapacity() - array->barraySize())
+        return false;
+      std::memcpy((void*)(array->baValues() + array->barraySize()), (const void*)values, count * sizeof(bool));
+      array->setBASize(array->barraySize() + count);
+      return true;
+    }
+    
+    bool pushInt64Array(const int64_t* values, uint32_t count)
+    {
+      if (count == 0u)
+        return true;
+      if (specialized(JType::DARRAY) != nullptr)
+      {
+        for (uint32_t i = 0u; i < count; ++i)
+        {
+          if (!pushDouble((double)values[i]))
+            return false;
+        }
+        return true;
+      }
+      JValue* array = specialized(JType::IARRAY);
+      if (array == nullptr || count > array->iarrayCapacity() - array->iarraySize())
+        return false;
+      std::memcpy((void*)(array->iaValues() + array->iarraySize()), (const void*)values, count * sizeof(int64_t));
+      array->setIASize(array->iarraySize() + count);
+      return true;
+    }
+    
+    bool pushDoubleArray(const double* values, uint32_t count)
+    {
+      if (count == 0u)
+        return true;
+      JValue* array = specialized(JType::DARRAY);
+      if (array == nullptr || count > array->darrayCapacity() - array->darraySize())
+        return false;
+      std::memcpy((void*)(array->daValues() + array->darraySize()), (const void*)values, count * sizeof(double));
+      array->setDASize(array->darraySize() + count);
+      return true;
+    }
   };
   
 private:
+  MemoryBudget mBudget;  // outlives the pools
   JValue mRoot;
   SharedStringPool mSPA;
   ObjectPoolAllocator<ObjectChunkSize, Allocator> mOPA;
@@ -1786,10 +2614,32 @@ private:
     }
     return res;
   }
+  
+  // A shared string pool counts toward the first Document using it
+  void attachBudget()
+  {
+    mOPA.setBudget(&mBudget);
+    if (mSPA->budget() == nullptr)
+      mSPA->setBudget(&mBudget);
+  }
+  
+  // Pool to re-intern strings from 'pool' into (nullptr if shared)
+  template <class Pool>
+  StringPool<StringChunkSize, Allocator>* internPoolFor(const std::shared_ptr<Pool>& pool)
+  {
+    assert(pool);
+    return ((const void*)pool.get() == (const void*)mSPA.get()) ? nullptr : mSPA.get();
+  }
 
 public:
-  Document() : mSPA(std::make_shared<StringPool<StringChunkSize, Allocator>>()), mOPA(mSPA->allocator()) {}
-  Document(const SharedStringPool& spa) : mSPA(spa), mOPA(mSPA->allocator()) {}
+  Document() : mSPA(std::make_shared<StringPool<StringChunkSize, Allocator>>()), mOPA(mSPA->allocator()) { attachBudget(); }
+  Document(const SharedStringPool& spa) : mSPA(spa), mOPA(mSPA->allocator()) { attachBudget(); }
+  
+  ~Document()
+  {
+    if (mSPA->budget() == &mBudget)
+      mSPA->setBudget(nullptr);
+  }
   
   Document(const Document& ot) = delete;
   Document& operator=(const Document&) = delete;
@@ -1802,6 +2652,41 @@ public:
   ObjectPoolAllocator<ObjectChunkSize, Allocator>& objectAllocator() { return mOPA; }
   const SharedStringPool& stringPool() const { return mSPA; }
   
+  // Memory budget (bytes taken from the base allocator by the object and string pools, O(1))
+  // Once exceeded, Handler events return false (parse aborted) and the Document can be cleared
+  // The Handler stack is checked on top of the pools while parsing, 0: unlimited
+  void setMemoryBudget(size_t bytes) { mBudget.limit = bytes > 0u ? bytes : MemoryBudget::Unlimited; }
+  size_t memoryBudget() const { return mBudget.limited() ? mBudget.limit : 0u; }
+  size_t memoryUsage()  const { return mBudget.used; }
+  bool overBudget()     const { return mBudget.exceeded(); }
+  
+  // Clone (deep) as root, 'value' must use this document string pool
+  void cloneFrom(const ConstValue& value)
+  {
+    root().copyFrom(value);
+  }
+  
+  // Clone (deep) as root, strings are re-interned only if pools differ
+  template <class Pool>
+  void cloneFrom(const ConstValue& value, const std::shared_ptr<Pool>& valuePool)
+  {
+    root().copyFrom(value, valuePool);
+  }
+  
+  template <uint16_t OtherStringChunkSize, class OtherAllocator, uint16_t OtherObjectChunkSize>
+  void cloneFrom(const Document<OtherStringChunkSize, OtherAllocator, OtherObjectChunkSize>& other)
+  {
+    root().copyFrom(other.croot(), other.stringPool());
+  }
+
+  // Replay as Handler events (e.g. into another Document Handler or a writer), specialized arrays as batch events
+  // Long strings and keys are pushed as extern if not 'copyStrings' (this document must outlive them)
+  template <class HandlerT>
+  bool accept(HandlerT& handler, bool copyStrings = true) const
+  {
+    return helper::acceptValue(mRoot, handler, copyStrings);
+  }
+
   // Modifiers
   void clear()
   {
@@ -1836,10 +2721,16 @@ public:
   {
     return Handler(*this, allowIntToDouble);
   }
+  
+  DirectHandler makeDirectHandler(const StructureTape& tape)
+  {
+    return DirectHandler(*this, tape);
+  }
 };
 
 // Helper aliases
 using DynamicDocument = Document<>;
+using DynamicTypeProfile = DynamicDocument::Profile;
 
 template <class Allocator, uint16_t ChunkSize = LFJ_DOCUMENT_DFLT_CHUNKSIZE>
 using CustomDocument = Document<ChunkSize, Allocator>;
@@ -0,0 +1,380 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+#ifndef LFJSON_HASH_H
+#define LFJSON_HASH_H
+
+#include "BaseData.h"
+#include "Document.h"
+#include "StringPool.h"  // xxHash
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+#include <vector>
+
+namespace lfjson
+{
+// Objects members order, for equality and hashing
+enum class MemberOrder : uint8_t {
+  SENSITIVE,
+  INSENSITIVE
+};
+
+namespace helper
+{
+inline uint32_t stringSize(const ConstValue& value)
+{
+  return value.isShortString() ? value.shortStringSize() : value.longStringSize();
+}
+
+// Size of any array kind
+inline uint32_t metaArraySize(const ConstValue& value)
+{
+  switch (value.type())
+  {
+    case JType::ARRAY:  return value.arraySize();
+    case JType::BARRAY: return value.barraySize();
+    case JType::IARRAY: return value.iarraySize();
+    case JType::DARRAY: return value.darraySize();
+    default: return 0u;
+  }
+}
+
+// Element of any array kind (shallow view, specialized elements as scalars)
+inline JValue metaArrayElement(const ConstValue& value, uint32_t index)
+{
+  switch (value.type())
+  {
+    case JType::BARRAY: return JValue(value.barrayValues()[index]);
+    case JType::IARRAY: return JValue(value.iarrayValues()[index]);
+    case JType::DARRAY: return JValue(value.darrayValues()[index]);
+    default:
+    {
+      JValue view;
+      std::memcpy((void*)&view, (const void*)&value.arrayValues()[index], sizeof(JValue));
+      return view;
+    }
+  }
+}
+
+inline bool sameKey(const ConstMember& lhs, const ConstMember& rhs, bool samePool)
+{
+  if (samePool)
+    return ((const JMember&)lhs).jkey() == ((const JMember&)rhs).jkey();
+  return lhs.keyLen() == rhs.keyLen() && std::memcmp(lhs.key(), rhs.key(), lhs.keyLen()) == 0;
+}
+
+// Member of 'object' with same key as 'key' (JString pointer compare if same pool)
+// Position 'hint' is tried first (members usually in same order)
+inline const ConstMember* findSameKey(const ConstValue& object, const ConstMember& key, bool samePool, uint32_t hint = 0u)
+{
+  const ConstMember* members = object.objectMembers();
+  const uint32_t size = object.objectSize();
+  if (hint < size && sameKey(members[hint], key, samePool))
+    return &members[hint];
+  for (uint32_t i = 0u; i < size; ++i)
+  {
+    if (sameKey(members[i], key, samePool))
+      return &members[i];
+  }
+  return nullptr;
+}
+
+// Containers sharing the same block (e.g. snapshots of a VersionedDocument) are equal
+inline bool sameBlock(const ConstValue& lhs, const ConstValue& rhs)
+{
+  if (lhs.type() != rhs.type())
+    return false;
+  switch (lhs.type())
+  {
+    case JType::OBJECT: return lhs.objectSize() == rhs.objectSize() && lhs.objectMembers() == rhs.objectMembers();
+    case JType::ARRAY:  return lhs.arraySize()  == rhs.arraySize()  && lhs.arrayValues()   == rhs.arrayValues();
+    case JType::BARRAY: return lhs.barraySize() == rhs.barraySize() && lhs.barrayValues()  == rhs.barrayValues();
+    case JType::IARRAY: return lhs.iarraySize() == rhs.iarraySize() && lhs.iarrayValues()  == rhs.iarrayValues();
+    case JType::DARRAY: return lhs.darraySize() == rhs.darraySize() && lhs.darrayValues()  == rhs.darrayValues();
+    default: return false;
+  }
+}
+
+inline bool valueEquals(const ConstValue& lhs, const ConstValue& rhs, MemberOrder order, bool samePool);
+
+inline bool arrayEquals(const ConstValue& lhs, const ConstValue& rhs, MemberOrder order, bool samePool)
+{
+  const uint32_t size = metaArraySize(lhs);
+  if (size != metaArraySize(rhs))
+    return false;
+  if (size == 0u || sameBlock(lhs, rhs))
+    return true;
+    
+  if (lhs.type() == rhs.type())
+  {
+    switch (lhs.type())  // bulk compares (doubles bitwise)
+    {
+      case JType::BARRAY: return std::memcmp(lhs.barrayValues(), rhs.barrayValues(), size * sizeof(bool)) == 0;
+      case JType::IARRAY: return std::memcmp(lhs.iarrayValues(), rhs.iarrayValues(), size * sizeof(int64_t)) == 0;
+      case JType::DARRAY: return std::memcmp(lhs.darrayValues(), rhs.darrayValues(), size * sizeof(double)) == 0;
+      default:
+      {
+        for (uint32_t i = 0u; i < size; ++i)
+        {
+          if (!valueEquals(lhs.arrayValues()[i], rhs.arrayValues()[i], order, samePool))
+            return false;
+        }
+        return true;
+      }
+    }
+  }
+  
+  for (uint32_t i = 0u; i < size; ++i)
+  {
+    if (!valueEquals(metaArrayElement(lhs, i), metaArrayElement(rhs, i), order, samePool))
+      return false;
+  }
+  return true;
+}
+
+inline bool objectEquals(const ConstValue& lhs, const ConstValue& rhs, MemberOrder order, bool samePool)
+{
+  const uint32_t size = lhs.objectSize();
+  if (size != rhs.objectSize())
+    return false;
+  if (sameBlock(lhs, rhs))
+    return true;
+    
+  const ConstMember* members = lhs.objectMembers();
+  const ConstMember* others = rhs.objectMembers();
+  if (order == MemberOrder::SENSITIVE)
+  {
+    for (uint32_t i = 0u; i < size; ++i)
+    {
+      if (!sameKey(members[i], others[i], samePool) || !valueEquals(members[i].value(), others[i].value(), order, samePool))
+        return false;
+    }
+    return true;
+  }
+  
+  // Each rhs member matches at most one lhs member (duplicate keys)
+  std::vector<bool> matched(size, false);
+  auto matches = [&](uint32_t i, uint32_t j) {
+    return !matched[j] && sameKey(members[i], others[j], samePool)
+        && valueEquals(members[i].value(), others[j].value(), order, samePool);
+  };
+  for (uint32_t i = 0u; i < size; ++i)
+  {
+    uint32_t j = i;  // same position tried first
+    if (!matches(i, j))
+    {
+      for (j = 0u; j < size && !matches(i, j); ++j) {}
+      if (j == size)
+        return false;
+    }
+    matched[j] = true;
+  }
+  return true;
+}
+
+// JSON equality: specialized and generic arrays compare by elements, int64/uint64 by value, doubles bitwise
+// Long strings compare by pointer if both values use the same pool (interned)
+inline bool valueEquals(const ConstValue& lhs, const ConstValue& rhs, MemberOrder order, bool samePool)
+{
+  if (lhs.isMetaArray() && rhs.isMetaArray())
+    return arrayEquals(lhs, rhs, order, samePool);
+    
+  if (lhs.type() != rhs.type())
+  {
+    if (lhs.isInt64() && rhs.isUInt64())
+      return lhs.getInt64() >= 0 && (uint64_t)lhs.getInt64() == rhs.getUInt64();
+    if (lhs.isUInt64() && rhs.isInt64())
+      return rhs.getInt64() >= 0 && (uint64_t)rhs.getInt64() == lhs.getUInt64();
+    return false;
+  }
+  
+  switch (lhs.type())
+  {
+    case JType::OBJECT:
+      return objectEquals(lhs, rhs, order, samePool);
+    case JType::SSTRING:
+      return lhs.shortStringSize() == rhs.shortStringSize()
+          && std::memcmp(lhs.getShortString(), rhs.getShortString(), lhs.shortStringSize()) == 0;
+    case JType::LSTRING:
+    {
+      if (lhs.getLongString() == rhs.getLongString())
+        return true;
+      return !samePool && lhs.longStringSize() == rhs.longStringSize()
+          && std::memcmp(lhs.getLongString(), rhs.getLongString(), lhs.longStringSize()) == 0;
+    }
+    case JType::INT64:  return lhs.getInt64()  == rhs.getInt64();
+    case JType::UINT64: return lhs.getUInt64() == rhs.getUInt64();
+    case JType::DOUBLE:
+    {
+      const double l = lhs.getDouble();
+      const double r = rhs.getDouble();
+      return std::memcmp(&l, &r, sizeof(double)) == 0;
+    }
+    default:  // true, false, null
+      return true;
+  }
+}
+
+inline uint64_t hashBytes(const void* data, size_t len, uint64_t seed)
+{
+#ifndef LFJ_NO_XXHASH
+  return (uint64_t)XXH_INLINE_XXH3_64bits_withSeed(data, len, seed);
+#else
+  // FNV-1a 64-bits (public domain)
+  uint64_t hash = 14695981039346656037ull ^ seed;
+  const unsigned char* bytes = (const unsigned char*)data;
+  for (size_t i = 0; i < len; ++i)
+    hash = (hash ^ bytes[i]) * 1099511628211ull;
+  return hash;
+#endif
+}
+
+// Finalizer (MurmurHash3 fmix64)
+inline uint64_t mix64(uint64_t h)
+{
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ull;
+  h ^= h >> 33;
+  return h;
+}
+} // namespace helper
+
+//
+// Structural hash of a value, consistent with deepEquals (same order option):
+// independent of string pool, members storage and arrays specialization
+// Scalars digest to their raw bits, arrays hash their elements digests in bulk (specialized arrays from memory)
+class StructuralHasher
+{
+private:
+  enum : uint64_t {
+    SeedString = 0x9e3779b97f4a7c15ull,
+    SeedArray  = 0xbf58476d1ce4e5b9ull,
+    SeedObject = 0x94d049bb133111ebull,
+    DigestNull = 0x2545f4914f6cdd1dull
+  };
+  
+  MemberOrder mOrder;
+  std::vector<std::vector<uint64_t>> mScratch;  // per depth digests
+  
+  std::vector<uint64_t>& scratch(uint32_t depth)
+  {
+    if (depth >= mScratch.size())
+      mScratch.resize(depth + 1u);
+    mScratch[depth].clear();
+    return mScratch[depth];
+  }
+  
+  static uint64_t stringDigest(const char* str, uint32_t len)
+  {
+    return helper::hashBytes(str, len, SeedString);
+  }
+  
+  uint64_t digest(const ConstValue& value, uint32_t depth)
+  {
+    switch (value.type())
+    {
+      case JType::OBJECT:  return objectDigest(value, depth);
+      case JType::ARRAY:   return arrayDigest(value, depth);
+      case JType::IARRAY:  return helper::hashBytes(value.iarrayValues(), value.iarraySize() * sizeof(int64_t), SeedArray);
+      case JType::DARRAY:  return helper::hashBytes(value.darrayValues(), value.darraySize() * sizeof(double), SeedArray);
+      case JType::BARRAY:
+      {
+        std::vector<uint64_t>& digests = scratch(depth);
+        digests.assign(value.barrayValues(), value.barrayValues() + value.barraySize());
+        return helper::hashBytes(digests.data(), digests.size() * sizeof(uint64_t), SeedArray);
+      }
+      case JType::SSTRING: return stringDigest(value.getShortString(), value.shortStringSize());
+      case JType::LSTRING: return stringDigest(value.getLongString(), value.longStringSize());
+      case JType::INT64:   return (uint64_t)value.getInt64();
+      case JType::UINT64:  return value.getUInt64();
+      case JType::DOUBLE:
+      {
+        const double d = value.getDouble();
+        uint64_t bits;
+        std::memcpy(&bits, &d, sizeof(double));
+        return bits;
+      }
+      case JType::TRUE:    return 1u;
+      case JType::FALSE:   return 0u;
+      default:             return DigestNull;
+    }
+  }
+  
+  uint64_t arrayDigest(const ConstValue& value, uint32_t depth)
+  {
+    const uint32_t size = value.arraySize();
+    std::vector<uint64_t>& digests = scratch(depth);
+    digests.reserve(size);
+    for (uint32_t i = 0u; i < size; ++i)
+    {
+      const uint64_t elem = digest(value.arrayValues()[i], depth + 1u);
+      mScratch[depth].push_back(elem);  // not 'digests' (resized by nested calls)
+    }
+    return helper::hashBytes(mScratch[depth].data(), size * sizeof(uint64_t), SeedArray);
+  }
+  
+  uint64_t objectDigest(const ConstValue& value, uint32_t depth)
+  {
+    const uint32_t size = value.objectSize();
+    const ConstMember* members = value.objectMembers();
+    if (mOrder == MemberOrder::INSENSITIVE)
+    {
+      uint64_t sum = 0u;  // commutative
+      for (uint32_t i = 0u; i < size; ++i)
+      {
+        const uint64_t key = stringDigest(members[i].key(), members[i].keyLen());
+        sum += helper::mix64(key ^ helper::mix64(digest(members[i].value(), depth + 1u) + SeedObject));
+      }
+      return helper::mix64(sum ^ (SeedObject + size));
+    }
+    
+    scratch(depth).reserve(2u * size);
+    for (uint32_t i = 0u; i < size; ++i)
+    {
+      const uint64_t key = stringDigest(members[i].key(), members[i].keyLen());
+      const uint64_t val = digest(members[i].value(), depth + 1u);
+      mScratch[depth].push_back(key);
+      mScratch[depth].push_back(val);
+    }
+    return helper::hashBytes(mScratch[depth].data(), 2u * size * sizeof(uint64_t), SeedObject);
+  }
+  
+public:
+  StructuralHasher(MemberOrder order = MemberOrder::INSENSITIVE) : mOrder(order) {}
+  
+  uint64_t operator()(const ConstValue& value) { return helper::mix64(digest(value, 0u)); }
+};
+
+// Structural hash (see StructuralHasher, reuse one for many values)
+inline uint64_t structuralHash(const ConstValue& value, MemberOrder order = MemberOrder::INSENSITIVE)
+{
+  StructuralHasher hasher(order);
+  return hasher(value);
+}
+
+// Deep equality, 'samePool' if both values use the same string pool (keys and long strings compared by pointer)
+inline bool deepEquals(const ConstValue& lhs, const ConstValue& rhs, MemberOrder order = MemberOrder::INSENSITIVE, bool samePool = false)
+{
+  return helper::valueEquals(lhs, rhs, order, samePool);
+}
+
+template <uint16_t LStringChunkSize, class LAllocator, uint16_t LObjectChunkSize,
+          uint16_t RStringChunkSize, class RAllocator, uint16_t RObjectChunkSize>
+bool deepEquals(const Document<LStringChunkSize, LAllocator, LObjectChunkSize>& lhs,
+                const Document<RStringChunkSize, RAllocator, RObjectChunkSize>& rhs,
+                MemberOrder order = MemberOrder::INSENSITIVE)
+{
+  const bool samePool = (void*)lhs.stringPool().get() == (void*)rhs.stringPool().get();
+  return helper::valueEquals(lhs.croot(), rhs.croot(), order, samePool);
+}
+
+} // namespace lfjson
+
+#endif // LFJSON_HASH_H
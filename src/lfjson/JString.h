@@ -53,7 +53,7 @@ private:
     bool key()     const { return flags & 0x02; } // if used as JMember key at least once
     uint32_t len() const { return flags >> 2; }   // string length
     
-    void updateIsKey(bool key) { flags |= key << 1; }
+    void updateIsKey(bool key) { if (key && !(flags & 0x02)) flags |= 0x02; } // no store if unchanged
     
     uint32_t  flags;  // len:30 | key:1 | own:1
   } mInfo;
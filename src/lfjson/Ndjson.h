@@ -0,0 +1,540 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+#ifndef LFJSON_NDJSON_H
+#define LFJSON_NDJSON_H
+
+#include "Pointer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace lfjson
+{
+enum class FilterOp : uint8_t {
+  EQ      = 0,
+  NE      = 1,
+  LT      = 2,
+  LE      = 3,
+  GT      = 4,
+  GE      = 5,
+  EXISTS  = 6
+};
+
+namespace helper
+{
+// Raw JSON text scanning (no value built, nothing validated beyond what is read)
+inline const char* scanWs(const char* p, const char* end)
+{
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+    ++p;
+  return p;
+}
+
+// 'p' after the opening quote, returns after the closing one (nullptr if unterminated)
+inline const char* scanStringEnd(const char* p, const char* end)
+{
+  for (;;)
+  {
+    const char* q = (const char*)std::memchr(p, '"', (size_t)(end - p));
+    if (q == nullptr)
+      return nullptr;
+    const char* b = q;
+    while (b > p && b[-1] == '\\')
+      --b;
+    if (((q - b) & 1) == 0)  // not escaped
+      return q + 1;
+    p = q + 1;
+  }
+}
+
+inline const char* scanNumberEnd(const char* p, const char* end)
+{
+  while (p < end && ((*p >= '0' && *p <= '9') || *p == '-' || *p == '+' || *p == '.' || *p == 'e' || *p == 'E'))
+    ++p;
+  return p;
+}
+
+inline const char* scanValueEnd(const char* p, const char* end)
+{
+  if (p >= end)
+    return nullptr;
+  switch (*p)
+  {
+    case '"':
+      return scanStringEnd(p + 1, end);
+    case '{':
+    case '[':
+    {
+      uint32_t depth = 0u;
+      while (p < end)
+      {
+        const char c = *p++;
+        if (c == '"')
+        {
+          p = scanStringEnd(p, end);
+          if (p == nullptr)
+            return nullptr;
+        }
+        else if (c == '{' || c == '[')
+          ++depth;
+        else if ((c == '}' || c == ']') && --depth == 0u)
+          return p;
+      }
+      return nullptr;
+    }
+    case 't':
+    case 'n':
+      return end - p >= 4 ? p + 4 : nullptr;
+    case 'f':
+      return end - p >= 5 ? p + 5 : nullptr;
+    default:
+    {
+      const char* q = scanNumberEnd(p, end);
+      return q != p ? q : nullptr;
+    }
+  }
+}
+
+inline void appendUtf8(std::string& out, uint32_t cp)
+{
+  if (cp < 0x80u)
+    out.push_back((char)cp);
+  else if (cp < 0x800u)
+  {
+    out.push_back((char)(0xC0u | (cp >> 6)));
+    out.push_back((char)(0x80u | (cp & 0x3Fu)));
+  }
+  else if (cp < 0x10000u)
+  {
+    out.push_back((char)(0xE0u | (cp >> 12)));
+    out.push_back((char)(0x80u | ((cp >> 6) & 0x3Fu)));
+    out.push_back((char)(0x80u | (cp & 0x3Fu)));
+  }
+  else
+  {
+    out.push_back((char)(0xF0u | (cp >> 18)));
+    out.push_back((char)(0x80u | ((cp >> 12) & 0x3Fu)));
+    out.push_back((char)(0x80u | ((cp >> 6) & 0x3Fu)));
+    out.push_back((char)(0x80u | (cp & 0x3Fu)));
+  }
+}
+
+inline bool scanHex4(const char* p, const char* end, uint32_t& cp)
+{
+  if (end - p < 4)
+    return false;
+  cp = 0u;
+  for (int i = 0; i < 4; ++i)
+  {
+    const char c = p[i];
+    cp <<= 4;
+    if (c >= '0' && c <= '9')      cp |= (uint32_t)(c - '0');
+    else if (c >= 'a' && c <= 'f') cp |= (uint32_t)(c - 'a' + 10);
+    else if (c >= 'A' && c <= 'F') cp |= (uint32_t)(c - 'A' + 10);
+    else return false;
+  }
+  return true;
+}
+
+// String content [p, end) with escapes, to UTF-8
+inline bool unescape(const char* p, const char* end, std::string& out)
+{
+  out.clear();
+  while (p < end)
+  {
+    const char c = *p++;
+    if (c != '\\')
+    {
+      out.push_back(c);
+      continue;
+    }
+    if (p >= end)
+      return false;
+    switch (*p++)
+    {
+      case '"':  out.push_back('"');  break;
+      case '\\': out.push_back('\\'); break;
+      case '/':  out.push_back('/');  break;
+      case 'b':  out.push_back('\b'); break;
+      case 'f':  out.push_back('\f'); break;
+      case 'n':  out.push_back('\n'); break;
+      case 'r':  out.push_back('\r'); break;
+      case 't':  out.push_back('\t'); break;
+      case 'u':
+      {
+        uint32_t cp = 0u;
+        if (!scanHex4(p, end, cp))
+          return false;
+        p += 4;
+        if (cp >= 0xD800u && cp <= 0xDBFFu)  // surrogate pair
+        {
+          uint32_t low = 0u;
+          if (end - p < 6 || p[0] != '\\' || p[1] != 'u' || !scanHex4(p + 2, end, low) || low < 0xDC00u || low > 0xDFFFu)
+            return false;
+          p += 6;
+          cp = 0x10000u + ((cp - 0xD800u) << 10) + (low - 0xDC00u);
+        }
+        appendUtf8(out, cp);
+        break;
+      }
+      default:
+        return false;
+    }
+  }
+  return true;
+}
+} // namespace helper
+
+//
+// Conjunction of field predicates evaluated on raw JSON text, before any parse
+// Fields are JSON Pointers (object keys, array indices), compared to a number, string, bool or null literal
+// The scan stops at the first failing predicate or once all passed: values not on a predicate path are
+// skipped by bracket matching, nothing is converted but compared scalars
+// A missing field fails every predicate (NE included), numbers are compared as double,
+// strings byte-wise after unescaping, NE is true on type mismatch
+class RecordFilter
+{
+public:
+  enum { MaxPredicates = 64 };
+  
+private:
+  enum class Literal : uint8_t {
+    NUMBER  = 0,
+    STRING  = 1,
+    BOOL    = 2,
+    NUL     = 3,
+    ANY     = 4   // EXISTS
+  };
+  
+  struct Predicate {
+    std::vector<std::string>  keys;
+    std::vector<uint32_t>     indices;  // CompiledPointer::NoIndex if not an array index
+    FilterOp                  op;
+    Literal                   kind;
+    double                    number;
+    std::string               str;
+    bool                      boolean;
+  };
+  
+  struct State {
+    uint64_t passed;
+    bool     rejected;
+  };
+  
+  std::vector<Predicate> mPredicates;
+  uint64_t mAll = 0u;
+  
+  RecordFilter& add(const char* pointer, FilterOp op, Literal kind, double number, const char* str, size_t len, bool boolean)
+  {
+    if (mPredicates.size() >= (size_t)MaxPredicates)
+      throw std::length_error("[lfjson] RecordFilter: too many predicates");
+    DynamicPointer parsed;
+    if (!parsed.parse(pointer))
+      throw std::invalid_argument("[lfjson] RecordFilter: invalid JSON pointer syntax");
+      
+    Predicate pred;
+    for (uint32_t i = 0u; i < parsed.size(); ++i)
+    {
+      pred.keys.push_back(parsed.key(i));
+      pred.indices.push_back(parsed.index(i));
+    }
+    pred.op      = op;
+    pred.kind    = kind;
+    pred.number  = number;
+    pred.str.assign(str, len);
+    pred.boolean = boolean;
+    mPredicates.push_back(std::move(pred));
+    mAll = (mAll << 1) | 1u;
+    return *this;
+  }
+  
+  template <class T>
+  static bool compare(FilterOp op, const T& lhs, const T& rhs)
+  {
+    switch (op)
+    {
+      case FilterOp::EQ: return lhs == rhs;
+      case FilterOp::NE: return !(lhs == rhs);
+      case FilterOp::LT: return lhs < rhs;
+      case FilterOp::LE: return lhs <= rhs;
+      case FilterOp::GT: return lhs > rhs;
+      case FilterOp::GE: return lhs >= rhs;
+      default:           return true;
+    }
+  }
+  
+  // Predicate against the value at 'p' ('next' set after it, nullptr if malformed)
+  bool evaluate(const Predicate& pred, const char* p, const char* end, const char*& next, std::string& buffer) const
+  {
+    next = helper::scanValueEnd(p, end);
+    if (next == nullptr)
+      return false;
+    if (pred.op == FilterOp::EXISTS)
+      return true;
+      
+    Literal kind;
+    switch (*p)
+    {
+      case '"': kind = Literal::STRING; break;
+      case 't':
+      case 'f': kind = Literal::BOOL;   break;
+      case 'n': kind = Literal::NUL;    break;
+      case '{':
+      case '[': kind = Literal::ANY;    break;
+      default:  kind = Literal::NUMBER; break;
+    }
+    if (kind != pred.kind)
+      return pred.op == FilterOp::NE;
+      
+    switch (kind)
+    {
+      case Literal::NUMBER:
+      {
+        char digits[64];
+        const size_t len = (size_t)(next - p);
+        if (len >= sizeof(digits))
+          return false;
+        std::memcpy(digits, p, len);
+        digits[len] = '\0';
+        return compare(pred.op, std::strtod(digits, nullptr), pred.number);
+      }
+      case Literal::STRING:
+      {
+        const char* str = p + 1;
+        size_t len = (size_t)(next - 1 - str);
+        if (std::memchr(str, '\\', len) != nullptr)
+        {
+          if (!helper::unescape(str, str + len, buffer))
+            return false;
+          str = buffer.data();
+          len = buffer.size();
+        }
+        const size_t minLen = len < pred.str.size() ? len : pred.str.size();
+        int cmp = std::memcmp(str, pred.str.data(), minLen);
+        if (cmp == 0)
+          cmp = len < pred.str.size() ? -1 : (len > pred.str.size() ? 1 : 0);
+        return compare(pred.op, cmp, 0);
+      }
+      case Literal::BOOL:
+        return (pred.op == FilterOp::EQ || pred.op == FilterOp::NE) && compare(pred.op, *p == 't', pred.boolean);
+      default:  // null
+        return pred.op == FilterOp::EQ;
+    }
+  }
+  
+  // Value at 'p' for predicates 'mask' whose path matched up to 'depth'
+  // Returns after the value, nullptr once decided (see State) or if malformed
+  const char* scan(const char* p, const char* end, uint32_t depth, uint64_t mask, State& state, std::string& buffer) const
+  {
+    uint64_t deeper = 0u;
+    for (uint32_t i = 0u; i < (uint32_t)mPredicates.size(); ++i)
+    {
+      const uint64_t bit = (uint64_t)1u << i;
+      if ((mask & bit) == 0u)
+        continue;
+      const Predicate& pred = mPredicates[i];
+      if (pred.keys.size() > depth)
+      {
+        deeper |= bit;
+        continue;
+      }
+      const char* next = nullptr;
+      if (!evaluate(pred, p, end, next, buffer))
+      {
+        state.rejected = true;
+        return nullptr;
+      }
+      state.passed |= bit;
+    }
+    if (state.passed == mAll)
+      return nullptr;
+    if (deeper == 0u)
+      return helper::scanValueEnd(p, end);
+    if (*p != '{' && *p != '[')  // paths continue below a scalar
+    {
+      state.rejected = true;
+      return nullptr;
+    }
+    
+    const bool object = *p == '{';
+    const char close = object ? '}' : ']';
+    p = helper::scanWs(p + 1, end);
+    if (p < end && *p == close)
+      return closed(p + 1, deeper, state);
+    for (uint32_t index = 0u; p < end; ++index)
+    {
+      uint64_t sub = 0u;
+      if (object)  // key, then value
+      {
+        if (*p != '"')
+          return nullptr;
+        const char* keyEnd = helper::scanStringEnd(p + 1, end);
+        if (keyEnd == nullptr)
+          return nullptr;
+        const char* key = p + 1;
+        size_t keyLen = (size_t)(keyEnd - 1 - key);
+        if (std::memchr(key, '\\', keyLen) != nullptr)
+        {
+          if (!helper::unescape(key, key + keyLen, buffer))
+            return nullptr;
+          key = buffer.data();
+          keyLen = buffer.size();
+        }
+        sub = keyMask(deeper, depth, key, keyLen);
+        p = helper::scanWs(keyEnd, end);
+        if (p >= end || *p != ':')
+          return nullptr;
+        p = helper::scanWs(p + 1, end);
+      }
+      else
+        sub = indexMask(deeper, depth, index);
+        
+      p = sub != 0u ? scan(p, end, depth + 1u, sub, state, buffer) : helper::scanValueEnd(p, end);
+      if (p == nullptr)
+        return nullptr;
+      p = helper::scanWs(p, end);
+      if (p < end && *p == ',')
+        p = helper::scanWs(p + 1, end);
+      else if (p < end && *p == close)
+        return closed(p + 1, deeper, state);
+      else
+        return nullptr;
+    }
+    return nullptr;
+  }
+  
+  // Container end: paths through it not found are missing
+  static const char* closed(const char* p, uint64_t deeper, State& state)
+  {
+    if ((deeper & ~state.passed) == 0u)
+      return p;
+    state.rejected = true;
+    return nullptr;
+  }
+  
+  uint64_t keyMask(uint64_t mask, uint32_t depth, const char* key, size_t len) const
+  {
+    uint64_t sub = 0u;
+    for (uint32_t i = 0u; i < (uint32_t)mPredicates.size(); ++i)
+    {
+      const uint64_t bit = (uint64_t)1u << i;
+      if ((mask & bit) == 0u)
+        continue;
+      const std::string& tok = mPredicates[i].keys[depth];
+      if (tok.size() == len && std::memcmp(tok.data(), key, len) == 0)
+        sub |= bit;
+    }
+    return sub;
+  }
+  
+  uint64_t indexMask(uint64_t mask, uint32_t depth, uint32_t index) const
+  {
+    uint64_t sub = 0u;
+    for (uint32_t i = 0u; i < (uint32_t)mPredicates.size(); ++i)
+    {
+      const uint64_t bit = (uint64_t)1u << i;
+      if ((mask & bit) != 0u && mPredicates[i].indices[depth] == index)
+        sub |= bit;
+    }
+    return sub;
+  }
+  
+public:
+  // Predicates (throw std::invalid_argument on pointer syntax error)
+  RecordFilter& where(const char* pointer, FilterOp op, double number) { return add(pointer, op, Literal::NUMBER, number, "", 0u, false); }
+  RecordFilter& where(const char* pointer, FilterOp op, int64_t number) { return where(pointer, op, (double)number); }
+  RecordFilter& where(const char* pointer, FilterOp op, int number)     { return where(pointer, op, (double)number); }
+  RecordFilter& where(const char* pointer, FilterOp op, bool b)         { return add(pointer, op, Literal::BOOL, 0., "", 0u, b); }
+  RecordFilter& where(const char* pointer, FilterOp op, std::nullptr_t) { return add(pointer, op, Literal::NUL, 0., "", 0u, false); }
+  RecordFilter& where(const char* pointer, FilterOp op, const std::string& str)
+  {
+    return add(pointer, op, Literal::STRING, 0., str.data(), str.size(), false);
+  }
+  RecordFilter& where(const char* pointer, FilterOp op, const char* str) { return where(pointer, op, std::string(str)); }
+  RecordFilter& exists(const char* pointer) { return add(pointer, FilterOp::EXISTS, Literal::ANY, 0., "", 0u, false); }
+  
+  void clear()
+  {
+    mPredicates.clear();
+    mAll = 0u;
+  }
+  
+  // Accessors
+  size_t size() const { return mPredicates.size(); }
+  bool empty()  const { return mPredicates.empty(); }
+  
+  // 'true' if all predicates pass on 'json' (malformed text before the decision: 'false')
+  bool matches(const char* json, size_t length) const
+  {
+    if (mPredicates.empty())
+      return true;
+    const char* end = json + length;
+    const char* p = helper::scanWs(json, end);
+    if (p >= end)
+      return false;
+    State state = { 0u, false };
+    std::string buffer;  // unescaped strings only
+    scan(p, end, 0u, mAll, state, buffer);
+    return !state.rejected && state.passed == mAll;
+  }
+  
+  bool matches(const std::string& json) const { return matches(json.data(), json.size()); }
+};
+
+struct NdjsonStats {
+  uint64_t records = 0u;  // non blank lines
+  uint64_t matched = 0u;
+  uint64_t bytes   = 0u;  // of matched records
+};
+
+//
+// Splits newline delimited JSON and hands only records passing 'filter' to 'onRecord(const char*, size_t)',
+// which parses them (e.g. with a ParseSession); returning 'false' stops the scan
+// Rejected records never reach a Handler nor a StringPool
+template <class Func>
+NdjsonStats scanNdjson(const char* data, size_t length, const RecordFilter& filter, Func onRecord)
+{
+  NdjsonStats stats;
+  const char* p = data;
+  const char* end = data + length;
+  while (p < end)
+  {
+    const char* eol = (const char*)std::memchr(p, '\n', (size_t)(end - p));
+    const char* lineEnd = eol != nullptr ? eol : end;
+    const char* last = lineEnd;
+    while (last > p && (last[-1] == '\r' || last[-1] == ' ' || last[-1] == '\t'))
+      --last;
+    const char* first = helper::scanWs(p, last);
+    p = eol != nullptr ? eol + 1 : end;
+    if (first == last)  // blank
+      continue;
+      
+    ++stats.records;
+    const size_t len = (size_t)(last - first);
+    if (!filter.matches(first, len))
+      continue;
+    ++stats.matched;
+    stats.bytes += len;
+    if (!onRecord(first, len))
+      break;
+  }
+  return stats;
+}
+
+inline NdjsonStats scanNdjson(const std::string& data, const RecordFilter& filter)
+{
+  return scanNdjson(data.data(), data.size(), filter, [](const char*, size_t) { return true; });
+}
+
+} // namespace lfjson
+
+#endif // LFJSON_NDJSON_H
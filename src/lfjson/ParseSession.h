@@ -0,0 +1,96 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+#ifndef LFJSON_PARSESESSION_H
+#define LFJSON_PARSESESSION_H
+
+#include "Document.h"
+#include "StringPool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+#include <memory>
+
+namespace lfjson
+{
+//
+// Reusable parse state for request loops: one Handler whose stack survives across documents
+// The stack keeps its peak capacity (reserveStack to skip warm-up), so steady state parses allocate
+// nothing but the document itself
+// Stack memory comes from the allocator of the first bound document's string pool, kept alive here
+template <uint16_t StringChunkSize = LFJ_DOCUMENT_DFLT_CHUNKSIZE,
+          class Allocator = StdAllocator,
+          uint16_t ObjectChunkSize = StringChunkSize>
+class ParseSession
+{
+public:
+  using DocumentT = Document<StringChunkSize, Allocator, ObjectChunkSize>;
+  using Handler = typename DocumentT::Handler;
+  using SharedStringPool = typename DocumentT::SharedStringPool;
+  
+private:
+  SharedStringPool mStackPool;  // owns stack allocator
+  Handler mHandler;
+  uint64_t mParses = 0u;
+  
+public:
+  explicit ParseSession(DocumentT& doc, size_t stackCapacity = 1024u, bool allowIntToDouble = true)
+    : mStackPool(doc.stringPool())
+    , mHandler(doc, mStackPool->allocator(), stackCapacity, allowIntToDouble)
+  {}
+  
+  ParseSession(const ParseSession&) = delete;
+  ParseSession& operator=(const ParseSession&) = delete;
+  
+  // Accessors
+  uint64_t parses()        const { return mParses; }
+  uint64_t stackCapacity() const { return mHandler.stackCapacity(); }
+  DocumentT& document()    const { return mHandler.document(); }
+  
+  // Handler for the next parse into 'doc' (new, or cleared by the caller)
+  Handler& begin(DocumentT& doc)
+  {
+    mHandler.rebind(doc);
+    return mHandler;
+  }
+  
+  // Handler for the next parse into the current document, cleared first
+  Handler& begin(bool clearStrings = true)
+  {
+    DocumentT& doc = mHandler.document();
+    if (clearStrings)
+      doc.clear();
+    else
+      doc.clearObjects();
+    return begin(doc);
+  }
+  
+  // Ends a parse, stack kept (unlike Handler::finalize)
+  void end(bool shrinkDocument = false, bool rehashStringPool = false)
+  {
+    mHandler.clear();
+    ++mParses;
+    if (shrinkDocument)
+      mHandler.document().shrink(rehashStringPool);
+  }
+  
+  void reserveStack(size_t capacity)
+  {
+    mHandler.reserveStack(capacity);
+  }
+  
+  // Array type hints, e.g. learned from previous documents (see Handler::setTypeProfile)
+  void setTypeProfile(typename DocumentT::Profile* profile)
+  {
+    mHandler.setTypeProfile(profile);
+  }
+};
+
+using DynamicParseSession = ParseSession<>;
+
+} // namespace lfjson
+
+#endif // LFJSON_PARSESESSION_H
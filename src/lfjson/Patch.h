@@ -0,0 +1,514 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+#ifndef LFJSON_PATCH_H
+#define LFJSON_PATCH_H
+
+#include "BaseData.h"
+#include "DataHelper.h"
+#include "Document.h"
+#include "Hash.h"
+#include "Pointer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+#include <memory>
+#include <string>
+
+namespace lfjson {
+namespace helper
+{
+//
+// Appends JSON Patch operations to a Document root (array)
+template <class PatchDocument, class Pool>
+class PatchWriter
+{
+private:
+  PatchDocument& mPatch;
+  const std::shared_ptr<Pool>& mPool;
+  const bool mSamePool;
+  std::string mPath;
+  uint32_t mCount = 0u;
+  
+  void pushKey(const char* key, uint32_t len)
+  {
+    mPath.push_back('/');
+    for (uint32_t i = 0u; i < len; ++i)
+    {
+      if (key[i] == '~')
+        mPath.append("~0");
+      else if (key[i] == '/')
+        mPath.append("~1");
+      else
+        mPath.push_back(key[i]);
+    }
+  }
+  
+  void pushIndex(uint32_t index)
+  {
+    mPath.push_back('/');
+    mPath.append(std::to_string(index));
+  }
+  
+  void emit(const char* op, const ConstValue* value)
+  {
+    auto ops = mPatch.root();
+    auto entry = ops[(int)ops.arraySize()];
+    entry["op"] = op;
+    entry["path"] = (char*)mPath.c_str();
+    if (value != nullptr)
+      entry["value"].copyFrom(*value, mPool);
+    ++mCount;
+  }
+  
+public:
+  PatchWriter(PatchDocument& patch, const std::shared_ptr<Pool>& pool, bool samePool)
+    : mPatch(patch), mPool(pool), mSamePool(samePool)
+  {
+    if (mPatch.croot().isNul())
+      mPatch.root().toArray();
+    assert(mPatch.croot().isArray());
+  }
+  
+  uint32_t count() const { return mCount; }
+  
+  void diff(const ConstValue& from, const ConstValue& to)
+  {
+    const size_t pathLen = mPath.size();
+    if (sameBlock(from, to))
+      return;
+    if (from.isObject() && to.isObject())
+    {
+      const ConstMember* fromMembers = from.objectMembers();
+      for (uint32_t i = 0u; i < from.objectSize(); ++i)
+      {
+        const ConstMember* other = findSameKey(to, fromMembers[i], mSamePool, i);
+        pushKey(fromMembers[i].key(), fromMembers[i].keyLen());
+        if (other == nullptr)
+          emit("remove", nullptr);
+        else
+          diff(fromMembers[i].value(), other->value());
+        mPath.resize(pathLen);
+      }
+      
+      const ConstMember* toMembers = to.objectMembers();
+      for (uint32_t i = 0u; i < to.objectSize(); ++i)
+      {
+        if (findSameKey(from, toMembers[i], mSamePool, i) != nullptr)
+          continue;
+        pushKey(toMembers[i].key(), toMembers[i].keyLen());
+        emit("add", &toMembers[i].value());
+        mPath.resize(pathLen);
+      }
+      return;
+    }
+    
+    if (from.isMetaArray() && to.isMetaArray())
+    {
+      const uint32_t fromSize = metaArraySize(from);
+      const uint32_t toSize = metaArraySize(to);
+      if (from.type() == to.type() && !from.isArray() && arrayEquals(from, to, MemberOrder::INSENSITIVE, mSamePool))  // memcmp
+        return;
+        
+      const uint32_t common = std::min(fromSize, toSize);
+      for (uint32_t i = 0u; i < common; ++i)
+      {
+        pushIndex(i);
+        diff(metaArrayElement(from, i), metaArrayElement(to, i));
+        mPath.resize(pathLen);
+      }
+      for (uint32_t i = fromSize; i > toSize; --i)  // from the end (stable indices)
+      {
+        pushIndex(i - 1u);
+        emit("remove", nullptr);
+        mPath.resize(pathLen);
+      }
+      for (uint32_t i = fromSize; i < toSize; ++i)
+      {
+        pushIndex(i);
+        const JValue element = metaArrayElement(to, i);
+        emit("add", &element);
+        mPath.resize(pathLen);
+      }
+      return;
+    }
+    
+    if (!valueEquals(from, to, MemberOrder::INSENSITIVE, mSamePool))
+      emit("replace", &to);
+  }
+};
+
+//
+// Applies JSON Patch operations to a Document value
+template <class TargetDocument, class Pool>
+class PatchApplier
+{
+private:
+  using RefValue = typename TargetDocument::RefValue;
+  
+  TargetDocument& mDoc;
+  ConstValue& mTarget;
+  const std::shared_ptr<Pool>& mPool;
+  const bool mSamePool;
+  
+  static const ConstValue* field(const ConstValue& op, const char* name)
+  {
+    return PoolKeys<>::findMember(op, name, (uint32_t)std::strlen(name));
+  }
+  
+  static bool parsePointer(const ConstValue* value, DynamicPointer& pointer)
+  {
+    return value != nullptr && value->isMetaString() && pointer.parse(value->asString(), (int32_t)stringSize(*value));
+  }
+  
+  static bool isPrefix(const DynamicPointer& prefix, const DynamicPointer& pointer)
+  {
+    if (prefix.size() > pointer.size())
+      return false;
+    for (uint32_t i = 0u; i < prefix.size(); ++i)
+    {
+      if (prefix.key(i) != pointer.key(i))
+        return false;
+    }
+    return true;
+  }
+  
+  static uint32_t memberIndex(const ConstValue& object, const std::string& key)
+  {
+    const ConstMember* members = object.objectMembers();
+    const uint32_t size = object.objectSize();
+    for (uint32_t i = 0u; i < size; ++i)
+    {
+      if (members[i].keyLen() == key.size() && std::memcmp(members[i].key(), key.c_str(), key.size()) == 0)
+        return i;
+    }
+    return size;
+  }
+  
+  // Container holding last token (nullptr if missing)
+  JValue* parentOf(const DynamicPointer& pointer)
+  {
+    assert(!pointer.empty());
+    ConstValue* cur = &mTarget;
+    for (uint32_t i = 0u; i + 1u < pointer.size(); ++i)
+    {
+      if (cur->isObject())
+      {
+        const std::string& key = pointer.key(i);
+        cur = (ConstValue*)PoolKeys<>::findMember(*cur, key.c_str(), (uint32_t)key.size());
+      }
+      else if (cur->isArray())
+        cur = pointer.index(i) < cur->arraySize() ? &cur->arrayValues()[pointer.index(i)] : nullptr;
+      else
+        cur = nullptr;
+      if (cur == nullptr)
+        return nullptr;
+    }
+    return (JValue*)cur;
+  }
+  
+  // Array position of last token ('-' is end), NoIndex if invalid
+  static uint32_t arrayPos(const DynamicPointer& pointer, uint32_t size, bool insert)
+  {
+    const uint32_t last = pointer.size() - 1u;
+    if (insert && pointer.key(last) == "-")
+      return size;
+    const uint32_t index = pointer.index(last);
+    return (index < size || (insert && index == size)) ? index : (uint32_t)DynamicPointer::NoIndex;
+  }
+  
+  void release(JValue& value)
+  {
+    RefValue(mDoc, (ConstValue&)value) = nullptr;
+  }
+  
+  // Shallow view of value at 'pointer'
+  bool get(const DynamicPointer& pointer, JValue& view)
+  {
+    if (pointer.empty())
+    {
+      std::memcpy((void*)&view, (const void*)&mTarget, sizeof(JValue));
+      return true;
+    }
+    JValue* parent = parentOf(pointer);
+    if (parent == nullptr)
+      return false;
+      
+    if (parent->isObject())
+    {
+      const uint32_t pos = memberIndex(*parent, pointer.key(pointer.size() - 1u));
+      if (pos == parent->objectSize())
+        return false;
+      std::memcpy((void*)&view, (const void*)&parent->member(pos).jvalue(), sizeof(JValue));
+      return true;
+    }
+    if (!parent->isMetaArray())
+      return false;
+    const uint32_t pos = arrayPos(pointer, metaArraySize(*parent), false);
+    if (pos == (uint32_t)DynamicPointer::NoIndex)
+      return false;
+    view = metaArrayElement(*parent, pos);
+    return true;
+  }
+  
+  // Detach value at 'pointer' into 'out' (owned by caller)
+  bool take(const DynamicPointer& pointer, JValue& out)
+  {
+    if (pointer.empty())
+    {
+      std::memcpy((void*)&out, (const void*)&mTarget, sizeof(JValue));
+      new (&mTarget) JValue();
+      return true;
+    }
+    JValue* parent = parentOf(pointer);
+    if (parent == nullptr)
+      return false;
+      
+    if (parent->isObject())
+    {
+      const uint32_t pos = memberIndex(*parent, pointer.key(pointer.size() - 1u));
+      if (pos == parent->objectSize())
+        return false;
+      JMember& member = parent->member(pos);
+      std::memcpy((void*)&out, (const void*)&member.jvalue(), sizeof(JValue));
+      helper::objectOverwrite(*parent, &member);
+      return true;
+    }
+    if (!parent->isMetaArray())
+      return false;
+    const uint32_t pos = arrayPos(pointer, metaArraySize(*parent), false);
+    if (pos == (uint32_t)DynamicPointer::NoIndex)
+      return false;
+    out = metaArrayElement(*parent, pos);
+    switch (parent->type())
+    {
+      case JType::BARRAY: helper::barrayOverwrite(*parent, parent->baValues() + pos); break;
+      case JType::IARRAY: helper::iarrayOverwrite(*parent, parent->iaValues() + pos); break;
+      case JType::DARRAY: helper::darrayOverwrite(*parent, parent->daValues() + pos); break;
+      default:            helper::arrayOverwrite(*parent, parent->aValues() + pos); break;
+    }
+    return true;
+  }
+  
+  // Store 'staged' (owned) at 'pointer': inserted if 'insert', must exist otherwise
+  bool place(const DynamicPointer& pointer, JValue& staged, bool insert)
+  {
+    if (pointer.empty())
+    {
+      release((JValue&)mTarget);
+      std::memcpy((void*)&mTarget, (const void*)&staged, sizeof(JValue));
+      return true;
+    }
+    JValue* parent = parentOf(pointer);
+    if (parent == nullptr)
+      return false;
+    RefValue ref(mDoc, (ConstValue&)*parent);
+    
+    if (parent->isObject())
+    {
+      std::string key = pointer.key(pointer.size() - 1u);
+      uint32_t pos = memberIndex(*parent, key);
+      if (pos < parent->objectSize())
+        release(parent->member(pos).jvalue());
+      else if (!insert)
+        return false;
+      else
+      {
+        ref[&key[0]];  // new member (key copied)
+        pos = parent->objectSize() - 1u;
+      }
+      std::memcpy((void*)&parent->member(pos).jvalue(), (const void*)&staged, sizeof(JValue));
+      return true;
+    }
+    if (!parent->isMetaArray())
+      return false;
+      
+    const uint32_t size = metaArraySize(*parent);
+    const uint32_t pos = arrayPos(pointer, size, insert);
+    if (pos == (uint32_t)DynamicPointer::NoIndex)
+      return false;
+      
+    // Specialized arrays: same type in place, converted to generic array otherwise
+    if (parent->isBArray() && staged.isMetaBool())
+    {
+      if (insert)
+      {
+        ref.barrayPushBack(staged.getBool());
+        std::rotate(parent->baValues() + pos, parent->baValues() + size, parent->baValues() + size + 1u);
+      }
+      else
+        parent->baValues()[pos] = staged.getBool();
+      return true;
+    }
+    if (parent->isIArray() && staged.isInt64())
+    {
+      if (insert)
+      {
+        ref.iarrayPushBack(staged.getInt64());
+        std::rotate(parent->iaValues() + pos, parent->iaValues() + size, parent->iaValues() + size + 1u);
+      }
+      else
+        parent->iaValues()[pos] = staged.getInt64();
+      return true;
+    }
+    if (parent->isDArray() && staged.isDouble())
+    {
+      if (insert)
+      {
+        ref.darrayPushBack(staged.getDouble());
+        std::rotate(parent->daValues() + pos, parent->daValues() + size, parent->daValues() + size + 1u);
+      }
+      else
+        parent->daValues()[pos] = staged.getDouble();
+      return true;
+    }
+    if (parent->isBArray())
+      ref.convertBArrayToArray(1u);
+    else if (parent->isIArray())
+      ref.convertIArrayToArray(1u);
+    else if (parent->isDArray())
+      ref.convertDArrayToArray(1u);
+      
+    if (insert)
+    {
+      ref.arrayPushBack(nullptr);
+      JValue* values = parent->aValues();
+      std::memmove((void*)(values + pos + 1u), (void*)(values + pos), (size - pos) * sizeof(JValue));
+    }
+    else
+      release(parent->aValues()[pos]);
+    std::memcpy((void*)(parent->aValues() + pos), (const void*)&staged, sizeof(JValue));
+    return true;
+  }
+  
+  bool placeOrRelease(const DynamicPointer& pointer, JValue& staged, bool insert)
+  {
+    if (place(pointer, staged, insert))
+      return true;
+    release(staged);
+    return false;
+  }
+  
+public:
+  PatchApplier(TargetDocument& doc, ConstValue& target, const std::shared_ptr<Pool>& pool)
+    : mDoc(doc)
+    , mTarget(target)
+    , mPool(pool)
+    , mSamePool((void*)pool.get() == (void*)doc.stringPool().get())
+  {
+  }
+  
+  bool apply(const ConstValue& op)
+  {
+    if (!op.isObject())
+      return false;
+    const ConstValue* name = field(op, "op");
+    DynamicPointer path;
+    if (name == nullptr || !name->isMetaString() || !parsePointer(field(op, "path"), path))
+      return false;
+      
+    const std::string opName(name->asString(), stringSize(*name));
+    if (opName == "add" || opName == "replace")
+    {
+      const ConstValue* value = field(op, "value");
+      if (value == nullptr)
+        return false;
+      JValue staged;
+      RefValue(mDoc, (ConstValue&)staged).copyFrom(*value, mPool);
+      return placeOrRelease(path, staged, opName == "add");
+    }
+    if (opName == "remove")
+    {
+      JValue removed;
+      if (!take(path, removed))
+        return false;
+      release(removed);
+      return true;
+    }
+    if (opName == "move" || opName == "copy")
+    {
+      DynamicPointer from;
+      if (!parsePointer(field(op, "from"), from))
+        return false;
+      JValue staged;
+      if (opName == "move")
+      {
+        if (isPrefix(from, path))  // no-op if 'from' exists, or into itself
+        {
+          JValue view;
+          return from.size() == path.size() && get(from, view);
+        }
+        if (!take(from, staged))
+          return false;
+      }
+      else
+      {
+        JValue view;
+        if (!get(from, view))
+          return false;
+        RefValue(mDoc, (ConstValue&)staged).copyFrom(view);
+      }
+      return placeOrRelease(path, staged, true);
+    }
+    if (opName == "test")
+    {
+      const ConstValue* value = field(op, "value");
+      JValue view;
+      return value != nullptr && get(path, view) && valueEquals(view, *value, MemberOrder::INSENSITIVE, mSamePool);
+    }
+    return false;
+  }
+};
+} // namespace helper
+
+//
+// JSON Patch (RFC 6902) turning 'from' into 'to', operations appended to 'patch' root (array)
+// 'toPool' is the pool of 'to' (values are copied into 'patch'), 'samePool' if 'from' also uses it:
+// keys and long strings are then compared by pointer. Arrays are diffed by index (no moves)
+template <class Pool, uint16_t StringChunkSize, class Allocator, uint16_t ObjectChunkSize>
+uint32_t diff(const ConstValue& from, const ConstValue& to, const std::shared_ptr<Pool>& toPool,
+              Document<StringChunkSize, Allocator, ObjectChunkSize>& patch, bool samePool = false)
+{
+  helper::PatchWriter<Document<StringChunkSize, Allocator, ObjectChunkSize>, Pool> writer(patch, toPool, samePool);
+  writer.diff(from, to);
+  return writer.count();
+}
+
+template <class FromDocument, class ToDocument, class PatchDocument>
+uint32_t diff(const FromDocument& from, const ToDocument& to, PatchDocument& patch)
+{
+  const bool samePool = (void*)from.stringPool().get() == (void*)to.stringPool().get();
+  return diff(from.croot(), to.croot(), to.stringPool(), patch, samePool);
+}
+
+// Apply JSON Patch 'patch' (array, strings from 'patchPool') to 'target', a value of 'doc'
+// Stops at the first failing operation and returns 'false' (previous operations are kept)
+template <uint16_t StringChunkSize, class Allocator, uint16_t ObjectChunkSize, class Pool>
+bool apply(Document<StringChunkSize, Allocator, ObjectChunkSize>& doc, ConstValue& target,
+           const ConstValue& patch, const std::shared_ptr<Pool>& patchPool)
+{
+  if (!patch.isArray())
+    return false;
+  helper::PatchApplier<Document<StringChunkSize, Allocator, ObjectChunkSize>, Pool> applier(doc, target, patchPool);
+  for (uint32_t i = 0u; i < patch.arraySize(); ++i)
+  {
+    if (!applier.apply(patch.arrayValues()[i]))
+      return false;
+  }
+  return true;
+}
+
+template <class TargetDocument, class PatchDocument>
+bool apply(TargetDocument& doc, const PatchDocument& patch)
+{
+  return apply(doc, (ConstValue&)doc.croot(), patch.croot(), patch.stringPool());
+}
+
+} // namespace lfjson
+
+#endif // LFJSON_PATCH_H
@@ -0,0 +1,301 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+#ifndef LFJSON_POINTER_H
+#define LFJSON_POINTER_H
+
+#include "BaseData.h"
+#include "Document.h"
+#include "StringPool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace lfjson
+{
+//
+// Keys cached as JString handles of a StringPool (nullptr if not in pool yet)
+// Handles are re-resolved when used with another pool or after the pool released strings,
+// missing ones are retried only when the pool grew
+template <uint16_t StringChunkSize = LFJ_DOCUMENT_DFLT_CHUNKSIZE,
+          class Allocator = StdAllocator>
+class PoolKeys
+{
+public:
+  using SharedStringPool = std::shared_ptr<StringPool<StringChunkSize, Allocator>>;
+  
+private:
+  struct Key {
+    std::string     str;
+    const JString*  handle;
+  };
+  
+  std::vector<Key> mKeys;
+  SharedStringPool mPool;           // keeps bound pool alive (no ABA on address)
+  uint32_t mGeneration  = 0u;
+  uint32_t mPoolSize    = 0u;       // pool size when last resolved
+  uint32_t mUnresolved  = 0u;       // count of null handles
+  
+public:
+  uint32_t add(const std::string& str)
+  {
+    mKeys.push_back(Key{ str, nullptr });
+    ++mUnresolved;
+    return (uint32_t)mKeys.size() - 1u;
+  }
+  
+  void clear()
+  {
+    mKeys.clear();
+    mPool.reset();
+    mUnresolved = 0u;
+  }
+  
+  uint32_t size() const { return (uint32_t)mKeys.size(); }
+  const std::string& str(uint32_t pos) const { assert(pos < size()); return mKeys[pos].str; }
+  const JString* handle(uint32_t pos)  const { assert(pos < size()); return mKeys[pos].handle; }
+  
+  void resolve(const SharedStringPool& pool)
+  {
+    assert(pool);
+    const bool full = (pool != mPool) || (pool->generation() != mGeneration);
+    if (!full && (mUnresolved == 0u || pool->size() == mPoolSize))
+      return;
+      
+    mUnresolved = 0u;
+    for (auto& key : mKeys)
+    {
+      if (full || key.handle == nullptr)
+        key.handle = pool->get(key.str.c_str(), (int32_t)key.str.size());
+      if (key.handle == nullptr)
+        ++mUnresolved;
+    }
+    mPool       = pool;
+    mGeneration = pool->generation();
+    mPoolSize   = pool->size();
+  }
+  
+  // First member with key 'jKey' (nullptr if none)
+  static const ConstValue* findMember(const ConstValue& value, const JString* jKey)
+  {
+    assert(value.isObject());
+    const JMember* members = (const JMember*)value.objectMembers();
+    const uint32_t size = value.objectSize();
+    for (uint32_t i = 0u; i < size; ++i)
+    {
+      if (members[i].jkey() == jKey)
+        return &members[i].value();
+    }
+    return nullptr;
+  }
+  
+  // First member with key text 'key' (nullptr if none), no pool access
+  static const ConstValue* findMember(const ConstValue& value, const char* key, uint32_t len)
+  {
+    assert(value.isObject());
+    const ConstMember* members = value.objectMembers();
+    const uint32_t size = value.objectSize();
+    for (uint32_t i = 0u; i < size; ++i)
+    {
+      if (members[i].keyLen() == len && std::memcmp(members[i].key(), key, len) == 0)
+        return &members[i].value();
+    }
+    return nullptr;
+  }
+};
+
+//
+// JSON Pointer (RFC 6901), parsed once and resolved against a StringPool
+// Key segments are cached as JString handles: evaluation is pointer compares and array indexing only
+template <uint16_t StringChunkSize = LFJ_DOCUMENT_DFLT_CHUNKSIZE,
+          class Allocator = StdAllocator>
+class CompiledPointer
+{
+public:
+  using SharedStringPool = std::shared_ptr<StringPool<StringChunkSize, Allocator>>;
+  
+  enum { NoIndex = std::numeric_limits<uint32_t>::max() };
+  
+private:
+  using Keys = PoolKeys<StringChunkSize, Allocator>;
+  
+  Keys mKeys;                       // one per token (unescaped)
+  std::vector<uint32_t> mIndices;   // NoIndex if not a valid array index
+  
+  template <class FindMember>
+  const ConstValue* walk(const ConstValue& root, uint32_t* elementIndex, FindMember findMember) const
+  {
+    const ConstValue* cur = &root;
+    const uint32_t count = size();
+    for (uint32_t i = 0u; i < count; ++i)
+    {
+      const uint32_t index = mIndices[i];
+      switch (cur->type())
+      {
+        case JType::OBJECT:
+        {
+          cur = findMember(*cur, i);
+          if (cur == nullptr)
+            return nullptr;
+          break;
+        }
+        case JType::ARRAY:
+        {
+          if (index >= cur->arraySize())
+            return nullptr;
+          cur = &cur->arrayValues()[index];
+          break;
+        }
+        case JType::BARRAY:
+        case JType::IARRAY:
+        case JType::DARRAY:
+        {
+          if (elementIndex == nullptr || i + 1u != count)
+            return nullptr;
+          const uint32_t arrSize = cur->isBArray() ? cur->barraySize()
+                                 : cur->isIArray() ? cur->iarraySize() : cur->darraySize();
+          if (index >= arrSize)
+            return nullptr;
+          *elementIndex = index;
+          return cur;
+        }
+        default:
+          return nullptr;
+      }
+    }
+    return cur;
+  }
+  
+  static uint32_t parseIndex(const std::string& tok)
+  {
+    // '0' or [1-9][0-9]*, no sign nor leading zeros
+    const size_t len = tok.size();
+    if (len == 0u || len > 10u || (len > 1u && tok[0] == '0'))
+      return NoIndex;
+      
+    uint64_t idx = 0u;
+    for (size_t i = 0; i < len; ++i)
+    {
+      const char c = tok[i];
+      if (c < '0' || c > '9')
+        return NoIndex;
+      idx = idx * 10u + (uint64_t)(c - '0');
+    }
+    return idx < (uint64_t)NoIndex ? (uint32_t)idx : (uint32_t)NoIndex;
+  }
+  
+public:
+  CompiledPointer() = default;
+  
+  CompiledPointer(const char* pointer, int32_t length = -1)
+  {
+    if (!parse(pointer, length))
+      throw std::invalid_argument("[lfjson] CompiledPointer: invalid JSON pointer syntax");
+  }
+  
+  CompiledPointer(const std::string& pointer) : CompiledPointer(pointer.c_str(), (int32_t)pointer.size()) {}
+  
+  // Parse (returns 'false' on syntax error, leaving pointer empty)
+  bool parse(const char* pointer, int32_t length = -1)
+  {
+    assert(pointer != nullptr);
+    mKeys.clear();
+    mIndices.clear();
+    
+    const size_t len = length >= 0 ? (size_t)length : std::strlen(pointer);
+    if (len == 0u)  // whole document
+      return true;
+    if (pointer[0] != '/')
+      return false;
+      
+    std::string tok;
+    for (size_t i = 1; i <= len; ++i)
+    {
+      if (i == len || pointer[i] == '/')
+      {
+        mKeys.add(tok);
+        mIndices.push_back(parseIndex(tok));
+        tok.clear();
+        continue;
+      }
+      
+      const char c = pointer[i];
+      if (c == '~')  // escaped
+      {
+        const char e = (i + 1 < len) ? pointer[++i] : '\0';
+        if (e == '0')
+          tok.push_back('~');
+        else if (e == '1')
+          tok.push_back('/');
+        else
+        {
+          mKeys.clear();
+          mIndices.clear();
+          return false;
+        }
+      }
+      else
+        tok.push_back(c);
+    }
+    return true;
+  }
+  
+  // Accessors
+  uint32_t size() const { return (uint32_t)mIndices.size(); }
+  bool empty() const { return mIndices.empty(); }
+  
+  const std::string& key(uint32_t pos) const { return mKeys.str(pos); }
+  uint32_t index(uint32_t pos) const { assert(pos < size()); return mIndices[pos]; }
+  bool isIndex(uint32_t pos) const { return index(pos) != (uint32_t)NoIndex; }
+  
+  // Resolve once for a given pool (optional, done lazily by find)
+  void bind(const SharedStringPool& pool) { mKeys.resolve(pool); }
+  
+  const JString* handle(uint32_t pos) const { return mKeys.handle(pos); }
+  
+  // Evaluate from root, with keys interned in 'pool'
+  // Elements of specialized arrays are not ConstValue: if the last token indexes one,
+  // returns the array and sets 'elementIndex' (or nullptr if not provided)
+  const ConstValue* find(const ConstValue& root, const SharedStringPool& pool, uint32_t* elementIndex = nullptr)
+  {
+    assert(pool);
+    if (!mIndices.empty())
+      mKeys.resolve(pool);
+      
+    return walk(root, elementIndex, [this](const ConstValue& value, uint32_t pos) -> const ConstValue* {
+      const JString* jKey = mKeys.handle(pos);
+      return jKey != nullptr ? Keys::findMember(value, jKey) : nullptr;
+    });
+  }
+  
+  // Evaluate from root comparing key text: no pool access, safe on a tree shared with a writer
+  const ConstValue* findText(const ConstValue& root, uint32_t* elementIndex = nullptr) const
+  {
+    return walk(root, elementIndex, [this](const ConstValue& value, uint32_t pos) -> const ConstValue* {
+      const std::string& str = mKeys.str(pos);
+      return Keys::findMember(value, str.c_str(), (uint32_t)str.size());
+    });
+  }
+  
+  template <uint16_t ObjectChunkSize>
+  const ConstValue* find(const Document<StringChunkSize, Allocator, ObjectChunkSize>& doc, uint32_t* elementIndex = nullptr)
+  {
+    return find(doc.croot(), doc.stringPool(), elementIndex);
+  }
+};
+
+// Helper aliases
+using DynamicPointer = CompiledPointer<>;
+
+} // namespace lfjson
+
+#endif // LFJSON_POINTER_H
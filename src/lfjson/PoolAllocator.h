@@ -8,6 +8,7 @@
 
 #include "BaseData.h"
 
+#include <cstddef>
 #include <cstdint>
 #include <cmath>
 #include <cstring>
@@ -30,6 +31,57 @@
 
 namespace lfjson
 {
+//
+// Byte budget of a Document: memory taken from the base allocator (chunks, chunk vectors, fallbacks)
+// Allocations are counted, never refused: callers check 'allows' before growing and 'exceeded' after
+struct MemoryBudget {
+  static constexpr size_t Unlimited = std::numeric_limits<size_t>::max();
+  
+  size_t limit = Unlimited;
+  size_t used  = 0u;
+  
+  bool limited()  const { return limit != Unlimited; }
+  bool exceeded() const { return used > limit; }
+  bool allows(size_t extra) const { return used <= limit && extra <= limit - used; }
+};
+
+//
+// Origin of a request to the base allocator (see ProfilingAllocator)
+// Allocators providing 'allocate(size, AllocOrigin)' receive it, others are called with the size only
+enum class AllocOrigin : uint8_t {
+  USER            = 0,  // untagged (e.g. containers on Document::baseAllocator)
+  STRING_CHUNK    = 1,
+  STRING_BUCKETS  = 2,  // StringPool bucket array beyond a chunk
+  STRING_FALLBACK = 3,  // strings beyond a chunk
+  OBJECT_CHUNK    = 4,
+  OBJECT_FALLBACK = 5,  // JBig* containers beyond a chunk
+  CHUNK_TABLE     = 6,  // chunk vectors of pools
+  STACK           = 7,  // Handler stack growth
+  COUNT           = 8
+};
+
+namespace helper
+{
+  template <class Allocator>
+  auto allocateTagged(Allocator& allocator, size_t size, AllocOrigin origin, int)
+    -> decltype(allocator.allocate(size, origin))
+  {
+    return allocator.allocate(size, origin);
+  }
+  
+  template <class Allocator>
+  char* allocateTagged(Allocator& allocator, size_t size, AllocOrigin, long)
+  {
+    return allocator.allocate(size);
+  }
+  
+  template <class Allocator>
+  char* allocateFrom(Allocator& allocator, size_t size, AllocOrigin origin)
+  {
+    return allocateTagged(allocator, size, origin, 0);
+  }
+} // namespace helper
+
 //
 // Slab allocator, with dead-cells management
 // When using PoolPtr for StringPool (on 64-bits), enforces an alternate allocation scheme
@@ -114,6 +166,28 @@ private:
   
   typedef typename std::conditional<ownAllocator, Allocator, Allocator&>::type BaseAllocator;
   BaseAllocator mAllocator;
+  size_t mFootprint         = 0;  // bytes taken from mAllocator
+  MemoryBudget* mBudget     = nullptr;
+  
+  char* allocateBase(size_t size, AllocOrigin origin)
+  {
+    mFootprint += size;
+    if (mBudget != nullptr)
+      mBudget->used += size;
+    return helper::allocateFrom(mAllocator, size, origin);
+  }
+  
+  static AllocOrigin chunkOrigin()    { return altScheme ? AllocOrigin::STRING_CHUNK : AllocOrigin::OBJECT_CHUNK; }
+  static AllocOrigin fallbackOrigin() { return altScheme ? AllocOrigin::STRING_FALLBACK : AllocOrigin::OBJECT_FALLBACK; }
+  
+  void deallocateBase(char* ptr, size_t size)
+  {
+    assert(mFootprint >= size);
+    mFootprint -= size;
+    if (mBudget != nullptr)
+      mBudget->used -= size;
+    mAllocator.deallocate(ptr, size);
+  }
   
 public:
   PoolAllocator() = default;  // for owned allocator
@@ -129,6 +203,10 @@ public:
   // Accessors
   uint32_t chunksCount() const { return mChunksCount; }
   
+  size_t footprint() const { return mFootprint; }
+  
+  MemoryBudget* budget() const { return mBudget; }
+  
   uint32_t chunksCapacity() const { return mChunksCapacity; }
   
   uint32_t countFallbacks() const
@@ -248,7 +326,8 @@ public:
   Allocator& allocator() { return mAllocator; }
   const Allocator& callocator() const { return mAllocator; }
   
-  void* allocate(uint32_t size)
+  // 'origin' of a fallback (beyond a chunk) for profiling
+  void* allocate(uint32_t size, AllocOrigin origin = fallbackOrigin())
   {
   #ifdef LFJ_64BIT
     assert(!altScheme);
@@ -262,11 +341,11 @@ public:
       // Check empty
       if (mChunksCapacity == 0)
       {
-        mChunks = (Chunk*)mAllocator.allocate(sizeof(Chunk));
+        mChunks = (Chunk*)allocateBase(sizeof(Chunk), AllocOrigin::CHUNK_TABLE);
         assert(mChunks != nullptr);
         mChunksCapacity = 1;
         
-        new (&mChunks[0]) Chunk(mAllocator.allocate(ChunkSize));
+        new (&mChunks[0]) Chunk(allocateBase(ChunkSize, chunkOrigin()));
         mChunksCount = 1;
         mLastChunk = 0;
       }
@@ -343,16 +422,16 @@ public:
         assert(mChunksCapacity < std::numeric_limits<uint32_t>::max() / ChunkVectorGrowthFactor);
         uint32_t newCapacity = (uint32_t)std::ceil(mChunksCapacity * ChunkVectorGrowthFactor);
         
-        Chunk* newChunks = (Chunk*)mAllocator.allocate(sizeof(Chunk) * newCapacity);
+        Chunk* newChunks = (Chunk*)allocateBase(sizeof(Chunk) * newCapacity, AllocOrigin::CHUNK_TABLE);
         assert(newChunks != nullptr);
         memcpy(newChunks, mChunks, mChunksCount * sizeof(Chunk));
         
-        mAllocator.deallocate((char*)mChunks, mChunksCapacity * sizeof(Chunk));
+        deallocateBase((char*)mChunks, mChunksCapacity * sizeof(Chunk));
         mChunks = newChunks;
         mChunksCapacity = newCapacity;
       }
       // Construct and sort by data address
-      new (&mChunks[mChunksCount]) Chunk(mAllocator.allocate(ChunkSize));
+      new (&mChunks[mChunksCount]) Chunk(allocateBase(ChunkSize, chunkOrigin()));
       mLastChunk = sortNewChunk();
       ++mChunksCount;
       
@@ -363,7 +442,7 @@ public:
     }
     
     // Fallback
-    void* raw = mAllocator.allocate(sizeof(Fallback) - 1 + size);
+    void* raw = allocateBase(sizeof(Fallback) - 1 + size, origin);
     assert(raw != nullptr);
     Fallback* fallback = new (raw) Fallback(mFallbacks, size);
     mFallbacks = fallback;
@@ -444,7 +523,7 @@ public:
       {
         assert(fallback->size == size);
         mFallbacks = fallback->next;
-        mAllocator.deallocate((char*)fallback, sizeof(Fallback) - 1 + fallback->size);
+        deallocateBase((char*)fallback, sizeof(Fallback) - 1 + fallback->size);
       }
       else
       {
@@ -455,7 +534,7 @@ public:
             Fallback* found = fallback->next;
             assert(found->size == size);
             fallback->next = fallback->next->next;
-            mAllocator.deallocate((char*)found, sizeof(Fallback) - 1 + found->size);
+            deallocateBase((char*)found, sizeof(Fallback) - 1 + found->size);
             return;
           }
           fallback = fallback->next;
@@ -466,11 +545,46 @@ public:
       LFJ_POOLALLOCATOR_SANITY_CHECK
     }
   }
-  
+
+  // Relink a fallback block (i.e. not chunkable) to 'other', both must use the same base allocator
+  // Returns false if 'ptr' is in a chunk (can't be transferred, must be copied)
+  bool transferFallback(void* ptr, uint32_t size, PoolAllocator& other)
+  {
+    assert(!altScheme);
+    assert(&mAllocator == &other.mAllocator || std::is_empty<Allocator>::value);
+    if (ptr == nullptr || chunkable(alignSize(size)))
+      return false;
+
+    Fallback** link = &mFallbacks;
+    while (*link != nullptr && (*link)->data != (unsigned char*)ptr)
+      link = &(*link)->next;
+    if (*link == nullptr)
+    {
+      assert(false && "[lfjson] PoolAllocator: pointer to transfer doesn't belong");
+      return false;
+    }
+    Fallback* fallback = *link;
+    assert(fallback->size == size);
+    *link = fallback->next;
+
+    fallback->next = other.mFallbacks;
+    other.mFallbacks = fallback;
+    
+    const size_t rawSize = sizeof(Fallback) - 1 + size;
+    mFootprint -= rawSize;
+    other.mFootprint += rawSize;
+    if (mBudget != nullptr)
+      mBudget->used -= rawSize;
+    if (other.mBudget != nullptr)
+      other.mBudget->used += rawSize;
+    LFJ_POOLALLOCATOR_SANITY_CHECK
+    return true;
+  }
+
 #ifdef LFJ_64BIT
   // Alternative allocation scheme (keep chunk/fallback indexes stable)
   // /!\ Do not mix schemes (nominal for objects, alt for strings)
-  PoolPtr allocateAlt(uint32_t size)
+  PoolPtr allocateAlt(uint32_t size, AllocOrigin origin = fallbackOrigin())
   {
     assert(altScheme);
     uint32_t alignedSize = alignSize(size);
@@ -482,11 +596,11 @@ public:
       // Check empty
       if (mChunksCapacity == 0)
       {
-        mChunks = (Chunk*)mAllocator.allocate(sizeof(Chunk));
+        mChunks = (Chunk*)allocateBase(sizeof(Chunk), AllocOrigin::CHUNK_TABLE);
         assert(mChunks != nullptr);
         mChunksCapacity = 1;
         
-        new (&mChunks[0]) Chunk(mAllocator.allocate(ChunkSize));
+        new (&mChunks[0]) Chunk(allocateBase(ChunkSize, chunkOrigin()));
         mChunksCount = 1;
         mLastChunk = 0;
       }
@@ -575,16 +689,16 @@ public:
         assert(mChunksCapacity < std::numeric_limits<uint32_t>::max() / ChunkVectorGrowthFactor);
         uint32_t newCapacity = (uint32_t)std::ceil(mChunksCapacity * ChunkVectorGrowthFactor);
         
-        Chunk* newChunks = (Chunk*)mAllocator.allocate(sizeof(Chunk) * newCapacity);
+        Chunk* newChunks = (Chunk*)allocateBase(sizeof(Chunk) * newCapacity, AllocOrigin::CHUNK_TABLE);
         assert(newChunks != nullptr);
         memcpy(newChunks, mChunks, mChunksCount * sizeof(Chunk));
         
-        mAllocator.deallocate((char*)mChunks, mChunksCapacity * sizeof(Chunk));
+        deallocateBase((char*)mChunks, mChunksCapacity * sizeof(Chunk));
         mChunks = newChunks;
         mChunksCapacity = newCapacity;
       }
       // Construct
-      new (&mChunks[mChunksCount]) Chunk(mAllocator.allocate(ChunkSize));
+      new (&mChunks[mChunksCount]) Chunk(allocateBase(ChunkSize, chunkOrigin()));
       mLastChunk = mChunksCount;
       ++mChunksCount;
       
@@ -595,7 +709,7 @@ public:
     }
     
     // Fallback
-    void* raw = mAllocator.allocate(sizeof(Fallback) - 1 + size);
+    void* raw = allocateBase(sizeof(Fallback) - 1 + size, origin);
     assert(raw != nullptr);
     Fallback* fallback = new (raw) Fallback(mFallbacks, size);
     mFallbacks = fallback;
@@ -663,10 +777,10 @@ public:
       if (pos == 0)
       {
         assert(mFallbacks->size == size);
-        void* raw = mAllocator.allocate(sizeof(Fallback));
+        void* raw = allocateBase(sizeof(Fallback), fallbackOrigin());
         assert(raw != nullptr);
         Fallback* fallback = new (raw) Fallback(mFallbacks->next, 1);  // replace by empty
-        mAllocator.deallocate((char*)mFallbacks, sizeof(Fallback) - 1 + mFallbacks->size);
+        deallocateBase((char*)mFallbacks, sizeof(Fallback) - 1 + mFallbacks->size);
         mFallbacks = fallback;
       }
       else
@@ -681,18 +795,18 @@ public:
         }
         // Replace by empty
         assert(it->size == size);
-        void* raw = mAllocator.allocate(sizeof(Fallback));
+        void* raw = allocateBase(sizeof(Fallback), fallbackOrigin());
         assert(raw != nullptr);
         Fallback* fallback = new (raw) Fallback(it->next, 1);  // replace by empty
         prevIt->next = fallback;
-        mAllocator.deallocate((char*)it, sizeof(Fallback) - 1 + it->size);
+        deallocateBase((char*)it, sizeof(Fallback) - 1 + it->size);
       }
       LFJ_POOLALLOCATOR_SANITY_CHECK
     }
   }
 #else
   // Redirect to nominal functions
-  PoolPtr allocateAlt(uint32_t size) { return (PoolPtr)allocate(size); }
+  PoolPtr allocateAlt(uint32_t size, AllocOrigin origin = fallbackOrigin()) { return (PoolPtr)allocate(size, origin); }
   void deallocateAlt(PoolPtr sp, uint32_t size) { deallocate(sp, size); }
 #endif // LFJ_64BIT
   
@@ -848,11 +962,21 @@ public:
   }
   
   // Modifiers
+  // Current and future footprint counted in 'budget' (nullptr: none)
+  void setBudget(MemoryBudget* budget)
+  {
+    if (mBudget != nullptr)
+      mBudget->used -= mFootprint;
+    mBudget = budget;
+    if (mBudget != nullptr)
+      mBudget->used += mFootprint;
+  }
+  
   void releaseAll()
   {
     for (uint32_t i = 0; i < mChunksCount; ++i)
-      mAllocator.deallocate((char*)mChunks[i].data, ChunkSize);
-    mAllocator.deallocate((char*)mChunks, mChunksCapacity * sizeof(Chunk));
+      deallocateBase((char*)mChunks[i].data, ChunkSize);
+    deallocateBase((char*)mChunks, mChunksCapacity * sizeof(Chunk));
     
     mLastChunk      = 0;
     mTotalDead      = 0;
@@ -864,7 +988,7 @@ public:
     while (it != nullptr)
     {
       Fallback* itNext = it->next;
-      mAllocator.deallocate((char*)it, sizeof(Fallback) - 1 + it->size);
+      deallocateBase((char*)it, sizeof(Fallback) - 1 + it->size);
       it = itNext;
     }
     mFallbacks = nullptr;
@@ -884,7 +1008,7 @@ public:
     while (it != nullptr)
     {
       Fallback* itNext = it->next;
-      mAllocator.deallocate((char*)it, sizeof(Fallback) - 1 + it->size);
+      deallocateBase((char*)it, sizeof(Fallback) - 1 + it->size);
       it = itNext;
     }
     mFallbacks = nullptr;
@@ -895,37 +1019,25 @@ public:
   #ifdef LFJ_64BIT
     assert(!altScheme);
   #endif
-    uint32_t newSize = mChunksCount;
-    for (uint32_t i = 0; i < mChunksCount; ++i)
+    uint32_t newSize = 0;
+    uint32_t newLastChunk = 0;
+    for (uint32_t i = 0; i < mChunksCount; ++i)  // compact in place (keeps address order)
     {
       if (mChunks[i].firstAvail == 0)
+        deallocateBase((char*)mChunks[i].data, ChunkSize);
+      else
       {
-        mAllocator.deallocate((char*)mChunks[i].data, ChunkSize);
-        --newSize;
-      }
-    }
-    if (newSize > 0)
-    {
-      for (uint32_t i = 0; i < mChunksCount;)
-      {
-        int j = 1;
-        if (mChunks[i].firstAvail == 0)
-        {
-          while (i + j < mChunksCount && mChunks[i + j].firstAvail == 0)
-            ++j;
-          if (i + j == mChunksCount)
-            break;
-          
-          std::memmove((void*)(&mChunks[i]), (void*)(&mChunks[i + j]), (mChunksCount - i - j) * sizeof(Chunk));
-          i += j;
-        }
-        else
-          ++i;
+        if (newSize != i)
+          std::memcpy((void*)(&mChunks[newSize]), (void*)(&mChunks[i]), sizeof(Chunk));
+        if (i == mLastChunk)
+          newLastChunk = newSize;
+        ++newSize;
       }
     }
-    else
+    mLastChunk = newLastChunk;  // index must stay valid
+    if (newSize == 0)
     {
-      mAllocator.deallocate((char*)mChunks, mChunksCapacity * sizeof(Chunk));
+      deallocateBase((char*)mChunks, mChunksCapacity * sizeof(Chunk));
       mChunksCapacity = 0;
       mChunks = nullptr;
     }
@@ -946,9 +1058,9 @@ public:
     }
     
     for (uint32_t i = 0; i < mChunksCount; ++i)
-      mAllocator.deallocate((char*)mChunks[i].data, ChunkSize);
+      deallocateBase((char*)mChunks[i].data, ChunkSize);
     
-    mAllocator.deallocate((char*)mChunks, mChunksCapacity * sizeof(Chunk));
+    deallocateBase((char*)mChunks, mChunksCapacity * sizeof(Chunk));
     mChunksCount = 0;
     mChunksCapacity = 0;
     mChunks = nullptr;
@@ -0,0 +1,143 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+#ifndef LFJSON_PROFILINGALLOCATOR_H
+#define LFJSON_PROFILINGALLOCATOR_H
+
+#include "PoolAllocator.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+#include <memory>
+#include <unordered_map>
+
+namespace lfjson
+{
+//
+// Heap allocator attributing each request to its origin (see AllocOrigin): bytes in use, peaks, size histograms
+// Pool layers tag their requests, untagged ones count as USER
+// Stats are per instance: a Document's base allocator is owned by its StringPool (see Document::baseAllocator)
+class ProfilingAllocator
+{
+public:
+  using value_type = char;
+  
+  enum {
+    OriginCount = (int)AllocOrigin::COUNT,
+    SizeClasses = 32  // floor(log2(size)), last one for larger
+  };
+  
+  struct OriginStats {
+    uint64_t allocated = 0u;  // in use
+    uint64_t peak      = 0u;  // in use, max
+    uint64_t atPeak    = 0u;  // in use when the total peaked
+    uint64_t total     = 0u;  // cumulated
+    uint64_t count     = 0u;  // requests
+    uint64_t sizes[SizeClasses] = {};  // requests by size class
+  };
+  
+private:
+  std::allocator<value_type> mAllocator;
+  std::unordered_map<const char*, AllocOrigin> mOrigins;  // live blocks
+  OriginStats mStats[OriginCount];
+  uint64_t mAllocated = 0u;
+  uint64_t mPeak      = 0u;
+  
+public:
+  static const char* name(AllocOrigin origin)
+  {
+    switch (origin)
+    {
+      case AllocOrigin::USER:             return "user";
+      case AllocOrigin::STRING_CHUNK:     return "string_chunk";
+      case AllocOrigin::STRING_BUCKETS:   return "string_buckets";
+      case AllocOrigin::STRING_FALLBACK:  return "string_fallback";
+      case AllocOrigin::OBJECT_CHUNK:     return "object_chunk";
+      case AllocOrigin::OBJECT_FALLBACK:  return "object_fallback";
+      case AllocOrigin::CHUNK_TABLE:      return "chunk_table";
+      case AllocOrigin::STACK:            return "stack";
+      default:                            return "unknown";
+    }
+  }
+  
+  static uint32_t sizeClass(std::size_t size)
+  {
+    uint32_t sizeClass = 0u;
+    while (size > 1u && sizeClass < SizeClasses - 1u)
+    {
+      size >>= 1u;
+      ++sizeClass;
+    }
+    return sizeClass;
+  }
+  
+  // Accessors
+  const OriginStats& stats(AllocOrigin origin) const
+  {
+    assert(origin < AllocOrigin::COUNT);
+    return mStats[(int)origin];
+  }
+  
+  uint64_t allocated() const { return mAllocated; }
+  uint64_t peak() const { return mPeak; }
+  
+  // Allocator
+  char* allocate(std::size_t size, AllocOrigin origin = AllocOrigin::USER)
+  {
+    assert(origin < AllocOrigin::COUNT);
+    char* mem = mAllocator.allocate(size);
+    mOrigins[mem] = origin;
+    
+    OriginStats& stats = mStats[(int)origin];
+    stats.allocated += size;
+    stats.total     += size;
+    ++stats.count;
+    ++stats.sizes[sizeClass(size)];
+    stats.peak = stats.peak < stats.allocated ? stats.allocated : stats.peak;
+    
+    mAllocated += size;
+    if (mAllocated > mPeak)
+    {
+      mPeak = mAllocated;
+      for (OriginStats& it : mStats)
+        it.atPeak = it.allocated;
+    }
+    return mem;
+  }
+  
+  void deallocate(char* ptr, std::size_t size)
+  {
+    mAllocator.deallocate(ptr, size);
+    if (ptr == nullptr)
+      return;
+      
+    auto it = mOrigins.find(ptr);
+    assert(it != mOrigins.end() && "[lfjson] ProfilingAllocator: pointer to deallocate doesn't belong");
+    OriginStats& stats = mStats[(int)it->second];
+    mOrigins.erase(it);
+    assert(stats.allocated >= size && mAllocated >= size);
+    stats.allocated -= size;
+    mAllocated      -= size;
+  }
+  
+  // Restart peaks and cumulated counts from the memory in use (e.g. between phases)
+  void resetStats()
+  {
+    mPeak = mAllocated;
+    for (OriginStats& stats : mStats)
+    {
+      const uint64_t allocated = stats.allocated;
+      stats = OriginStats();
+      stats.allocated = allocated;
+      stats.peak      = allocated;
+      stats.atPeak    = allocated;
+    }
+  }
+};
+
+} // namespace lfjson
+
+#endif // LFJSON_PROFILINGALLOCATOR_H
@@ -0,0 +1,405 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+#ifndef LFJSON_PROJECTION_H
+#define LFJSON_PROJECTION_H
+
+#include "BaseData.h"
+#include "Pointer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace lfjson
+{
+//
+// Set of JSON Pointers (RFC 6901) selecting the paths to materialize, as a prefix tree of tokens
+// A '*' token matches any member or element, a selected path includes its whole subtree
+class Projection
+{
+public:
+  enum { NoNode = std::numeric_limits<uint32_t>::max() };
+  
+private:
+  struct Child {
+    std::string key;
+    uint32_t    index;  // CompiledPointer::NoIndex if not an array index
+    uint32_t    node;
+  };
+  
+  struct Node {
+    std::vector<Child> children;
+    uint32_t any      = NoNode;  // '*' child
+    bool     selected = false;
+  };
+  
+  std::vector<Node> mNodes;  // [0] is root
+  
+  uint32_t newNode()
+  {
+    mNodes.push_back(Node());
+    return (uint32_t)mNodes.size() - 1u;
+  }
+  
+public:
+  Projection() : mNodes(1u) {}
+  
+  Projection(std::initializer_list<std::string> pointers) : Projection()
+  {
+    for (const auto& pointer : pointers)
+    {
+      if (!add(pointer))
+        throw std::invalid_argument("[lfjson] Projection: invalid JSON pointer syntax");
+    }
+  }
+  
+  // Add a path (returns 'false' on syntax error, projection unchanged)
+  bool add(const char* pointer, int32_t length = -1)
+  {
+    DynamicPointer parsed;
+    if (!parsed.parse(pointer, length))
+      return false;
+      
+    uint32_t node = 0u;
+    for (uint32_t i = 0u; i < parsed.size(); ++i)
+    {
+      if (mNodes[node].selected)  // covered by a shorter path
+        return true;
+        
+      const std::string& tok = parsed.key(i);
+      uint32_t child = NoNode;
+      if (tok == "*")
+      {
+        child = mNodes[node].any;
+        if (child == NoNode)
+        {
+          child = newNode();
+          mNodes[node].any = child;
+        }
+      }
+      else
+      {
+        for (const Child& c : mNodes[node].children)
+        {
+          if (c.key == tok)
+          {
+            child = c.node;
+            break;
+          }
+        }
+        if (child == NoNode)
+        {
+          child = newNode();
+          mNodes[node].children.push_back(Child{ tok, parsed.index(i), child });
+        }
+      }
+      node = child;
+    }
+    
+    // Whole subtree selected, deeper paths are redundant
+    mNodes[node].selected = true;
+    mNodes[node].children.clear();
+    mNodes[node].any = NoNode;
+    return true;
+  }
+  
+  bool add(const std::string& pointer) { return add(pointer.c_str(), (int32_t)pointer.size()); }
+  
+  void clear()
+  {
+    mNodes.assign(1u, Node());
+  }
+  
+  // Navigation (NoNode if the value is not on a selected path)
+  uint32_t root() const { return 0u; }
+  
+  bool selected(uint32_t node) const { assert(node < mNodes.size()); return mNodes[node].selected; }
+  
+  uint32_t member(uint32_t node, const char* key, uint32_t len) const
+  {
+    assert(node < mNodes.size());
+    const Node& n = mNodes[node];
+    for (const Child& c : n.children)
+    {
+      if (c.key.size() == len && std::memcmp(c.key.data(), key, len) == 0)
+        return c.node;
+    }
+    return n.any;
+  }
+  
+  uint32_t element(uint32_t node, uint32_t index) const
+  {
+    assert(node < mNodes.size());
+    const Node& n = mNodes[node];
+    for (const Child& c : n.children)
+    {
+      if (c.index == index)
+        return c.node;
+    }
+    return n.any;
+  }
+  
+  // Same node for every element ('*' only)
+  bool uniform(uint32_t node) const { assert(node < mNodes.size()); return mNodes[node].children.empty(); }
+  
+  uint32_t any(uint32_t node) const { assert(node < mNodes.size()); return mNodes[node].any; }
+};
+
+//
+// Forwards to 'HandlerT' (e.g. Document::Handler) only the events of projected paths
+// Other subtrees are skipped structurally: no value built, no key or string interned
+// Keys are matched by text, containers on a path are forwarded lazily (once something below is selected),
+// so the result holds only existing projected paths; arrays keep their selected elements, in order
+// Root container is always forwarded
+template <class HandlerT>
+class ProjectionHandler
+{
+private:
+  struct Frame {
+    uint32_t    node;
+    uint32_t    count;  // members or elements forwarded
+    uint32_t    index;  // next element position (arrays)
+    bool        array;
+    std::string key;    // member key in parent, forwarded on open
+  };
+  
+  HandlerT& mHandler;
+  const Projection& mProjection;
+  std::vector<Frame> mFrames;     // containers on selected paths (strings reused)
+  uint32_t mDepth     = 0u;       // active frames
+  uint32_t mOpened    = 0u;       // frames forwarded (a prefix of active ones)
+  uint32_t mSkipDepth = 0u;       // inside a skipped subtree
+  uint32_t mFullDepth = 0u;       // inside a selected subtree (forwarded as is)
+  uint32_t mKeyNode   = (uint32_t)Projection::NoNode;
+  std::string mKey;               // pending member key
+  bool mDone = false;
+  
+  // Node of the next value
+  uint32_t next()
+  {
+    if (mDepth == 0u)
+      return mProjection.root();
+    Frame& frame = mFrames[mDepth - 1u];
+    if (frame.array)
+      return mProjection.element(frame.node, frame.index++);
+    return mKeyNode;
+  }
+  
+  // Forward pending containers
+  bool openFrames()
+  {
+    for (; mOpened < mDepth; ++mOpened)
+    {
+      Frame& frame = mFrames[mOpened];
+      if (mOpened > 0u)
+      {
+        Frame& parent = mFrames[mOpened - 1u];
+        ++parent.count;
+        if (!parent.array && !mHandler.pushKey(frame.key.c_str(), true, (int32_t)frame.key.size()))
+          return false;
+      }
+      if (!(frame.array ? mHandler.startArray() : mHandler.startObject()))
+        return false;
+    }
+    return true;
+  }
+  
+  // Forward pending containers, then the key of the next value
+  bool open()
+  {
+    if (!openFrames())
+      return false;
+    if (mDepth == 0u)
+      return true;
+    Frame& top = mFrames[mDepth - 1u];
+    ++top.count;
+    return top.array || mHandler.pushKey(mKey.c_str(), true, (int32_t)mKey.size());
+  }
+  
+  template <class Func>
+  bool scalar(Func push)
+  {
+    if (mFullDepth > 0u)
+      return push();
+    if (mSkipDepth > 0u)
+      return true;
+    const uint32_t node = next();
+    mDone = mDepth == 0u;
+    if (node == Projection::NoNode || !mProjection.selected(node))  // path continues below a scalar
+      return true;
+    return open() && push();
+  }
+  
+  bool start(bool array)
+  {
+    if (mFullDepth > 0u)
+    {
+      ++mFullDepth;
+      return array ? mHandler.startArray() : mHandler.startObject();
+    }
+    if (mSkipDepth > 0u)
+    {
+      ++mSkipDepth;
+      return true;
+    }
+    const uint32_t node = next();
+    if (node == Projection::NoNode)
+    {
+      mSkipDepth = 1u;
+      return true;
+    }
+    if (mProjection.selected(node))
+    {
+      mFullDepth = 1u;
+      return open() && (array ? mHandler.startArray() : mHandler.startObject());
+    }
+    
+    if (mDepth == mFrames.size())
+      mFrames.emplace_back();
+    Frame& frame = mFrames[mDepth];
+    frame.node  = node;
+    frame.count = 0u;
+    frame.index = 0u;
+    frame.array = array;
+    if (mDepth > 0u && !mFrames[mDepth - 1u].array)
+      frame.key.assign(mKey);
+    ++mDepth;
+    return mDepth > 1u || openFrames();  // root forwarded
+  }
+  
+  bool end(bool array, uint32_t count)
+  {
+    if (mFullDepth > 0u)
+    {
+      --mFullDepth;
+      mDone = mFullDepth == 0u && mDepth == 0u;
+      return array ? mHandler.endArray(count) : mHandler.endObject(count);
+    }
+    if (mSkipDepth > 0u)
+    {
+      --mSkipDepth;
+      return true;
+    }
+    assert(mDepth > 0u && mFrames[mDepth - 1u].array == array);
+    --mDepth;
+    mDone = mDepth == 0u;
+    if (mOpened <= mDepth)  // nothing selected below
+      return true;
+    mOpened = mDepth;
+    const Frame& frame = mFrames[mDepth];
+    return array ? mHandler.endArray(frame.count) : mHandler.endObject(frame.count);
+  }
+  
+  template <class V>
+  bool batch(const V* values, uint32_t count, bool (HandlerT::*pushArray)(const V*, uint32_t),
+             bool (ProjectionHandler::*push)(V))
+  {
+    if (mFullDepth > 0u)
+      return (mHandler.*pushArray)(values, count);
+    if (mSkipDepth > 0u || count == 0u)
+      return true;
+    assert(mDepth > 0u && mFrames[mDepth - 1u].array);
+    Frame& frame = mFrames[mDepth - 1u];
+    if (mProjection.uniform(frame.node))
+    {
+      const uint32_t any = mProjection.any(frame.node);
+      if (any == Projection::NoNode || !mProjection.selected(any))
+      {
+        frame.index += count;
+        return true;
+      }
+      if (!open())  // counts the first element
+        return false;
+      frame.index += count;
+      frame.count += count - 1u;
+      return (mHandler.*pushArray)(values, count);
+    }
+    for (uint32_t i = 0u; i < count; ++i)
+    {
+      if (!(this->*push)(values[i]))
+        return false;
+    }
+    return true;
+  }
+  
+public:
+  ProjectionHandler(HandlerT& handler, const Projection& projection)
+    : mHandler(handler)
+    , mProjection(projection)
+  {
+    mFrames.reserve(8u);
+  }
+  
+  // Accessors
+  bool done() const { return mDone; }
+  HandlerT& handler() const { return mHandler; }
+  
+  // Group
+  bool startObject() { return start(false); }
+  bool endObject(uint32_t memberCount) { return end(false, memberCount); }
+  bool startArray() { return start(true); }
+  bool endArray(uint32_t elementCount) { return end(true, elementCount); }
+  
+  // Scalar
+  bool pushKey(const char* str, bool copy, int32_t length = -1)
+  {
+    if (mFullDepth > 0u)
+      return mHandler.pushKey(str, copy, length);
+    if (mSkipDepth > 0u)
+      return true;
+    assert(mDepth > 0u && !mFrames[mDepth - 1u].array);
+    const uint32_t len = length < 0 ? (uint32_t)std::strlen(str) : (uint32_t)length;
+    mKeyNode = mProjection.member(mFrames[mDepth - 1u].node, str, len);
+    if (mKeyNode != Projection::NoNode)
+      mKey.assign(str, len);
+    return true;
+  }
+  
+  bool pushNull()               { return scalar([this]() { return mHandler.pushNull(); }); }
+  bool pushBool(bool b)         { return scalar([this, b]() { return mHandler.pushBool(b); }); }
+  bool pushInt(int i)           { return scalar([this, i]() { return mHandler.pushInt(i); }); }
+  bool pushUInt(unsigned u)     { return scalar([this, u]() { return mHandler.pushUInt(u); }); }
+  bool pushInt64(int64_t i64)   { return scalar([this, i64]() { return mHandler.pushInt64(i64); }); }
+  bool pushUInt64(uint64_t u64) { return scalar([this, u64]() { return mHandler.pushUInt64(u64); }); }
+  bool pushDouble(double d)     { return scalar([this, d]() { return mHandler.pushDouble(d); }); }
+  
+  bool pushString(const char* str, bool copy, int32_t length = -1)
+  {
+    return scalar([this, str, copy, length]() { return mHandler.pushString(str, copy, length); });
+  }
+  
+  // Batch (array elements only)
+  bool pushBoolArray(const bool* values, uint32_t count)
+  {
+    return batch(values, count, &HandlerT::pushBoolArray, &ProjectionHandler::pushBool);
+  }
+  
+  bool pushInt64Array(const int64_t* values, uint32_t count)
+  {
+    return batch(values, count, &HandlerT::pushInt64Array, &ProjectionHandler::pushInt64);
+  }
+  
+  bool pushDoubleArray(const double* values, uint32_t count)
+  {
+    return batch(values, count, &HandlerT::pushDoubleArray, &ProjectionHandler::pushDouble);
+  }
+};
+
+template <class HandlerT>
+ProjectionHandler<HandlerT> makeProjectionHandler(HandlerT& handler, const Projection& projection)
+{
+  return ProjectionHandler<HandlerT>(handler, projection);
+}
+
+} // namespace lfjson
+
+#endif // LFJSON_PROJECTION_H
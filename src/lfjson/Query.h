@@ -0,0 +1,785 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+#ifndef LFJSON_QUERY_H
+#define LFJSON_QUERY_H
+
+#include "BaseData.h"
+#include "Document.h"
+#include "Pointer.h"
+#include "Aggregate.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+#include <cerrno>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace lfjson
+{
+//
+// JSONPath query (subset), parsed once and evaluated over ConstValue
+// Supported: '$', '.name', '['name']', '[n]' (negative from end), '[*]' / '.*',
+// '..' (recursive descent), '[start:end:step]' and filters '[?(@.a.b op literal)]' / '[?(@ op literal)]'
+// with op in == != < <= > >= (or none for existence) and literal number, 'string', true, false or null
+// Names and string literals are cached as JString handles (see PoolKeys)
+// Numeric filters over IARRAY/DARRAY are block scans returning index sets (see Aggregate.h)
+template <uint16_t StringChunkSize = LFJ_DOCUMENT_DFLT_CHUNKSIZE,
+          class Allocator = StdAllocator>
+class CompiledQuery
+{
+public:
+  using SharedStringPool = std::shared_ptr<StringPool<StringChunkSize, Allocator>>;
+  
+  enum { NoIndex = std::numeric_limits<uint32_t>::max() };
+  
+  // Query result: a value, or an element of a specialized array (not a ConstValue)
+  struct Match {
+    const ConstValue* value;  // node, or array holding element
+    uint32_t          index;  // element position, NoIndex for nodes
+    
+    bool isElement() const { return index != (uint32_t)NoIndex; }
+  };
+  
+private:
+  using Keys = PoolKeys<StringChunkSize, Allocator>;
+  
+  enum class Selector : uint8_t {
+    NAME      = 0,
+    WILDCARD  = 1,
+    INDEX     = 2,
+    SLICE     = 3,
+    FILTER    = 4
+  };
+  
+  enum class Literal : uint8_t {
+    NUMBER  = 0,
+    STRING  = 1,
+    TRUE    = 2,
+    FALSE   = 3,
+    NUL     = 4
+  };
+  
+  // Three-way comparison result, DIFFERENT for unequal but unordered values
+  enum Order { LESS = -1, EQUAL = 0, GREATER = 1, DIFFERENT = 2 };
+  
+  struct Step {
+    Selector  sel;
+    bool      recursive;
+    // NAME
+    uint32_t  key;
+    // INDEX/SLICE
+    int64_t   start;
+    int64_t   end;
+    int64_t   step;
+    bool      hasStart;
+    bool      hasEnd;
+    // FILTER
+    uint32_t  pathBegin;  // range of keys in mPaths
+    uint32_t  pathEnd;
+    QueryOp   op;
+    Literal   lit;
+    bool      litIsInt;
+    int64_t   litInt;
+    double    litDouble;
+    uint32_t  litKey;     // STRING
+  };
+  
+  Keys mKeys;
+  std::vector<Step> mSteps;
+  std::vector<uint32_t> mPaths;     // filter relative paths (key indices)
+  
+  // Evaluation buffers (reused)
+  std::vector<Match> mNext;
+  std::vector<Match> mNodes;
+  std::vector<uint32_t> mIndices;
+  std::vector<const ConstValue*> mStack;
+  
+  // Parsing
+  static void skipWs(const char*& cur, const char* end)
+  {
+    while (cur < end && (*cur == ' ' || *cur == '\t' || *cur == '\n' || *cur == '\r'))
+      ++cur;
+  }
+  
+  static bool isNameChar(char c)
+  {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+        || c == '_' || c == '-' || (unsigned char)c >= 0x80u;
+  }
+  
+  static bool parseName(const char*& cur, const char* end, std::string& name)
+  {
+    const char* begin = cur;
+    while (cur < end && isNameChar(*cur))
+      ++cur;
+    name.assign(begin, cur);
+    return cur != begin;
+  }
+  
+  static bool parseQuoted(const char*& cur, const char* end, std::string& str)
+  {
+    assert(cur < end && (*cur == '\'' || *cur == '"'));
+    const char quote = *cur++;
+    str.clear();
+    while (cur < end && *cur != quote)
+    {
+      char c = *cur++;
+      if (c == '\\')
+      {
+        if (cur == end)
+          return false;
+        c = *cur++;
+        switch (c)
+        {
+          case '\\':
+          case '/':
+          case '\'':
+          case '"':               break;
+          case 'b':   c = '\b';   break;
+          case 'f':   c = '\f';   break;
+          case 'n':   c = '\n';   break;
+          case 'r':   c = '\r';   break;
+          case 't':   c = '\t';   break;
+          default:
+            return false;
+        }
+      }
+      str.push_back(c);
+    }
+    if (cur == end)
+      return false;
+    ++cur;  // closing quote
+    return true;
+  }
+  
+  static bool parseInt(const char*& cur, const char* end, int64_t& value)
+  {
+    bool neg = false;
+    if (cur < end && *cur == '-')
+    {
+      neg = true;
+      ++cur;
+    }
+    const char* begin = cur;
+    int64_t v = 0;
+    while (cur < end && *cur >= '0' && *cur <= '9')
+    {
+      if (cur - begin >= 18)  // overflow
+        return false;
+      v = v * 10 + (int64_t)(*cur++ - '0');
+    }
+    if (cur == begin)
+    {
+      cur -= neg ? 1 : 0;  // lone '-' left to the caller (syntax error)
+      return false;
+    }
+    value = neg ? -v : v;
+    return true;
+  }
+  
+  bool parseLiteral(const char*& cur, const char* end, Step& step)
+  {
+    if (cur == end)
+      return false;
+      
+    if (*cur == '\'' || *cur == '"')
+    {
+      std::string str;
+      if (!parseQuoted(cur, end, str))
+        return false;
+      step.lit = Literal::STRING;
+      step.litKey = mKeys.add(str);
+      return true;
+    }
+    
+    static const struct { const char* word; size_t len; Literal lit; } words[] = {
+      { "true",   4u, Literal::TRUE  },
+      { "false",  5u, Literal::FALSE },
+      { "null",   4u, Literal::NUL   }
+    };
+    for (const auto& w : words)
+    {
+      if ((size_t)(end - cur) >= w.len && std::memcmp(cur, w.word, w.len) == 0)
+      {
+        cur += w.len;
+        step.lit = w.lit;
+        return true;
+      }
+    }
+    
+    // Number
+    const char* begin = cur;
+    bool isInt = true;
+    while (cur < end && ((*cur >= '0' && *cur <= '9') || *cur == '-' || *cur == '+'
+                          || *cur == '.' || *cur == 'e' || *cur == 'E'))
+    {
+      if (*cur == '.' || *cur == 'e' || *cur == 'E')
+        isInt = false;
+      ++cur;
+    }
+    if (cur == begin)
+      return false;
+      
+    const std::string num(begin, cur);
+    char* numEnd = nullptr;
+    errno = 0;
+    step.lit = Literal::NUMBER;
+    step.litDouble = std::strtod(num.c_str(), &numEnd);
+    if (numEnd != num.c_str() + num.size())
+      return false;
+      
+    step.litIsInt = false;
+    if (isInt)
+    {
+      errno = 0;
+      const long long i = std::strtoll(num.c_str(), &numEnd, 10);
+      if (errno == 0 && numEnd == num.c_str() + num.size())
+      {
+        step.litIsInt = true;
+        step.litInt = (int64_t)i;
+      }
+    }
+    return true;
+  }
+  
+  bool parseFilter(const char*& cur, const char* end, Step& step)
+  {
+    assert(cur < end && *cur == '?');
+    ++cur;
+    skipWs(cur, end);
+    const bool paren = (cur < end && *cur == '(');
+    if (paren)
+    {
+      ++cur;
+      skipWs(cur, end);
+    }
+    if (cur == end || *cur != '@')
+      return false;
+    ++cur;
+    
+    // Relative path
+    step.sel = Selector::FILTER;
+    step.pathBegin = (uint32_t)mPaths.size();
+    std::string name;
+    while (cur < end && (*cur == '.' || *cur == '['))
+    {
+      if (*cur == '.')
+      {
+        ++cur;
+        if (!parseName(cur, end, name))
+          return false;
+      }
+      else
+      {
+        ++cur;
+        skipWs(cur, end);
+        if (cur == end || (*cur != '\'' && *cur != '"') || !parseQuoted(cur, end, name))
+          return false;
+        skipWs(cur, end);
+        if (cur == end || *cur != ']')
+          return false;
+        ++cur;
+      }
+      mPaths.push_back(mKeys.add(name));
+    }
+    step.pathEnd = (uint32_t)mPaths.size();
+    
+    // Operator
+    skipWs(cur, end);
+    step.op = QueryOp::EXISTS;
+    if (end - cur >= 2 && cur[1] == '=')
+    {
+      switch (cur[0])
+      {
+        case '=': step.op = QueryOp::EQ; break;
+        case '!': step.op = QueryOp::NE; break;
+        case '<': step.op = QueryOp::LE; break;
+        case '>': step.op = QueryOp::GE; break;
+        default:
+          return false;
+      }
+      cur += 2;
+    }
+    else if (cur < end && (*cur == '<' || *cur == '>'))
+    {
+      step.op = (*cur == '<') ? QueryOp::LT : QueryOp::GT;
+      ++cur;
+    }
+    
+    if (step.op != QueryOp::EXISTS)
+    {
+      skipWs(cur, end);
+      if (!parseLiteral(cur, end, step))
+        return false;
+      skipWs(cur, end);
+    }
+    
+    if (paren)
+    {
+      if (cur == end || *cur != ')')
+        return false;
+      ++cur;
+    }
+    return true;
+  }
+  
+  bool parseBracket(const char*& cur, const char* end, Step& step)
+  {
+    assert(cur < end && *cur == '[');
+    ++cur;
+    skipWs(cur, end);
+    if (cur == end)
+      return false;
+      
+    if (*cur == '*')
+    {
+      step.sel = Selector::WILDCARD;
+      ++cur;
+    }
+    else if (*cur == '\'' || *cur == '"')
+    {
+      std::string name;
+      if (!parseQuoted(cur, end, name))
+        return false;
+      step.sel = Selector::NAME;
+      step.key = mKeys.add(name);
+    }
+    else if (*cur == '?')
+    {
+      if (!parseFilter(cur, end, step))
+        return false;
+    }
+    else  // index or slice
+    {
+      step.hasStart = parseInt(cur, end, step.start);
+      skipWs(cur, end);
+      if (cur < end && *cur == ':')
+      {
+        step.sel = Selector::SLICE;
+        ++cur;
+        skipWs(cur, end);
+        step.hasEnd = parseInt(cur, end, step.end);
+        skipWs(cur, end);
+        step.step = 1;
+        if (cur < end && *cur == ':')
+        {
+          ++cur;
+          skipWs(cur, end);
+          if (!parseInt(cur, end, step.step))
+            step.step = 1;
+        }
+      }
+      else if (step.hasStart)
+        step.sel = Selector::INDEX;
+      else
+        return false;
+    }
+    
+    skipWs(cur, end);
+    if (cur == end || *cur != ']')
+      return false;
+    ++cur;
+    return true;
+  }
+  
+  bool fail()
+  {
+    mKeys.clear();
+    mSteps.clear();
+    mPaths.clear();
+    return false;
+  }
+  
+  // Evaluation
+  static uint32_t arrayLength(const ConstValue& value)
+  {
+    switch (value.type())
+    {
+      case JType::ARRAY:  return value.arraySize();
+      case JType::BARRAY: return value.barraySize();
+      case JType::IARRAY: return value.iarraySize();
+      case JType::DARRAY: return value.darraySize();
+      default:
+        return 0u;
+    }
+  }
+  
+  static bool isContainer(const ConstValue& value)
+  {
+    return value.isObject() || value.isMetaArray();
+  }
+  
+  static void pushChild(const ConstValue& value, uint32_t pos, std::vector<Match>& out)
+  {
+    if (value.isArray())
+      out.push_back(Match{ &value.arrayValues()[pos], (uint32_t)NoIndex });
+    else
+      out.push_back(Match{ &value, pos });
+  }
+  
+  template <class T>
+  static Order compare3(T lhs, T rhs)
+  {
+    return (lhs < rhs) ? LESS : (rhs < lhs) ? GREATER : (lhs == rhs) ? EQUAL : DIFFERENT;  // NaN: unordered
+  }
+  
+  static bool apply(QueryOp op, Order order)
+  {
+    switch (op)
+    {
+      case QueryOp::EQ: return order == EQUAL;
+      case QueryOp::NE: return order != EQUAL;
+      case QueryOp::LT: return order == LESS;
+      case QueryOp::LE: return order == LESS    || order == EQUAL;
+      case QueryOp::GT: return order == GREATER;
+      case QueryOp::GE: return order == GREATER || order == EQUAL;
+      default:
+        return true;
+    }
+  }
+  
+  Order compare(const ConstValue& value, const Step& step) const
+  {
+    switch (step.lit)
+    {
+      case Literal::NUMBER:
+      {
+        if (!value.isMetaNumber())
+          return DIFFERENT;
+        if (step.litIsInt && value.isInt64())
+          return compare3(value.getInt64(), step.litInt);
+        if (step.litIsInt && value.isUInt64())
+          return (step.litInt < 0) ? GREATER : compare3(value.getUInt64(), (uint64_t)step.litInt);
+        return compare3(value.asNumber(), step.litDouble);
+      }
+      case Literal::STRING:
+      {
+        if (!value.isMetaString())
+          return DIFFERENT;
+        const std::string& lit = mKeys.str(step.litKey);
+        const uint32_t len = value.isShortString() ? value.shortStringSize() : value.longStringSize();
+        if (value.isLongString() && len == lit.size())  // interned: identity
+        {
+          const JString* jLit = mKeys.handle(step.litKey);
+          if (jLit != nullptr && jLit->c_str() == value.getLongString())
+            return EQUAL;
+        }
+        const size_t minLen = len < lit.size() ? len : lit.size();
+        const int cmp = std::memcmp(value.asString(), lit.data(), minLen);
+        if (cmp != 0)
+          return cmp < 0 ? LESS : GREATER;
+        return compare3((size_t)len, lit.size());
+      }
+      case Literal::TRUE:   return value.isTrue()  ? EQUAL : DIFFERENT;
+      case Literal::FALSE:  return value.isFalse() ? EQUAL : DIFFERENT;
+      default:              return value.isNul()   ? EQUAL : DIFFERENT;
+    }
+  }
+  
+  bool test(const ConstValue& value, const Step& step) const
+  {
+    const ConstValue* cur = &value;
+    for (uint32_t i = step.pathBegin; i < step.pathEnd; ++i)
+    {
+      const JString* jKey = mKeys.handle(mPaths[i]);
+      if (jKey == nullptr || !cur->isObject())
+        return false;
+      cur = Keys::findMember(*cur, jKey);
+      if (cur == nullptr)
+        return false;
+    }
+    return step.op == QueryOp::EXISTS || apply(step.op, compare(*cur, step));
+  }
+  
+  // Filter over elements of a specialized array
+  void filterElements(const ConstValue& value, const Step& step, std::vector<Match>& out)
+  {
+    const uint32_t size = arrayLength(value);
+    if (size == 0u || step.pathBegin != step.pathEnd)  // elements have no members
+      return;
+      
+    mIndices.resize(size);
+    uint32_t* indices = mIndices.data();
+    uint32_t count = 0u;
+    if (step.op == QueryOp::EXISTS)
+    {
+      for (uint32_t i = 0u; i < size; ++i)
+        indices[i] = i;
+      count = size;
+    }
+    else if (value.isIArray() && step.lit == Literal::NUMBER)
+    {
+      count = step.litIsInt ? helper::selectIndices(value.iarrayValues(), size, step.op, step.litInt, indices)
+                            : helper::selectIndices(value.iarrayValues(), size, step.op, step.litDouble, indices);
+    }
+    else if (value.isDArray() && step.lit == Literal::NUMBER)
+    {
+      count = helper::selectIndices(value.darrayValues(), size, step.op, step.litDouble, indices);
+    }
+    else if (value.isBArray() && (step.lit == Literal::TRUE || step.lit == Literal::FALSE)
+             && (step.op == QueryOp::EQ || step.op == QueryOp::NE))
+    {
+      count = helper::selectIndices(value.barrayValues(), size, step.op, step.lit == Literal::TRUE, indices);
+    }
+    else if (step.op == QueryOp::NE)  // type mismatch
+    {
+      for (uint32_t i = 0u; i < size; ++i)
+        indices[i] = i;
+      count = size;
+    }
+    
+    for (uint32_t i = 0u; i < count; ++i)
+      out.push_back(Match{ &value, indices[i] });
+  }
+  
+  void select(const Step& step, const Match& match, std::vector<Match>& out)
+  {
+    if (match.isElement())  // scalar
+      return;
+      
+    const ConstValue& value = *match.value;
+    switch (step.sel)
+    {
+      case Selector::NAME:
+      {
+        const JString* jKey = mKeys.handle(step.key);
+        if (jKey == nullptr || !value.isObject())
+          return;
+        const ConstValue* member = Keys::findMember(value, jKey);
+        if (member != nullptr)
+          out.push_back(Match{ member, (uint32_t)NoIndex });
+        return;
+      }
+      case Selector::WILDCARD:
+      {
+        if (value.isObject())
+        {
+          const ConstMember* members = value.objectMembers();
+          for (uint32_t i = 0u; i < value.objectSize(); ++i)
+            out.push_back(Match{ &members[i].value(), (uint32_t)NoIndex });
+        }
+        else
+        {
+          const uint32_t size = arrayLength(value);
+          for (uint32_t i = 0u; i < size; ++i)
+            pushChild(value, i, out);
+        }
+        return;
+      }
+      case Selector::INDEX:
+      {
+        const int64_t size = (int64_t)arrayLength(value);
+        const int64_t pos = step.start < 0 ? size + step.start : step.start;
+        if (pos >= 0 && pos < size)
+          pushChild(value, (uint32_t)pos, out);
+        return;
+      }
+      case Selector::SLICE:
+      {
+        const int64_t size = (int64_t)arrayLength(value);
+        if (size == 0 || step.step == 0)
+          return;
+        auto norm = [size](int64_t i) { return i >= 0 ? i : size + i; };
+        auto clamp = [](int64_t i, int64_t lo, int64_t hi) { return i < lo ? lo : (i > hi ? hi : i); };
+        if (step.step > 0)
+        {
+          const int64_t lower = clamp(step.hasStart ? norm(step.start) : 0,    0, size);
+          const int64_t upper = clamp(step.hasEnd   ? norm(step.end)   : size, 0, size);
+          for (int64_t i = lower; i < upper; i += step.step)
+            pushChild(value, (uint32_t)i, out);
+        }
+        else
+        {
+          const int64_t upper = clamp(step.hasStart ? norm(step.start) : size - 1, -1, size - 1);
+          const int64_t lower = clamp(step.hasEnd   ? norm(step.end)   : -1,       -1, size - 1);
+          for (int64_t i = upper; i > lower; i += step.step)
+            pushChild(value, (uint32_t)i, out);
+        }
+        return;
+      }
+      case Selector::FILTER:
+      {
+        if (value.isObject())
+        {
+          const ConstMember* members = value.objectMembers();
+          for (uint32_t i = 0u; i < value.objectSize(); ++i)
+          {
+            if (test(members[i].value(), step))
+              out.push_back(Match{ &members[i].value(), (uint32_t)NoIndex });
+          }
+        }
+        else if (value.isArray())
+        {
+          const ConstValue* values = value.arrayValues();
+          for (uint32_t i = 0u; i < value.arraySize(); ++i)
+          {
+            if (test(values[i], step))
+              out.push_back(Match{ &values[i], (uint32_t)NoIndex });
+          }
+        }
+        else if (value.isMetaArray())
+          filterElements(value, step, out);
+        return;
+      }
+    }
+  }
+  
+  // Containers reachable from matches, including themselves (document order)
+  void descendants(const std::vector<Match>& matches)
+  {
+    mNodes.clear();
+    for (const Match& match : matches)
+    {
+      if (match.isElement())
+        continue;
+        
+      mStack.push_back(match.value);
+      while (!mStack.empty())
+      {
+        const ConstValue* value = mStack.back();
+        mStack.pop_back();
+        mNodes.push_back(Match{ value, (uint32_t)NoIndex });
+        
+        // Push children in reverse for pre-order
+        if (value->isObject())
+        {
+          const ConstMember* members = value->objectMembers();
+          for (uint32_t i = value->objectSize(); i-- > 0u; )
+          {
+            if (isContainer(members[i].value()))
+              mStack.push_back(&members[i].value());
+          }
+        }
+        else if (value->isArray())
+        {
+          const ConstValue* values = value->arrayValues();
+          for (uint32_t i = value->arraySize(); i-- > 0u; )
+          {
+            if (isContainer(values[i]))
+              mStack.push_back(&values[i]);
+          }
+        }
+      }
+    }
+  }
+  
+public:
+  CompiledQuery() = default;
+  
+  CompiledQuery(const char* query, int32_t length = -1)
+  {
+    if (!parse(query, length))
+      throw std::invalid_argument("[lfjson] CompiledQuery: invalid JSONPath syntax");
+  }
+  
+  CompiledQuery(const std::string& query) : CompiledQuery(query.c_str(), (int32_t)query.size()) {}
+  
+  // Parse (returns 'false' on syntax error, leaving query empty)
+  bool parse(const char* query, int32_t length = -1)
+  {
+    assert(query != nullptr);
+    fail();
+    
+    const char* cur = query;
+    const char* end = query + (length >= 0 ? (size_t)length : std::strlen(query));
+    skipWs(cur, end);
+    if (cur == end || *cur != '$')
+      return false;
+    ++cur;
+    
+    std::string name;
+    for (skipWs(cur, end); cur < end; skipWs(cur, end))
+    {
+      Step step = Step();
+      if (*cur == '.')
+      {
+        ++cur;
+        if (cur < end && *cur == '.')
+        {
+          step.recursive = true;
+          ++cur;
+        }
+        if (step.recursive && cur < end && *cur == '[')
+        {
+          if (!parseBracket(cur, end, step))
+            return fail();
+        }
+        else if (cur < end && *cur == '*')
+        {
+          step.sel = Selector::WILDCARD;
+          ++cur;
+        }
+        else if (parseName(cur, end, name))
+        {
+          step.sel = Selector::NAME;
+          step.key = mKeys.add(name);
+        }
+        else
+          return fail();
+      }
+      else if (*cur == '[')
+      {
+        if (!parseBracket(cur, end, step))
+          return fail();
+      }
+      else
+        return fail();
+        
+      mSteps.push_back(step);
+    }
+    return true;
+  }
+  
+  // Accessors
+  uint32_t size() const { return (uint32_t)mSteps.size(); }
+  bool empty() const { return mSteps.empty(); }
+  
+  // Resolve once for a given pool (optional, done lazily by evaluate)
+  void bind(const SharedStringPool& pool) { mKeys.resolve(pool); }
+  
+  // Evaluate from root, with keys interned in 'pool' (results in document order per step)
+  void evaluate(const ConstValue& root, const SharedStringPool& pool, std::vector<Match>& results)
+  {
+    assert(pool);
+    mKeys.resolve(pool);
+    
+    results.clear();
+    results.push_back(Match{ &root, (uint32_t)NoIndex });
+    for (const Step& step : mSteps)
+    {
+      if (step.recursive)
+        descendants(results);
+      const std::vector<Match>& input = step.recursive ? mNodes : results;
+      
+      mNext.clear();
+      for (const Match& match : input)
+        select(step, match, mNext);
+      results.swap(mNext);
+      
+      if (results.empty())
+        break;
+    }
+  }
+  
+  template <uint16_t ObjectChunkSize>
+  void evaluate(const Document<StringChunkSize, Allocator, ObjectChunkSize>& doc, std::vector<Match>& results)
+  {
+    evaluate(doc.croot(), doc.stringPool(), results);
+  }
+};
+
+// Helper aliases
+using DynamicQuery = CompiledQuery<>;
+
+} // namespace lfjson
+
+#endif // LFJSON_QUERY_H
@@ -0,0 +1,721 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+#ifndef LFJSON_SCHEMA_H
+#define LFJSON_SCHEMA_H
+
+#include "BaseData.h"
+#include "Document.h"
+#include "Pointer.h"
+#include "Aggregate.h"
+#include "Hash.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+#include <cassert>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace lfjson
+{
+//
+// JSON Schema validator (draft-7 subset), compiled once from a schema Document
+// Supported: type, required, properties, additionalProperties, items (single schema), enum/const (scalars),
+// minimum, maximum, exclusiveMinimum, exclusiveMaximum, minLength, maxLength, minItems, maxItems,
+// minProperties, maxProperties and boolean schemas (annotations are ignored, other keywords are rejected)
+// Property names are cached as JString handles (see PoolKeys): objects are validated with pointer compares
+// Numeric bounds over IARRAY/DARRAY items use dispatched min/max kernels (see Aggregate.h)
+template <uint16_t StringChunkSize = LFJ_DOCUMENT_DFLT_CHUNKSIZE,
+          class Allocator = StdAllocator>
+class CompiledSchema
+{
+public:
+  using SharedStringPool = std::shared_ptr<StringPool<StringChunkSize, Allocator>>;
+  
+private:
+  using Keys = PoolKeys<StringChunkSize, Allocator>;
+  
+  enum : uint32_t { NoNode = std::numeric_limits<uint32_t>::max() };
+  
+  enum : uint8_t {
+    TypeNull    = 0x01,
+    TypeBoolean = 0x02,
+    TypeInteger = 0x04,
+    TypeNumber  = 0x08,  // includes integers
+    TypeString  = 0x10,
+    TypeArray   = 0x20,
+    TypeObject  = 0x40,
+    TypeAny     = 0x7F
+  };
+  
+  // enum/const scalar
+  struct Literal {
+    JType     type;     // NUL, TRUE, FALSE, INT64, UINT64, DOUBLE or SSTRING (any string)
+    int64_t   i64;
+    uint64_t  u64;
+    double    d;
+    uint32_t  key;      // string, in mKeys (long strings compared by handle)
+  };
+  
+  struct Node {
+    uint8_t   types       = TypeAny;
+    bool      hasLow      = false;
+    bool      hasHigh     = false;
+    bool      lowStrict   = false;
+    bool      highStrict  = false;
+    double    low         = 0.;
+    double    high        = 0.;
+    uint32_t  minLength   = 0u;
+    uint32_t  maxLength   = std::numeric_limits<uint32_t>::max();
+    uint32_t  minItems    = 0u;
+    uint32_t  maxItems    = std::numeric_limits<uint32_t>::max();
+    uint32_t  minProps    = 0u;
+    uint32_t  maxProps    = std::numeric_limits<uint32_t>::max();
+    uint32_t  items       = NoNode;
+    uint32_t  additional  = NoNode;  // schema of other members
+    bool      closed      = false;   // additionalProperties: false
+    bool      hasEnum     = false;
+    uint32_t  propBegin   = 0u;      // range in mProps
+    uint32_t  propEnd     = 0u;
+    uint32_t  reqBegin    = 0u;      // range in mRequired
+    uint32_t  reqEnd      = 0u;
+    uint32_t  enumBegin   = 0u;      // range in mLiterals
+    uint32_t  enumEnd     = 0u;
+  };
+  
+  struct Property {
+    uint32_t  key;
+    uint32_t  node;
+  };
+  
+  Keys mKeys;
+  std::vector<Node> mNodes;  // root first
+  std::vector<Property> mProps;
+  std::vector<uint32_t> mRequired;
+  std::vector<Literal> mLiterals;
+  
+  // Last failure
+  const char* mErrorKeyword = "";
+  std::string mErrorPath;
+  
+  // Compilation
+  static bool is(const ConstMember& member, const char* keyword)
+  {
+    const uint32_t len = (uint32_t)std::strlen(keyword);
+    return member.keyLen() == len && std::memcmp(member.key(), keyword, len) == 0;
+  }
+  
+  static bool isAnyOf(const ConstMember& member, const char* const* keywords)
+  {
+    for (; *keywords != nullptr; ++keywords)
+    {
+      if (is(member, *keywords))
+        return true;
+    }
+    return false;
+  }
+  
+  static std::string text(const ConstValue& value)
+  {
+    return value.isShortString() ? std::string(value.getShortString(), value.shortStringSize())
+                                 : std::string(value.getLongString(), value.longStringSize());
+  }
+  
+  static bool toNumber(const ConstValue& value, double& number)
+  {
+    switch (value.type())
+    {
+      case JType::INT64:  { number = (double)value.getInt64();  return true; }
+      case JType::UINT64: { number = (double)value.getUInt64(); return true; }
+      case JType::DOUBLE: { number = value.getDouble(); return true; }
+      default: return false;
+    }
+  }
+  
+  static bool toCount(const ConstValue& value, uint32_t& count)
+  {
+    double number = 0.;
+    if (!toNumber(value, number) || number < 0. || number != std::floor(number))
+      return false;
+    count = number > (double)std::numeric_limits<uint32_t>::max() ? std::numeric_limits<uint32_t>::max() : (uint32_t)number;
+    return true;
+  }
+  
+  static bool typeMask(const ConstValue& value, uint8_t& mask)
+  {
+    if (!value.isMetaString())
+      return false;
+    const std::string name = text(value);
+    if      (name == "null")    mask |= TypeNull;
+    else if (name == "boolean") mask |= TypeBoolean;
+    else if (name == "integer") mask |= TypeInteger;
+    else if (name == "number")  mask |= TypeNumber | TypeInteger;
+    else if (name == "string")  mask |= TypeString;
+    else if (name == "array")   mask |= TypeArray;
+    else if (name == "object")  mask |= TypeObject;
+    else
+      return false;
+    return true;
+  }
+  
+  bool addLiteral(const ConstValue& value)
+  {
+    Literal lit = Literal();
+    lit.type = value.type();
+    switch (value.type())
+    {
+      case JType::NUL:
+      case JType::TRUE:
+      case JType::FALSE:  break;
+      case JType::INT64:  { lit.i64 = value.getInt64();  break; }
+      case JType::UINT64: { lit.u64 = value.getUInt64(); break; }
+      case JType::DOUBLE: { lit.d   = value.getDouble(); break; }
+      case JType::SSTRING:
+      case JType::LSTRING:
+      {
+        lit.type = JType::SSTRING;
+        lit.key  = mKeys.add(text(value));
+        break;
+      }
+      default:
+        return false;  // containers not supported
+    }
+    mLiterals.push_back(lit);
+    return true;
+  }
+  
+  uint32_t compileNode(const ConstValue& schema)
+  {
+    static const char* const annotations[] = {
+      "$schema", "$id", "$comment", "title", "description", "default", "examples", "readOnly", "writeOnly",
+      "format", "definitions", "contentMediaType", "contentEncoding", nullptr
+    };
+    
+    const uint32_t index = (uint32_t)mNodes.size();
+    mNodes.push_back(Node());
+    if (schema.isMetaBool())  // boolean schema
+    {
+      if (schema.isFalse())
+        mNodes[index].types = 0u;
+      return index;
+    }
+    if (!schema.isObject())
+      return NoNode;
+      
+    Node node;
+    std::vector<Property> props;
+    std::vector<uint32_t> required;
+    std::vector<Literal> literals;
+    const uint32_t literalsBegin = (uint32_t)mLiterals.size();
+    
+    const ConstMember* members = schema.objectMembers();
+    for (uint32_t i = 0u; i < schema.objectSize(); ++i)
+    {
+      const ConstMember& member = members[i];
+      const ConstValue& value = member.value();
+      double number = 0.;
+      if (is(member, "type"))
+      {
+        node.types = 0u;
+        if (value.isArray())
+        {
+          for (uint32_t j = 0u; j < value.arraySize(); ++j)
+          {
+            if (!typeMask(value.arrayValues()[j], node.types))
+              return NoNode;
+          }
+        }
+        else if (!typeMask(value, node.types))
+          return NoNode;
+      }
+      else if (is(member, "properties"))
+      {
+        if (!value.isObject())
+          return NoNode;
+        for (uint32_t j = 0u; j < value.objectSize(); ++j)
+        {
+          const ConstMember& prop = value.objectMembers()[j];
+          const uint32_t child = compileNode(prop.value());
+          if (child == NoNode)
+            return NoNode;
+          props.push_back(Property{ mKeys.add(std::string(prop.key(), prop.keyLen())), child });
+        }
+      }
+      else if (is(member, "required"))
+      {
+        if (!value.isArray())
+          return NoNode;
+        for (uint32_t j = 0u; j < value.arraySize(); ++j)
+        {
+          if (!value.arrayValues()[j].isMetaString())
+            return NoNode;
+          required.push_back(mKeys.add(text(value.arrayValues()[j])));
+        }
+      }
+      else if (is(member, "additionalProperties"))
+      {
+        if (value.isFalse())
+          node.closed = true;
+        else if (!value.isTrue())
+        {
+          node.additional = compileNode(value);
+          if (node.additional == NoNode)
+            return NoNode;
+        }
+      }
+      else if (is(member, "items"))
+      {
+        node.items = compileNode(value);  // tuple form (array) not supported
+        if (node.items == NoNode)
+          return NoNode;
+      }
+      else if (is(member, "enum") || is(member, "const"))
+      {
+        node.hasEnum = true;
+        if (is(member, "enum") && value.isArray())
+        {
+          for (uint32_t j = 0u; j < value.arraySize(); ++j)
+          {
+            if (!addLiteral(value.arrayValues()[j]))
+              return NoNode;
+          }
+        }
+        else if (is(member, "enum") || !addLiteral(value))
+          return NoNode;
+      }
+      else if (is(member, "minimum") || is(member, "exclusiveMinimum"))
+      {
+        if (!toNumber(value, number))
+          return NoNode;
+        const bool strict = is(member, "exclusiveMinimum");
+        if (!node.hasLow || number > node.low || (number == node.low && strict))
+        {
+          node.hasLow = true;
+          node.low = number;
+          node.lowStrict = strict;
+        }
+      }
+      else if (is(member, "maximum") || is(member, "exclusiveMaximum"))
+      {
+        if (!toNumber(value, number))
+          return NoNode;
+        const bool strict = is(member, "exclusiveMaximum");
+        if (!node.hasHigh || number < node.high || (number == node.high && strict))
+        {
+          node.hasHigh = true;
+          node.high = number;
+          node.highStrict = strict;
+        }
+      }
+      else if (is(member, "minLength"))
+      {
+        if (!toCount(value, node.minLength))
+          return NoNode;
+      }
+      else if (is(member, "maxLength"))
+      {
+        if (!toCount(value, node.maxLength))
+          return NoNode;
+      }
+      else if (is(member, "minProperties"))
+      {
+        if (!toCount(value, node.minProps))
+          return NoNode;
+      }
+      else if (is(member, "maxProperties"))
+      {
+        if (!toCount(value, node.maxProps))
+          return NoNode;
+      }
+      else if (is(member, "minItems"))
+      {
+        if (!toCount(value, node.minItems))
+          return NoNode;
+      }
+      else if (is(member, "maxItems"))
+      {
+        if (!toCount(value, node.maxItems))
+          return NoNode;
+      }
+      else if (!isAnyOf(member, annotations))
+        return NoNode;  // unsupported keyword
+    }
+    
+    // Ranges (children compiled first)
+    node.propBegin = (uint32_t)mProps.size();
+    mProps.insert(mProps.end(), props.begin(), props.end());
+    node.propEnd = (uint32_t)mProps.size();
+    node.reqBegin = (uint32_t)mRequired.size();
+    mRequired.insert(mRequired.end(), required.begin(), required.end());
+    node.reqEnd = (uint32_t)mRequired.size();
+    node.enumBegin = literalsBegin;
+    node.enumEnd = (uint32_t)mLiterals.size();
+    mNodes[index] = node;
+    return index;
+  }
+  
+  bool fail()
+  {
+    mKeys.clear();
+    mNodes.clear();
+    mProps.clear();
+    mRequired.clear();
+    mLiterals.clear();
+    return false;
+  }
+  
+  // Validation
+  bool error(const char* keyword)
+  {
+    mErrorKeyword = keyword;
+    mErrorPath.clear();
+    return false;
+  }
+  
+  // Prepend a JSON Pointer segment to the error path (on failure only)
+  bool errorAt(const char* key, uint32_t len)
+  {
+    std::string segment("/");
+    for (uint32_t i = 0u; i < len; ++i)
+    {
+      if (key[i] == '~')
+        segment += "~0";
+      else if (key[i] == '/')
+        segment += "~1";
+      else
+        segment += key[i];
+    }
+    mErrorPath.insert(0, segment);
+    return false;
+  }
+  
+  bool errorAt(uint32_t index)
+  {
+    mErrorPath.insert(0, "/" + std::to_string(index));
+    return false;
+  }
+  
+  static bool isIntegral(double d)
+  {
+    return std::isfinite(d) && d == std::floor(d);
+  }
+  
+  static uint32_t stringLength(const ConstValue& value)  // code points (UTF-8)
+  {
+    const char* str = value.isShortString() ? value.getShortString() : value.getLongString();
+    const uint32_t size = value.isShortString() ? value.shortStringSize() : value.longStringSize();
+    uint32_t count = 0u;
+    for (uint32_t i = 0u; i < size; ++i)
+      count += ((unsigned char)str[i] & 0xC0) != 0x80;
+    return count;
+  }
+  
+  bool inBounds(const Node& node, double number) const
+  {
+    if (node.hasLow && (node.lowStrict ? number <= node.low : number < node.low))
+      return false;
+    if (node.hasHigh && (node.highStrict ? number >= node.high : number > node.high))
+      return false;
+    return true;
+  }
+  
+  static bool numberEquals(const ConstValue& value, const Literal& lit)
+  {
+    if (value.isInt64() && lit.type == JType::INT64)
+      return value.getInt64() == lit.i64;
+    if (value.isUInt64() && lit.type == JType::UINT64)
+      return value.getUInt64() == lit.u64;
+    double number = 0.;
+    toNumber(value, number);
+    switch (lit.type)
+    {
+      case JType::INT64:  return number == (double)lit.i64;
+      case JType::UINT64: return number == (double)lit.u64;
+      case JType::DOUBLE: return number == lit.d;
+      default: return false;
+    }
+  }
+  
+  bool matchesEnum(const Node& node, const ConstValue& value) const
+  {
+    for (uint32_t i = node.enumBegin; i < node.enumEnd; ++i)
+    {
+      const Literal& lit = mLiterals[i];
+      switch (value.type())
+      {
+        case JType::NUL:
+        case JType::TRUE:
+        case JType::FALSE:
+        {
+          if (lit.type == value.type())
+            return true;
+          break;
+        }
+        case JType::INT64:
+        case JType::UINT64:
+        case JType::DOUBLE:
+        {
+          if (numberEquals(value, lit))
+            return true;
+          break;
+        }
+        case JType::SSTRING:
+        {
+          const std::string& str = mKeys.str(lit.key);
+          if (lit.type == JType::SSTRING && str.size() == value.shortStringSize()
+              && std::memcmp(str.data(), value.getShortString(), str.size()) == 0)
+            return true;
+          break;
+        }
+        case JType::LSTRING:
+        {
+          if (lit.type == JType::SSTRING && mKeys.handle(lit.key) != nullptr
+              && (const char*)mKeys.handle(lit.key)->c_str() == value.getLongString())  // interned: identity
+            return true;
+          break;
+        }
+        default:
+          break;
+      }
+    }
+    return false;
+  }
+  
+  bool checkObject(const Node& node, const ConstValue& value)
+  {
+    const uint32_t size = value.objectSize();
+    if (size < node.minProps || size > node.maxProps)
+      return error(size < node.minProps ? "minProperties" : "maxProperties");
+      
+    const JMember* members = (const JMember*)value.objectMembers();
+    for (uint32_t i = node.reqBegin; i < node.reqEnd; ++i)
+    {
+      const JString* jKey = mKeys.handle(mRequired[i]);
+      if (jKey == nullptr || Keys::findMember(value, jKey) == nullptr)  // not in pool: missing
+        return error("required");
+    }
+    
+    const bool open = !node.closed && node.additional == NoNode;
+    if (open && node.propBegin == node.propEnd)
+      return true;
+    for (uint32_t i = 0u; i < size; ++i)
+    {
+      const JMember& member = members[i];
+      uint32_t child = node.additional;
+      for (uint32_t p = node.propBegin; p < node.propEnd; ++p)
+      {
+        if (mKeys.handle(mProps[p].key) == member.jkey())
+        {
+          child = mProps[p].node;
+          break;
+        }
+      }
+      if (child == NoNode)
+      {
+        if (node.closed)
+          return error("additionalProperties") || errorAt(member.key(), member.keyLen());
+        continue;
+      }
+      if (!check(member.value(), child))
+        return errorAt(member.key(), member.keyLen());
+    }
+    return true;
+  }
+  
+  template <class T>
+  bool checkNumbers(const Node& item, const T* data, uint32_t size)
+  {
+    if (!(item.types & (TypeInteger | TypeNumber)))
+      return error("type");
+    if ((item.types & TypeNumber) == 0u)  // integers only
+    {
+      for (uint32_t i = 0u; i < size; ++i)
+      {
+        if (!isIntegral((double)data[i]))
+          return error("type") || errorAt(i);
+      }
+    }
+    if (item.hasLow && !inBounds(item, (double)helper::min(data, size)))
+      return error(item.lowStrict ? "exclusiveMinimum" : "minimum");
+    if (item.hasHigh && !inBounds(item, (double)helper::max(data, size)))
+      return error(item.highStrict ? "exclusiveMaximum" : "maximum");
+    return true;
+  }
+  
+  bool checkSpecialized(const Node& node, const ConstValue& value)
+  {
+    const uint32_t size = helper::metaArraySize(value);
+    if (size < node.minItems || size > node.maxItems)
+      return error(size < node.minItems ? "minItems" : "maxItems");
+    if (node.items == NoNode || size == 0u)
+      return true;
+      
+    const Node& item = mNodes[node.items];
+    if (item.hasEnum)  // per element
+    {
+      for (uint32_t i = 0u; i < size; ++i)
+      {
+        if (!check(helper::metaArrayElement(value, i), node.items))
+          return errorAt(i);
+      }
+      return true;
+    }
+    switch (value.type())
+    {
+      case JType::BARRAY:
+        return (item.types & TypeBoolean) ? true : error("type");
+      case JType::IARRAY:
+        return checkNumbers(item, value.iarrayValues(), size);
+      default:
+        return checkNumbers(item, value.darrayValues(), size);
+    }
+  }
+  
+  bool check(const ConstValue& value, uint32_t index)
+  {
+    const Node& node = mNodes[index];
+    switch (value.type())
+    {
+      case JType::OBJECT:
+      {
+        if (!(node.types & TypeObject))
+          return error("type");
+        return checkObject(node, value);
+      }
+      case JType::ARRAY:
+      {
+        if (!(node.types & TypeArray))
+          return error("type");
+        const uint32_t size = value.arraySize();
+        if (size < node.minItems || size > node.maxItems)
+          return error(size < node.minItems ? "minItems" : "maxItems");
+        if (node.items != NoNode)
+        {
+          for (uint32_t i = 0u; i < size; ++i)
+          {
+            if (!check(value.arrayValues()[i], node.items))
+              return errorAt(i);
+          }
+        }
+        return true;
+      }
+      case JType::BARRAY:
+      case JType::IARRAY:
+      case JType::DARRAY:
+      {
+        if (!(node.types & TypeArray))
+          return error("type");
+        return checkSpecialized(node, value);
+      }
+      case JType::SSTRING:
+      case JType::LSTRING:
+      {
+        if (!(node.types & TypeString))
+          return error("type");
+        if (node.minLength > 0u || node.maxLength < std::numeric_limits<uint32_t>::max())
+        {
+          const uint32_t length = stringLength(value);
+          if (length < node.minLength || length > node.maxLength)
+            return error(length < node.minLength ? "minLength" : "maxLength");
+        }
+        break;
+      }
+      case JType::INT64:
+      case JType::UINT64:
+      case JType::DOUBLE:
+      {
+        double number = 0.;
+        toNumber(value, number);
+        const bool integral = !value.isDouble() || isIntegral(number);
+        if (!(node.types & (integral ? (TypeInteger | TypeNumber) : TypeNumber)))
+          return error("type");
+        if (!inBounds(node, number))
+        {
+          if (node.hasLow && (node.lowStrict ? number <= node.low : number < node.low))
+            return error(node.lowStrict ? "exclusiveMinimum" : "minimum");
+          return error(node.highStrict ? "exclusiveMaximum" : "maximum");
+        }
+        break;
+      }
+      case JType::TRUE:
+      case JType::FALSE:
+      {
+        if (!(node.types & TypeBoolean))
+          return error("type");
+        break;
+      }
+      default:
+      {
+        if (!(node.types & TypeNull))
+          return error("type");
+        break;
+      }
+    }
+    if (node.hasEnum && !matchesEnum(node, value))
+      return error("enum");
+    return true;
+  }
+  
+public:
+  CompiledSchema() = default;
+  
+  template <uint16_t SchemaStringChunkSize, class SchemaAllocator, uint16_t SchemaObjectChunkSize>
+  CompiledSchema(const Document<SchemaStringChunkSize, SchemaAllocator, SchemaObjectChunkSize>& schema)
+  {
+    if (!compile(schema.croot()))
+      throw std::invalid_argument("[lfjson] CompiledSchema: invalid or unsupported schema");
+  }
+  
+  // Compile (returns 'false' on invalid or unsupported schema, leaving schema empty)
+  // 'schema' is not referenced after compilation
+  bool compile(const ConstValue& schema)
+  {
+    fail();
+    if (compileNode(schema) == NoNode)
+      return fail();
+    return true;
+  }
+  
+  // Accessors
+  bool empty() const { return mNodes.empty(); }
+  
+  // Last failure: keyword and JSON Pointer to the invalid value
+  const char* errorKeyword() const { return mErrorKeyword; }
+  const std::string& errorPath() const { return mErrorPath; }
+  
+  // Resolve once for a given pool (optional, done lazily by validate)
+  void bind(const SharedStringPool& pool) { mKeys.resolve(pool); }
+  
+  // Validate 'root', with keys interned in 'pool' (an empty schema accepts anything)
+  bool validate(const ConstValue& root, const SharedStringPool& pool)
+  {
+    assert(pool);
+    mErrorKeyword = "";
+    mErrorPath.clear();
+    if (mNodes.empty())
+      return true;
+      
+    mKeys.resolve(pool);
+    return check(root, 0u);
+  }
+  
+  template <uint16_t ObjectChunkSize>
+  bool validate(const Document<StringChunkSize, Allocator, ObjectChunkSize>& doc)
+  {
+    return validate(doc.croot(), doc.stringPool());
+  }
+};
+
+// Helper aliases
+using DynamicSchema = CompiledSchema<>;
+
+} // namespace lfjson
+
+#endif // LFJSON_SCHEMA_H
@@ -88,6 +88,7 @@ private:
   uint32_t  mBucketCount;  // total buckets
   PoolPtr*  mBuckets;      // array
   PoolPtr   mBucketsPtr;   // alt for mBuckets
+  uint32_t  mGeneration = 0u;  // bumped when held strings may be released
   
 public:
   StringPool()
@@ -104,7 +105,7 @@ public:
   {
     if (initBucketCount > 0u)
     {
-      mBucketsPtr = mAllocator.allocateAlt(sizeof(PoolPtr) * initBucketCount);
+      mBucketsPtr = mAllocator.allocateAlt(sizeof(PoolPtr) * initBucketCount, AllocOrigin::STRING_BUCKETS);
       mBuckets = (PoolPtr*)mAllocator.toPtr(mBucketsPtr);
       std::memset((void*)mBuckets, PoolPtrInit, sizeof(PoolPtr) * initBucketCount);
     }
@@ -143,6 +144,9 @@ public:
   
   uint32_t bucket_count() const { return mBucketCount; }
   
+  // Changes whenever previously provided JString pointers may have been invalidated
+  uint32_t generation() const { return mGeneration; }
+  
   float load_factor() const { return (mBucketCount == 0u) ? 0.f : (float)mItemCount / (float)mBucketCount; }
   
   float max_load_factor() const { return mMaxLoadFactor; }
@@ -234,6 +238,11 @@ public:
   
   const StringPoolAllocator<ChunkSize, Allocator>& stringPoolAllocator() const { return mAllocator; }
   
+  // Memory budget (see Document::setMemoryBudget)
+  size_t footprint() const { return mAllocator.footprint(); }
+  MemoryBudget* budget() const { return mAllocator.budget(); }
+  void setBudget(MemoryBudget* budget) { mAllocator.setBudget(budget); }
+  
   const JString* get(const char* str, int32_t length = -1) const
   {
     return get_(str, length);
@@ -259,6 +268,7 @@ public:
   // Release memory of strings not used as JMember key
   void releaseValues()
   {
+    ++mGeneration;
     for (uint32_t i = 0; i < mBucketCount; ++i)
     {
       PoolPtr itPtr = mBuckets[i];
@@ -313,6 +323,7 @@ public:
   void releaseAll()
   {
     mAllocator.releaseAll();
+    ++mGeneration;
     
     mItemCount   = 0;
     mBucketCount = 0;
@@ -323,6 +334,7 @@ public:
   // Modifiers
   void clear()
   {
+    ++mGeneration;
     for (uint32_t i = 0; i < mBucketCount; ++i)
     {
       PoolPtr itPtr = mBuckets[i];
@@ -360,7 +372,26 @@ public:
   #endif
     mAllocator.shrinkAlt();
   }
-  
+
+  // Rehash once so that 'count' more strings fit without growth (e.g. batch of keys)
+  void reserve(uint32_t count)
+  {
+    assert(count <= std::numeric_limits<uint32_t>::max() - mItemCount);
+    const uint32_t needed = mItemCount + count;
+    if (needed <= (uint32_t)(mBucketCount * mMaxLoadFactor))
+      return;
+
+    uint32_t newBucketCount = (mBucketCount > 0u) ? mBucketCount : StartingBucketCount;
+    while (needed > (uint32_t)(newBucketCount * mMaxLoadFactor))
+    {
+      if (newBucketCount >= std::numeric_limits<uint32_t>::max() / GrowthFactor)
+        break;
+      newBucketCount = (uint32_t)std::ceil(newBucketCount * GrowthFactor);
+    }
+    if (newBucketCount != mBucketCount)
+      rehash(newBucketCount);
+  }
+
 private:
 #ifndef LFJ_NO_XXHASH
   static uint32_t xxh3_low_len(const char* str, const int32_t len)
@@ -502,7 +533,7 @@ private:
   
   void rehash(uint32_t newBucketCount)
   {
-    PoolPtr newBucketsPtr = mAllocator.allocateAlt(sizeof(PoolPtr) * newBucketCount);
+    PoolPtr newBucketsPtr = mAllocator.allocateAlt(sizeof(PoolPtr) * newBucketCount, AllocOrigin::STRING_BUCKETS);
     PoolPtr* newBuckets = (PoolPtr*)mAllocator.toPtr(newBucketsPtr);
     assert(newBuckets != nullptr);
     std::memset((void*)newBuckets, PoolPtrInit, sizeof(PoolPtr) * newBucketCount);
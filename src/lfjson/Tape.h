@@ -0,0 +1,160 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+#ifndef LFJSON_TAPE_H
+#define LFJSON_TAPE_H
+
+#include "BaseData.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+#include <limits>
+#include <vector>
+
+namespace lfjson
+{
+namespace helper
+{
+// Array type holding elements of 'current' and 'kind' (NUL: no element yet)
+inline JType mergeArrayType(JType current, JType kind, bool intToDouble)
+{
+  if (current == JType::NUL || current == kind)
+    return kind;
+  if (intToDouble && (current == JType::IARRAY || current == JType::DARRAY)
+                  && (kind == JType::IARRAY || kind == JType::DARRAY))
+    return JType::DARRAY;
+  return JType::ARRAY;
+}
+} // namespace helper
+
+//
+// Container counts of an event stream, in startObject/startArray order (see Document::DirectHandler)
+// Arrays also get the type the Handler would give them (BARRAY, IARRAY, DARRAY or ARRAY)
+struct StructureTape {
+  struct Entry {  // 8 Bytes
+    uint32_t count;  // members or elements
+    JType    type;
+  };
+  
+  std::vector<Entry> entries;
+  
+  size_t size() const { return entries.size(); }
+  bool empty()  const { return entries.empty(); }
+  const Entry& operator[](size_t i) const { return entries[i]; }
+  
+  void clear() { entries.clear(); }
+};
+
+//
+// Structural pre-pass: records a StructureTape from the same events as Document::Handler
+// Strings are neither copied nor interned, scalars are only counted
+class TapeRecorder
+{
+private:
+  StructureTape& mTape;
+  std::vector<uint32_t> mFrames;  // open containers (tape indexes)
+  bool mMemberVal = false;
+  const bool mIntToDouble = true;
+  
+  // Counts an element of 'kind' in the open array (member values are counted by keys)
+  bool element(JType kind)
+  {
+    if (mMemberVal)
+    {
+      mMemberVal = false;
+      return true;
+    }
+    if (mFrames.empty())  // root
+      return true;
+      
+    StructureTape::Entry& entry = mTape.entries[mFrames.back()];
+    assert(entry.type != JType::OBJECT && "[lfjson] TapeRecorder: value without key");
+    if (entry.count == std::numeric_limits<uint32_t>::max())
+      return false;
+    ++entry.count;
+    entry.type = helper::mergeArrayType(entry.type, kind, mIntToDouble);
+    return true;
+  }
+  
+  bool start(JType type)
+  {
+    if (!element(JType::ARRAY))
+      return false;
+    mFrames.push_back((uint32_t)mTape.entries.size());
+    mTape.entries.push_back({ 0u, type });
+    return true;
+  }
+  
+  bool end(uint32_t count)
+  {
+    assert(!mFrames.empty());
+    StructureTape::Entry& entry = mTape.entries[mFrames.back()];
+    mFrames.pop_back();
+    if (entry.type == JType::NUL)  // empty array
+      entry.type = JType::ARRAY;
+    return entry.count == count;
+  }
+  
+public:
+  TapeRecorder(StructureTape& tape, bool allowIntToDouble = true)
+    : mTape(tape)
+    , mIntToDouble(allowIntToDouble)
+  {
+    mTape.clear();
+  }
+  
+  // Accessors
+  bool done() const { return mFrames.empty() && !mTape.empty(); }
+  
+  // Group
+  bool startObject() { return start(JType::OBJECT); }
+  bool endObject(uint32_t memberCount) { return end(memberCount); }
+  bool startArray() { return start(JType::NUL); }  // type from elements
+  bool endArray(uint32_t elementCount) { return end(elementCount); }
+  
+  // Scalar
+  bool pushKey(const char*, bool, int32_t = -1)
+  {
+    assert(!mMemberVal && !mFrames.empty());
+    StructureTape::Entry& entry = mTape.entries[mFrames.back()];
+    assert(entry.type == JType::OBJECT && "[lfjson] TapeRecorder: key outside object");
+    ++entry.count;
+    mMemberVal = true;
+    return true;
+  }
+  
+  bool pushNull()                               { return element(JType::ARRAY); }
+  bool pushBool(bool)                           { return element(JType::BARRAY); }
+  bool pushInt(int)                             { return element(JType::IARRAY); }
+  bool pushUInt(unsigned)                       { return element(JType::IARRAY); }
+  bool pushInt64(int64_t)                       { return element(JType::IARRAY); }
+  bool pushUInt64(uint64_t u64)                 { return element(u64 <= (uint64_t)std::numeric_limits<int64_t>::max() ? JType::IARRAY : JType::ARRAY); }
+  bool pushDouble(double)                       { return element(JType::DARRAY); }
+  bool pushString(const char*, bool, int32_t = -1) { return element(JType::ARRAY); }
+  
+  // Batch (array elements only)
+  bool pushBoolArray(const bool*, uint32_t count)     { return batch(count, JType::BARRAY); }
+  bool pushInt64Array(const int64_t*, uint32_t count) { return batch(count, JType::IARRAY); }
+  bool pushDoubleArray(const double*, uint32_t count) { return batch(count, JType::DARRAY); }
+  
+private:
+  bool batch(uint32_t count, JType kind)
+  {
+    assert(!mMemberVal && !mFrames.empty());
+    if (count == 0u)
+      return true;
+    StructureTape::Entry& entry = mTape.entries[mFrames.back()];
+    if (count > std::numeric_limits<uint32_t>::max() - entry.count)
+      return false;
+    entry.count += count;
+    entry.type = helper::mergeArrayType(entry.type, kind, mIntToDouble);
+    return true;
+  }
+};
+
+} // namespace lfjson
+
+#endif // LFJSON_TAPE_H
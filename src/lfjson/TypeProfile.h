@@ -0,0 +1,151 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+#ifndef LFJSON_TYPEPROFILE_H
+#define LFJSON_TYPEPROFILE_H
+
+#include "BaseData.h"
+#include "StringPool.h"
+#include "Tape.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace lfjson
+{
+//
+// Array type hints by parent key: the Handler starts member arrays with their final representation,
+// no mid-parse conversion when first elements are misleading (see Document::Handler::setTypeProfile)
+// A hint never changes data: ignored if the first element does not fit it as is (e.g. ints hinted DARRAY)
+// Declared, or learned from previous documents (types merged per key, conflicts give ARRAY)
+// Keys are matched as JString handles of the bound pool, interned there by bind
+template <uint16_t StringChunkSize, class Allocator>
+class TypeProfile
+{
+public:
+  using SharedStringPool = std::shared_ptr<StringPool<StringChunkSize, Allocator>>;
+  
+private:
+  std::unordered_map<std::string, JType> mTypes;
+  std::unordered_map<const JString*, JType> mHints;  // for bound pool
+  SharedStringPool mPool;                            // keeps bound pool alive (no ABA on address)
+  uint32_t mGeneration = 0u;
+  bool mChanged = true;
+  
+  static bool isArrayType(JType type)
+  {
+    return type == JType::ARRAY || type == JType::BARRAY || type == JType::IARRAY || type == JType::DARRAY;
+  }
+  
+  void learnValue(const ConstValue& value, bool intToDouble)
+  {
+    if (value.isObject())
+    {
+      const ConstMember* members = value.objectMembers();
+      const uint32_t size = value.objectSize();
+      for (uint32_t i = 0u; i < size; ++i)
+      {
+        const ConstValue& member = members[i].value();
+        const JType type = member.type();
+        if (isArrayType(type) && !emptyArray(member))
+        {
+          JType& known = mTypes.emplace(std::string(members[i].key(), members[i].keyLen()), JType::NUL).first->second;
+          const JType merged = helper::mergeArrayType(known, type, intToDouble);
+          mChanged |= merged != known;
+          known = merged;
+        }
+        learnValue(member, intToDouble);
+      }
+    }
+    else if (value.isArray())
+    {
+      const ConstValue* values = value.arrayValues();
+      const uint32_t size = value.arraySize();
+      for (uint32_t i = 0u; i < size; ++i)
+        learnValue(values[i], intToDouble);
+    }
+  }
+  
+  static bool emptyArray(const ConstValue& array)
+  {
+    switch (array.type())
+    {
+      case JType::BARRAY: return array.barraySize() == 0u;
+      case JType::IARRAY: return array.iarraySize() == 0u;
+      case JType::DARRAY: return array.darraySize() == 0u;
+      default:            return array.arraySize()  == 0u;
+    }
+  }
+  
+public:
+  // Accessors
+  size_t size() const { return mTypes.size(); }
+  bool empty()  const { return mTypes.empty(); }
+  
+  // Hint for 'key' (NUL if none)
+  JType type(const std::string& key) const
+  {
+    auto it = mTypes.find(key);
+    return it != mTypes.end() ? it->second : JType::NUL;
+  }
+  
+  // Modifiers
+  void declare(const std::string& key, JType type)
+  {
+    assert(isArrayType(type) && "[lfjson] TypeProfile: not an array type");
+    mTypes[key] = type;
+    mChanged = true;
+  }
+  
+  // Merge array types of all member arrays of 'root' (empty ones carry no information)
+  void learn(const ConstValue& root, bool allowIntToDouble = true)
+  {
+    learnValue(root, allowIntToDouble);
+  }
+  
+  void clear()
+  {
+    mTypes.clear();
+    mHints.clear();
+    mPool.reset();
+    mChanged = true;
+  }
+  
+  // Resolve hints for 'pool' (no-op if already bound and unchanged)
+  void bind(const SharedStringPool& pool)
+  {
+    assert(pool);
+    if (!mChanged && pool == mPool && pool->generation() == mGeneration)
+      return;
+      
+    mHints.clear();
+    for (const auto& entry : mTypes)
+    {
+      bool found = false;
+      const JString* jKey = pool->provideInterned(entry.first.c_str(), true, found, (int32_t)entry.first.size());
+      mHints[jKey] = entry.second;
+    }
+    mPool       = pool;
+    mGeneration = pool->generation();
+    mChanged    = false;
+  }
+  
+  // Hint for a key of the bound pool (NUL if none)
+  JType hint(const JString* jKey) const
+  {
+    if (mHints.empty())
+      return JType::NUL;
+    auto it = mHints.find(jKey);
+    return it != mHints.end() ? it->second : JType::NUL;
+  }
+};
+
+} // namespace lfjson
+
+#endif // LFJSON_TYPEPROFILE_H
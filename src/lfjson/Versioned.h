@@ -0,0 +1,644 @@
+/**
+ * Copyright 2022 Guillaume AUJAY. All rights reserved.
+ *
+ */
+
+#ifndef LFJSON_VERSIONED_H
+#define LFJSON_VERSIONED_H
+
+#include "BaseData.h"
+#include "DataHelper.h"
+#include "Document.h"
+#include "Pointer.h"
+#include "StringPool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace lfjson
+{
+//
+// Persistent Document: a single writer publishes immutable versions, readers hold snapshots
+// Edits copy only the blocks on the path from root to the modified node, other subtrees are shared
+// Blocks superseded by a version are freed (by the writer) once it and all older versions are released
+template <uint16_t StringChunkSize = LFJ_DOCUMENT_DFLT_CHUNKSIZE,
+          class Allocator = StdAllocator,
+          uint16_t ObjectChunkSize = StringChunkSize>
+class VersionedDocument
+{
+public:
+  using Pointer = CompiledPointer<StringChunkSize, Allocator>;
+  using SharedStringPool = std::shared_ptr<StringPool<StringChunkSize, Allocator>>;
+  
+private:
+  // Arenas (root unused), shared by versions until compaction
+  struct Store {
+    Document<StringChunkSize, Allocator, ObjectChunkSize> doc;
+  };
+  
+  struct Block {
+    void*     ptr;
+    uint32_t  size;
+  };
+  
+  struct Version {
+    Version(const JValue& root_, uint64_t id_, const std::shared_ptr<Store>& store_)
+      : root(root_), id(id_), store(store_) {}
+      
+    JValue              root;
+    uint64_t            id;
+    std::shared_ptr<Store> store;     // keeps arenas alive
+    std::vector<Block>  retired;      // blocks replaced by next version (writer only)
+  };
+  
+public:
+  // Immutable view of a published version (readers only access blocks and string data, never the pool)
+  class Snapshot
+  {
+    friend class VersionedDocument;
+    
+  private:
+    std::shared_ptr<const Version> mVersion;
+    
+    Snapshot(const std::shared_ptr<const Version>& version) : mVersion(version) {}
+    
+  public:
+    Snapshot() = default;
+    
+    bool valid() const { return (bool)mVersion; }
+    void reset() { mVersion.reset(); }
+    
+    uint64_t version() const { assert(valid()); return mVersion->id; }
+    const ConstValue& root() const { assert(valid()); return mVersion->root; }
+    
+    const ConstValue* find(const Pointer& pointer, uint32_t* elementIndex = nullptr) const
+    {
+      return pointer.findText(root(), elementIndex);
+    }
+  };
+  
+private:
+  std::shared_ptr<Store> mStore;
+  std::shared_ptr<Version> mCurrent;              // guarded by mMutex (written by writer only)
+  mutable std::mutex mMutex;
+  
+  // Writer state
+  std::deque<std::shared_ptr<Version>> mHistory;  // not reclaimed yet, oldest first
+  JValue mWorking;                                // next version root
+  std::vector<Block> mRetired;                    // published blocks replaced since last commit
+  std::unordered_set<void*> mOwned;               // blocks allocated since last commit
+  uint64_t mLastId = 0u;
+  bool mDirty = false;
+  
+  // Interns keys without setting their key flag: it shares a word with the length that snapshots read,
+  // and existing strings may be visible to readers (key flag only matters to StringPool::releaseValues)
+  struct KeyInterner {
+    StringPool<StringChunkSize, Allocator>* pool;
+    
+    const JString* provideInterned(const char* str, bool, bool& found, int32_t length = -1)
+    {
+      return pool->provideInterned(str, false, found, length);
+    }
+  };
+  
+  ObjectPoolAllocator<ObjectChunkSize, Allocator>& opa() { return mStore->doc.objectAllocator(); }
+  const SharedStringPool& pool() const { return mStore->doc.stringPool(); }
+  KeyInterner interner() const { return KeyInterner{ pool().get() }; }
+  
+  static Block blockOf(const JValue& value)
+  {
+    // Big blocks share the same pointer slot
+    switch (value.type())
+    {
+      case JType::OBJECT:
+        return value.objectCapacity() == 0u ? Block{ nullptr, 0u }
+             : Block{ value.objectCapacity() < LFJ_MAX_UINT16 ? (void*)value.oO() : (void*)value.oBO(), value.objectMemSize() };
+      case JType::ARRAY:
+        return value.arrayCapacity() == 0u ? Block{ nullptr, 0u }
+             : Block{ value.arrayCapacity() < LFJ_MAX_UINT16 ? (void*)value.aA() : (void*)value.aBA(), value.arrayMemSize() };
+      case JType::BARRAY:
+        return value.barrayCapacity() == 0u ? Block{ nullptr, 0u }
+             : Block{ value.barrayCapacity() < LFJ_MAX_UINT16 ? (void*)value.baA() : (void*)value.baBA(), value.barrayMemSize() };
+      case JType::IARRAY:
+        return value.iarrayCapacity() == 0u ? Block{ nullptr, 0u }
+             : Block{ value.iarrayCapacity() < LFJ_MAX_UINT16 ? (void*)value.iaA() : (void*)value.iaBA(), value.iarrayMemSize() };
+      case JType::DARRAY:
+        return value.darrayCapacity() == 0u ? Block{ nullptr, 0u }
+             : Block{ value.darrayCapacity() < LFJ_MAX_UINT16 ? (void*)value.daA() : (void*)value.daBA(), value.darrayMemSize() };
+      default:
+        return Block{ nullptr, 0u };
+    }
+  }
+  
+  // Path copy: container block becomes private to the working version
+  void own(JValue& value)
+  {
+    const Block block = blockOf(value);
+    if (block.ptr == nullptr || mOwned.count(block.ptr) > 0u)
+      return;
+      
+    JValue copy;
+    helper::copyBlock(copy, value, opa());
+    std::memcpy((void*)&value, (const void*)&copy, sizeof(JValue));
+    mRetired.push_back(block);
+    mDirty = true;  // published by next commit, even if the edit then fails
+    
+    const Block owned = blockOf(value);
+    if (owned.ptr != nullptr)
+      mOwned.insert(owned.ptr);
+  }
+  
+  // Track block moved by a grow/convert of an owned container
+  void rebind(void* oldPtr, const JValue& value)
+  {
+    void* ptr = blockOf(value).ptr;
+    if (ptr == oldPtr)
+      return;
+    mOwned.erase(oldPtr);
+    if (ptr != nullptr)
+      mOwned.insert(ptr);
+  }
+  
+  // Mark all blocks of a freshly built subtree as owned
+  void adopt(const JValue& value)
+  {
+    const Block block = blockOf(value);
+    if (block.ptr != nullptr)
+      mOwned.insert(block.ptr);
+      
+    if (value.isObject())
+    {
+      for (uint32_t i = 0u; i < value.objectSize(); ++i)
+        adopt(value.member(i).jvalue());
+    }
+    else if (value.isArray())
+    {
+      for (uint32_t i = 0u; i < value.arraySize(); ++i)
+        adopt(value[i]);
+    }
+  }
+  
+  // Subtree dropped from the working version: owned blocks are freed now, published ones retired
+  void release(const JValue& value)
+  {
+    if (value.isObject())
+    {
+      for (uint32_t i = 0u; i < value.objectSize(); ++i)
+        release(value.member(i).jvalue());
+    }
+    else if (value.isArray())
+    {
+      for (uint32_t i = 0u; i < value.arraySize(); ++i)
+        release(value[i]);
+    }
+    
+    const Block block = blockOf(value);
+    if (block.ptr == nullptr)
+      return;
+    if (mOwned.erase(block.ptr) > 0u)
+      opa().deallocate(block.ptr, block.size);
+    else
+      mRetired.push_back(block);
+  }
+  
+  static uint32_t memberIndex(const JValue& value, const std::string& key)
+  {
+    const uint32_t size = value.objectSize();
+    for (uint32_t i = 0u; i < size; ++i)
+    {
+      const JMember& member = value.member(i);
+      if (member.keyLen() == key.size() && std::memcmp(member.key(), key.c_str(), key.size()) == 0)
+        return i;
+    }
+    return size;
+  }
+  
+  // Node at 'depth' of 'path' (nullptr if missing), read only
+  const JValue* find(const Pointer& path, uint32_t depth) const
+  {
+    const JValue* cur = &mWorking;
+    for (uint32_t i = 0u; i < depth && cur != nullptr; ++i)
+    {
+      if (cur->isObject())
+      {
+        const uint32_t pos = memberIndex(*cur, path.key(i));
+        cur = pos < cur->objectSize() ? &cur->member(pos).jvalue() : nullptr;
+      }
+      else if (cur->isArray())
+        cur = path.index(i) < cur->arraySize() ? &(*cur)[path.index(i)] : nullptr;
+      else
+        cur = nullptr;
+    }
+    return cur;
+  }
+  
+  // Owned node at 'depth' of 'path' (nullptr if missing), containers above it are path copied
+  JValue* descend(const Pointer& path, uint32_t depth)
+  {
+    if (find(path, depth) == nullptr)  // no copy for a missing path
+      return nullptr;
+      
+    JValue* cur = &mWorking;
+    for (uint32_t i = 0u; i < depth; ++i)
+    {
+      if (cur->isObject())
+      {
+        const uint32_t pos = memberIndex(*cur, path.key(i));
+        if (pos == cur->objectSize())
+          return nullptr;
+        own(*cur);
+        cur = &cur->member(pos).jvalue();
+      }
+      else if (cur->isArray())
+      {
+        const uint32_t index = path.index(i);
+        if (index >= cur->arraySize())
+          return nullptr;
+        own(*cur);
+        cur = &(*cur)[index];
+      }
+      else
+        return nullptr;
+    }
+    own(*cur);
+    return cur;
+  }
+  
+  // Array position of last token ('-' or size appends), NoIndex if invalid
+  static uint32_t arrayPos(const Pointer& path, uint32_t size)
+  {
+    const uint32_t last = path.size() - 1u;
+    const uint32_t index = path.isIndex(last) ? path.index(last)
+                         : (path.key(last) == "-") ? size : (uint32_t)Pointer::NoIndex;
+    return index <= size ? index : (uint32_t)Pointer::NoIndex;
+  }
+  
+  // Store element in a specialized array if types match (returns 'false' otherwise)
+  bool writeElement(JValue& arr, uint32_t pos, const JValue& value)
+  {
+    void* oldPtr = blockOf(arr).ptr;
+    switch (arr.type())
+    {
+      case JType::BARRAY:
+      {
+        if (!value.isMetaBool())
+          return false;
+        if (pos == arr.barraySize())
+        {
+          if (arr.baFull())
+            helper::barrayGrow(arr, opa());
+          arr.incBASizeUninit();
+        }
+        arr.baValues()[pos] = value.getBool();
+        break;
+      }
+      case JType::IARRAY:
+      {
+        if (!value.isInt64())
+          return false;
+        if (pos == arr.iarraySize())
+        {
+          if (arr.iaFull())
+            helper::iarrayGrow(arr, opa());
+          arr.incIASizeUninit();
+        }
+        arr.iaValues()[pos] = value.getInt64();
+        break;
+      }
+      case JType::DARRAY:
+      {
+        if (!value.isDouble())
+          return false;
+        if (pos == arr.darraySize())
+        {
+          if (arr.daFull())
+            helper::darrayGrow(arr, opa());
+          arr.incDASizeUninit();
+        }
+        arr.daValues()[pos] = value.getDouble();
+        break;
+      }
+      default:
+        return false;
+    }
+    rebind(oldPtr, arr);
+    return true;
+  }
+  
+  // Store 'value' (owned) at 'path', replaced subtree is released
+  bool write(const Pointer& path, const JValue& value)
+  {
+    if (path.empty())
+    {
+      release(mWorking);
+      std::memcpy((void*)&mWorking, (const void*)&value, sizeof(JValue));
+      mDirty = true;
+      return true;
+    }
+    
+    JValue* parent = descend(path, path.size() - 1u);
+    if (parent == nullptr)
+      return false;
+      
+    if (parent->isObject())
+    {
+      const std::string& key = path.key(path.size() - 1u);
+      const uint32_t pos = memberIndex(*parent, key);
+      JValue* dst = nullptr;
+      if (pos < parent->objectSize())
+      {
+        dst = &parent->member(pos).jvalue();
+        release(*dst);
+      }
+      else
+      {
+        if (parent->oFull())
+        {
+          void* oldPtr = blockOf(*parent).ptr;
+          helper::objectGrow(*parent, opa());
+          rebind(oldPtr, *parent);
+        }
+        bool found = false;
+        dst = &parent->incOSize(interner().provideInterned(key.c_str(), true, found, (int32_t)key.size()));
+      }
+      std::memcpy((void*)dst, (const void*)&value, sizeof(JValue));
+      mDirty = true;
+      return true;
+    }
+    
+    if (parent->isBArray() || parent->isIArray() || parent->isDArray())
+    {
+      const uint32_t size = parent->isBArray() ? parent->barraySize()
+                          : parent->isIArray() ? parent->iarraySize() : parent->darraySize();
+      const uint32_t pos = arrayPos(path, size);
+      if (pos == (uint32_t)Pointer::NoIndex)
+        return false;
+      if (writeElement(*parent, pos, value))
+      {
+        mDirty = true;
+        return true;
+      }
+      
+      // Mixed types: fallback to generic array
+      void* oldPtr = blockOf(*parent).ptr;
+      if (parent->isBArray())
+        helper::convertBArrayToArray(*parent, 1u, opa());
+      else if (parent->isIArray())
+        helper::convertIArrayToArray(*parent, 1u, opa());
+      else
+        helper::convertDArrayToArray(*parent, 1u, opa());
+      rebind(oldPtr, *parent);
+    }
+    
+    if (parent->isArray())
+    {
+      const uint32_t pos = arrayPos(path, parent->arraySize());
+      if (pos == (uint32_t)Pointer::NoIndex)
+        return false;
+      if (pos < parent->arraySize())
+        release((*parent)[pos]);
+      else
+      {
+        if (parent->aFull())
+        {
+          void* oldPtr = blockOf(*parent).ptr;
+          helper::arrayGrow(*parent, opa());
+          rebind(oldPtr, *parent);
+        }
+        parent->incASize();
+      }
+      std::memcpy((void*)&(*parent)[pos], (const void*)&value, sizeof(JValue));
+      mDirty = true;
+      return true;
+    }
+    return false;
+  }
+  
+  bool writeOrRelease(const Pointer& path, const JValue& value)
+  {
+    if (write(path, value))
+      return true;
+    release(value);
+    return false;
+  }
+  
+  void publish(const std::shared_ptr<Version>& next)
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mCurrent = next;
+  }
+  
+public:
+  VersionedDocument()
+    : mStore(std::make_shared<Store>())
+    , mCurrent(std::make_shared<Version>(JValue(), 0u, mStore))
+  {
+    mHistory.push_back(mCurrent);
+  }
+  
+  VersionedDocument(const VersionedDocument&) = delete;
+  VersionedDocument& operator=(const VersionedDocument&) = delete;
+  
+  // Readers (thread-safe)
+  Snapshot snapshot() const
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return Snapshot(mCurrent);
+  }
+  
+  // Writer (single thread), edits are visible to readers after commit
+  // Returns 'false' if the parent of the last token does not exist (or is not a container)
+  bool set(const Pointer& path, std::nullptr_t)   { return write(path, JValue()); }
+  bool set(const Pointer& path, bool b)           { return write(path, JValue(b)); }
+  bool set(const Pointer& path, int i)            { return write(path, JValue((int64_t)i)); }
+  bool set(const Pointer& path, int64_t i64)      { return write(path, JValue(i64)); }
+  bool set(const Pointer& path, unsigned int u)   { return write(path, JValue((uint64_t)u)); }
+  bool set(const Pointer& path, uint64_t u64)     { return write(path, JValue(u64)); }
+  bool set(const Pointer& path, double d)         { return write(path, JValue(d)); }
+  bool set(const Pointer& path, JType type)
+  {
+    assert(type == JType::OBJECT || type == JType::ARRAY || type == JType::NUL);
+    return write(path, JValue(type));
+  }
+  
+  bool set(const Pointer& path, const char* str, int32_t length = -1)
+  {
+    assert(str != nullptr);
+    const uint32_t len = length >= 0 ? (uint32_t)length : (uint32_t)std::strlen(str);
+    if (len < JValue::ShortString_MaxSize)
+      return write(path, JValue(str, len));
+      
+    bool found = false;
+    const JString* js = pool()->provideInterned(str, false, found, (int32_t)len);
+    return write(path, JValue(js, len));
+  }
+  
+  // Deep copy of 'value' (strings from 'valuePool')
+  template <class Pool>
+  bool assign(const Pointer& path, const ConstValue& value, const std::shared_ptr<Pool>& valuePool)
+  {
+    JValue copy;
+    KeyInterner keys = interner();
+    helper::cloneValue(copy, value, opa(), ((void*)valuePool.get() == (void*)pool().get()) ? nullptr : &keys);
+    adopt(copy);
+    return writeOrRelease(path, copy);
+  }
+  
+  template <uint16_t OtherStringChunkSize, class OtherAllocator, uint16_t OtherObjectChunkSize>
+  bool assign(const Pointer& path, const Document<OtherStringChunkSize, OtherAllocator, OtherObjectChunkSize>& doc)
+  {
+    return assign(path, doc.croot(), doc.stringPool());
+  }
+  
+  // Remove member or element (returns 'false' if not found)
+  bool erase(const Pointer& path)
+  {
+    if (path.empty())
+      return write(path, JValue());
+      
+    JValue* parent = descend(path, path.size() - 1u);
+    if (parent == nullptr)
+      return false;
+      
+    const uint32_t last = path.size() - 1u;
+    switch (parent->type())
+    {
+      case JType::OBJECT:
+      {
+        const uint32_t pos = memberIndex(*parent, path.key(last));
+        const uint32_t size = parent->objectSize();
+        if (pos == size)
+          return false;
+        release(parent->member(pos).jvalue());
+        JMember* members = parent->oMembers();
+        std::memmove((void*)(members + pos), (void*)(members + pos + 1u), (size - pos - 1u) * sizeof(JMember));
+        parent->decOSize();
+        break;
+      }
+      case JType::ARRAY:
+      {
+        const uint32_t size = parent->arraySize();
+        if (!path.isIndex(last) || path.index(last) >= size)
+          return false;
+        const uint32_t pos = path.index(last);
+        release((*parent)[pos]);
+        JValue* values = parent->aValues();
+        std::memmove((void*)(values + pos), (void*)(values + pos + 1u), (size - pos - 1u) * sizeof(JValue));
+        parent->decASize();
+        break;
+      }
+      case JType::BARRAY:
+      {
+        const uint32_t size = parent->barraySize();
+        if (!path.isIndex(last) || path.index(last) >= size)
+          return false;
+        bool* values = parent->baValues();
+        std::memmove(values + path.index(last), values + path.index(last) + 1u, (size - path.index(last) - 1u) * sizeof(bool));
+        parent->decBASize();
+        break;
+      }
+      case JType::IARRAY:
+      {
+        const uint32_t size = parent->iarraySize();
+        if (!path.isIndex(last) || path.index(last) >= size)
+          return false;
+        int64_t* values = parent->iaValues();
+        std::memmove(values + path.index(last), values + path.index(last) + 1u, (size - path.index(last) - 1u) * sizeof(int64_t));
+        parent->decIASize();
+        break;
+      }
+      case JType::DARRAY:
+      {
+        const uint32_t size = parent->darraySize();
+        if (!path.isIndex(last) || path.index(last) >= size)
+          return false;
+        double* values = parent->daValues();
+        std::memmove(values + path.index(last), values + path.index(last) + 1u, (size - path.index(last) - 1u) * sizeof(double));
+        parent->decDASize();
+        break;
+      }
+      default:
+        return false;
+    }
+    mDirty = true;
+    return true;
+  }
+  
+  // Publish working version (no-op if unchanged), returns current version id
+  uint64_t commit()
+  {
+    if (!mDirty)
+      return mCurrent->id;
+      
+    std::shared_ptr<Version> prev = mCurrent;
+    std::shared_ptr<Version> next = std::make_shared<Version>(mWorking, ++mLastId, mStore);
+    publish(next);
+    
+    prev->retired.swap(mRetired);  // reachable from 'prev' and older only
+    mOwned.clear();
+    mDirty = false;
+    
+    mHistory.push_back(next);
+    collect();
+    return next->id;
+  }
+  
+  // Free blocks of versions without readers (oldest first), returns reclaimed versions count
+  uint32_t collect()
+  {
+    uint32_t count = 0u;
+    while (mHistory.size() > 1u && mHistory.front().use_count() == 1)
+    {
+      std::atomic_thread_fence(std::memory_order_acquire);  // readers done with its blocks
+      for (const Block& block : mHistory.front()->retired)
+        opa().deallocate(block.ptr, block.size);
+      mHistory.pop_front();
+      ++count;
+    }
+    return count;
+  }
+  
+  // Commit and republish as a deep copy in fresh arenas (strings re-interned)
+  // Previous arenas are released with the last snapshot referencing them
+  uint64_t compact()
+  {
+    commit();  // hands path copies over to the previous version (own marks dirty)
+    assert(mRetired.empty() && mOwned.empty());
+    
+    std::shared_ptr<Store> store = std::make_shared<Store>();
+    JValue root;
+    helper::cloneValue(root, mWorking, store->doc.objectAllocator(), store->doc.stringPool().get());
+    
+    std::shared_ptr<Version> next = std::make_shared<Version>(root, ++mLastId, store);
+    publish(next);
+    
+    mHistory.clear();
+    mHistory.push_back(next);
+    mStore = store;
+    std::memcpy((void*)&mWorking, (const void*)&root, sizeof(JValue));
+    return next->id;
+  }
+  
+  // Writer accessors
+  uint64_t version() const { return mCurrent->id; }
+  uint32_t versions() const { return (uint32_t)mHistory.size(); }  // published and not reclaimed
+  bool dirty() const { return mDirty; }
+  const ConstValue& working() const { return mWorking; }
+  const SharedStringPool& stringPool() const { return pool(); }
+};
+
+// Helper aliases
+using DynamicVersionedDocument = VersionedDocument<>;
+
+} // namespace lfjson
+
+#endif // LFJSON_VERSIONED_H
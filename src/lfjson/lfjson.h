@@ -8,6 +8,19 @@
 
 
 #include "Document.h"
+#include "ParseSession.h"
+#include "Tape.h"
+#include "TypeProfile.h"
+#include "Pointer.h"
+#include "Projection.h"
+#include "Ndjson.h"
+#include "Query.h"
+#include "Aggregate.h"
+#include "Hash.h"
+#include "Patch.h"
+#include "Schema.h"
+#include "Binding.h"
+#include "Versioned.h"
 
 
 #endif // LFJSON_LFJSON_H
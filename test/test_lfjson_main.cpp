@@ -10,14 +10,41 @@
 #include "lfjson/lfjson.h"
 #include "lfjson/StackAllocator.h"
 #include "lfjson/HeapAllocator.h"
+#include "lfjson/ProfilingAllocator.h"
 
 #include <cmath>
 #include <array>
 #include <string>
 #include <memory>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 using namespace lfjson;
 
+// Bound structs (see Binding.h)
+struct BindPoint {
+  int         x = 0;
+  int         y = 0;
+  std::string label;
+};
+
+struct BindShape {
+  std::string                       name;
+  uint8_t                           layer = 0;
+  double                            scale = 1.;
+  bool                              visible = false;
+  std::vector<BindPoint>            points;
+  std::vector<int64_t>              ids;
+  std::vector<bool>                 flags;
+  std::map<std::string, double>     weights;
+};
+
+LFJ_BINDING(BindPoint, LFJ_FIELD(x), LFJ_FIELD(y), LFJ_FIELD_AS("text", label))
+LFJ_BINDING(BindShape, LFJ_FIELD(name), LFJ_FIELD(layer), LFJ_FIELD(scale), LFJ_FIELD(visible),
+                       LFJ_FIELD(points), LFJ_FIELD(ids), LFJ_FIELD(flags), LFJ_FIELD(weights))
+
 
 TEST(JString, Compare)
 {
@@ -336,6 +363,26 @@ TEST(Allocators, ObjectPoolAllocator)
     EXPECT_EQ(m1, m1_);
     EXPECT_EQ(m3, m3_);
   }
+  {
+    ObjectPoolAllocator<64, HeapAllocator, true> opa;
+    
+    // Last used chunk is the trailing one (highest address), emptied then released
+    void* m0 = opa.allocate(64u);
+    void* m1 = opa.allocate(64u);
+    void* m2 = opa.allocate(64u);
+    EXPECT_EQ(opa.chunksCount(), 3u);
+    void* last = std::max({ m0, m1, m2 }, std::less<void*>());
+    opa.deallocate(last, 64u);
+    EXPECT_EQ(opa.allocate(64u), last);
+    opa.deallocate(last, 64u);
+    opa.shrink();
+    EXPECT_EQ(opa.chunksCount(), 2u);
+    
+    // Next allocation gets a new chunk (not the released one)
+    void* m3 = opa.allocate(64u);
+    EXPECT_EQ(opa.chunksCount(), 3u);
+    opa.deallocate(m3, 64u);
+  }
 }
 
 TEST(Allocators, AllocatorExtract)
@@ -1113,6 +1160,33 @@ TEST(Document, Deserialize_Iterate)
   }
 }
 
+TEST(Document, Deserialize_CopiedStrings)
+{
+  // Copied strings, length given or unknown (-1)
+  DynamicDocument doc;
+  {
+    auto handler = doc.makeHandler();
+    EXPECT_TRUE(handler.startObject());
+    EXPECT_TRUE(handler.pushKey("member", true));
+    EXPECT_TRUE(handler.pushString("short", true));
+    EXPECT_TRUE(handler.pushKey("array", true));
+    EXPECT_TRUE(handler.startArray());
+    EXPECT_TRUE(handler.pushString("short", true));
+    EXPECT_TRUE(handler.pushString("sized", true, 5));
+    EXPECT_TRUE(handler.pushString("this is a long string for test", true));
+    EXPECT_TRUE(handler.endArray(3u));
+    EXPECT_TRUE(handler.endObject(2u));
+    handler.finalize();
+  }
+  auto rt = doc.root();
+  EXPECT_STREQ(rt["member"].getShortString(), "short");
+  EXPECT_EQ(rt["member"].shortStringSize(), 5u);
+  EXPECT_STREQ(rt["array"][0].getShortString(), "short");
+  EXPECT_EQ(rt["array"][0].shortStringSize(), 5u);
+  EXPECT_STREQ(rt["array"][1].getShortString(), "sized");
+  EXPECT_STREQ(rt["array"][2].getLongString(), "this is a long string for test");
+}
+
 TEST(Document, SpecializedArray)
 {
   { // barray
@@ -1534,3 +1608,1906 @@ TEST(Document, ReuseStringPool)
   uint32_t size2 = sp->size();
   EXPECT_EQ(size2, size1);  // reused
 }
+
+TEST(Document, CompiledPointer)
+{
+  { // syntax
+    DynamicPointer ptr("/a~1b/~0c/12/");
+    EXPECT_EQ(ptr.size(), 4u);
+    EXPECT_EQ(ptr.key(0), "a/b");
+    EXPECT_EQ(ptr.key(1), "~c");
+    EXPECT_TRUE(ptr.isIndex(2));
+    EXPECT_EQ(ptr.index(2), 12u);
+    EXPECT_EQ(ptr.key(3), "");
+    EXPECT_FALSE(ptr.isIndex(3));
+    
+    EXPECT_TRUE(DynamicPointer("").empty());
+    EXPECT_FALSE(DynamicPointer("/01").isIndex(0));
+    EXPECT_FALSE(ptr.parse("a/b"));
+    EXPECT_FALSE(ptr.parse("/a~2"));
+    EXPECT_FALSE(ptr.parse("/a~"));
+    EXPECT_TRUE(ptr.empty());
+    EXPECT_THROW(DynamicPointer("/~"), std::invalid_argument);
+  }
+  { // find
+    DynamicDocument doc;
+    auto rt = doc.root();
+    rt["statuses"][0]["user"]["screen_name"] = "this is a long string for test";
+    rt["statuses"][1]["user"]["id"] = 42;
+    auto ia = rt["ids"].toIArray();
+    ia.iarrayPushBack(7);
+    ia.iarrayPushBack(8);
+    
+    DynamicPointer ptr("/statuses/0/user/screen_name");
+    auto val = ptr.find(doc);
+    ASSERT_NE(val, nullptr);
+    EXPECT_TRUE(val->isLongString());
+    EXPECT_EQ(ptr.find(doc), val);  // cached handles
+    EXPECT_EQ(DynamicPointer("").find(doc), &doc.croot());
+    
+    EXPECT_EQ(DynamicPointer("/statuses/2").find(doc), nullptr);
+    EXPECT_EQ(DynamicPointer("/statuses/x").find(doc), nullptr);
+    EXPECT_EQ(DynamicPointer("/missing").find(doc), nullptr);
+    
+    // Specialized array element
+    DynamicPointer iptr("/ids/1");
+    EXPECT_EQ(iptr.find(doc), nullptr);
+    uint32_t idx = 0u;
+    auto arr = iptr.find(doc, &idx);
+    ASSERT_NE(arr, nullptr);
+    EXPECT_TRUE(arr->isIArray());
+    EXPECT_EQ(idx, 1u);
+    EXPECT_EQ(arr->iarrayValues()[idx], 8);
+    
+    // Key interned after first evaluation
+    DynamicPointer lptr("/later");
+    EXPECT_EQ(lptr.find(doc), nullptr);
+    rt["later"] = true;
+    auto lval = lptr.find(doc);
+    ASSERT_NE(lval, nullptr);
+    EXPECT_TRUE(lval->isTrue());
+    
+    // Pool released and refilled
+    doc.clear();
+    EXPECT_EQ(ptr.find(doc), nullptr);
+    auto rt2 = doc.root();
+    rt2["statuses"][0]["user"]["screen_name"] = 1;
+    val = ptr.find(doc);
+    ASSERT_NE(val, nullptr);
+    EXPECT_TRUE(val->isInt64());
+  }
+}
+
+TEST(Document, CompiledQuery)
+{
+  { // syntax
+    EXPECT_TRUE(DynamicQuery("$").empty());
+    EXPECT_EQ(DynamicQuery("$.store.book[*].author").size(), 4u);
+    EXPECT_EQ(DynamicQuery("$..book[-1:]").size(), 2u);
+    EXPECT_EQ(DynamicQuery("$['store'][?(@.price < 10.5)]").size(), 2u);
+    EXPECT_EQ(DynamicQuery("$.a[?@ != 'x']").size(), 2u);
+    
+    DynamicQuery query;
+    EXPECT_FALSE(query.parse("store"));
+    EXPECT_FALSE(query.parse("$.a["));
+    EXPECT_FALSE(query.parse("$.a[?(@.b ==)]"));
+    EXPECT_FALSE(query.parse("$.a['b]"));
+    EXPECT_FALSE(query.parse("$.a[-]"));
+    EXPECT_FALSE(query.parse("$.a[-:]"));
+    EXPECT_FALSE(query.parse("$.a[1:-]"));
+    EXPECT_THROW(DynamicQuery("$."), std::invalid_argument);
+  }
+  { // evaluate
+    DynamicDocument doc;
+    auto rt = doc.root();
+    auto books = rt["store"]["book"];
+    const char* authors[] = { "Nigel Rees", "Evelyn Waugh", "Herman Melville", "J. R. R. Tolkien" };
+    const double prices[] = { 8.95, 12.99, 8.99, 22.99 };
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+      books[i]["author"] = authors[i];
+      books[i]["price"] = prices[i];
+      books[i]["category"] = i == 0 ? "reference with a long name" : "fiction";
+    }
+    books[2]["isbn"] = "0-553-21311-3";
+    rt["store"]["bicycle"]["price"] = 19.95;
+    auto ia = rt["ids"].toIArray();
+    for (int64_t i = 0; i < 100; ++i)
+      ia.iarrayPushBack(i * 3);
+    auto da = rt["ratios"].toDArray();
+    da.darrayPushBack(0.5);
+    da.darrayPushBack(1.5);
+    da.darrayPushBack(2.5);
+    
+    std::vector<DynamicQuery::Match> res;
+    
+    DynamicQuery("$.store.book[*].author").evaluate(doc, res);
+    ASSERT_EQ(res.size(), 4u);
+    EXPECT_STREQ(res[3].value->asString(), "J. R. R. Tolkien");
+    
+    DynamicQuery("$..price").evaluate(doc, res);
+    EXPECT_EQ(res.size(), 5u);
+    
+    DynamicQuery("$.store.book[-1].price").evaluate(doc, res);
+    ASSERT_EQ(res.size(), 1u);
+    EXPECT_EQ(res[0].value->getDouble(), 22.99);
+    
+    DynamicQuery("$.store.book[::-2].author").evaluate(doc, res);
+    ASSERT_EQ(res.size(), 2u);
+    EXPECT_STREQ(res[0].value->asString(), "J. R. R. Tolkien");
+    EXPECT_STREQ(res[1].value->asString(), "Evelyn Waugh");
+    
+    DynamicQuery("$.store.book[?(@.price < 10)].author").evaluate(doc, res);
+    ASSERT_EQ(res.size(), 2u);
+    EXPECT_STREQ(res[1].value->asString(), "Herman Melville");
+    
+    DynamicQuery("$.store.book[?(@.isbn)]").evaluate(doc, res);
+    EXPECT_EQ(res.size(), 1u);
+    
+    DynamicQuery("$..book[?(@.category == 'reference with a long name')].price").evaluate(doc, res);
+    ASSERT_EQ(res.size(), 1u);
+    EXPECT_EQ(res[0].value->getDouble(), 8.95);
+    
+    DynamicQuery("$.store.book[?(@.category != 'fiction')]").evaluate(doc, res);
+    EXPECT_EQ(res.size(), 1u);
+    
+    DynamicQuery("$.store.*").evaluate(doc, res);
+    EXPECT_EQ(res.size(), 2u);
+    
+    DynamicQuery("$.missing[0]").evaluate(doc, res);
+    EXPECT_TRUE(res.empty());
+    
+    // Specialized arrays (index sets)
+    DynamicQuery("$.ids[?(@ >= 150)]").evaluate(doc, res);
+    ASSERT_EQ(res.size(), 50u);
+    EXPECT_TRUE(res[0].isElement());
+    EXPECT_EQ(res[0].value->iarrayValues()[res[0].index], 150);
+    EXPECT_EQ(res[49].index, 99u);
+    
+    DynamicQuery("$.ids[?(@ < 7.5)]").evaluate(doc, res);
+    EXPECT_EQ(res.size(), 3u);
+    
+    DynamicQuery("$.ids[10:20:5]").evaluate(doc, res);
+    ASSERT_EQ(res.size(), 2u);
+    EXPECT_EQ(res[1].index, 15u);
+    
+    DynamicQuery("$.ratios[?(@ > 1)]").evaluate(doc, res);
+    ASSERT_EQ(res.size(), 2u);
+    EXPECT_EQ(res[0].value->darrayValues()[res[0].index], 1.5);
+    
+    DynamicQuery("$..[?(@ == 2.5)]").evaluate(doc, res);
+    EXPECT_EQ(res.size(), 1u);
+    
+    // NaN is unordered: only '!=' matches it
+    auto mixed = rt["mixed"];
+    mixed[0] = std::numeric_limits<double>::quiet_NaN();
+    mixed[1] = 5;
+    mixed[2] = "x";
+    DynamicQuery("$.mixed[?(@ == 5)]").evaluate(doc, res);
+    EXPECT_EQ(res.size(), 1u);
+    DynamicQuery("$.mixed[?(@ <= 5)]").evaluate(doc, res);
+    EXPECT_EQ(res.size(), 1u);
+    DynamicQuery("$.mixed[?(@ >= 5)]").evaluate(doc, res);
+    EXPECT_EQ(res.size(), 1u);
+    DynamicQuery("$.mixed[?(@ != 5)]").evaluate(doc, res);
+    EXPECT_EQ(res.size(), 2u);
+  }
+}
+
+TEST(Document, Aggregate)
+{
+  DynamicDocument doc;
+  auto rt = doc.root();
+  auto ia = rt["ints"].toIArray();
+  auto da = rt["doubles"].toDArray();
+  auto ba = rt["bools"].toBArray();
+  
+  // Big arrays (JBig storage) with odd tail
+  const uint32_t count = 70001u;
+  uint64_t seed = 42u;
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+    const int64_t v = (int64_t)(seed >> 40) - (1 << 23);
+    ia.iarrayPushBack(v);
+    da.darrayPushBack((double)v / 7.);
+    ba.barrayPushBack((v & 3) == 0);
+  }
+  // Reference
+  const int64_t* ints = rt["ints"].iarrayCBegin();
+  const double*  dbls = rt["doubles"].darrayCBegin();
+  const bool*    bls  = rt["bools"].barrayCBegin();
+  int64_t iSum = 0, iMin = ints[0], iMax = ints[0];
+  uint32_t iMaxPos = 0u, iGt = 0u, dLe = 0u, bTrue = 0u;
+  double dMin = dbls[0], dMax = dbls[0], dMean = 0.;
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    iSum += ints[i];
+    iMin = std::min(iMin, ints[i]);
+    if (ints[i] > iMax)
+    {
+      iMax = ints[i];
+      iMaxPos = i;
+    }
+    iGt += ints[i] > 1000;
+    dMin = std::min(dMin, dbls[i]);
+    dMax = std::max(dMax, dbls[i]);
+    dMean += dbls[i];
+    dLe += dbls[i] <= -0.5;
+    bTrue += bls[i];
+  }
+  dMean /= count;
+  double dVar = 0.;
+  for (uint32_t i = 0; i < count; ++i)
+    dVar += (dbls[i] - dMean) * (dbls[i] - dMean);
+  dVar /= count;
+  
+  for (bool simd : { false, true })  // same results on both paths
+  {
+    helper::simdEnabled() = simd;
+    const ConstValue& ints_ = *DynamicPointer("/ints").find(doc);
+    const ConstValue& dbls_ = *DynamicPointer("/doubles").find(doc);
+    const ConstValue& bls_  = *DynamicPointer("/bools").find(doc);
+    
+    EXPECT_EQ(iarraySum(ints_), iSum);
+    EXPECT_EQ(iarrayMin(ints_), iMin);
+    EXPECT_EQ(iarrayMax(ints_), iMax);
+    EXPECT_EQ(iarrayArgMax(ints_), iMaxPos);
+    EXPECT_EQ(iarrayCountIf(ints_, QueryOp::GT, 1000), iGt);
+    EXPECT_EQ(iarrayCountIf(ints_, QueryOp::LE, 1000), count - iGt);
+    EXPECT_NEAR(iarrayMean(ints_), (double)iSum / count, 1e-6);
+    EXPECT_GT(iarrayVariance(ints_), 0.);
+    
+    EXPECT_EQ(darrayMin(dbls_), dMin);
+    EXPECT_EQ(darrayMax(dbls_), dMax);
+    EXPECT_EQ(darrayArgMax(dbls_), iMaxPos);
+    EXPECT_NEAR(darrayMean(dbls_), dMean, 1e-6);
+    EXPECT_NEAR(darrayVariance(dbls_), dVar, dVar * 1e-9);
+    EXPECT_EQ(darrayCountIf(dbls_, QueryOp::LE, -0.5), dLe);
+    EXPECT_EQ(darrayCountIf(dbls_, QueryOp::EXISTS, 0.), count);
+    
+    EXPECT_EQ(barraySum(bls_), bTrue);
+    EXPECT_FALSE(barrayMin(bls_));
+    EXPECT_TRUE(barrayMax(bls_));
+    EXPECT_EQ(barrayCountIf(bls_, QueryOp::EQ, false), count - bTrue);
+    EXPECT_EQ(barrayCountIf(bls_, QueryOp::GE, false), count);
+    EXPECT_EQ(bls[barrayArgMax(bls_)], true);
+    
+    uint32_t bins[4];
+    EXPECT_EQ(iarrayHistogram(ints_, (double)iMin, (double)iMax, 4u, bins), count);
+    EXPECT_EQ(bins[0] + bins[1] + bins[2] + bins[3], count);
+    EXPECT_EQ(darrayHistogram(dbls_, 0., 1e9, 2u, bins), count - (uint32_t)std::count_if(dbls, dbls + count, [](double d) { return d < 0.; }));
+  }
+  helper::simdEnabled() = true;
+  
+  // Double sums are deterministic across paths
+  const ConstValue& dv = *DynamicPointer("/doubles").find(doc);
+  helper::simdEnabled() = false;
+  const double sumScalar = darraySum(dv);
+  helper::simdEnabled() = true;
+  EXPECT_EQ(darraySum(dv), sumScalar);
+  
+  // Extremes seeded from elements, not from type limits
+  auto inf = rt["inf"].toDArray();
+  inf.darrayPushBack(std::numeric_limits<double>::infinity());
+  auto ninf = rt["ninf"].toDArray();
+  for (uint32_t i = 0; i < 5u; ++i)  // vector and tail
+    ninf.darrayPushBack(-std::numeric_limits<double>::infinity());
+  for (bool simd : { false, true })
+  {
+    helper::simdEnabled() = simd;
+    EXPECT_EQ(darrayMin(*DynamicPointer("/inf").find(doc)), std::numeric_limits<double>::infinity());
+    EXPECT_EQ(darrayMax(*DynamicPointer("/ninf").find(doc)), -std::numeric_limits<double>::infinity());
+  }
+  helper::simdEnabled() = true;
+  
+  // NaNs are skipped on both paths (in vector lanes, seed and tail)
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  auto nans = rt["nans"].toDArray();
+  for (double d : { nan, 3., 1., nan, 2., 5., 4., nan, -1., nan })
+    nans.darrayPushBack(d);
+  auto allNans = rt["allNans"].toDArray();
+  for (uint32_t i = 0; i < 6u; ++i)
+    allNans.darrayPushBack(nan);
+  for (bool simd : { false, true })
+  {
+    helper::simdEnabled() = simd;
+    const ConstValue& nans_ = *DynamicPointer("/nans").find(doc);
+    EXPECT_EQ(darrayMin(nans_), -1.);
+    EXPECT_EQ(darrayMax(nans_), 5.);
+    EXPECT_EQ(darrayArgMax(nans_), 5u);
+    EXPECT_TRUE(std::isnan(darrayMin(*DynamicPointer("/allNans").find(doc))));
+    EXPECT_TRUE(std::isnan(darrayMax(*DynamicPointer("/allNans").find(doc))));
+    EXPECT_EQ(darrayArgMax(*DynamicPointer("/allNans").find(doc)), NoElement);
+    uint32_t bins[2];
+    EXPECT_EQ(darrayHistogram(nans_, -1., 5., 2u, bins), 6u);
+    EXPECT_EQ(bins[0] + bins[1], 6u);
+  }
+  helper::simdEnabled() = true;
+  
+  // Integer elements against real literal
+  std::vector<uint32_t> indices(count);
+  EXPECT_EQ(helper::selectIndices(ints, count, QueryOp::LT, 1000.5, indices.data()), count - iGt);
+  EXPECT_EQ(helper::selectIndices(ints, count, QueryOp::EQ, 0.5, indices.data()), 0u);
+  EXPECT_EQ(helper::selectIndices(ints, count, QueryOp::NE, 0.5, indices.data()), count);
+  EXPECT_EQ(helper::selectIndices(ints, count, QueryOp::GT, 1e30, indices.data()), 0u);
+  for (QueryOp op : { QueryOp::EQ, QueryOp::LT, QueryOp::LE, QueryOp::GT, QueryOp::GE })
+    EXPECT_EQ(helper::selectIndices(ints, count, op, nan, indices.data()), 0u);
+  EXPECT_EQ(helper::selectIndices(ints, count, QueryOp::NE, nan, indices.data()), count);
+}
+
+TEST(Document, CloneFrom)
+{
+  DynamicDocument tmpl;
+  {
+    auto rt = tmpl.root();
+    rt["name"] = "this is a long string for test";
+    rt["id"] = 42;
+    rt["tags"][0] = "short";
+    rt["tags"][1] = "this is another long string for test";
+    rt["nested"]["deep"]["flag"] = true;
+    rt["nested"]["empty"].toObject();
+    auto ia = rt["ints"].toIArray();
+    for (int64_t i = 0; i < 70000; ++i)  // big
+      ia.iarrayPushBack(i);
+    auto da = rt["doubles"].toDArray();
+    da.darrayPushBack(0.5);
+    rt["bools"].toBArray();
+  }
+  const ConstValue& src = tmpl.croot();
+  const char* srcName = DynamicPointer("/name").find(tmpl)->getLongString();
+  
+  auto check = [](DynamicDocument& doc) {
+    auto rt = doc.root();
+    EXPECT_EQ(rt.objectSize(), 7u);
+    EXPECT_STREQ(rt["name"].getLongString(), "this is a long string for test");
+    EXPECT_EQ(rt["id"].getInt64(), 42);
+    EXPECT_STREQ(rt["tags"][0].getShortString(), "short");
+    EXPECT_STREQ(rt["tags"][1].getLongString(), "this is another long string for test");
+    EXPECT_TRUE(rt["nested"]["deep"]["flag"].isTrue());
+    EXPECT_TRUE(rt["nested"]["empty"].objectEmpty());
+    EXPECT_EQ(rt["ints"].iarraySize(), 70000u);
+    EXPECT_EQ(rt["ints"].iarrayCValue(69999), 69999);
+    EXPECT_EQ(rt["doubles"].darrayCValue(0), 0.5);
+    EXPECT_TRUE(rt["bools"].isBArray());
+  };
+  
+  { // shared pool: verbatim strings
+    DynamicDocument doc(tmpl.stringPool());
+    const uint32_t poolSize = tmpl.stringPool()->size();
+    doc.cloneFrom(tmpl);
+    EXPECT_EQ(tmpl.stringPool()->size(), poolSize);
+    EXPECT_EQ(DynamicPointer("/name").find(doc)->getLongString(), srcName);
+    EXPECT_NE(doc.croot().objectMembers(), src.objectMembers());
+    check(doc);
+    
+    // Independent from source
+    doc.root()["tags"][0] = 1;
+    EXPECT_TRUE(DynamicPointer("/tags/0").find(tmpl)->isShortString());
+  }
+  { // other pool: re-interned
+    DynamicDocument doc;
+    doc.root()["old"] = "to be replaced by clone";
+    doc.cloneFrom(src, tmpl.stringPool());
+    EXPECT_NE(DynamicPointer("/name").find(doc)->getLongString(), srcName);
+    EXPECT_NE(doc.stringPool()->get("nested"), nullptr);
+    check(doc);
+  }
+  { // subtree, within same document
+    DynamicDocument doc;
+    doc.cloneFrom(src, tmpl.stringPool());
+    auto rt = doc.root();
+    auto cp = rt["copy"];
+    cp.copyFrom(rt["nested"]);
+    EXPECT_TRUE(rt["copy"]["deep"]["flag"].isTrue());
+    rt["nested"].copyFrom(DynamicPointer("/nested/deep").find(doc)[0]);  // child into parent
+    EXPECT_TRUE(rt["nested"]["flag"].isTrue());
+    EXPECT_EQ(rt["nested"].objectSize(), 1u);
+  }
+}
+
+TEST(Document, VersionedDocument)
+{
+  using VDoc = DynamicVersionedDocument;
+  VDoc vdoc;
+  
+  EXPECT_EQ(vdoc.commit(), 0u);  // unchanged
+  EXPECT_TRUE(vdoc.set(DynamicPointer(""), JType::OBJECT));
+  EXPECT_TRUE(vdoc.set(DynamicPointer("/name"), "this is a long string for test"));
+  EXPECT_TRUE(vdoc.set(DynamicPointer("/conf"), JType::OBJECT));
+  EXPECT_TRUE(vdoc.set(DynamicPointer("/conf/a"), 1));
+  EXPECT_TRUE(vdoc.set(DynamicPointer("/list"), JType::ARRAY));
+  EXPECT_TRUE(vdoc.set(DynamicPointer("/list/-"), true));
+  EXPECT_TRUE(vdoc.set(DynamicPointer("/list/1"), 2.5));
+  EXPECT_FALSE(vdoc.set(DynamicPointer("/missing/a"), 1));
+  EXPECT_FALSE(vdoc.set(DynamicPointer("/list/5"), 1));
+  {
+    DynamicDocument src;
+    auto rt = src.root();
+    auto ia = rt["ints"].toIArray();
+    for (int64_t i = 0; i < 70000; ++i)  // big
+      ia.iarrayPushBack(i);
+    rt["str"] = "another long string from other pool";
+    EXPECT_TRUE(vdoc.assign(DynamicPointer("/data"), src));
+  }
+  EXPECT_EQ(vdoc.commit(), 1u);
+  
+  VDoc::Snapshot s1 = vdoc.snapshot();
+  EXPECT_EQ(s1.version(), 1u);
+  EXPECT_STREQ(s1.find(DynamicPointer("/name"))->getLongString(), "this is a long string for test");
+  EXPECT_EQ(s1.find(DynamicPointer("/conf/a"))->getInt64(), 1);
+  EXPECT_DOUBLE_EQ(s1.find(DynamicPointer("/list/1"))->getDouble(), 2.5);
+  EXPECT_STREQ(s1.find(DynamicPointer("/data/str"))->getLongString(), "another long string from other pool");
+  uint32_t elem = 0u;
+  EXPECT_EQ(s1.find(DynamicPointer("/data/ints/69999"), &elem)->iarrayValues()[elem], 69999);
+  
+  // Path copy: edited nodes are private, siblings are shared
+  EXPECT_TRUE(vdoc.set(DynamicPointer("/conf/a"), 2));
+  EXPECT_TRUE(vdoc.set(DynamicPointer("/data/ints/0"), (int64_t)-1));
+  EXPECT_TRUE(vdoc.erase(DynamicPointer("/list/0")));
+  EXPECT_FALSE(vdoc.erase(DynamicPointer("/conf/b")));
+  EXPECT_TRUE(vdoc.dirty());
+  EXPECT_EQ(s1.find(DynamicPointer("/conf/a"))->getInt64(), 1);  // not published
+  EXPECT_EQ(vdoc.commit(), 2u);
+  
+  VDoc::Snapshot s2 = vdoc.snapshot();
+  EXPECT_EQ(s1.find(DynamicPointer("/conf/a"))->getInt64(), 1);
+  EXPECT_EQ(s2.find(DynamicPointer("/conf/a"))->getInt64(), 2);
+  EXPECT_EQ(s1.find(DynamicPointer("/data/ints/0"), &elem)->iarrayValues()[elem], 0);
+  EXPECT_EQ(s2.find(DynamicPointer("/data/ints/0"), &elem)->iarrayValues()[elem], -1);
+  EXPECT_EQ(s1.find(DynamicPointer("/list"))->arraySize(), 2u);
+  EXPECT_EQ(s2.find(DynamicPointer("/list"))->arraySize(), 1u);
+  EXPECT_NE(s1.root().objectMembers(), s2.root().objectMembers());
+  EXPECT_EQ(s1.find(DynamicPointer("/name"))->getLongString(), s2.find(DynamicPointer("/name"))->getLongString());
+  // Key matching a published value string: shared JString is left untouched
+  const JString* nameStr = vdoc.stringPool()->get("this is a long string for test");
+  ASSERT_NE(nameStr, nullptr);
+  EXPECT_FALSE(nameStr->isKey());
+  EXPECT_TRUE(vdoc.set(DynamicPointer("/this is a long string for test"), 1));
+  EXPECT_FALSE(nameStr->isKey());
+  EXPECT_TRUE(vdoc.erase(DynamicPointer("/this is a long string for test")));
+  EXPECT_TRUE(vdoc.set(DynamicPointer("/conf/b"), JType::ARRAY));
+  EXPECT_EQ(vdoc.commit(), 3u);
+  VDoc::Snapshot s3 = vdoc.snapshot();
+  EXPECT_EQ(s2.find(DynamicPointer("/data/ints"))->iarrayValues(), s3.find(DynamicPointer("/data/ints"))->iarrayValues());
+  
+  // Reclaim: versions are freed oldest first, once released
+  EXPECT_EQ(vdoc.versions(), 3u);  // version 0 had no reader
+  s2.reset();
+  EXPECT_EQ(vdoc.collect(), 0u);  // 's1' still alive
+  s1.reset();
+  EXPECT_EQ(vdoc.collect(), 2u);
+  EXPECT_EQ(vdoc.versions(), 1u);
+  EXPECT_EQ(s3.find(DynamicPointer("/conf/a"))->getInt64(), 2);
+  
+  // Compaction: fresh arenas, old snapshot still valid
+  EXPECT_EQ(vdoc.compact(), 4u);
+  VDoc::Snapshot s4 = vdoc.snapshot();
+  EXPECT_NE(vdoc.stringPool()->get("name"), nullptr);
+  EXPECT_NE(s3.find(DynamicPointer("/name"))->getLongString(), s4.find(DynamicPointer("/name"))->getLongString());
+  EXPECT_STREQ(s4.find(DynamicPointer("/name"))->getLongString(), "this is a long string for test");
+  EXPECT_EQ(s4.find(DynamicPointer("/data/ints/69999"), &elem)->iarrayValues()[elem], 69999);
+  s3.reset();
+  EXPECT_EQ(vdoc.versions(), 1u);
+  
+  // Failed writes then compaction: no path copy left behind in the old arenas
+  {
+    VDoc other;
+    EXPECT_TRUE(other.set(DynamicPointer(""), JType::OBJECT));
+    EXPECT_TRUE(other.set(DynamicPointer("/a"), JType::OBJECT));
+    EXPECT_TRUE(other.set(DynamicPointer("/a/x"), 1));
+    EXPECT_TRUE(other.set(DynamicPointer("/l"), JType::ARRAY));
+    other.commit();
+    EXPECT_FALSE(other.set(DynamicPointer("/a/b/c"), 2));  // missing parent
+    EXPECT_FALSE(other.dirty());
+    EXPECT_FALSE(other.set(DynamicPointer("/l/3"), 2));    // parent copied, index invalid
+    other.compact();
+    EXPECT_FALSE(other.dirty());
+    for (int i = 0; i < 4; ++i)
+    {
+      EXPECT_TRUE(other.set(DynamicPointer("/a/x"), i));
+      EXPECT_TRUE(other.set(DynamicPointer("/a/y"), JType::ARRAY));
+      other.commit();
+    }
+    EXPECT_EQ(other.snapshot().find(DynamicPointer("/a/x"))->getInt64(), 3);
+  }
+  
+  // Concurrent readers: each snapshot is consistent
+  EXPECT_TRUE(vdoc.set(DynamicPointer("/conf/a"), 0));
+  vdoc.commit();
+  std::atomic<bool> done(false);
+  std::atomic<uint32_t> errors(0u);
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; ++t)
+  {
+    readers.emplace_back([&]() {
+      const DynamicPointer pa("/conf/a");
+      const DynamicPointer pb("/conf/b");
+      while (!done.load())
+      {
+        VDoc::Snapshot snap = vdoc.snapshot();
+        const ConstValue* a = snap.find(pa);
+        const ConstValue* b = snap.find(pb);
+        if (a == nullptr || b == nullptr || !b->isArray() || a->getInt64() != (int64_t)b->arraySize())
+          ++errors;
+      }
+    });
+  }
+  for (int i = 1; i <= 2000; ++i)
+  {
+    vdoc.set(DynamicPointer("/conf/a"), i);
+    vdoc.set(DynamicPointer("/conf/b/-"), "a long string value for each element");
+    vdoc.commit();
+  }
+  done.store(true);
+  for (auto& reader : readers)
+    reader.join();
+  EXPECT_EQ(errors.load(), 0u);
+  EXPECT_EQ(vdoc.snapshot().find(DynamicPointer("/conf/b"))->arraySize(), 2000u);
+}
+
+TEST(Document, Patch)
+{
+  DynamicDocument from;
+  DynamicDocument to(from.stringPool());
+  {
+    auto rt = from.root();
+    rt["a"] = 1;
+    rt["b"] = "this is a long string for test";
+    auto ia = rt["arr"].toIArray();
+    for (int64_t i = 1; i <= 3; ++i)
+      ia.iarrayPushBack(i);
+    rt["obj"]["x"] = true;
+    rt["obj"]["y"] = nullptr;
+    rt["list"][0]["k"] = 1;
+    rt["list"][1]["k"] = 2;
+    rt["gone"] = 1;
+    rt["a/b~c"] = 0;
+  }
+  {
+    auto rt = to.root();
+    rt["a"] = 2;
+    rt["b"] = "this is a long string for test";
+    auto ia = rt["arr"].toIArray();
+    ia.iarrayPushBack(1);
+    ia.iarrayPushBack(5);
+    ia.iarrayPushBack(3);
+    ia.iarrayPushBack(4);
+    rt["obj"]["x"] = true;
+    rt["obj"]["z"] = "short";
+    rt["list"][0]["k"] = 1;
+    rt["a/b~c"] = 1;
+    rt["new"] = "another long string for test";
+  }
+  EXPECT_FALSE(deepEquals(from.croot(), to.croot(), MemberOrder::INSENSITIVE, true));
+  
+  DynamicDocument patch;
+  EXPECT_EQ(diff(from, to, patch), 9u);
+  auto ops = patch.root();
+  EXPECT_STREQ(ops[0]["op"].asString(), "replace");
+  EXPECT_STREQ(ops[0]["path"].asString(), "/a");
+  EXPECT_EQ(ops[0]["value"].getInt64(), 2);
+  EXPECT_STREQ(ops[1]["path"].asString(), "/arr/1");
+  EXPECT_STREQ(ops[2]["op"].asString(), "add");
+  EXPECT_STREQ(ops[2]["path"].asString(), "/arr/3");
+  EXPECT_STREQ(ops[7]["path"].asString(), "/a~1b~0c");
+  
+  // Apply (other pool) then no more differences
+  EXPECT_TRUE(apply(from, patch));
+  EXPECT_TRUE(deepEquals(from.croot(), to.croot(), MemberOrder::INSENSITIVE, true));
+  EXPECT_TRUE(from.croot().objectMembers()[2].value().isIArray());
+  DynamicDocument empty;
+  EXPECT_EQ(diff(from, to, empty), 0u);
+  
+  // Text compares across pools
+  DynamicDocument other;
+  other.cloneFrom(to);
+  EXPECT_TRUE(deepEquals(other.croot(), to.croot(), MemberOrder::INSENSITIVE, false));
+  DynamicDocument none;
+  EXPECT_EQ(diff(other, to, none), 0u);
+  
+  // Other operations
+  DynamicDocument ops2;
+  {
+    auto rt = ops2.root();
+    rt[0]["op"] = "move";
+    rt[0]["from"] = "/list/0";
+    rt[0]["path"] = "/moved";
+    rt[1]["op"] = "copy";
+    rt[1]["from"] = "/arr/1";
+    rt[1]["path"] = "/arr/-";
+    rt[2]["op"] = "add";
+    rt[2]["path"] = "/arr/0";
+    rt[2]["value"] = "str";
+    rt[3]["op"] = "test";
+    rt[3]["path"] = "/moved/k";
+    rt[3]["value"] = 1;
+    rt[4]["op"] = "remove";
+    rt[4]["path"] = "/list";
+  }
+  EXPECT_TRUE(apply(from, ops2));
+  auto rt = from.root();
+  EXPECT_EQ(rt["moved"]["k"].getInt64(), 1);
+  EXPECT_TRUE(rt["arr"].isArray());  // converted
+  EXPECT_EQ(rt["arr"].arraySize(), 6u);
+  EXPECT_STREQ(rt["arr"][0].asString(), "str");
+  EXPECT_EQ(rt["arr"][5].getInt64(), 5);
+  EXPECT_EQ(rt.objectFindValue("list"), nullptr);
+  
+  DynamicDocument bad;
+  {
+    auto rt = bad.root();
+    rt[0]["op"] = "test";
+    rt[0]["path"] = "/a";
+    rt[0]["value"] = 3;
+  }
+  EXPECT_FALSE(apply(from, bad));
+  bad.root()[0]["op"] = "replace";
+  bad.root()[0]["path"] = "/missing/x";
+  EXPECT_FALSE(apply(from, bad));
+  bad.root()[0]["op"] = "move";
+  bad.root()[0]["from"] = "/obj";
+  bad.root()[0]["path"] = "/obj/x";
+  EXPECT_FALSE(apply(from, bad));
+  bad.root()[0]["from"] = "/missing";  // same path: 'from' must exist
+  bad.root()[0]["path"] = "/missing";
+  EXPECT_FALSE(apply(from, bad));
+  bad.root()[0]["from"] = "/moved";
+  bad.root()[0]["path"] = "/moved";
+  EXPECT_TRUE(apply(from, bad));
+}
+
+TEST(Document, StructuralHash)
+{
+  DynamicDocument a;
+  DynamicDocument b;  // other pool, other members order, generic array
+  {
+    auto rt = a.root();
+    rt["name"] = "this is a long string for test";
+    rt["n"] = 3;
+    rt["d"] = 1.5;
+    auto ia = rt["ints"].toIArray();
+    for (int64_t i = 0; i < 4; ++i)
+      ia.iarrayPushBack(i * 10);
+    rt["obj"]["x"] = true;
+    rt["obj"]["y"] = nullptr;
+  }
+  {
+    auto rt = b.root();
+    rt["obj"]["y"] = nullptr;
+    rt["obj"]["x"] = true;
+    for (int64_t i = 0; i < 4; ++i)
+      rt["ints"][(uint32_t)i] = i * 10;
+    rt["d"] = 1.5;
+    rt["n"] = 3;
+    rt["name"] = "this is a long string for test";
+  }
+  EXPECT_TRUE(b.croot().objectMembers()[1].value().isArray());
+  EXPECT_TRUE(deepEquals(a, b));
+  EXPECT_EQ(structuralHash(a.croot()), structuralHash(b.croot()));
+  
+  // Members order
+  EXPECT_FALSE(deepEquals(a, b, MemberOrder::SENSITIVE));
+  EXPECT_NE(structuralHash(a.croot(), MemberOrder::SENSITIVE), structuralHash(b.croot(), MemberOrder::SENSITIVE));
+  DynamicDocument c;
+  c.cloneFrom(a);
+  EXPECT_TRUE(deepEquals(a, c, MemberOrder::SENSITIVE));
+  EXPECT_EQ(structuralHash(a.croot(), MemberOrder::SENSITIVE), structuralHash(c.croot(), MemberOrder::SENSITIVE));
+  
+  // Same pool (pointer compares)
+  DynamicDocument d(a.stringPool());
+  d.cloneFrom(b);
+  EXPECT_TRUE(deepEquals(a, d));
+  d.root()["name"] = "this is another long string for test";
+  EXPECT_FALSE(deepEquals(a, d));
+  EXPECT_NE(structuralHash(a.croot()), structuralHash(d.croot()));
+  
+  // Any modification changes the hash
+  StructuralHasher hasher;
+  const uint64_t h = hasher(b.croot());
+  b.root()["ints"][2] = 21;
+  EXPECT_NE(hasher(b.croot()), h);
+  b.root()["ints"][2] = 20;
+  EXPECT_EQ(hasher(b.croot()), h);
+  b.root()["obj"]["x"] = false;
+  EXPECT_NE(hasher(b.croot()), h);
+  EXPECT_FALSE(deepEquals(a, b));
+  
+  // Duplicate keys: members matched one to one
+  DynamicDocument dup;
+  auto drt = dup.root();
+  const char* names[] = {"twice", "mixed", "swapped", "ordered"};
+  const char* keys[4][2] = {{"a", "a"}, {"a", "b"}, {"a", "a"}, {"a", "a"}};
+  const int vals[4][2] = {{1, 1}, {1, 2}, {2, 1}, {1, 2}};
+  for (int o = 0; o < 4; ++o)
+  {
+    auto obj = drt[names[o]].toObject();
+    obj.objectPushBack(keys[o][0], vals[o][0]);  // no duplicate check
+    obj.objectPushBack(keys[o][1], vals[o][1]);
+  }
+  const ConstMember* objs = dup.croot().objectMembers();
+  const ConstValue& twice = objs[0].value();
+  const ConstValue& mixed = objs[1].value();
+  const ConstValue& swapped = objs[2].value();
+  const ConstValue& ordered = objs[3].value();
+  EXPECT_FALSE(deepEquals(twice, mixed));
+  EXPECT_FALSE(deepEquals(mixed, twice));
+  EXPECT_FALSE(deepEquals(twice, ordered));
+  EXPECT_TRUE(deepEquals(swapped, ordered));
+  EXPECT_EQ(structuralHash(swapped), structuralHash(ordered));
+  EXPECT_FALSE(deepEquals(swapped, ordered, MemberOrder::SENSITIVE));
+}
+
+TEST(Document, BulkBuilders)
+{
+  DynamicDocument doc;
+  auto rt = doc.root();
+  std::string owned = "this is a copied long string for test";
+  char key[] = "copied";
+  rt.objectAssign({
+    {"null",  nullptr},
+    {"bool",  true},
+    {"int",   -3},
+    {"uint",  (uint64_t)LFJ_MAX_INT64 + 1u},
+    {"dbl",   1.5},
+    {"short", "short"},
+    {"long",  "this is an extern long string for test"},
+    {key,     owned},
+    {std::string("list"), nullptr}
+  });
+  owned.assign(owned.size(), 'x');
+  key[0] = 'x';
+  EXPECT_EQ(rt.objectSize(), 9u);
+  EXPECT_EQ(rt.objectCapacity(), 9u);  // exact
+  EXPECT_TRUE(rt["null"].isNul());
+  EXPECT_TRUE(rt["bool"].isTrue());
+  EXPECT_EQ(rt["int"].getInt64(), -3);
+  EXPECT_EQ(rt["uint"].getUInt64(), LFJ_MAX_INT64 + 1u);
+  EXPECT_EQ(rt["dbl"].getDouble(), 1.5);
+  EXPECT_STREQ(rt["short"].getShortString(), "short");
+  EXPECT_STREQ(rt["long"].getLongString(), "this is an extern long string for test");
+  EXPECT_STREQ(rt["copied"].getLongString(), "this is a copied long string for test");
+  EXPECT_TRUE(rt.objectCMemberAt(7).keyOwned());
+  EXPECT_FALSE(rt.objectCMemberAt(0).keyOwned());
+  
+  // Nested, from iterators
+  std::vector<int64_t> ints = {1, 2, 3};
+  rt["list"].arrayAssign(ints.begin(), ints.end());
+  rt["list"].arrayPushBack("end");
+  EXPECT_EQ(rt["list"].arraySize(), 4u);
+  EXPECT_EQ(rt["list"][2].getInt64(), 3);
+  std::vector<BuildMember> members = {{"a", 1}, {"b", "two"}};
+  rt["obj"].objectAssign(members.begin(), members.end());
+  EXPECT_STREQ(rt["obj"]["b"].getShortString(), "two");
+  rt["obj"].arrayAssign({});  // replaced
+  EXPECT_TRUE(rt["obj"].isArray());
+  EXPECT_TRUE(rt["obj"].arrayEmpty());
+  
+  // Specialized, big
+  std::vector<double> doubles(70000, 0.25);
+  rt["doubles"].darrayAssign(doubles.data(), (uint32_t)doubles.size());
+  EXPECT_EQ(rt["doubles"].darraySize(), 70000u);
+  EXPECT_EQ(rt["doubles"].darrayCValueAt(69999), 0.25);
+  const int64_t i64s[] = {4, 5};
+  rt["ints"].iarrayAssign(i64s, 2u);
+  EXPECT_EQ(rt["ints"].iarrayCValueAt(1), 5);
+  const bool bools[] = {true, false, true};
+  rt["bools"].barrayAssign(bools, 3u);
+  EXPECT_EQ(rt["bools"].barrayCapacity(), 3u);
+  EXPECT_TRUE(rt["bools"].barrayCValueAt(2));
+  
+  // Same as push based construction
+  DynamicDocument pushed(doc.stringPool());
+  {
+    auto prt = pushed.root();
+    prt["a"] = 1;
+    prt["b"]["c"][0] = "short";
+    prt["b"]["c"][1] = 2.5;
+  }
+  DynamicDocument built(doc.stringPool());
+  built.root().objectAssign({{"a", 1}, {"b", nullptr}});
+  built.root()["b"].objectAssign({{"c", nullptr}});
+  built.root()["b"]["c"].arrayAssign({"short", 2.5});
+  EXPECT_TRUE(deepEquals(pushed, built, MemberOrder::SENSITIVE));
+  
+  // String pool reserve, single rehash
+  StringPool<> pool;
+  pool.reserve(100u);
+  const uint32_t buckets = pool.bucket_count();
+  EXPECT_GE(buckets * pool.max_load_factor(), 100.f);
+  bool found = false;
+  for (int i = 0; i < 100; ++i)
+    pool.provideInterned(std::to_string(i).c_str(), true, found);
+  EXPECT_EQ(pool.bucket_count(), buckets);
+  pool.reserve(10u);
+  EXPECT_EQ(pool.bucket_count(), buckets);
+}
+
+TEST(Document, MoveFrom)
+{
+  DynamicDocument live;
+  DynamicDocument staging(live.stringPool());  // same pool and base allocator
+  {
+    auto rt = staging.root();
+    rt["name"] = "this is a long string for test";
+    auto ia = rt["big"].toIArray();
+    for (int64_t i = 0; i < 70000; ++i)  // fallback block
+      ia.iarrayPushBack(i);
+    rt["small"][0] = 1;
+    rt["small"][1]["k"] = "v";
+  }
+  const int64_t* bigValues = DynamicPointer("/big").find(staging)->iarrayValues();
+  const uint32_t stagingFallbacks = staging.objectAllocator().countFallbacks();
+  EXPECT_GE(stagingFallbacks, 1u);
+  
+  // Between documents: big block relinked, small blocks copied
+  auto rt = live.root();
+  rt["data"].moveFrom(staging.root());
+  EXPECT_TRUE(staging.croot().isNul());
+  EXPECT_EQ(staging.objectAllocator().countFallbacks(), stagingFallbacks - 1u);
+  EXPECT_EQ(live.objectAllocator().countFallbacks(), 1u);
+  EXPECT_EQ(DynamicPointer("/data/big").find(live)->iarrayValues(), bigValues);  // not copied
+  EXPECT_EQ(rt["data"]["big"].iarraySize(), 70000u);
+  EXPECT_EQ(rt["data"]["big"].iarrayCValueAt(69999), 69999);
+  EXPECT_STREQ(rt["data"]["small"][1]["k"].getShortString(), "v");
+  EXPECT_STREQ(rt["data"]["name"].getLongString(), "this is a long string for test");
+  staging.root()["reuse"] = 1;  // staging still usable
+  staging.clearObjects();
+  EXPECT_EQ(rt["data"]["big"].iarrayCValueAt(1), 1);
+  
+  // Same document: relinked
+  const ConstValue* smallValues = DynamicPointer("/data/small").find(live)->arrayValues();
+  rt["moved"].moveFrom(rt["data"]["small"]);
+  EXPECT_EQ(DynamicPointer("/moved").find(live)->arrayValues(), smallValues);
+  EXPECT_TRUE(rt["data"]["small"].isNul());
+  
+  // Other pool: copied
+  DynamicDocument other;
+  other.root()["x"] = "this is another long string for test";
+  rt["other"].moveFrom(other.root());
+  EXPECT_STREQ(rt["other"]["x"].getLongString(), "this is another long string for test");
+  EXPECT_TRUE(other.croot().isNul());
+  
+  // Splices
+  DynamicDocument batch(live.stringPool());
+  batch.root()[0] = 10;
+  batch.root()[1]["y"] = 2;
+  rt["moved"].arraySplice(1u, batch.root());
+  EXPECT_EQ(rt["moved"].arraySize(), 4u);
+  EXPECT_EQ(rt["moved"][0].getInt64(), 1);
+  EXPECT_EQ(rt["moved"][1].getInt64(), 10);
+  EXPECT_EQ(rt["moved"][2]["y"].getInt64(), 2);
+  EXPECT_STREQ(rt["moved"][3]["k"].getShortString(), "v");
+  EXPECT_TRUE(batch.root().arrayEmpty());
+  
+  DynamicDocument fields;
+  fields.root()["f1"] = "this is a third long string for test";
+  fields.root()["f2"][0] = true;
+  rt["other"].objectSplice(fields.root());
+  EXPECT_EQ(rt["other"].objectSize(), 3u);
+  EXPECT_STREQ(rt["other"]["f1"].getLongString(), "this is a third long string for test");
+  EXPECT_TRUE(rt["other"]["f2"][0].isTrue());
+  EXPECT_TRUE(fields.root().objectEmpty());
+}
+
+// Records events, no batch events
+struct RecordHandler
+{
+  std::string events;
+  int abortAt = -1;
+  
+  bool record(const std::string& ev)
+  {
+    events += ev + ",";
+    return abortAt < 0 || (int)std::count(events.begin(), events.end(), ',') < abortAt;
+  }
+  bool startObject()                { return record("{"); }
+  bool endObject(uint32_t count)    { return record("}" + std::to_string(count)); }
+  bool startArray()                 { return record("["); }
+  bool endArray(uint32_t count)     { return record("]" + std::to_string(count)); }
+  bool pushKey(const char* str, bool, int32_t len) { return record(std::string(str, len) + ":"); }
+  bool pushNull()                   { return record("null"); }
+  bool pushBool(bool b)             { return record(b ? "true" : "false"); }
+  bool pushInt64(int64_t i)         { return record(std::to_string(i)); }
+  bool pushUInt64(uint64_t u)       { return record(std::to_string(u) + "u"); }
+  bool pushDouble(double d)         { return record(std::to_string(d)); }
+  bool pushString(const char* str, bool, int32_t len) { return record("'" + std::string(str, len) + "'"); }
+};
+
+TEST(Document, Accept)
+{
+  DynamicDocument doc;
+  {
+    auto rt = doc.root();
+    rt["name"] = "this is a long string for test";
+    rt["u"] = (uint64_t)LFJ_MAX_INT64 + 1u;
+    auto ia = rt["ints"].toIArray();
+    for (int64_t i = 0; i < 70000; ++i)  // big
+      ia.iarrayPushBack(i);
+    rt["doubles"].toDArray().darrayPushBack(0.5);
+    rt["bools"].toBArray().barrayPushBack(true);
+    rt["list"][0]["k"] = nullptr;
+    rt["list"][1] = 1.5;
+    rt["list"][2].toArray();
+    rt["mixed"][0] = true;  // specialized arrays converted by the Handler
+    rt["mixed"][1] = "s";
+    rt["mixedi"][0] = 1;
+    rt["mixedi"][1] = 2;
+    rt["mixedi"][2] = nullptr;
+    rt["mixedd"][0] = 0.5;
+    rt["mixedd"][1].toObject();
+    rt["empty"].toObject();
+  }
+  
+  // Into another Document (other pool), batch events
+  DynamicDocument copy;
+  {
+    auto handler = copy.makeHandler();
+    EXPECT_TRUE(doc.accept(handler));
+    handler.finalize();
+  }
+  EXPECT_TRUE(deepEquals(doc, copy, MemberOrder::SENSITIVE));
+  EXPECT_TRUE(copy.root()["ints"].isIArray());
+  EXPECT_TRUE(copy.root()["doubles"].isDArray());
+  EXPECT_TRUE(copy.root()["bools"].isBArray());
+  
+  // Extern strings, same pool
+  DynamicDocument shared(doc.stringPool());
+  {
+    auto handler = shared.makeHandler();
+    EXPECT_TRUE(doc.accept(handler, false));
+    handler.finalize();
+  }
+  EXPECT_TRUE(deepEquals(doc, shared));
+  
+  // Per element events, abort
+  DynamicDocument small;
+  {
+    auto rt = small.root();
+    rt["a"].toIArray().iarrayPushBack(1);
+    rt["a"].iarrayPushBack(2);
+    rt["b"][0]["c"] = "s";
+    rt["b"][1] = (uint64_t)LFJ_MAX_INT64 + 1u;
+  }
+  RecordHandler record;
+  EXPECT_TRUE(small.accept(record));
+  EXPECT_EQ(record.events, "{,a:,[,1,2,]2,b:,[,{,c:,'s',}1,9223372036854775808u,]2,}2,");
+  RecordHandler aborted;
+  aborted.abortAt = 5;
+  EXPECT_FALSE(small.accept(aborted));
+  EXPECT_EQ(aborted.events, "{,a:,[,1,2,");
+}
+
+TEST(Document, Schema)
+{
+  DynamicDocument schema;
+  {
+    auto rt = schema.root();
+    rt["$schema"] = "http://json-schema.org/draft-07/schema#";
+    rt["type"] = "object";
+    rt["required"][0] = "id";
+    rt["required"][1] = "name";
+    rt["properties"]["id"]["type"] = "integer";
+    rt["properties"]["id"]["minimum"] = 1;
+    rt["properties"]["name"]["type"] = "string";
+    rt["properties"]["name"]["minLength"] = 2;
+    rt["properties"]["name"]["maxLength"] = 4;
+    rt["properties"]["kind"]["enum"][0] = "small";
+    rt["properties"]["kind"]["enum"][1] = "a very long kind of value";
+    rt["properties"]["kind"]["enum"][2] = nullptr;
+    rt["properties"]["ratios"]["type"] = "array";
+    rt["properties"]["ratios"]["maxItems"] = 3;
+    rt["properties"]["ratios"]["items"]["type"] = "number";
+    rt["properties"]["ratios"]["items"]["exclusiveMaximum"] = 1;
+    rt["properties"]["tags"]["items"]["type"] = "string";
+    rt["additionalProperties"] = false;
+  }
+  DynamicSchema validator(schema);
+  EXPECT_FALSE(validator.empty());
+  
+  DynamicDocument doc;
+  auto rt = doc.root();
+  rt["id"] = 7;
+  rt["name"] = "abc";
+  rt["kind"] = "a very long kind of value";
+  auto da = rt["ratios"].toDArray();
+  da.darrayPushBack(0.25);
+  da.darrayPushBack(0.5);
+  rt["tags"][0] = "x";
+  EXPECT_TRUE(validator.validate(doc));
+  EXPECT_STREQ(validator.errorKeyword(), "");
+  
+  // Failures (keyword, path)
+  rt["ratios"].darrayPushBack(1.);
+  EXPECT_FALSE(validator.validate(doc));
+  EXPECT_STREQ(validator.errorKeyword(), "exclusiveMaximum");
+  EXPECT_EQ(validator.errorPath(), "/ratios");
+  rt["ratios"].darrayPushBack(0.);
+  EXPECT_FALSE(validator.validate(doc));
+  EXPECT_STREQ(validator.errorKeyword(), "maxItems");
+  rt["ratios"].toArray();
+  
+  rt["tags"][1] = 2;
+  EXPECT_FALSE(validator.validate(doc));
+  EXPECT_STREQ(validator.errorKeyword(), "type");
+  EXPECT_EQ(validator.errorPath(), "/tags/1");
+  rt["tags"][1] = "y";
+  
+  rt["kind"] = "big";
+  EXPECT_FALSE(validator.validate(doc));
+  EXPECT_STREQ(validator.errorKeyword(), "enum");
+  rt["kind"] = nullptr;
+  EXPECT_TRUE(validator.validate(doc));
+  
+  rt["name"] = "\xC3\xA9t\xC3\xA9";  // 3 code points
+  EXPECT_TRUE(validator.validate(doc));
+  rt["name"] = "abcde";
+  EXPECT_FALSE(validator.validate(doc));
+  EXPECT_STREQ(validator.errorKeyword(), "maxLength");
+  rt["name"] = "ab";
+  
+  rt["id"] = 1.5;
+  EXPECT_FALSE(validator.validate(doc));
+  EXPECT_STREQ(validator.errorKeyword(), "type");
+  rt["id"] = 0;
+  EXPECT_FALSE(validator.validate(doc));
+  EXPECT_STREQ(validator.errorKeyword(), "minimum");
+  EXPECT_EQ(validator.errorPath(), "/id");
+  rt["id"] = 2.0;  // integral double
+  EXPECT_TRUE(validator.validate(doc));
+  
+  rt["a/b"] = true;
+  EXPECT_FALSE(validator.validate(doc));
+  EXPECT_STREQ(validator.errorKeyword(), "additionalProperties");
+  EXPECT_EQ(validator.errorPath(), "/a~1b");
+  rt.objectPopBack();
+  EXPECT_TRUE(validator.validate(doc));
+  
+  // Required key never interned in pool
+  DynamicDocument other;
+  other.root()["name"] = "ab";
+  EXPECT_FALSE(validator.validate(other));
+  EXPECT_STREQ(validator.errorKeyword(), "required");
+  other.root()["id"] = 3;
+  EXPECT_TRUE(validator.validate(other));
+  
+  // Boolean schemas, unsupported keywords
+  DynamicDocument anything;
+  anything.root() = true;
+  EXPECT_TRUE(DynamicSchema(anything).validate(doc));
+  anything.root() = false;
+  EXPECT_FALSE(DynamicSchema(anything).validate(doc));
+  
+  DynamicSchema compiled;
+  DynamicDocument unsupported;
+  unsupported.root()["pattern"] = "^a";
+  EXPECT_FALSE(compiled.compile(unsupported.croot()));
+  EXPECT_TRUE(compiled.empty());
+  EXPECT_THROW(DynamicSchema{unsupported}, std::invalid_argument);
+  unsupported.root().objectPopBack();
+  unsupported.root()["type"] = "integers";
+  EXPECT_THROW(DynamicSchema{unsupported}, std::invalid_argument);
+  
+  // Item and property counts apply to their own type only
+  DynamicDocument counts;
+  counts.root()["minItems"] = 3;
+  counts.root()["maxProperties"] = 1;
+  DynamicSchema countsValidator(counts);
+  DynamicDocument value;
+  value.root()["a"] = 1;
+  EXPECT_TRUE(countsValidator.validate(value));
+  value.root()["b"] = 2;
+  EXPECT_FALSE(countsValidator.validate(value));
+  EXPECT_STREQ(countsValidator.errorKeyword(), "maxProperties");
+  value.root().toArray();
+  value.root()[0] = 1;
+  value.root()[1] = 2;
+  value.root()[2] = 3;
+  EXPECT_TRUE(countsValidator.validate(value));
+  value.root().arrayPopBack();
+  EXPECT_FALSE(countsValidator.validate(value));
+  EXPECT_STREQ(countsValidator.errorKeyword(), "minItems");
+  
+  counts.root().toObject();
+  counts.root()["minProperties"] = 2;
+  counts.root()["maxItems"] = 0;
+  DynamicSchema propsValidator(counts);
+  value.root().toArray();
+  EXPECT_TRUE(propsValidator.validate(value));
+  value.root()[0] = nullptr;
+  EXPECT_FALSE(propsValidator.validate(value));
+  EXPECT_STREQ(propsValidator.errorKeyword(), "maxItems");
+  value.root().toObject();
+  value.root()["a"] = 1;
+  EXPECT_FALSE(propsValidator.validate(value));
+  EXPECT_STREQ(propsValidator.errorKeyword(), "minProperties");
+}
+
+TEST(Document, RemoveIf)
+{
+  Document<512u, HeapAllocator> doc;
+  const auto& alc = doc.baseAllocator();
+  auto rt = doc.root();
+  
+  // Generic array, children deallocated
+  auto ar = rt["ar"].toArray();
+  for (uint32_t i = 0; i < 100; ++i)
+  {
+    if (i % 3 == 0)
+    {
+      ar[i]["id"] = i;
+      ar[i]["name"] = "this is a long string for test";
+    }
+    else
+      ar.arrayPushBack((int64_t)i);
+  }
+  const uint64_t mem = alc.getAllocated();
+  EXPECT_EQ(ar.arrayRemoveIf([](const ConstValue& v) { return v.isObject(); }), 34u);
+  EXPECT_EQ(ar.arraySize(), 66u);
+  EXPECT_EQ(ar.arrayCValueAt(0).getInt64(), 1);
+  EXPECT_EQ(ar.arrayCValueAt(65).getInt64(), 98);
+  EXPECT_TRUE(std::all_of(ar.arrayCBegin(), ar.arrayCEnd(), [](const ConstValue& v) { return v.isInt64(); }));
+  doc.shrink();
+  EXPECT_LT(alc.getAllocated(), mem);
+  EXPECT_EQ(ar.arrayRemoveIf([](const ConstValue&) { return false; }), 0u);
+  
+  // Range erase
+  ar.arrayErase(ar.arrayCBegin() + 1, ar.arrayCBegin() + 65);
+  ASSERT_EQ(ar.arraySize(), 2u);
+  EXPECT_EQ(ar.arrayCValueAt(1).getInt64(), 98);
+  ar.arrayErase(ar.arrayCEnd(), ar.arrayCEnd());
+  EXPECT_EQ(ar.arraySize(), 2u);
+  
+  // Specialized arrays, shrink
+  rt["ia"].toIArray();
+  rt["da"].toDArray();
+  rt["ba"].toBArray();
+  rt["ob"].toObject();
+  auto ia = rt["ia"];
+  auto da = rt["da"];
+  auto ba = rt["ba"];
+  for (int64_t i = 0; i < 1000; ++i)
+  {
+    ia.iarrayPushBack(i);
+    da.darrayPushBack(i * 0.5);
+    ba.barrayPushBack(i % 4 == 0);
+  }
+  EXPECT_EQ(ia.iarrayRemoveIf([](int64_t i) { return i % 2 == 1; }, true), 500u);
+  EXPECT_EQ(ia.iarraySize(), 500u);
+  EXPECT_EQ(ia.iarrayCapacity(), 500u);
+  EXPECT_EQ(ia.iarrayCBegin()[499], 998);
+  EXPECT_EQ(da.darrayRemoveIf([](double d) { return d >= 10.; }), 980u);
+  EXPECT_EQ(da.darraySize(), 20u);
+  EXPECT_EQ(da.darrayCBegin()[19], 9.5);
+  EXPECT_EQ(ba.barrayRemoveIf([](bool b) { return !b; }), 750u);
+  EXPECT_EQ(std::count(ba.barrayCBegin(), ba.barrayCEnd(), true), 250);
+  ia.iarrayErase(ia.iarrayCBegin(), ia.iarrayCBegin() + 10);
+  EXPECT_EQ(ia.iarrayCBegin()[0], 20);
+  da.darrayErase(da.darrayCBegin() + 10, da.darrayCEnd());
+  EXPECT_EQ(da.darraySize(), 10u);
+  ba.barrayErase(ba.barrayCBegin(), ba.barrayCEnd());
+  EXPECT_TRUE(ba.barrayEmpty());
+  
+  // Object
+  auto ob = rt["ob"];
+  ob["a"] = 1;
+  ob["b"]["c"] = "this is a long string for test";
+  ob["d"] = 2;
+  ob["e"] = "e";
+  EXPECT_EQ(ob.objectRemoveIf([](const ConstMember& m) { return !m.value().isInt64(); }, true), 2u);
+  ASSERT_EQ(ob.objectSize(), 2u);
+  EXPECT_EQ(ob.objectCapacity(), 2u);
+  EXPECT_STREQ(ob.objectCBegin()[1].key(), "d");
+  ob.objectErase(ob.objectCBegin(), ob.objectCBegin() + 1);
+  ASSERT_EQ(ob.objectSize(), 1u);
+  EXPECT_EQ(ob["d"].getInt64(), 2);
+}
+
+TEST(Document, Binding)
+{
+  DynamicDocument doc;
+  {
+    auto rt = doc.root();
+    rt["unknown"]["deep"][0]["a"] = "skipped";  // skipped with its subtree
+    rt["name"] = "this is a long string for test";
+    rt["scale"] = 2;  // integer into double
+    rt["layer"] = 3.0;  // integral double into integer
+    rt["visible"] = true;
+    rt["points"][0]["y"] = -2;
+    rt["points"][0]["x"] = 1;
+    rt["points"][0]["text"] = "a";
+    rt["points"][1]["x"] = 3;
+    rt["points"][1]["z"] = nullptr;
+    auto ids = rt["ids"].toIArray();
+    for (int64_t i = 0; i < 10; ++i)
+      ids.iarrayPushBack(i * i);
+    rt["flags"].toBArray().barrayPushBack(true);
+    rt["flags"].barrayPushBack(false);
+    rt["weights"]["w1"] = 0.5;
+    rt["weights"]["w2"] = 1.5;
+    rt["label"] = nullptr;
+  }
+  BindShape shape;
+  shape.ids.push_back(-1);  // cleared
+  ASSERT_TRUE(bindValue(doc.croot(), shape));
+  EXPECT_EQ(shape.name, "this is a long string for test");
+  EXPECT_EQ(shape.scale, 2.);
+  EXPECT_EQ(shape.layer, 3u);
+  EXPECT_TRUE(shape.visible);
+  ASSERT_EQ(shape.points.size(), 2u);
+  EXPECT_EQ(shape.points[0].x, 1);
+  EXPECT_EQ(shape.points[0].y, -2);
+  EXPECT_EQ(shape.points[0].label, "a");
+  EXPECT_EQ(shape.points[1].x, 3);
+  EXPECT_EQ(shape.points[1].y, 0);
+  ASSERT_EQ(shape.ids.size(), 10u);
+  EXPECT_EQ(shape.ids[9], 81);
+  EXPECT_EQ(shape.flags, std::vector<bool>({ true, false }));
+  EXPECT_EQ(shape.weights.size(), 2u);
+  EXPECT_EQ(shape.weights["w2"], 1.5);
+  
+  // Events directly (parser side), root array
+  std::vector<BindPoint> points;
+  auto handler = makeBindHandler(points);
+  EXPECT_TRUE(handler.startArray());
+  EXPECT_TRUE(handler.startObject());
+  EXPECT_TRUE(handler.pushKey("x", true));
+  EXPECT_TRUE(handler.pushUInt64(7u));
+  EXPECT_TRUE(handler.pushKey("text", false, 4));
+  EXPECT_TRUE(handler.pushString("pt", true));
+  EXPECT_TRUE(handler.endObject(2u));
+  EXPECT_FALSE(handler.done());
+  EXPECT_TRUE(handler.endArray(1u));
+  EXPECT_TRUE(handler.done());
+  ASSERT_EQ(points.size(), 1u);
+  EXPECT_EQ(points[0].x, 7);
+  EXPECT_EQ(points[0].label, "pt");
+  
+  // Mismatches abort
+  doc.root()["layer"] = 256;  // out of uint8_t range
+  EXPECT_FALSE(bindValue(doc.croot(), shape));
+  doc.root()["layer"] = 1.5;
+  EXPECT_FALSE(bindValue(doc.croot(), shape));
+  doc.root()["layer"] = 1;
+  doc.root()["points"] = "not an array";
+  EXPECT_FALSE(bindValue(doc.croot(), shape));
+  doc.root()["points"].toArray();
+  EXPECT_TRUE(bindValue(doc.croot(), shape));
+  EXPECT_TRUE(shape.points.empty());
+  
+  std::map<std::string, std::vector<double>> series;
+  DynamicDocument other;
+  other.root()["a"].toDArray().darrayPushBack(0.25);
+  other.root()["b"][0] = 1;
+  other.root()["b"][1] = 2.5;
+  ASSERT_TRUE(bindValue(other.croot(), series));
+  EXPECT_EQ(series["a"], std::vector<double>({ 0.25 }));
+  EXPECT_EQ(series["b"], std::vector<double>({ 1., 2.5 }));
+}
+
+TEST(Document, BindingWrite)
+{
+  BindShape shape;
+  shape.name = "this is a long string for test";
+  shape.layer = 200;
+  shape.scale = 0.5;
+  shape.visible = true;
+  shape.points.resize(2);
+  shape.points[0].x = 1;
+  shape.points[0].label = "a";
+  shape.points[1].y = -3;
+  shape.ids = { 1, 4, 9 };
+  shape.flags = { true, false, true };
+  shape.weights["w1"] = 0.25;
+  
+  DynamicDocument doc;
+  StructWriter<> writer;
+  writer.write(doc, shape);
+  
+  auto rt = doc.root();
+  ASSERT_TRUE(rt.isObject());
+  EXPECT_EQ(rt.objectSize(), 8u);
+  EXPECT_EQ(std::string(rt.objectMember(0).key()), "name");  // declaration order
+  EXPECT_EQ(rt["layer"].getInt64(), 200);
+  EXPECT_TRUE(rt["ids"].isIArray());
+  EXPECT_EQ(rt["ids"].iarraySize(), 3u);
+  EXPECT_TRUE(rt["flags"].isBArray());
+  EXPECT_TRUE(rt["points"].isArray());
+  EXPECT_EQ(rt["points"][1].objectSize(), 3u);
+  EXPECT_EQ(std::string(rt["points"][0]["text"].asString()), "a");
+  
+  // Round trip
+  BindShape back;
+  ASSERT_TRUE(bindValue(doc.croot(), back));
+  EXPECT_EQ(back.name, shape.name);
+  EXPECT_EQ(back.layer, shape.layer);
+  EXPECT_EQ(back.scale, shape.scale);
+  EXPECT_EQ(back.points[1].y, -3);
+  EXPECT_EQ(back.ids, shape.ids);
+  EXPECT_EQ(back.flags, shape.flags);
+  EXPECT_EQ(back.weights, shape.weights);
+  
+  // Keys interned once: same strings across objects and documents sharing the pool
+  DynamicDocument other(doc.stringPool());
+  writer.write(other, shape.points[0]);
+  EXPECT_EQ(other.croot().objectMembers()[0].key(), rt["points"][0].objectMember(0).key());
+  EXPECT_EQ(rt["points"][0].objectMember(2).key(), rt["points"][1].objectMember(2).key());
+  
+  // Pool cleared: keys interned again
+  other.clear();
+  doc.clear();
+  writer.write(doc, shape.points[1]);
+  EXPECT_EQ(doc.root()["y"].getInt64(), -3);
+  
+  // Conversions: small integers / floats batched, large unsigned in generic array
+  std::map<std::string, std::vector<uint64_t>> big;
+  big["a"] = { 1u, 2u };
+  big["b"] = { 1u, 0xFFFFFFFFFFFFFFFFull };
+  writer.write(doc, big);
+  EXPECT_TRUE(doc.root()["a"].isIArray());
+  EXPECT_TRUE(doc.root()["b"].isArray());
+  EXPECT_EQ(doc.root()["b"][1].getUInt64(), 0xFFFFFFFFFFFFFFFFull);
+  
+  std::vector<float> floats = { 0.5f, 1.5f };
+  writer.write(doc, doc.root()["f"], floats);
+  EXPECT_TRUE(doc.root()["f"].isDArray());
+  EXPECT_EQ(doc.root()["f"].darraySize(), 2u);
+}
+
+TEST(Document, ParseSession)
+{
+  DynamicDocument src;
+  {
+    auto rt = src.root();
+    rt["name"] = "this is a long string for test";
+    struct Deep {
+      static void build(DynamicDocument::RefValue value, int depth)
+      {
+        if (depth == 0)
+          value = 1;
+        else
+          build(value[0]["k"], depth - 1);
+      }
+    };
+    Deep::build(rt["deep"], 20);
+    auto ia = rt["ints"].toIArray();
+    for (int64_t i = 0; i < 500; ++i)
+      ia.iarrayPushBack(i);
+    rt["mixed"][0] = true;  // specialized arrays converted by the Handler
+    rt["mixed"][1] = "s";
+    rt["mixedi"][0] = 1;
+    rt["mixedi"][1] = 2;
+    rt["mixedi"][2] = nullptr;
+    rt["mixedd"][0] = 0.5;
+    rt["mixedd"][1].toObject();
+  }
+  
+  std::unique_ptr<DynamicParseSession> session;
+  {
+    DynamicDocument first;
+    session.reset(new DynamicParseSession(first, 64u));
+    EXPECT_EQ(session->stackCapacity(), 64u);
+    EXPECT_TRUE(src.accept(session->begin(first)));
+    session->end();
+    EXPECT_TRUE(deepEquals(src, first, MemberOrder::SENSITIVE));
+  }
+  const uint64_t warmCapacity = session->stackCapacity();
+  EXPECT_GT(warmCapacity, 64u);
+  
+  // Rebound to another Document (first one destroyed), then reused: no stack growth
+  DynamicDocument doc;
+  for (int i = 0; i < 3; ++i)
+  {
+    auto& handler = i == 0 ? session->begin(doc) : session->begin();
+    EXPECT_EQ(&handler.document(), &doc);
+    EXPECT_TRUE(src.accept(handler));
+    session->end(i == 2);
+    EXPECT_TRUE(deepEquals(src, doc, MemberOrder::SENSITIVE));
+    EXPECT_EQ(session->stackCapacity(), warmCapacity);
+  }
+  EXPECT_EQ(session->parses(), 4u);
+  
+  // Unfinished parse dropped by next begin
+  auto& handler = session->begin();
+  EXPECT_TRUE(handler.startObject());
+  EXPECT_TRUE(handler.pushKey("a", false));
+  EXPECT_TRUE(handler.startArray());
+  EXPECT_TRUE(handler.pushInt(1));
+  EXPECT_TRUE(src.accept(session->begin()));
+  session->end();
+  EXPECT_TRUE(deepEquals(src, doc, MemberOrder::SENSITIVE));
+}
+
+TEST(Document, MemoryBudget)
+{
+  DynamicDocument src;
+  {
+    auto rt = src.root();
+    auto ia = rt["ints"].toIArray();
+    for (int64_t i = 0; i < 100000; ++i)  // big, through the stack
+      ia.iarrayPushBack(i);
+    for (int i = 0; i < 1000; ++i)
+    {
+      std::string s = "this is a long string number " + std::to_string(i);
+      rt["strings"][i] = (char*)s.c_str();
+    }
+  }
+  
+  // Usage tracked in O(1), unlimited by default
+  std::unique_ptr<DynamicDocument> doc(new DynamicDocument());
+  EXPECT_EQ(doc->memoryBudget(), 0u);
+  const size_t emptyUsage = doc->memoryUsage();
+  {
+    auto handler = doc->makeHandler();
+    EXPECT_TRUE(src.accept(handler));
+    handler.finalize(false);
+  }
+  const size_t fullUsage = doc->memoryUsage();
+  EXPECT_GT(fullUsage, emptyUsage + 100000u * sizeof(int64_t));
+  EXPECT_TRUE(deepEquals(src, *doc));
+  
+  // Over budget: parse aborted, Document clearable and reusable
+  doc->clear();
+  doc->shrink();
+  EXPECT_LT(doc->memoryUsage(), fullUsage);
+  doc->setMemoryBudget(64u * 1024u);
+  EXPECT_EQ(doc->memoryBudget(), 64u * 1024u);
+  {
+    auto handler = doc->makeHandler();
+    EXPECT_FALSE(src.accept(handler));
+    handler.clear();
+    handler.finalize(false);
+  }
+  EXPECT_LE(doc->memoryUsage(), 64u * 1024u + LFJ_DOCUMENT_DFLT_CHUNKSIZE);
+  doc->clear();
+  
+  doc->setMemoryBudget(fullUsage + 2u * 100000u * sizeof(ConstValue));  // pools + stack peak
+  {
+    auto handler = doc->makeHandler();
+    EXPECT_TRUE(src.accept(handler));
+    handler.finalize(false);
+  }
+  EXPECT_FALSE(doc->overBudget());
+  EXPECT_TRUE(deepEquals(src, *doc));
+  
+  // Many small events past the budget (no batch)
+  doc->clear();
+  doc->setMemoryBudget(doc->memoryUsage() + 1024u);
+  {
+    auto handler = doc->makeHandler();
+    bool ok = handler.startArray();
+    for (int i = 0; ok && i < 100000; ++i)
+      ok = handler.pushString("this is a long string for test", true);
+    EXPECT_FALSE(ok);
+    handler.clear();
+    handler.finalize(false);
+  }
+  doc->clear();
+  doc->setMemoryBudget(0u);
+  EXPECT_FALSE(doc->overBudget());
+  
+  // Shared string pool counts toward its first Document, detached when destroyed
+  DynamicDocument other(doc->stringPool());
+  other.root()["k"] = "this is a long string for test";
+  const size_t otherUsage = other.memoryUsage();
+  EXPECT_GT(doc->memoryUsage(), 0u);
+  doc.reset();
+  other.root()["k2"] = "this is another long string for test";
+  EXPECT_EQ(other.memoryUsage(), otherUsage);
+}
+
+TEST(Document, DirectHandler)
+{
+  DynamicDocument src;
+  {
+    auto rt = src.root();
+    rt["name"] = "this is a long string for test";
+    rt["u"] = (uint64_t)LFJ_MAX_INT64 + 1u;
+    auto ia = rt["ints"].toIArray();
+    for (int64_t i = 0; i < 70000; ++i)  // big
+      ia.iarrayPushBack(i);
+    rt["doubles"].toDArray().darrayPushBack(0.5);
+    rt["bools"].toBArray().barrayPushBack(true);
+    rt["numbers"][0] = 1;  // converted to DARRAY
+    rt["numbers"][1] = 2.5;
+    rt["mixed"][0] = true;
+    rt["mixed"][1]["k"] = "v";
+    rt["mixed"][2].toArray();
+    rt["empty"].toObject();
+    rt["big"].toObject();
+    for (int i = 0; i < 70000; ++i)  // big object
+    {
+      std::string key = "k" + std::to_string(i);
+      rt["big"].objectPushBack((char*)key.c_str(), (int64_t)i);
+    }
+  }
+  
+  // Pre-pass
+  StructureTape tape;
+  TapeRecorder recorder(tape);
+  ASSERT_TRUE(src.accept(recorder));
+  EXPECT_TRUE(recorder.done());
+  EXPECT_EQ(tape[0].type, JType::OBJECT);
+  EXPECT_EQ(tape[0].count, src.croot().objectSize());
+  EXPECT_EQ(tape[1].type, JType::IARRAY);  // ints
+  EXPECT_EQ(tape[1].count, 70000u);
+  EXPECT_EQ(tape[4].type, JType::DARRAY);  // numbers
+  
+  // Same Document as the Handler
+  DynamicDocument staged;
+  {
+    auto handler = staged.makeHandler();
+    ASSERT_TRUE(src.accept(handler));
+    handler.finalize();
+  }
+  DynamicDocument direct;
+  {
+    auto handler = direct.makeDirectHandler(tape);
+    ASSERT_TRUE(src.accept(handler));
+    EXPECT_TRUE(handler.done());
+    handler.finalize();
+  }
+  EXPECT_TRUE(deepEquals(staged, direct, MemberOrder::SENSITIVE));
+  EXPECT_TRUE(direct.root()["numbers"].isDArray());
+  EXPECT_TRUE(direct.root()["bools"].isBArray());
+  EXPECT_EQ(direct.root()["big"].objectSize(), 70000u);
+  
+  // Per element events, int into DARRAY
+  {
+    StructureTape small;
+    TapeRecorder rec(small);
+    DynamicDocument doc;
+    for (int pass = 0; pass < 2; ++pass)
+    {
+      DynamicDocument::DirectHandler dh = doc.makeDirectHandler(small);
+      auto run = [&](bool rec_) {
+        bool ok = rec_ ? rec.startArray() : dh.startArray();
+        ok = ok && (rec_ ? rec.pushInt(1) : dh.pushInt(1));
+        ok = ok && (rec_ ? rec.pushDouble(2.5) : dh.pushDouble(2.5));
+        ok = ok && (rec_ ? rec.pushInt64(3) : dh.pushInt64(3));
+        ok = ok && (rec_ ? rec.endArray(3u) : dh.endArray(3u));
+        return ok;
+      };
+      EXPECT_TRUE(run(pass == 0));
+    }
+    ASSERT_TRUE(doc.croot().isDArray());
+    EXPECT_EQ(doc.croot().darraySize(), 3u);
+    EXPECT_EQ(doc.root().darrayCBegin()[2], 3.);
+  }
+  
+  // Events not matching the tape
+  DynamicDocument other;
+  other.root()["name"] = "x";
+  DynamicDocument failed;
+  auto handler = failed.makeDirectHandler(tape);
+  EXPECT_FALSE(other.accept(handler) && handler.done());
+  failed.clear();
+}
+
+TEST(Document, Projection)
+{
+  DynamicDocument src;
+  {
+    auto rt = src.root();
+    rt["id"] = 42;
+    rt["level"] = "error";
+    rt["message"] = "this is a long message that is not projected";
+    rt["user"]["name"] = "this is a long user name";
+    rt["user"]["email"] = "user@example.com";
+    rt["user"]["roles"][0] = "admin";
+    for (int i = 0; i < 3; ++i)
+    {
+      rt["items"][i]["sku"] = i;
+      rt["items"][i]["qty"] = i * 2;
+    }
+    rt["items"][3] = "not an object";
+    auto ia = rt["ints"].toIArray();
+    for (int64_t i = 0; i < 10; ++i)
+      ia.iarrayPushBack(i * 10);
+    rt["tags"][0] = "a";
+    rt["tags"][1] = "b";
+    rt["nested"]["deep"]["x"] = 1;
+  }
+  
+  Projection projection = { "/id", "/user/name", "/items/*/sku", "/ints/2", "/ints/7", "/tags/1",
+                            "/missing/x", "/nested/deep/y", "/id/x" };
+  DynamicDocument doc;
+  {
+    auto handler = doc.makeHandler();
+    auto projected = makeProjectionHandler(handler, projection);
+    ASSERT_TRUE(src.accept(projected, false));
+    EXPECT_TRUE(projected.done());
+    handler.finalize();
+  }
+  
+  DynamicDocument expected;
+  {
+    auto rt = expected.root();
+    rt["id"] = 42;
+    rt["user"]["name"] = "this is a long user name";
+    for (int i = 0; i < 3; ++i)
+      rt["items"][i]["sku"] = i;
+    auto ints = rt["ints"].toIArray();
+    ints.iarrayPushBack(20);
+    ints.iarrayPushBack(70);
+    rt["tags"][0] = "b";
+  }
+  EXPECT_TRUE(deepEquals(doc, expected, MemberOrder::SENSITIVE));
+  
+  // Unselected strings and keys are never interned
+  EXPECT_EQ(doc.stringPool()->get("message"), nullptr);
+  EXPECT_EQ(doc.stringPool()->get("this is a long message that is not projected"), nullptr);
+  EXPECT_EQ(doc.stringPool()->get("nested"), nullptr);
+  
+  // Wildcard over a specialized array: batch forwarded as is
+  {
+    Projection all = { "/ints/*", "/user" };
+    DynamicDocument out;
+    auto handler = out.makeHandler();
+    auto projected = makeProjectionHandler(handler, all);
+    ASSERT_TRUE(src.accept(projected));
+    handler.finalize();
+    EXPECT_TRUE(out.root()["ints"].isIArray());
+    EXPECT_EQ(out.root()["ints"].iarraySize(), 10u);
+    EXPECT_EQ(out.root()["user"].objectSize(), 3u);
+    EXPECT_EQ(out.croot().objectSize(), 2u);
+  }
+  
+  // Empty pointer selects the whole document, no path gives an empty root object
+  {
+    Projection whole = { "" };
+    DynamicDocument out;
+    auto handler = out.makeHandler();
+    auto projected = makeProjectionHandler(handler, whole);
+    ASSERT_TRUE(src.accept(projected));
+    handler.finalize();
+    EXPECT_TRUE(deepEquals(out, src, MemberOrder::SENSITIVE));
+    
+    Projection none;
+    DynamicDocument empty;
+    auto handler2 = empty.makeHandler();
+    auto projected2 = makeProjectionHandler(handler2, none);
+    ASSERT_TRUE(src.accept(projected2));
+    handler2.finalize();
+    EXPECT_TRUE(empty.croot().isObject());
+    EXPECT_EQ(empty.croot().objectSize(), 0u);
+  }
+  
+  // Syntax
+  Projection invalid;
+  EXPECT_FALSE(invalid.add("id"));
+  EXPECT_FALSE(invalid.add("/a~2"));
+  EXPECT_TRUE(invalid.add("/a~1b"));
+  EXPECT_NE(invalid.member(invalid.root(), "a/b", 3u), (uint32_t)Projection::NoNode);
+  EXPECT_THROW(Projection({ "/ok", "bad" }), std::invalid_argument);
+}
+
+TEST(Document, RecordFilter)
+{
+  const std::string lines =
+    "{\"level\":\"info\",\"status\":200,\"msg\":\"ok\",\"http\":{\"method\":\"GET\",\"path\":\"/a\"}}\n"
+    "{\"msg\":\"fail {\\\"x\\\"]\",\"level\":\"error\",\"status\":503,\"http\":{\"method\":\"POST\"},\"tags\":[\"a\",\"b\"]}\r\n"
+    "\n"
+    "  {\"level\":\"err\\u006Fr\",\"status\":404.0,\"retry\":true,\"tags\":[\"c\"]}  \n"
+    "{\"level\":\"error\",\"status\":\"500\",\"http\":null}\n"
+    "{\"level\":\"error\"";  // truncated, no status
+    
+  RecordFilter errors;
+  errors.where("/level", FilterOp::EQ, "error");
+  std::vector<std::string> matched;
+  NdjsonStats stats = scanNdjson(lines.data(), lines.size(), errors, [&](const char* line, size_t len) {
+    matched.push_back(std::string(line, len));
+    return true;
+  });
+  EXPECT_EQ(stats.records, 5u);
+  EXPECT_EQ(stats.matched, 4u);  // decided before the truncation
+  ASSERT_EQ(matched.size(), 4u);
+  EXPECT_EQ(matched[1].front(), '{');
+  EXPECT_EQ(matched[1].back(), '}');
+  
+  // Range, stops when the callback returns false
+  RecordFilter range;
+  range.where("/status", FilterOp::GE, 500).where("/status", FilterOp::LT, 600);
+  matched.clear();
+  stats = scanNdjson(lines.data(), lines.size(), range, [&](const char* line, size_t len) {
+    matched.push_back(std::string(line, len));
+    return false;
+  });
+  ASSERT_EQ(matched.size(), 1u);  // "500" is a string, 404.0 is out of range
+  EXPECT_NE(matched[0].find("\"status\":503"), std::string::npos);
+  EXPECT_EQ(stats.records, 2u);
+  EXPECT_EQ(stats.bytes, matched[0].size());
+  EXPECT_EQ(scanNdjson(lines, range).matched, 1u);
+  
+  // Nested paths, array indices, bool, null, exists and type mismatch
+  auto count = [&](const RecordFilter& filter) { return scanNdjson(lines, filter).matched; };
+  EXPECT_EQ(count(RecordFilter().where("/http/method", FilterOp::EQ, "POST")), 1u);
+  EXPECT_EQ(count(RecordFilter().where("/http/method", FilterOp::NE, "POST")), 1u);  // missing fails
+  EXPECT_EQ(count(RecordFilter().where("/tags/1", FilterOp::EQ, "b")), 1u);
+  EXPECT_EQ(count(RecordFilter().where("/tags/0", FilterOp::GT, "a")), 1u);
+  EXPECT_EQ(count(RecordFilter().where("/retry", FilterOp::EQ, true)), 1u);
+  EXPECT_EQ(count(RecordFilter().where("/http", FilterOp::EQ, nullptr)), 1u);
+  EXPECT_EQ(count(RecordFilter().exists("/http")), 3u);
+  EXPECT_EQ(count(RecordFilter().where("/status", FilterOp::NE, 404)), 3u);
+  EXPECT_EQ(count(RecordFilter().where("/status", FilterOp::EQ, "500")), 1u);
+  EXPECT_EQ(count(RecordFilter().where("/msg", FilterOp::EQ, "fail {\"x\"]")), 1u);
+  EXPECT_EQ(count(RecordFilter()), 5u);
+  
+  EXPECT_TRUE(RecordFilter().where("", FilterOp::EQ, 3.5).matches(" 3.5 "));
+  EXPECT_FALSE(RecordFilter().where("/a/b", FilterOp::EXISTS, 0).matches("{\"a\":1,\"b\":{\"b\":1}}"));
+  EXPECT_THROW(RecordFilter().where("a", FilterOp::EQ, 1), std::invalid_argument);
+}
+
+TEST(Document, TypeProfile)
+{
+  // Long arrays whose first elements are misleading
+  DynamicDocument raw;
+  {
+    auto rt = raw.root();
+    for (int i = 0; i < 100; ++i)
+      rt["values"][i] = i;
+    rt["values"][100] = 0.5;  // DARRAY
+    for (int i = 0; i < 100; ++i)
+      rt["mixed"][i] = i;
+    rt["mixed"][100] = "end";  // ARRAY
+    rt["flags"][0] = true;
+    rt["ints"][0] = 1;
+    rt["empty"].toArray();
+    rt["nested"]["values"][0] = 2;  // same key
+    rt["nested"]["values"][1] = 3.5;
+  }
+  DynamicDocument src;  // arrays specialized by the Handler
+  {
+    auto handler = src.makeHandler();
+    ASSERT_TRUE(raw.accept(handler));
+    handler.finalize();
+  }
+  ASSERT_TRUE(src.root()["values"].isDArray());
+  ASSERT_TRUE(src.root()["mixed"].isArray());
+  
+  DynamicTypeProfile profile;
+  profile.learn(src.croot());
+  EXPECT_EQ(profile.size(), 4u);
+  EXPECT_EQ(profile.type("values"), JType::DARRAY);
+  EXPECT_EQ(profile.type("mixed"), JType::ARRAY);
+  EXPECT_EQ(profile.type("flags"), JType::BARRAY);
+  EXPECT_EQ(profile.type("ints"), JType::IARRAY);
+  EXPECT_EQ(profile.type("empty"), JType::NUL);
+  
+  // Same Document, arrays started with their final type
+  DynamicDocument doc;
+  {
+    auto handler = doc.makeHandler();
+    handler.setTypeProfile(&profile);
+    ASSERT_TRUE(src.accept(handler));
+    handler.finalize();
+  }
+  EXPECT_TRUE(deepEquals(doc, src, MemberOrder::SENSITIVE));
+  EXPECT_TRUE(doc.root()["values"].isDArray());
+  EXPECT_TRUE(doc.root()["empty"].isArray());
+  
+  // Hinted by key: first element not fitting the hint, stored as usual (ints not turned into doubles)
+  {
+    DynamicDocument ints;
+    ints.root()["values"][0] = (int64_t)(1ll << 53) + 1;
+    ints.root()["nested"]["values"][0] = 1.5;
+    ints.root()["nested"]["values"][1] = 2;
+    DynamicDocument hinted;
+    auto handler = hinted.makeHandler();
+    handler.setTypeProfile(&profile);
+    ASSERT_TRUE(ints.accept(handler));
+    handler.finalize();
+    ASSERT_TRUE(hinted.root()["values"].isIArray());
+    EXPECT_EQ(hinted.root()["values"].iarrayCBegin()[0], (int64_t)(1ll << 53) + 1);
+    ASSERT_TRUE(hinted.root()["nested"]["values"].isDArray());
+    EXPECT_EQ(hinted.root()["nested"]["values"].darrayCBegin()[1], 2.);
+  }
+  
+  // Declared hints, reused by a session across cleared pools
+  DynamicTypeProfile declared;
+  declared.declare("ints", JType::ARRAY);
+  declared.declare("flags", JType::DARRAY);  // not matching: stored as usual
+  DynamicDocument sessionDoc;
+  DynamicParseSession session(sessionDoc);
+  session.setTypeProfile(&declared);
+  for (int pass = 0; pass < 2; ++pass)
+  {
+    auto& handler = session.begin();
+    ASSERT_TRUE(src.accept(handler));
+    session.end();
+    EXPECT_TRUE(sessionDoc.root()["ints"].isArray());
+    EXPECT_EQ(sessionDoc.root()["ints"][0].getInt64(), 1);
+    EXPECT_TRUE(sessionDoc.root()["flags"].isBArray());
+    EXPECT_TRUE(sessionDoc.root()["values"].isDArray());
+  }
+  
+  // Conflicts across documents widen the hint
+  DynamicDocument other;
+  other.root()["ints"][0] = "x";
+  profile.learn(other.croot());
+  EXPECT_EQ(profile.type("ints"), JType::ARRAY);
+  profile.clear();
+  EXPECT_TRUE(profile.empty());
+}
+
+TEST(Document, ProfilingAllocator)
+{
+  using ProfiledDocument = Document<512u, ProfilingAllocator>;
+  ProfiledDocument doc;
+  const ProfilingAllocator& alc = doc.baseAllocator();
+  auto stats = [&alc](AllocOrigin origin) { return alc.stats(origin); };
+  
+  // Many keys (chunks, buckets beyond a chunk), long string and containers beyond a chunk, small object
+  const std::string longStr(600u, 'x');
+  {
+    auto handler = doc.makeHandler();
+    EXPECT_TRUE(handler.startObject());
+    for (uint32_t i = 0u; i < 300u; ++i)
+    {
+      const std::string key = "key_" + std::to_string(i);
+      EXPECT_TRUE(handler.pushKey(key.c_str(), true, (int32_t)key.size()));
+      EXPECT_TRUE(handler.pushInt((int)i));
+    }
+    EXPECT_TRUE(handler.pushKey("long", true));
+    EXPECT_TRUE(handler.pushString(longStr.c_str(), true, (int32_t)longStr.size()));
+    EXPECT_TRUE(handler.pushKey("mixed", true));
+    EXPECT_TRUE(handler.startArray());
+    for (uint32_t i = 0u; i < 200u; ++i)
+      EXPECT_TRUE(i % 2u == 0u ? handler.pushNull() : handler.pushString("short", true));
+    EXPECT_TRUE(handler.endArray(200u));
+    EXPECT_TRUE(handler.pushKey("small", true));
+    EXPECT_TRUE(handler.startObject());
+    EXPECT_TRUE(handler.pushKey("a", true));
+    EXPECT_TRUE(handler.pushBool(true));
+    EXPECT_TRUE(handler.endObject(1u));
+    EXPECT_TRUE(handler.endObject(303u));
+    handler.finalize(false);
+  }
+  EXPECT_EQ(doc.root()["key_299"].getInt64(), 299);
+  
+  const AllocOrigin tagged[] = {
+    AllocOrigin::STRING_CHUNK, AllocOrigin::STRING_BUCKETS, AllocOrigin::STRING_FALLBACK,
+    AllocOrigin::OBJECT_CHUNK, AllocOrigin::OBJECT_FALLBACK, AllocOrigin::CHUNK_TABLE, AllocOrigin::STACK
+  };
+  for (AllocOrigin origin : tagged)
+  {
+    EXPECT_GT(stats(origin).count, 0u) << ProfilingAllocator::name(origin);
+    EXPECT_GT(stats(origin).peak, 0u) << ProfilingAllocator::name(origin);
+  }
+  EXPECT_EQ(stats(AllocOrigin::USER).count, 0u);
+  EXPECT_EQ(stats(AllocOrigin::STACK).allocated, 0u);  // released by finalize
+  
+  // Totals: in use, peak composition, size histograms
+  uint64_t allocated = 0u;
+  uint64_t atPeak = 0u;
+  for (int i = 0; i < ProfilingAllocator::OriginCount; ++i)
+  {
+    const auto& origin = stats((AllocOrigin)i);
+    allocated += origin.allocated;
+    atPeak    += origin.atPeak;
+    EXPECT_LE(origin.atPeak, origin.peak);
+    uint64_t count = 0u;
+    for (uint64_t c : origin.sizes)
+      count += c;
+    EXPECT_EQ(count, origin.count);
+  }
+  EXPECT_EQ(allocated, alc.allocated());
+  EXPECT_EQ(atPeak, alc.peak());
+  EXPECT_EQ(alc.allocated(), doc.stringPool()->footprint() + doc.objectAllocator().footprint());
+  EXPECT_EQ(stats(AllocOrigin::STRING_CHUNK).sizes[ProfilingAllocator::sizeClass(512u)], stats(AllocOrigin::STRING_CHUNK).count);
+  
+  // Untagged requests
+  char* mem = doc.baseAllocator().allocate(100u);
+  EXPECT_EQ(stats(AllocOrigin::USER).allocated, 100u);
+  doc.baseAllocator().deallocate(mem, 100u);
+  EXPECT_EQ(stats(AllocOrigin::USER).allocated, 0u);
+  EXPECT_EQ(stats(AllocOrigin::USER).count, 1u);
+  
+  // Restart from memory in use
+  doc.baseAllocator().resetStats();
+  EXPECT_EQ(alc.peak(), alc.allocated());
+  EXPECT_EQ(stats(AllocOrigin::STACK).count, 0u);
+  doc.clear();
+  doc.shrink();
+  EXPECT_EQ(alc.allocated(), stats(AllocOrigin::STRING_FALLBACK).allocated);  // empty placeholders (alt scheme)
+}